@@ -19,8 +19,36 @@ struct BroadwayOutput {
   GString *buf;
   int error;
   guint32 serial;
+
+  /* Frame pacing */
+  guint32 sent_frame;
+  guint32 acked_frame;
+
+  /* Tiles the client has cached, and which texture uses which */
+  GHashTable *tiles;    /* BroadwayTile set */
+  GHashTable *textures; /* id -> GArray of tile hashes */
 };
 
+typedef struct {
+  guint64 hash;
+  guint refcount;
+} BroadwayTile;
+
+static guint
+broadway_tile_hash (gconstpointer key)
+{
+  const BroadwayTile *tile = key;
+
+  return (guint) (tile->hash ^ (tile->hash >> 32));
+}
+
+static gboolean
+broadway_tile_equal (gconstpointer a,
+                     gconstpointer b)
+{
+  return ((const BroadwayTile *) a)->hash == ((const BroadwayTile *) b)->hash;
+}
+
 static void
 broadway_output_send_cmd (BroadwayOutput *output,
                           gboolean fin, BroadwayWSOpCode code,
@@ -84,6 +112,10 @@ broadway_output_new (GOutputStream *out, guint32 serial)
   output->out = g_object_ref (out);
   output->buf = g_string_new ("");
   output->serial = serial;
+  output->tiles = g_hash_table_new_full (broadway_tile_hash, broadway_tile_equal,
+                                         g_free, NULL);
+  output->textures = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                            NULL, (GDestroyNotify) g_array_unref);
 
   return output;
 }
@@ -92,6 +124,8 @@ void
 broadway_output_free (BroadwayOutput *output)
 {
   g_object_unref (output->out);
+  g_hash_table_destroy (output->textures);
+  g_hash_table_destroy (output->tiles);
   free (output);
 }
 
@@ -261,6 +295,32 @@ broadway_output_roundtrip (BroadwayOutput *output,
   append_uint32 (output, tag);
 }
 
+/* The client acks this once everything before it is on screen */
+void
+broadway_output_frame (BroadwayOutput *output)
+{
+  write_header (output, BROADWAY_OP_FRAME);
+  append_uint32 (output, ++output->sent_frame);
+}
+
+void
+broadway_output_ack_frame (BroadwayOutput *output,
+                           guint32         serial)
+{
+  /* Ignore acks for frames that were never sent, they would
+   * make the frames in flight wrap around */
+  if (serial - output->acked_frame > output->sent_frame - output->acked_frame)
+    return;
+
+  output->acked_frame = serial;
+}
+
+guint32
+broadway_output_get_frames_in_flight (BroadwayOutput *output)
+{
+  return output->sent_frame - output->acked_frame;
+}
+
 void
 broadway_output_set_show_keyboard (BroadwayOutput *output,
                                    gboolean show)
@@ -316,7 +376,7 @@ static void
 append_type (BroadwayOutput *output, guint32 type, BroadwayNode *node)
 {
 #ifdef DEBUG_NODE_SENDING
-  g_print ("%*s%s(%d/%d)", append_node_depth*2, "", broadway_node_type_names[type], node->id, node->output_id);
+  g_print ("%*s%s(%d)", append_node_depth*2, "", broadway_node_type_names[type], node->id);
   if (type == BROADWAY_NODE_TEXTURE)
     g_print (" tx=%u", node->data[4]);
   g_print ("\n");
@@ -368,12 +428,12 @@ append_node (BroadwayOutput *output,
     {
       broadway_node_mark_deep_consumed (reused_node, TRUE);
       append_type (output, BROADWAY_NODE_REUSE, node);
-      append_uint32 (output, node->output_id);
+      append_uint32 (output, node->id);
     }
   else
     {
       append_type (output, node->type, node);
-      append_uint32 (output, node->output_id);
+      append_uint32 (output, node->id);
       for (i = 0; i < node->n_data; i++)
         append_uint32 (output, node->data[i]);
       for (i = 0; i < node->n_children; i++)
@@ -405,11 +465,11 @@ should_reuse_node (BroadwayOutput *output,
   switch (node->type) {
   case BROADWAY_NODE_TRANSFORM:
 #ifdef DEBUG_NODE_SENDING
-   g_print ("Patching transform node %d/%d\n",
-            old_node->id, old_node->output_id);
+   g_print ("Patching transform node %d\n",
+            old_node->id);
 #endif
     append_uint32 (output, BROADWAY_NODE_OP_PATCH_TRANSFORM);
-    append_uint32 (output, old_node->output_id);
+    append_uint32 (output, old_node->id);
     for (i = 0; i < node->n_data; i++)
       append_uint32 (output, node->data[i]);
     return TRUE;
@@ -423,12 +483,12 @@ should_reuse_node (BroadwayOutput *output,
     new_texture = node->data[4];
 
 #ifdef DEBUG_NODE_SENDING
-   g_print ("Patching texture node %d/%d to tx=%d\n",
-            old_node->id, old_node->output_id,
+   g_print ("Patching texture node %d to tx=%d\n",
+            old_node->id,
             new_texture);
 #endif
     append_uint32 (output, BROADWAY_NODE_OP_PATCH_TEXTURE);
-    append_uint32 (output, old_node->output_id);
+    append_uint32 (output, old_node->id);
     append_uint32 (output, new_texture);
     return TRUE;
     break;
@@ -470,17 +530,15 @@ append_node_ops (BroadwayOutput *output,
           /* We can reuse it, bu it comes from a different place or
              order, if so we need to move it in place */
 #ifdef DEBUG_NODE_SENDING
-          g_print ("Move old node %d/%d to parent %d/%d after %d/%d\n",
-                   reused_node->id, reused_node->output_id,
+          g_print ("Move old node %d to parent %d after %d\n",
+                   reused_node->id,
                    parent ? parent->id : 0,
-                   parent ? parent->output_id : 0,
-                   previous_sibling ? previous_sibling->id : 0,
-                   previous_sibling ? previous_sibling->output_id : 0);
+                   previous_sibling ? previous_sibling->id : 0);
 #endif
           append_uint32 (output, BROADWAY_NODE_OP_MOVE_AFTER_CHILD);
-          append_uint32 (output, parent ? parent->output_id : 0);
-          append_uint32 (output, previous_sibling ? previous_sibling->output_id : 0);
-          append_uint32 (output, reused_node->output_id);
+          append_uint32 (output, parent ? parent->id : 0);
+          append_uint32 (output, previous_sibling ? previous_sibling->id : 0);
+          append_uint32 (output, reused_node->id);
         }
 
       return reused_node;
@@ -498,8 +556,16 @@ append_node_ops (BroadwayOutput *output,
 
       old_node->consumed = TRUE; // Don't reuse again
 
-      // We rewrite this new node as it now represents the old node in the browser
-      node->output_id = old_node->output_id;
+      /* The browser knows the old node by its old id, so rename it */
+      if (node->id != old_node->id)
+        {
+#ifdef DEBUG_NODE_SENDING
+          g_print ("Rename node %d to %d\n", old_node->id, node->id);
+#endif
+          append_uint32 (output, BROADWAY_NODE_OP_RENAME_NODE);
+          append_uint32 (output, old_node->id);
+          append_uint32 (output, node->id);
+        }
 
       /* However, we might need to rewrite then children of old_node */
       for (i = 0; i < node->n_children; i++)
@@ -526,15 +592,13 @@ append_node_ops (BroadwayOutput *output,
 
   /* Fallback to create a new tree */
 #ifdef DEBUG_NODE_SENDING
-   g_print ("Insert nodes in parent %d/%d, after sibling %d/%d\n",
+   g_print ("Insert nodes in parent %d, after sibling %d\n",
             parent ? parent->id : 0,
-            parent ? parent->output_id : 0,
-            previous_sibling ? previous_sibling->id : 0,
-            previous_sibling ? previous_sibling->output_id : 0);
+            previous_sibling ? previous_sibling->id : 0);
 #endif
    append_uint32 (output, BROADWAY_NODE_OP_INSERT_NODE);
-   append_uint32 (output, parent ? parent->output_id : 0);
-   append_uint32 (output, previous_sibling ? previous_sibling->output_id : 0);
+   append_uint32 (output, parent ? parent->id : 0);
+   append_uint32 (output, previous_sibling ? previous_sibling->id : 0);
 
    append_node(output, node, old_node_lookup);
 
@@ -550,11 +614,11 @@ append_node_removes (BroadwayOutput *output,
   if (!node->consumed)
     {
 #ifdef DEBUG_NODE_SENDING_REMOVE
-          g_print ("Remove old node non-consumed node %d/%d\n",
-                   node->id, node->output_id);
+          g_print ("Remove old node non-consumed node %d\n",
+                   node->id);
 #endif
       append_uint32 (output, BROADWAY_NODE_OP_REMOVE_NODE);
-      append_uint32 (output, node->output_id);
+      append_uint32 (output, node->id);
     }
 
   for (int i = 0; i < node->n_children; i++)
@@ -599,22 +663,280 @@ broadway_output_surface_set_nodes (BroadwayOutput *output,
   patch_uint32 (output, (end - start) / 4, size_pos);
 }
 
+static gboolean
+tile_is_solid (const guchar *data,
+               gsize         stride,
+               guint         width,
+               guint         height)
+{
+  guint32 pixel = *(const guint32 *) data;
+  guint x, y;
+
+  for (y = 0; y < height; y++)
+    {
+      const guint32 *row = (const guint32 *) (data + y * stride);
+
+      for (x = 0; x < width; x++)
+        if (row[x] != pixel)
+          return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Cairo uses premultiplied ARGB in native endianness, the
+ * client wants non-premultiplied RGBA bytes */
+static inline void
+unpremultiply_pixel (guint32  pixel,
+                     guchar  *out)
+{
+  guint a = pixel >> 24;
+
+  if (a == 0)
+    {
+      out[0] = out[1] = out[2] = out[3] = 0;
+      return;
+    }
+
+  out[0] = (((pixel >> 16) & 0xff) * 255 + a / 2) / a;
+  out[1] = (((pixel >> 8) & 0xff) * 255 + a / 2) / a;
+  out[2] = ((pixel & 0xff) * 255 + a / 2) / a;
+  out[3] = a;
+}
+
+static gsize
+compress_tile (const guchar *data,
+               gsize         size,
+               guchar       *out,
+               gsize         max_size)
+{
+  GConverter *compressor;
+  GConverterResult result;
+  gsize in_pos, out_pos, bytes_read, bytes_written;
+
+  /* Level 1: on a LAN, encode time matters more than the last few bytes */
+  compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB, 1));
+  in_pos = out_pos = 0;
+
+  do
+    {
+      if (out_pos == max_size)
+        {
+          result = G_CONVERTER_ERROR;
+          break;
+        }
+
+      result = g_converter_convert (compressor,
+                                    data + in_pos, size - in_pos,
+                                    out + out_pos, max_size - out_pos,
+                                    G_CONVERTER_INPUT_AT_END,
+                                    &bytes_read, &bytes_written,
+                                    NULL);
+      in_pos += bytes_read;
+      out_pos += bytes_written;
+    }
+  while (result == G_CONVERTER_CONVERTED);
+
+  g_object_unref (compressor);
+
+  return result == G_CONVERTER_FINISHED ? out_pos : 0;
+}
+
+static void
+encode_tile (BroadwayEncodedTile *tile,
+             const guchar        *data,
+             gsize                stride,
+             guint                width,
+             guint                height)
+{
+  guchar rgba[BROADWAY_TILE_SIZE * BROADWAY_TILE_SIZE * 4];
+  guchar compressed[BROADWAY_TILE_SIZE * BROADWAY_TILE_SIZE * 4];
+  gsize size, compressed_size;
+  guint x, y;
+
+  if (tile_is_solid (data, stride, width, height))
+    {
+      tile->encoding = BROADWAY_TILE_SOLID;
+      unpremultiply_pixel (*(const guint32 *) data, rgba);
+      tile->data = g_bytes_new (rgba, 4);
+      return;
+    }
+
+  tile->hash = broadway_hash_pixels (data, stride, width, height);
+
+  for (y = 0; y < height; y++)
+    {
+      const guint32 *row = (const guint32 *) (data + y * stride);
+
+      for (x = 0; x < width; x++)
+        unpremultiply_pixel (row[x], rgba + (y * width + x) * 4);
+    }
+
+  size = width * height * 4;
+  /* Only worth it if it saves at least a quarter */
+  compressed_size = compress_tile (rgba, size, compressed, size - size / 4);
+
+  if (compressed_size)
+    {
+      tile->encoding = BROADWAY_TILE_ZLIB;
+      tile->data = g_bytes_new (compressed, compressed_size);
+    }
+  else
+    {
+      tile->encoding = BROADWAY_TILE_RAW;
+      tile->data = g_bytes_new (rgba, size);
+    }
+}
+
+/* Textures are split into tiles and encoded once, no matter how many
+ * outputs they are sent to. */
+BroadwayEncodedTexture *
+broadway_encoded_texture_new (GBytes *texture)
+{
+  const BroadwayTextureHeader *header;
+  BroadwayEncodedTexture *encoded;
+  const guchar *data;
+  gsize size, stride;
+  guint x, y, i;
+
+  data = g_bytes_get_data (texture, &size);
+  header = (const BroadwayTextureHeader *) data;
+
+  encoded = g_new0 (BroadwayEncodedTexture, 1);
+
+  if (size < sizeof (BroadwayTextureHeader) ||
+      (size - sizeof (BroadwayTextureHeader)) / 4 / MAX (header->width, 1) < header->height)
+    {
+      g_warning ("Invalid texture data");
+      return encoded;
+    }
+
+  encoded->width = header->width;
+  encoded->height = header->height;
+  encoded->n_tiles = ((header->width + BROADWAY_TILE_SIZE - 1) / BROADWAY_TILE_SIZE) *
+                     ((header->height + BROADWAY_TILE_SIZE - 1) / BROADWAY_TILE_SIZE);
+  encoded->tiles = g_new0 (BroadwayEncodedTile, encoded->n_tiles);
+
+  data += sizeof (BroadwayTextureHeader);
+  stride = header->width * 4;
+
+  i = 0;
+  for (y = 0; y < header->height; y += BROADWAY_TILE_SIZE)
+    for (x = 0; x < header->width; x += BROADWAY_TILE_SIZE)
+      encode_tile (&encoded->tiles[i++],
+                   data + y * stride + x * 4, stride,
+                   MIN (BROADWAY_TILE_SIZE, header->width - x),
+                   MIN (BROADWAY_TILE_SIZE, header->height - y));
+
+  return encoded;
+}
+
+void
+broadway_encoded_texture_free (BroadwayEncodedTexture *encoded)
+{
+  guint i;
+
+  for (i = 0; i < encoded->n_tiles; i++)
+    g_bytes_unref (encoded->tiles[i].data);
+
+  g_free (encoded->tiles);
+  g_free (encoded);
+}
+
+/* Tiles the client already has from another texture are only
+ * referenced by their hash. This makes small changes to large
+ * fallback surfaces cheap. */
 void
-broadway_output_upload_texture (BroadwayOutput *output,
-                                guint32 id,
-                                GBytes *texture)
+broadway_output_upload_texture (BroadwayOutput               *output,
+                                guint32                       id,
+                                const BroadwayEncodedTexture *texture)
 {
-  gsize len = g_bytes_get_size (texture);
+  GArray *tile_hashes;
+  guint i;
+
   write_header (output, BROADWAY_OP_UPLOAD_TEXTURE);
   append_uint32 (output, id);
-  append_uint32 (output, (guint32)len);
-  g_string_append_len (output->buf, g_bytes_get_data (texture, NULL), len);
+  append_uint32 (output, texture->width);
+  append_uint32 (output, texture->height);
+
+  tile_hashes = g_array_new (FALSE, FALSE, sizeof (guint64));
+
+  for (i = 0; i < texture->n_tiles; i++)
+    {
+      const BroadwayEncodedTile *encoded = &texture->tiles[i];
+      BroadwayTile key, *tile;
+      gconstpointer data;
+      gsize size;
+
+      data = g_bytes_get_data (encoded->data, &size);
+
+      if (encoded->encoding == BROADWAY_TILE_SOLID)
+        {
+          append_uint8 (output, BROADWAY_TILE_SOLID);
+          g_string_append_len (output->buf, data, size);
+          continue;
+        }
+
+      key.hash = encoded->hash;
+      g_array_append_val (tile_hashes, key.hash);
+
+      tile = g_hash_table_lookup (output->tiles, &key);
+      if (tile)
+        {
+          tile->refcount++;
+          append_uint8 (output, BROADWAY_TILE_CACHED);
+          append_uint32 (output, key.hash & 0xffffffff);
+          append_uint32 (output, key.hash >> 32);
+          continue;
+        }
+
+      tile = g_new (BroadwayTile, 1);
+      tile->hash = key.hash;
+      tile->refcount = 1;
+      g_hash_table_add (output->tiles, tile);
+
+      append_uint8 (output, encoded->encoding);
+      append_uint32 (output, key.hash & 0xffffffff);
+      append_uint32 (output, key.hash >> 32);
+      append_uint32 (output, size);
+      g_string_append_len (output->buf, data, size);
+    }
+
+  g_hash_table_replace (output->textures, GUINT_TO_POINTER (id), tile_hashes);
+}
+
+gboolean
+broadway_output_has_texture (BroadwayOutput *output,
+                             guint32         id)
+{
+  return g_hash_table_contains (output->textures, GUINT_TO_POINTER (id));
 }
 
 void
 broadway_output_release_texture (BroadwayOutput *output,
                                  guint32 id)
 {
+  GArray *tile_hashes;
+  guint i;
+
+  tile_hashes = g_hash_table_lookup (output->textures, GUINT_TO_POINTER (id));
+  if (tile_hashes == NULL)
+    return;
+
   write_header (output, BROADWAY_OP_RELEASE_TEXTURE);
   append_uint32 (output, id);
+
+  /* The client drops its tile references the same way */
+
+  for (i = 0; i < tile_hashes->len; i++)
+    {
+      BroadwayTile key, *tile;
+
+      key.hash = g_array_index (tile_hashes, guint64, i);
+      tile = g_hash_table_lookup (output->tiles, &key);
+      if (tile && --tile->refcount == 0)
+        g_hash_table_remove (output->tiles, tile);
+    }
+
+  g_hash_table_remove (output->textures, GUINT_TO_POINTER (id));
 }
@@ -8,6 +8,19 @@
 
 typedef struct BroadwayOutput BroadwayOutput;
 
+typedef struct {
+  guint64 hash;      /* Unused for solid tiles */
+  guint8 encoding;   /* A BroadwayTileEncoding */
+  GBytes *data;      /* RGBA bytes, possibly compressed */
+} BroadwayEncodedTile;
+
+typedef struct {
+  guint32 width;
+  guint32 height;
+  guint n_tiles;
+  BroadwayEncodedTile *tiles;
+} BroadwayEncodedTexture;
+
 typedef enum {
   BROADWAY_WS_CONTINUATION = 0,
   BROADWAY_WS_TEXT = 1,
@@ -45,6 +58,10 @@ void            broadway_output_destroy_surface     (BroadwayOutput *output,
 void            broadway_output_roundtrip           (BroadwayOutput *output,
                                                      int             id,
                                                      guint32         tag);
+void            broadway_output_frame               (BroadwayOutput *output);
+void            broadway_output_ack_frame           (BroadwayOutput *output,
+                                                     guint32         serial);
+guint32         broadway_output_get_frames_in_flight (BroadwayOutput *output);
 void            broadway_output_move_resize_surface (BroadwayOutput *output,
                                                      int             id,
                                                      gboolean        has_pos,
@@ -63,7 +80,9 @@ void            broadway_output_surface_set_nodes   (BroadwayOutput *output,
                                                      GHashTable     *old_node_lookup);
 void            broadway_output_upload_texture      (BroadwayOutput *output,
                                                      guint32         id,
-                                                     GBytes         *texture);
+                                                     const BroadwayEncodedTexture *texture);
+gboolean        broadway_output_has_texture         (BroadwayOutput *output,
+                                                     guint32         id);
 void            broadway_output_release_texture     (BroadwayOutput *output,
                                                      guint32         id);
 void            broadway_output_grab_pointer        (BroadwayOutput *output,
@@ -74,4 +93,7 @@ void            broadway_output_pong                (BroadwayOutput *output);
 void            broadway_output_set_show_keyboard   (BroadwayOutput *output,
                                                      gboolean        show);
 
+BroadwayEncodedTexture *broadway_encoded_texture_new  (GBytes                 *texture);
+void                    broadway_encoded_texture_free (BroadwayEncodedTexture *encoded);
+
 #endif /* __BROADWAY_H__ */
@@ -31,8 +31,20 @@ typedef enum { /* Sync changes with broadway.js */
   BROADWAY_NODE_OP_MOVE_AFTER_CHILD = 2,
   BROADWAY_NODE_OP_PATCH_TEXTURE = 3,
   BROADWAY_NODE_OP_PATCH_TRANSFORM = 4,
+  BROADWAY_NODE_OP_RENAME_NODE = 5,
 } BroadwayNodeOpType;
 
+/* Textures are sent to the client in tiles of this size, so that
+ * tiles that did not change since an earlier texture are not sent again */
+#define BROADWAY_TILE_SIZE 64
+
+typedef enum { /* Sync changes with broadway.js */
+  BROADWAY_TILE_CACHED = 0,
+  BROADWAY_TILE_RAW = 1,
+  BROADWAY_TILE_ZLIB = 2,
+  BROADWAY_TILE_SOLID = 3,
+} BroadwayTileEncoding;
+
 static const char *broadway_node_type_names[] G_GNUC_UNUSED =  {
   "TEXTURE",
   "CONTAINER",
@@ -66,6 +78,7 @@ typedef enum {
   BROADWAY_EVENT_SCREEN_SIZE_CHANGED = 12,
   BROADWAY_EVENT_FOCUS = 13,
   BROADWAY_EVENT_ROUNDTRIP_NOTIFY = 14,
+  BROADWAY_EVENT_FRAME_ACK = 15,
 } BroadwayEventType;
 
 typedef enum {
@@ -86,6 +99,7 @@ typedef enum {
   BROADWAY_OP_RELEASE_TEXTURE = 14,
   BROADWAY_OP_SET_NODES = 15,
   BROADWAY_OP_ROUNDTRIP = 16,
+  BROADWAY_OP_FRAME = 17,
 } BroadwayOpType;
 
 typedef struct {
@@ -245,6 +259,44 @@ typedef struct {
   guint32 size;
 } BroadwayRequestUploadTexture;
 
+/* The data of an upload is this header followed by the pixels in
+ * CAIRO_FORMAT_ARGB32, with a stride of 4 * width */
+typedef struct {
+  guint32 width;
+  guint32 height;
+} BroadwayTextureHeader;
+
+/* Hashes ARGB32 pixels with FNV-1a and a final mix. The server uses
+ * it to find textures and tiles with the same pixels. Equal hashes
+ * don't guarantee equal pixels, textures are compared before they are
+ * shared.
+ */
+static inline guint64
+broadway_hash_pixels (const guchar *data,
+                      gsize         stride,
+                      guint         width,
+                      guint         height)
+{
+  guint64 hash = 0xcbf29ce484222325ull;
+  guint x, y;
+
+  hash = (hash ^ width) * 0x100000001b3ull;
+  hash = (hash ^ height) * 0x100000001b3ull;
+  for (y = 0; y < height; y++)
+    {
+      const guint32 *row = (const guint32 *) (data + y * stride);
+
+      for (x = 0; x < width; x++)
+        hash = (hash ^ row[x]) * 0x100000001b3ull;
+    }
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+
+  return hash;
+}
+
 typedef struct {
   BroadwayRequestBase base;
   guint32 id;
@@ -39,8 +39,13 @@
 typedef struct {
   int id;
   guint32 tag;
+  gboolean sent; /* FALSE while waiting for the surface nodes to be sent */
 } BroadwayOutstandingRoundtrip;
 
+/* How many frames we send before waiting for the client to display
+ * them. Updates in the meantime are coalesced. */
+#define MAX_FRAMES_IN_FLIGHT 2
+
 typedef struct BroadwayInput BroadwayInput;
 typedef struct BroadwaySurface BroadwaySurface;
 struct _BroadwayServer {
@@ -67,6 +72,7 @@ struct _BroadwayServer {
 
   guint32 next_texture_id;
   GHashTable *textures;
+  GHashTable *texture_contents; /* content hash -> BroadwayTexture */
 
   guint32 screen_scale;
 
@@ -88,6 +94,11 @@ struct _BroadwayServer {
   int future_mouse_in_surface;
 
   GList *outstanding_roundtrips;
+
+  /* Read-only clients, mirroring the display */
+  GList *viewers;
+  /* The output of the controlling client and those of the viewers */
+  GPtrArray *outputs;
 };
 
 struct _BroadwayServerClass
@@ -112,6 +123,7 @@ struct BroadwayInput {
   gboolean seen_time;
   gint64 time_base;
   gboolean active;
+  gboolean viewer;
 };
 
 struct BroadwaySurface {
@@ -124,17 +136,28 @@ struct BroadwaySurface {
   gboolean visible;
   gint32 transient_for;
   guint32 texture;
-  BroadwayNode *nodes;
+  BroadwayNode *nodes; /* Latest from the app */
   GHashTable *node_lookup;
+  GHashTable *sent; /* BroadwayOutput -> BroadwaySentNodes */
 };
 
+/* The nodes of a surface that one output has */
+typedef struct {
+  BroadwayNode *nodes;
+  GHashTable *node_lookup;
+} BroadwaySentNodes;
+
 struct _BroadwayTexture {
   grefcount refcount;
   guint32 id;
-  GBytes *bytes;
+  guint64 hash; /* Of the pixels, 0 if invalid */
+  GBytes *bytes; /* Kept to compare new uploads with the same hash */
+  BroadwayEncodedTexture *encoded;
 };
 
-static void broadway_server_resync_surfaces (BroadwayServer *server);
+static void broadway_server_resync_output (BroadwayServer *server,
+                                           BroadwayOutput *output);
+static void broadway_server_send_pending_nodes (BroadwayServer *server);
 static void send_outstanding_roundtrips (BroadwayServer *server);
 
 static void broadway_server_ref_texture (BroadwayServer   *server,
@@ -147,7 +170,8 @@ G_DEFINE_TYPE (BroadwayServer, broadway_server, G_TYPE_OBJECT)
 static void
 broadway_texture_free (BroadwayTexture *texture)
 {
-  g_bytes_unref (texture->bytes);
+  g_clear_pointer (&texture->bytes, g_bytes_unref);
+  g_clear_pointer (&texture->encoded, broadway_encoded_texture_free);
   g_free (texture);
 }
 
@@ -264,6 +288,8 @@ broadway_server_init (BroadwayServer *server)
   server->id_counter = 0;
   server->textures = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
                                             (GDestroyNotify)broadway_texture_free);
+  server->texture_contents = g_hash_table_new (g_int64_hash, g_int64_equal);
+  server->outputs = g_ptr_array_new ();
 
   root = g_new0 (BroadwaySurface, 1);
   root->id = server->id_counter++;
@@ -287,7 +313,9 @@ broadway_server_finalize (GObject *object)
   g_free (server->address);
   g_free (server->ssl_cert);
   g_free (server->ssl_key);
+  g_hash_table_destroy (server->texture_contents);
   g_hash_table_destroy (server->textures);
+  g_ptr_array_unref (server->outputs);
 
   G_OBJECT_CLASS (broadway_server_parent_class)->finalize (object);
 }
@@ -300,16 +328,93 @@ broadway_server_class_init (BroadwayServerClass * class)
   object_class->finalize = broadway_server_finalize;
 }
 
+static void
+broadway_sent_nodes_free (BroadwayServer    *server,
+                          BroadwaySentNodes *sent)
+{
+  broadway_node_unref (server, sent->nodes);
+  g_hash_table_unref (sent->node_lookup);
+  g_free (sent);
+}
+
 static void
 broadway_surface_free (BroadwayServer *server,
                        BroadwaySurface *surface)
 {
+  GHashTableIter iter;
+  gpointer value;
+
   if (surface->nodes)
     broadway_node_unref (server, surface->nodes);
+  g_hash_table_iter_init (&iter, surface->sent);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    broadway_sent_nodes_free (server, value);
+  g_hash_table_unref (surface->sent);
   g_hash_table_unref (surface->node_lookup);
   g_free (surface);
 }
 
+static void
+broadway_server_add_output (BroadwayServer *server,
+                            BroadwayOutput *output)
+{
+  g_ptr_array_add (server->outputs, output);
+}
+
+/* Forgets everything about the output, and frees it */
+static void
+broadway_server_remove_output (BroadwayServer *server,
+                               BroadwayOutput *output)
+{
+  GList *l;
+
+  g_ptr_array_remove (server->outputs, output);
+
+  for (l = server->surfaces; l != NULL; l = l->next)
+    {
+      BroadwaySurface *surface = l->data;
+      BroadwaySentNodes *sent;
+
+      sent = g_hash_table_lookup (surface->sent, output);
+      if (sent)
+        {
+          g_hash_table_remove (surface->sent, output);
+          broadway_sent_nodes_free (server, sent);
+        }
+    }
+
+  broadway_output_free (output);
+}
+
+/* The output whose frame acks pace the apps */
+static BroadwayOutput *
+broadway_server_get_pacing_output (BroadwayServer *server)
+{
+  GList *l;
+
+  if (server->output)
+    return server->output;
+
+  for (l = server->viewers; l != NULL; l = l->next)
+    {
+      BroadwayInput *viewer = l->data;
+
+      if (viewer->output)
+        return viewer->output;
+    }
+
+  return NULL;
+}
+
+static BroadwayNode *
+get_sent_nodes (BroadwaySurface *surface,
+                BroadwayOutput  *output)
+{
+  BroadwaySentNodes *sent = g_hash_table_lookup (surface->sent, output);
+
+  return sent ? sent->nodes : NULL;
+}
+
 static BroadwaySurface *
 broadway_server_lookup_surface (BroadwayServer   *server,
                                 guint32           id)
@@ -319,6 +424,9 @@ broadway_server_lookup_surface (BroadwayServer   *server,
 }
 
 static void start (BroadwayInput *input);
+static void start_viewer (BroadwayInput *input);
+static void broadway_server_remove_viewer (BroadwayServer *server,
+                                           BroadwayInput  *viewer);
 
 static void
 http_request_free (HttpRequest *request)
@@ -626,6 +734,36 @@ parse_input_message (BroadwayInput *input, const unsigned char *message)
 
   time_ = ntohl (*p++);
 
+  if (msg.base.type == BROADWAY_EVENT_FRAME_ACK)
+    {
+      /* Not an event, this paces the output of this client */
+      if (input->output)
+        {
+          broadway_output_ack_frame (input->output, ntohl (*p++));
+          broadway_server_send_pending_nodes (server);
+          broadway_server_flush (server);
+        }
+      return;
+    }
+
+  /* Roundtrips are only sent to the pacing output. When another
+   * client takes over pacing, the ones that are still out are answered
+   * right away, so late answers from the old one would be duplicates */
+  if (msg.base.type == BROADWAY_EVENT_ROUNDTRIP_NOTIFY &&
+      (input->output == NULL ||
+       input->output != broadway_server_get_pacing_output (server)))
+    return;
+
+  if (input->viewer)
+    {
+      /* Viewers are read-only, but answer the roundtrips sent to
+       * them while they were pacing the apps */
+      if (msg.base.type != BROADWAY_EVENT_ROUNDTRIP_NOTIFY)
+        return;
+
+      time_ = 0;
+    }
+
   if (time_ == 0) {
     time_ = server->last_seen_time;
   } else {
@@ -841,7 +979,8 @@ parse_input (BroadwayInput *input)
           }
         break;
       case BROADWAY_WS_CNX_PING:
-        broadway_output_pong (input->output);
+        if (input->output)
+          broadway_output_pong (input->output);
         break;
       case BROADWAY_WS_CNX_PONG:
         break; /* we never send pings, but tolerate pongs */
@@ -902,10 +1041,25 @@ broadway_server_read_all_input_nonblocking (BroadwayInput *input)
 
       if (input->server->input == input)
         {
-          send_outstanding_roundtrips (input->server);
-
-          input->server->input = NULL;
+          BroadwayServer *server = input->server;
+
+          /* The output of a closed client never acks another frame,
+           * so stop pacing on it, or the roundtrips that wait for it
+           * never get answered */
+          if (server->output == input->output && server->output)
+            {
+              server->saved_serial = broadway_output_get_next_serial (server->output);
+              broadway_server_remove_output (server, server->output);
+              server->output = NULL;
+            }
+          input->output = NULL;
+
+          send_outstanding_roundtrips (server);
+
+          server->input = NULL;
         }
+      else if (input->viewer)
+        broadway_server_remove_viewer (input->server, input);
       broadway_input_free (input);
       if (res < 0)
         {
@@ -986,32 +1140,81 @@ broadway_server_fake_roundtrip_reply (BroadwayServer *server,
   queue_process_input_at_idle (server);
 }
 
+/* Drops the output of the viewer, the input goes away once
+ * the connection is closed */
+static void
+broadway_server_drop_viewer_output (BroadwayServer *server,
+                                    BroadwayInput  *viewer)
+{
+  gboolean was_pacing;
+
+  was_pacing = viewer->output == broadway_server_get_pacing_output (server);
+
+  broadway_server_remove_output (server, viewer->output);
+  viewer->output = NULL;
+
+  if (was_pacing)
+    send_outstanding_roundtrips (server);
+}
+
+static void
+broadway_server_remove_viewer (BroadwayServer *server,
+                               BroadwayInput  *viewer)
+{
+  if (viewer->output)
+    broadway_server_drop_viewer_output (server, viewer);
+
+  server->viewers = g_list_remove (server->viewers, viewer);
+}
+
 void
 broadway_server_flush (BroadwayServer *server)
 {
+  GList *l;
+
   if (server->output &&
       !broadway_output_flush (server->output))
     {
       server->saved_serial = broadway_output_get_next_serial (server->output);
-      broadway_output_free (server->output);
+      broadway_server_remove_output (server, server->output);
       server->output = NULL;
+      if (server->input)
+        server->input->output = NULL;
       send_outstanding_roundtrips (server);
     }
+
+  for (l = server->viewers; l != NULL; l = l->next)
+    {
+      BroadwayInput *viewer = l->data;
+
+      if (viewer->output &&
+          !broadway_output_flush (viewer->output))
+        broadway_server_drop_viewer_output (server, viewer);
+    }
 }
 
+/* The app waits for the roundtrip after each frame, so by holding it
+ * back until the frame is sent, the frame clock of the app follows
+ * the frame acks of the client. */
 void
 broadway_server_roundtrip (BroadwayServer *server,
                            int             id,
                            guint32         tag)
 {
-  if (server->output)
+  BroadwayOutput *output = broadway_server_get_pacing_output (server);
+
+  if (output)
     {
+      BroadwaySurface *surface = broadway_server_lookup_surface (server, id);
       BroadwayOutstandingRoundtrip *rt = g_new0 (BroadwayOutstandingRoundtrip, 1);
       rt->id = id;
       rt->tag = tag;
+      rt->sent = surface == NULL || surface->id == 0 ||
+                 surface->nodes == get_sent_nodes (surface, output);
       server->outstanding_roundtrips = g_list_prepend (server->outstanding_roundtrips, rt);
 
-      broadway_output_roundtrip (server->output, id, tag);
+      if (rt->sent)
+        broadway_output_roundtrip (output, id, tag);
     }
   else
     broadway_server_fake_roundtrip_reply (server, id, tag);
@@ -1083,7 +1286,8 @@ generate_handshake_response_wsietf_v7 (const char *key)
 }
 
 static void
-start_input (HttpRequest *request)
+start_input (HttpRequest *request,
+             gboolean     viewer)
 {
   char **lines;
   const char *p;
@@ -1162,6 +1366,7 @@ start_input (HttpRequest *request)
   input = g_new0 (BroadwayInput, 1);
   input->server = request->server;
   input->connection = g_object_ref (request->connection);
+  input->viewer = viewer;
 
   data_buffer = g_buffered_input_stream_peek_buffer (G_BUFFERED_INPUT_STREAM (request->data), &data_buffer_size);
   input->buffer = g_byte_array_sized_new (data_buffer_size);
@@ -1179,7 +1384,10 @@ start_input (HttpRequest *request)
   g_source_set_callback (input->source, (GSourceFunc)input_data_cb, input, NULL);
   g_source_attach (input->source, NULL);
 
-  start (input);
+  if (viewer)
+    start_viewer (input);
+  else
+    start (input);
 
   /* Process any data in the pipe already */
   parse_input (input);
@@ -1211,9 +1419,11 @@ start (BroadwayInput *input)
 
   server = BROADWAY_SERVER (input->server);
 
+  /* The new client takes over pacing, also from any viewer */
+  send_outstanding_roundtrips (server);
+
   if (server->output)
     {
-      send_outstanding_roundtrips (server);
       broadway_output_disconnected (server->output);
       broadway_output_flush (server->output);
     }
@@ -1230,14 +1440,15 @@ start (BroadwayInput *input)
   if (server->output)
     {
       server->saved_serial = broadway_output_get_next_serial (server->output);
-      broadway_output_free (server->output);
+      broadway_server_remove_output (server, server->output);
     }
   server->output = input->output;
+  broadway_server_add_output (server, server->output);
 
   broadway_output_set_next_serial (server->output, server->saved_serial);
   broadway_output_flush (server->output);
 
-  broadway_server_resync_surfaces (server);
+  broadway_server_resync_output (server, server->output);
 
   if (server->pointer_grab_surface_id != -1)
     broadway_output_grab_pointer (server->output,
@@ -1247,6 +1458,21 @@ start (BroadwayInput *input)
   process_input_messages (server);
 }
 
+/* Viewers get the same display as the controlling client, but
+ * their input is ignored */
+static void
+start_viewer (BroadwayInput *input)
+{
+  BroadwayServer *server = input->server;
+
+  input->active = TRUE;
+
+  server->viewers = g_list_append (server->viewers, input);
+  broadway_server_add_output (server, input->output);
+
+  broadway_server_resync_output (server, input->output);
+}
+
 static void
 send_data (HttpRequest *request,
            const char *mimetype,
@@ -1272,6 +1498,35 @@ send_data (HttpRequest *request,
 #include "clienthtml.h"
 #include "broadwayjs.h"
 
+/* Whether the query string of a request, without the '?', has
+ * the parameter @name, as in "name", "name=..." or "a=b&name"
+ */
+static gboolean
+query_has_param (const char *query,
+                 const char *name)
+{
+  char **params;
+  gboolean found = FALSE;
+  int i;
+
+  params = g_strsplit (query, "&", -1);
+  for (i = 0; params[i] != NULL && !found; i++)
+    {
+      char *end, *key;
+
+      end = strchr (params[i], '=');
+      if (end)
+        *end = 0;
+
+      key = g_uri_unescape_string (params[i], NULL);
+      found = key != NULL && strcmp (key, name) == 0;
+      g_free (key);
+    }
+  g_strfreev (params);
+
+  return found;
+}
+
 static void
 got_request (HttpRequest *request)
 {
@@ -1311,7 +1566,7 @@ got_request (HttpRequest *request)
   else if (strcmp (escaped, "/broadway.js") == 0)
     send_data (request, "text/javascript", broadway_js, G_N_ELEMENTS(broadway_js) - 1);
   else if (strcmp (escaped, "/socket") == 0)
-    start_input (request);
+    start_input (request, query != NULL && query_has_param (query + 1, "viewer"));
   else
     send_error (request, 404, "File not found");
 
@@ -1568,6 +1823,8 @@ broadway_server_destroy_surface (BroadwayServer *server,
                                  int id)
 {
   BroadwaySurface *surface;
+  GList *l, *next;
+  guint i;
 
   if (server->mouse_in_surface_id == id)
     {
@@ -1578,10 +1835,24 @@ broadway_server_destroy_surface (BroadwayServer *server,
   if (server->pointer_grab_surface_id == id)
     server->pointer_grab_surface_id = -1;
 
-  if (server->output)
-    broadway_output_destroy_surface (server->output,
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_destroy_surface (g_ptr_array_index (server->outputs, i),
                                      id);
 
+  /* Roundtrips waiting for nodes of this surface will never be sent */
+  for (l = server->outstanding_roundtrips; l != NULL; l = next)
+    {
+      BroadwayOutstandingRoundtrip *rt = l->data;
+
+      next = l->next;
+      if (rt->id == id && !rt->sent)
+        {
+          broadway_server_fake_roundtrip_reply (server, rt->id, rt->tag);
+          server->outstanding_roundtrips = g_list_delete_link (server->outstanding_roundtrips, l);
+          g_free (rt);
+        }
+    }
+
   surface = broadway_server_lookup_surface (server, id);
   if (surface != NULL)
     {
@@ -1598,6 +1869,7 @@ broadway_server_surface_show (BroadwayServer *server,
 {
   BroadwaySurface *surface;
   gboolean sent = FALSE;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1605,9 +1877,9 @@ broadway_server_surface_show (BroadwayServer *server,
 
   surface->visible = TRUE;
 
-  if (server->output)
+  for (i = 0; i < server->outputs->len; i++)
     {
-      broadway_output_show_surface (server->output, surface->id);
+      broadway_output_show_surface (g_ptr_array_index (server->outputs, i), surface->id);
       sent = TRUE;
     }
 
@@ -1620,6 +1892,7 @@ broadway_server_surface_hide (BroadwayServer *server,
 {
   BroadwaySurface *surface;
   gboolean sent = FALSE;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1636,9 +1909,9 @@ broadway_server_surface_hide (BroadwayServer *server,
   if (server->pointer_grab_surface_id == id)
     server->pointer_grab_surface_id = -1;
 
-  if (server->output)
+  for (i = 0; i < server->outputs->len; i++)
     {
-      broadway_output_hide_surface (server->output, surface->id);
+      broadway_output_hide_surface (g_ptr_array_index (server->outputs, i), surface->id);
       sent = TRUE;
     }
   return sent;
@@ -1649,6 +1922,7 @@ broadway_server_surface_raise (BroadwayServer *server,
                                int id)
 {
   BroadwaySurface *surface;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1657,8 +1931,8 @@ broadway_server_surface_raise (BroadwayServer *server,
   server->surfaces = g_list_remove (server->surfaces, surface);
   server->surfaces = g_list_append (server->surfaces, surface);
 
-  if (server->output)
-    broadway_output_raise_surface (server->output, surface->id);
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_raise_surface (g_ptr_array_index (server->outputs, i), surface->id);
 }
 
 void
@@ -1679,6 +1953,7 @@ broadway_server_surface_lower (BroadwayServer *server,
                                int id)
 {
   BroadwaySurface *surface;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1687,8 +1962,8 @@ broadway_server_surface_lower (BroadwayServer *server,
   server->surfaces = g_list_remove (server->surfaces, surface);
   server->surfaces = g_list_prepend (server->surfaces, surface);
 
-  if (server->output)
-    broadway_output_lower_surface (server->output, surface->id);
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_lower_surface (g_ptr_array_index (server->outputs, i), surface->id);
 }
 
 void
@@ -1696,6 +1971,7 @@ broadway_server_surface_set_transient_for (BroadwayServer *server,
                                            int id, int parent)
 {
   BroadwaySurface *surface;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1703,11 +1979,11 @@ broadway_server_surface_set_transient_for (BroadwayServer *server,
 
   surface->transient_for = parent;
 
-  if (server->output)
-    {
-      broadway_output_set_transient_for (server->output, surface->id, surface->transient_for);
-      broadway_server_flush (server);
-    }
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_set_transient_for (g_ptr_array_index (server->outputs, i),
+                                       surface->id, surface->transient_for);
+
+  broadway_server_flush (server);
 }
 
 gboolean
@@ -1830,7 +2106,6 @@ decode_nodes (BroadwayServer *server,
   g_ref_count_init (&node->refcount);
   node->type = type;
   node->id = id;
-  node->output_id = id;
   node->texture_id = 0;
   node->n_children = n_children;
   node->children = (BroadwayNode **)((char *)node + sizeof(BroadwayNode) + (size - 1) * sizeof(guint32));
@@ -1880,12 +2155,6 @@ broadway_server_surface_update_nodes (BroadwayServer   *server,
 
   root = decode_nodes (server, surface, len, data, client_texture_map, &pos);
 
-  if (server->output != NULL)
-    broadway_output_surface_set_nodes (server->output, surface->id,
-                                       root,
-                                       surface->nodes,
-                                       surface->node_lookup);
-
   if (surface->nodes)
     broadway_node_unref (server, surface->nodes);
 
@@ -1893,25 +2162,180 @@ broadway_server_surface_update_nodes (BroadwayServer   *server,
 
   g_hash_table_remove_all (surface->node_lookup);
   broadway_node_add_to_lookup (root, surface->node_lookup);
+
+  /* If the client is behind this waits for the next frame ack, and
+   * then sends only the latest nodes */
+  broadway_server_send_pending_nodes (server);
+}
+
+static void
+upload_textures (BroadwayServer    *server,
+                 BroadwayOutput    *output,
+                 BroadwaySentNodes *sent,
+                 BroadwayNode      *node)
+{
+  BroadwayTexture *texture;
+
+  /* The client has all textures of the nodes it has */
+  if (sent && g_hash_table_lookup (sent->node_lookup, GINT_TO_POINTER (node->id)) == node)
+    return;
+
+  if (node->texture_id && !broadway_output_has_texture (output, node->texture_id))
+    {
+      texture = g_hash_table_lookup (server->textures, GINT_TO_POINTER (node->texture_id));
+      if (texture)
+        {
+          /* Encoded only once, however many clients are connected */
+          if (texture->encoded == NULL)
+            texture->encoded = broadway_encoded_texture_new (texture->bytes);
+
+          broadway_output_upload_texture (output, texture->id, texture->encoded);
+        }
+    }
+
+  for (int i = 0; i < node->n_children; i++)
+    upload_textures (server, output, sent, node->children[i]);
+}
+
+static void
+send_surface_nodes (BroadwayServer  *server,
+                    BroadwayOutput  *output,
+                    BroadwaySurface *surface)
+{
+  BroadwaySentNodes *sent;
+  GList *l;
+
+  sent = g_hash_table_lookup (surface->sent, output);
+
+  /* Textures are uploaded lazily, so that the ones only used in
+   * coalesced frames are never sent */
+  upload_textures (server, output, sent, surface->nodes);
+
+  broadway_output_surface_set_nodes (output, surface->id,
+                                     surface->nodes,
+                                     sent ? sent->nodes : NULL,
+                                     sent ? sent->node_lookup : NULL);
+
+  if (sent == NULL)
+    {
+      sent = g_new0 (BroadwaySentNodes, 1);
+      sent->node_lookup = g_hash_table_new (g_direct_hash, g_direct_equal);
+      g_hash_table_insert (surface->sent, output, sent);
+    }
+  else
+    {
+      broadway_node_unref (server, sent->nodes);
+      g_hash_table_remove_all (sent->node_lookup);
+    }
+
+  sent->nodes = broadway_node_ref (surface->nodes);
+  broadway_node_add_to_lookup (sent->nodes, sent->node_lookup);
+
+  if (output != broadway_server_get_pacing_output (server))
+    return;
+
+  /* Oldest first */
+  for (l = g_list_last (server->outstanding_roundtrips); l != NULL; l = l->prev)
+    {
+      BroadwayOutstandingRoundtrip *rt = l->data;
+
+      if (rt->id == surface->id && !rt->sent)
+        {
+          broadway_output_roundtrip (output, rt->id, rt->tag);
+          rt->sent = TRUE;
+        }
+    }
+}
+
+/* Each client gets the latest nodes at its own pace, slow ones
+ * just skip the frames in between */
+static void
+broadway_server_send_pending_nodes (BroadwayServer *server)
+{
+  guint i;
+  GList *l;
+
+  for (i = 0; i < server->outputs->len; i++)
+    {
+      BroadwayOutput *output = g_ptr_array_index (server->outputs, i);
+      gboolean sent = FALSE;
+
+      if (broadway_output_get_frames_in_flight (output) >= MAX_FRAMES_IN_FLIGHT)
+        continue;
+
+      for (l = server->surfaces; l != NULL; l = l->next)
+        {
+          BroadwaySurface *surface = l->data;
+
+          if (surface->nodes != NULL && surface->nodes != get_sent_nodes (surface, output))
+            {
+              send_surface_nodes (server, output, surface);
+              sent = TRUE;
+            }
+        }
+
+      if (sent)
+        broadway_output_frame (output);
+    }
+}
+
+static guint64
+hash_texture_bytes (GBytes *bytes)
+{
+  const BroadwayTextureHeader *header;
+  const guchar *data;
+  gsize size;
+
+  data = g_bytes_get_data (bytes, &size);
+  header = (const BroadwayTextureHeader *) data;
+
+  if (size < sizeof (BroadwayTextureHeader) ||
+      (size - sizeof (BroadwayTextureHeader)) / 4 / MAX (header->width, 1) < header->height)
+    return 0;
+
+  return broadway_hash_pixels (data + sizeof (BroadwayTextureHeader),
+                               header->width * 4, header->width, header->height);
 }
 
+/* Identical textures, e.g. the same icon from different apps, share
+ * one id, so the clients get them only once.
+ *
+ * Textures are kept as raw ARGB32, not as PNG, for as long as they
+ * are alive. That is width * height * 4 bytes each, several times
+ * what the PNG used to take, plus the encoded tiles once a client
+ * needed them. In exchange nothing is compressed up front, and tiles
+ * the client already has are only sent as a hash.
+ */
 guint32
 broadway_server_upload_texture (BroadwayServer   *server,
                                 GBytes           *bytes)
 {
   BroadwayTexture *texture;
+  guint64 hash;
+
+  hash = hash_texture_bytes (bytes);
+  texture = g_hash_table_lookup (server->texture_contents, &hash);
+  if (texture && g_bytes_equal (texture->bytes, bytes))
+    {
+      g_ref_count_inc (&texture->refcount);
+      return texture->id;
+    }
 
   texture = g_new0 (BroadwayTexture, 1);
   g_ref_count_init (&texture->refcount);
   texture->id = ++server->next_texture_id;
+  texture->hash = hash;
   texture->bytes = g_bytes_ref (bytes);
 
   g_hash_table_replace (server->textures,
                         GINT_TO_POINTER (texture->id),
                         texture);
+  /* On a hash collision the new texture is just not shared */
+  if (texture->hash != 0 &&
+      !g_hash_table_contains (server->texture_contents, &texture->hash))
+    g_hash_table_insert (server->texture_contents, &texture->hash, texture);
 
-  if (server->output)
-    broadway_output_upload_texture (server->output, texture->id, texture->bytes);
+  /* Sent along with the first nodes that use it */
 
   return texture->id;
 }
@@ -1937,10 +2361,14 @@ broadway_server_release_texture (BroadwayServer   *server,
 
   if (texture && g_ref_count_dec (&texture->refcount))
     {
-      g_hash_table_remove (server->textures, GINT_TO_POINTER (id));
+      guint i;
+
+      for (i = 0; i < server->outputs->len; i++)
+        broadway_output_release_texture (g_ptr_array_index (server->outputs, i), id);
 
-      if (server->output)
-        broadway_output_release_texture (server->output, id);
+      if (g_hash_table_lookup (server->texture_contents, &texture->hash) == texture)
+        g_hash_table_remove (server->texture_contents, &texture->hash);
+      g_hash_table_remove (server->textures, GINT_TO_POINTER (id));
     }
 }
 
@@ -1956,6 +2384,7 @@ broadway_server_surface_move_resize (BroadwayServer *server,
   BroadwaySurface *surface;
   gboolean with_resize;
   gboolean sent = FALSE;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1965,14 +2394,15 @@ broadway_server_surface_move_resize (BroadwayServer *server,
   surface->width = width;
   surface->height = height;
 
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_move_resize_surface (g_ptr_array_index (server->outputs, i),
+                                         surface->id,
+                                         with_move, x, y,
+                                         with_resize, surface->width, surface->height);
+
+  /* Only the controlling client sends configure events */
   if (server->output != NULL)
-    {
-      broadway_output_move_resize_surface (server->output,
-                                           surface->id,
-                                           with_move, x, y,
-                                           with_resize, surface->width, surface->height);
-      sent = TRUE;
-    }
+    sent = TRUE;
   else
     {
       if (with_move)
@@ -2077,6 +2507,7 @@ broadway_server_new_surface (BroadwayServer *server,
                              int height)
 {
   BroadwaySurface *surface;
+  guint i;
 
   surface = g_new0 (BroadwaySurface, 1);
   surface->owner = client;
@@ -2086,6 +2517,7 @@ broadway_server_new_surface (BroadwayServer *server,
   surface->width = width;
   surface->height = height;
   surface->node_lookup = g_hash_table_new (g_direct_hash, g_direct_equal);
+  surface->sent = g_hash_table_new (g_direct_hash, g_direct_equal);
 
   g_hash_table_insert (server->surface_id_hash,
                        GINT_TO_POINTER (surface->id),
@@ -2093,40 +2525,28 @@ broadway_server_new_surface (BroadwayServer *server,
 
   server->surfaces = g_list_append (server->surfaces, surface);
 
-  if (server->output)
-    broadway_output_new_surface (server->output,
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_new_surface (g_ptr_array_index (server->outputs, i),
                                  surface->id,
                                  surface->x,
                                  surface->y,
                                  surface->width,
                                  surface->height);
-  else
+
+  if (server->output == NULL)
     fake_configure_notify (server, surface);
 
   return surface->id;
 }
 
+/* The output is new, so it has no surfaces, nodes or textures yet */
 static void
-broadway_server_resync_surfaces (BroadwayServer *server)
+broadway_server_resync_output (BroadwayServer *server,
+                               BroadwayOutput *output)
 {
-  GHashTableIter iter;
-  gpointer key, value;
   GList *l;
 
-  if (server->output == NULL)
-    return;
-
-  /* First upload all textures */
-  g_hash_table_iter_init (&iter, server->textures);
-  while (g_hash_table_iter_next (&iter, &key, &value))
-    {
-      BroadwayTexture *texture = value;
-      broadway_output_upload_texture (server->output,
-                                      GPOINTER_TO_INT (key),
-                                      texture->bytes);
-    }
-
-  /* Then create all surfaces */
+  /* First create all surfaces */
   for (l = server->surfaces; l != NULL; l = l->next)
     {
       BroadwaySurface *surface = l->data;
@@ -2134,7 +2554,7 @@ broadway_server_resync_surfaces (BroadwayServer *server)
       if (surface->id == 0)
         continue; /* Skip root */
 
-      broadway_output_new_surface (server->output,
+      broadway_output_new_surface (output,
                                    surface->id,
                                    surface->x,
                                    surface->y,
@@ -2151,20 +2571,20 @@ broadway_server_resync_surfaces (BroadwayServer *server)
         continue; /* Skip root */
 
       if (surface->transient_for != -1)
-        broadway_output_set_transient_for (server->output, surface->id,
+        broadway_output_set_transient_for (output, surface->id,
                                            surface->transient_for);
 
       if (surface->nodes)
-        broadway_output_surface_set_nodes (server->output, surface->id,
-                                           surface->nodes,
-                                           NULL, NULL);
+        send_surface_nodes (server, output, surface);
 
       if (surface->visible)
-        broadway_output_show_surface (server->output, surface->id);
+        broadway_output_show_surface (output, surface->id);
     }
 
-  if (server->show_keyboard)
-    broadway_output_set_show_keyboard (server->output, TRUE);
+  broadway_output_frame (output);
+
+  if (output == server->output && server->show_keyboard)
+    broadway_output_set_show_keyboard (output, TRUE);
 
   broadway_server_flush (server);
 }
@@ -25,7 +25,6 @@ struct _BroadwayNode {
   grefcount refcount;
   guint32 type;
   guint32 id;
-  guint32 output_id;
   guint32 hash; /* deep hash */
   guint32 n_children;
   BroadwayNode **children;
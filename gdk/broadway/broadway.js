@@ -20,6 +20,7 @@ const BROADWAY_NODE_OP_REMOVE_NODE = 1;
 const BROADWAY_NODE_OP_MOVE_AFTER_CHILD = 2;
 const BROADWAY_NODE_OP_PATCH_TEXTURE = 3;
 const BROADWAY_NODE_OP_PATCH_TRANSFORM = 4;
+const BROADWAY_NODE_OP_RENAME_NODE = 5;
 
 const BROADWAY_OP_GRAB_POINTER = 0;
 const BROADWAY_OP_UNGRAB_POINTER = 1;
@@ -38,6 +39,14 @@ const BROADWAY_OP_UPLOAD_TEXTURE = 13;
 const BROADWAY_OP_RELEASE_TEXTURE = 14;
 const BROADWAY_OP_SET_NODES = 15;
 const BROADWAY_OP_ROUNDTRIP = 16;
+const BROADWAY_OP_FRAME = 17;
+
+const BROADWAY_TILE_SIZE = 64;
+
+const BROADWAY_TILE_CACHED = 0;
+const BROADWAY_TILE_RAW = 1;
+const BROADWAY_TILE_ZLIB = 2;
+const BROADWAY_TILE_SOLID = 3;
 
 const BROADWAY_EVENT_ENTER = 0;
 const BROADWAY_EVENT_LEAVE = 1;
@@ -54,6 +63,7 @@ const BROADWAY_EVENT_CONFIGURE_NOTIFY = 11;
 const BROADWAY_EVENT_SCREEN_SIZE_CHANGED = 12;
 const BROADWAY_EVENT_FOCUS = 13;
 const BROADWAY_EVENT_ROUNDTRIP_NOTIFY = 14;
+const BROADWAY_EVENT_FRAME_ACK = 15;
 
 const DISPLAY_OP_REPLACE_CHILD = 0;
 const DISPLAY_OP_APPEND_CHILD = 1;
@@ -68,6 +78,8 @@ const DISPLAY_OP_RESTACK_SURFACES = 9;
 const DISPLAY_OP_DELETE_SURFACE = 10;
 const DISPLAY_OP_CHANGE_TEXTURE = 11;
 const DISPLAY_OP_CHANGE_TRANSFORM = 12;
+const DISPLAY_OP_ROUNDTRIP = 13;
+const DISPLAY_OP_FRAME_ACK = 14;
 
 // GdkCrossingMode
 const GDK_CROSSING_NORMAL = 0;
@@ -91,60 +103,6 @@ const GDK_META_MASK     = 1 << 28;
 
 var useDataUrls = window.location.search.includes("datauri");
 
-/* This base64code is based on https://github.com/beatgammit/base64-js/blob/master/index.js which is MIT licensed */
-
-var b64_lookup = [];
-var base64_code = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/';
-for (var i = 0, len = base64_code.length; i < len; ++i) {
-    b64_lookup[i] = base64_code[i];
-}
-
-function tripletToBase64 (num) {
-    return b64_lookup[num >> 18 & 0x3F] +
-        b64_lookup[num >> 12 & 0x3F] +
-        b64_lookup[num >> 6 & 0x3F] +
-        b64_lookup[num & 0x3F];
-}
-
-function encodeBase64Chunk (uint8, start, end) {
-    var tmp;
-    var output = [];
-    for (var i = start; i < end; i += 3) {
-        tmp =
-            ((uint8[i] << 16) & 0xFF0000) +
-            ((uint8[i + 1] << 8) & 0xFF00) +
-            (uint8[i + 2] & 0xFF);
-        output.push(tripletToBase64(tmp));
-    }
-    return output.join('');
-}
-
-function bytesToDataUri(uint8) {
-    var tmp;
-    var len = uint8.length;
-    var extraBytes = len % 3; // if we have 1 byte left, pad 2 bytes
-    var parts = [];
-    var maxChunkLength = 16383; // must be multiple of 3
-
-    parts.push("data:image/png;base64,");
-
-    // go through the array every three bytes, we'll deal with trailing stuff later
-    for (var i = 0, len2 = len - extraBytes; i < len2; i += maxChunkLength) {
-        parts.push(encodeBase64Chunk(uint8, i, (i + maxChunkLength) > len2 ? len2 : (i + maxChunkLength)));
-    }
-
-    // pad the end with zeros, but make sure to not forget the extra bytes
-    if (extraBytes === 1) {
-        tmp = uint8[len - 1];
-        parts.push(b64_lookup[tmp >> 2] + b64_lookup[(tmp << 4) & 0x3F] + '==');
-    } else if (extraBytes === 2) {
-        tmp = (uint8[len - 2] << 8) + uint8[len - 1];
-        parts.push(b64_lookup[tmp >> 10] + b64_lookup[(tmp >> 4) & 0x3F] + b64_lookup[(tmp << 2) & 0x3F] + '=');
-    }
-
-    return parts.join('');
-}
-
 /* Helper functions for debugging */
 var logDiv = null;
 function log(str) {
@@ -229,6 +187,7 @@ var realSurfaceWithMouse = 0;
 var surfaceWithMouse = 0;
 var surfaces = {};
 var textures = {};
+var tiles = {};
 var stackingOrder = [];
 var outstandingCommands = new Array();
 var outstandingDisplayCommands = null;
@@ -253,23 +212,111 @@ function getButtonMask (button) {
     return 0;
 }
 
-function Texture(id, data) {
-    var url;
-    if (useDataUrls) {
-        url = bytesToDataUri(data);
+function inflate(data) {
+    var stream = new Blob([data]).stream().pipeThrough(new DecompressionStream("deflate"));
+    return new Response(stream).arrayBuffer();
+}
+
+/* Tiles are shared between textures by content hash, the server
+ * tracks which ones we have and only sends the hash for those. */
+function Tile(key, width, height, encoding, data) {
+    this.key = key;
+    this.refcount = 1;
+    if (encoding == BROADWAY_TILE_ZLIB) {
+        var tile = this;
+        this.image = null;
+        this.decoded = inflate(data).then(
+            (buffer) => {
+                tile.image = new ImageData(new Uint8ClampedArray(buffer), width, height);
+            });
     } else {
-        var blob = new Blob([data],{type: "image/png"});
-        url = window.URL.createObjectURL(blob);
+        this.image = new ImageData(new Uint8ClampedArray(data), width, height);
+        this.decoded = Promise.resolve();
     }
+    tiles[key] = this;
+}
+
+Tile.prototype.unref = function() {
+    this.refcount -= 1;
+    if (this.refcount == 0)
+        delete tiles[this.key];
+}
 
-    this.url = url;
+function Texture(id, cmd) {
     this.refcount = 1;
     this.id = id;
+    this.width = cmd.get_32();
+    this.height = cmd.get_32();
+    this.tiles = [];
+
+    var canvas = document.createElement("canvas");
+    canvas.width = this.width;
+    canvas.height = this.height;
+    var context = canvas.getContext("2d");
+    var decodes = [];
+
+    for (var y = 0; y < this.height; y += BROADWAY_TILE_SIZE) {
+        for (var x = 0; x < this.width; x += BROADWAY_TILE_SIZE) {
+            var w = Math.min(BROADWAY_TILE_SIZE, this.width - x);
+            var h = Math.min(BROADWAY_TILE_SIZE, this.height - y);
+            var encoding = cmd.get_uint8();
+
+            if (encoding == BROADWAY_TILE_SOLID) {
+                var r = cmd.get_uint8();
+                var g = cmd.get_uint8();
+                var b = cmd.get_uint8();
+                var a = cmd.get_uint8();
+                context.fillStyle = "rgba(" + r + "," + g + "," + b + "," + (a / 255) + ")";
+                context.fillRect(x, y, w, h);
+                continue;
+            }
 
-    var image = new Image();
-    image.src = this.url;
-    this.image = image;
-    this.decoded = image.decode();
+            var key = cmd.get_32() + ":" + cmd.get_32();
+            var tile = tiles[key];
+            if (encoding == BROADWAY_TILE_CACHED) {
+                if (tile == undefined) {
+                    console.log("Unknown tile " + key + " in texture " + id);
+                    continue;
+                }
+                tile.refcount += 1;
+            } else {
+                var data = cmd.get_data();
+                if (tile != undefined)
+                    tile.refcount += 1;
+                else
+                    tile = new Tile(key, w, h, encoding, data);
+            }
+            this.tiles.push(tile);
+
+            // Separate closure per tile for the position
+            var block = function(t, tx, ty) {
+                decodes.push(t.decoded.then(() => { context.putImageData(t.image, tx, ty); }));
+            };
+            block(tile, x, y);
+        }
+    }
+
+    /* The tiles are put together only once, and then turned into a
+     * single image URL that all nodes using this texture share, so the
+     * browser keeps one decoded copy instead of one per node. */
+    var texture = this;
+    this.url = null;
+    this.decoded = Promise.all(decodes).then(
+        () => {
+            if (useDataUrls)
+                return canvas.toDataURL("image/png");
+            return new Promise((resolve) => {
+                canvas.toBlob((blob) => { resolve(window.URL.createObjectURL(blob)); }, "image/png");
+            });
+        }).then(
+            (url) => {
+                texture.url = url;
+                // Free the backing store, the image has it now
+                canvas.width = 0;
+                canvas.height = 0;
+                if (texture.refcount == 0)
+                    texture.revokeUrl();
+            });
     textures[id] = this;
 }
 
@@ -278,16 +325,33 @@ Texture.prototype.ref = function() {
     return this;
 }
 
+Texture.prototype.revokeUrl = function() {
+    if (this.url != null && this.url.startsWith("blob"))
+        window.URL.revokeObjectURL(this.url);
+    this.url = null;
+}
+
 Texture.prototype.unref = function() {
     this.refcount -= 1;
     if (this.refcount == 0) {
-        if (this.url.startsWith("blob")) {
-            window.URL.revokeObjectURL(this.url);
-        }
+        for (var i = 0; i < this.tiles.length; i++)
+            this.tiles[i].unref();
+        this.revokeUrl();
         delete textures[this.id];
     }
 }
 
+/* Takes over the reference to the texture, which is dropped once the
+ * image has loaded the URL */
+Texture.prototype.showIn = function(image) {
+    var texture = this;
+    this.decoded.then(
+        () => {
+            image.src = texture.url;
+            image.onload = function() { texture.unref(); };
+        });
+}
+
 function sendConfigureNotify(surface)
 {
     sendInput(BROADWAY_EVENT_CONFIGURE_NOTIFY, [surface.id, surface.x, surface.y, surface.width, surface.height]);
@@ -605,10 +669,7 @@ TransformNodes.prototype.insertNode = function(parent, previousSibling, is_tople
             image.height = rect.height;
             image.style["position"] = "absolute";
             set_rect_style(image, rect);
-            var texture = textures[texture_id].ref();
-            image.src = texture.url;
-            // Unref blob url when loaded
-            image.onload = function() { texture.unref(); };
+            textures[texture_id].ref().showIn(image);
             newNode = image;
         }
         break;
@@ -911,6 +972,17 @@ TransformNodes.prototype.execute = function(display_commands)
             var transformString = this.decode_transform();
             this.display_commands.push([DISPLAY_OP_CHANGE_TRANSFORM, transformNode, transformString]);
             break;
+        case BROADWAY_NODE_OP_RENAME_NODE:
+            var oldId = this.decode_uint32();
+            var newId = this.decode_uint32();
+            var renamed = this.nodes[oldId];
+            delete this.nodes[oldId];
+            if (renamed == null)
+                console.log("Wanted to rename node " + oldId + " but it is unknown");
+            else
+                renamed.node_id = newId;
+            this.nodes[newId] = renamed;
+            break;
         }
 
     }
@@ -992,19 +1064,19 @@ function handleDisplayCommands(display_commands)
         case DISPLAY_OP_CHANGE_TEXTURE:
             var image = cmd[1];
             var texture = cmd[2];
-            // We need a new closure here to have a separate copy of "texture" for each iteration in the onload callback...
-            var block = function(t) {
-                image.src = t.url;
-                // Unref blob url when loaded
-                image.onload = function() { t.unref(); };
-            };
-            block(texture);
+            texture.showIn(image);
             break;
         case DISPLAY_OP_CHANGE_TRANSFORM:
             var div = cmd[1];
             var transform_string = cmd[2];
             div.style["transform"] = transform_string;
             break;
+        case DISPLAY_OP_ROUNDTRIP:
+            cmdRoundtrip(cmd[1], cmd[2]);
+            break;
+        case DISPLAY_OP_FRAME_ACK:
+            sendInput(BROADWAY_EVENT_FRAME_ACK, [cmd[1]]);
+            break;
         default:
             alert("Unknown display op " + command);
         }
@@ -1092,7 +1164,13 @@ function handleCommands(cmd, display_commands, new_textures, modified_trees)
         case BROADWAY_OP_ROUNDTRIP:
             id = cmd.get_16();
             var tag = cmd.get_32();
-            cmdRoundtrip(id, tag);
+            // Reply once the frame before it is shown, this paces the app
+            display_commands.push([DISPLAY_OP_ROUNDTRIP, id, tag]);
+            break;
+
+        case BROADWAY_OP_FRAME:
+            var serial = cmd.get_32();
+            display_commands.push([DISPLAY_OP_FRAME_ACK, serial]);
             break;
 
         case BROADWAY_OP_MOVE_RESIZE:
@@ -1129,8 +1207,7 @@ function handleCommands(cmd, display_commands, new_textures, modified_trees)
 
         case BROADWAY_OP_UPLOAD_TEXTURE:
             id = cmd.get_32();
-            var data = cmd.get_data();
-            var texture = new Texture (id, data); // Stores a ref in global textures array
+            var texture = new Texture (id, cmd); // Stores a ref in global textures array
             new_textures.push(texture);
             break;
 
@@ -3209,6 +3286,7 @@ function connect()
 {
     var url = window.location.toString();
     var query_string = url.split("?");
+    var viewer = false;
     if (query_string.length > 1) {
         var params = query_string[1].split("&");
 
@@ -3216,11 +3294,16 @@ function connect()
             var pair = params[i].split("=");
             if (pair[0] == "debug" && pair[1] == "decoding")
                 debugDecoding = true;
+            if (pair[0] == "viewer")
+                viewer = true;
         }
     }
 
     var loc = window.location.toString().replace("http:", "ws:").replace("https:", "wss:");
     loc = loc.substr(0, loc.lastIndexOf('/')) + "/socket";
+    /* Viewers only watch, input is taken from the controlling client */
+    if (viewer)
+        loc = loc + "?viewer";
     ws = new WebSocket(loc, "broadway");
     ws.binaryType = "arraybuffer";
 
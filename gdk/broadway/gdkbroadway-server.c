@@ -607,56 +607,62 @@ open_shared_memory (void)
   return ret;
 }
 
-typedef struct {
-  int fd;
-  gsize size;
-} PngData;
-
-static cairo_status_t
-write_png_cb (void         *closure,
-              const guchar *data,
-              unsigned int  length)
+static gboolean
+write_all (int           fd,
+           const guchar *data,
+           gsize         length)
 {
-  PngData *png_data = closure;
-  int fd = png_data->fd;
-
   while (length)
     {
       gssize ret = write (fd, data, length);
 
+      if (ret < 0 && errno == EINTR)
+        continue;
+
       if (ret <= 0)
-        return CAIRO_STATUS_WRITE_ERROR;
+        return FALSE;
 
-      png_data->size += ret;
       length -= ret;
       data += ret;
     }
 
-  return CAIRO_STATUS_SUCCESS;
+  return TRUE;
 }
 
+/* Textures are sent to the daemon as raw pixels, it does the tiling
+ * and encoding for the client, see broadway_output_upload_texture().
+ * The pixels are in CAIRO_FORMAT_ARGB32 with a stride of 4 * width.
+ */
 guint32
 gdk_broadway_server_upload_texture (GdkBroadwayServer *server,
-                                    GdkTexture        *texture)
+                                    int                width,
+                                    int                height,
+                                    const guchar      *pixels)
 {
   guint32 id;
-  cairo_surface_t *surface = gdk_texture_download_surface (texture);
   BroadwayRequestUploadTexture msg;
-  PngData data;
+  BroadwayTextureHeader header;
+  gsize stride;
+  int fd;
 
   id = server->next_texture_id++;
 
-  data.fd = open_shared_memory ();
-  data.size = 0;
-  cairo_surface_write_to_png_stream (surface, write_png_cb, &data);
+  header.width = width;
+  header.height = height;
+  stride = header.width * 4;
+
+  fd = open_shared_memory ();
+  if (!write_all (fd, (guchar *) &header, sizeof (header)) ||
+      !write_all (fd, pixels, stride * header.height))
+    g_warning ("Failed to write texture to shared memory: %m");
 
   msg.id = id;
   msg.offset = 0;
-  msg.size = data.size;
+  msg.size = sizeof (header) + stride * header.height;
 
   /* This passes ownership of fd */
   gdk_broadway_server_send_fd_message (server, msg,
-                                       BROADWAY_REQUEST_UPLOAD_TEXTURE, data.fd);
+                                       BROADWAY_REQUEST_UPLOAD_TEXTURE, fd);
 
   return id;
 }
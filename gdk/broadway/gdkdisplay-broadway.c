@@ -47,6 +47,12 @@
 static void   gdk_broadway_display_dispose            (GObject            *object);
 static void   gdk_broadway_display_finalize           (GObject            *object);
 
+typedef struct _BroadwayCachedTexture BroadwayCachedTexture;
+static void   broadway_cached_texture_free            (BroadwayCachedTexture *cached);
+static guint  texture_digest_hash                     (gconstpointer          key);
+static gboolean texture_digest_equal                  (gconstpointer          a,
+                                                       gconstpointer          b);
+
 #if 0
 #define DEBUG_WEBSOCKETS 1
 #endif
@@ -59,6 +65,9 @@ gdk_broadway_display_init (GdkBroadwayDisplay *display)
   gdk_display_set_input_shapes (GDK_DISPLAY (display), FALSE);
 
   display->id_ht = g_hash_table_new (NULL, NULL);
+  display->texture_cache = g_hash_table_new_full (texture_digest_hash, texture_digest_equal,
+                                                  NULL, (GDestroyNotify) broadway_cached_texture_free);
+  g_queue_init (&display->unused_textures);
 
   display->monitor = g_object_new (GDK_TYPE_BROADWAY_MONITOR,
                                    "display", display,
@@ -293,6 +302,8 @@ gdk_broadway_display_finalize (GObject *object)
 
   g_object_unref (broadway_display->monitor);
 
+  g_hash_table_destroy (broadway_display->texture_cache);
+
   G_OBJECT_CLASS (gdk_broadway_display_parent_class)->finalize (object);
 }
 
@@ -349,18 +360,107 @@ gdk_broadway_display_get_setting (GdkDisplay *display,
   return FALSE;
 }
 
+/* Textures with the same pixels share one upload. Unused uploads are
+ * kept around up to this size, in case the same pixels come back, like
+ * when an icon is loaded again.
+ */
+#define MAX_UNUSED_TEXTURE_SIZE (16 * 1024 * 1024)
+
+/* Textures are identified by a SHA-256 of their size and pixels. That
+ * is strong enough that we don't need to keep a copy of the pixels
+ * around to rule out collisions.
+ */
+#define TEXTURE_DIGEST_SIZE 32
+
+struct _BroadwayCachedTexture {
+  guint8 digest[TEXTURE_DIGEST_SIZE];
+  guint32 id;
+  int width;
+  int height;
+  int n_users;
+  GList link; /* In unused_textures when n_users is 0 */
+};
+
 typedef struct {
-  int id;
   GdkDisplay *display;
-  GList *textures;
+  BroadwayCachedTexture *cached;
 } BroadwayTextureData;
 
+static guint
+texture_digest_hash (gconstpointer key)
+{
+  guint hash;
+
+  /* The digest is evenly distributed already */
+  memcpy (&hash, key, sizeof (hash));
+
+  return hash;
+}
+
+static gboolean
+texture_digest_equal (gconstpointer a,
+                      gconstpointer b)
+{
+  return memcmp (a, b, TEXTURE_DIGEST_SIZE) == 0;
+}
+
+static void
+texture_digest (const guchar *pixels,
+                int           width,
+                int           height,
+                guint8        digest[TEXTURE_DIGEST_SIZE])
+{
+  GChecksum *checksum;
+  guint32 size[2] = { width, height };
+  gsize len = TEXTURE_DIGEST_SIZE;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  g_checksum_update (checksum, (const guchar *) size, sizeof (size));
+  g_checksum_update (checksum, pixels, (gsize) width * height * 4);
+  g_checksum_get_digest (checksum, digest, &len);
+  g_checksum_free (checksum);
+}
+
+static void
+broadway_cached_texture_free (BroadwayCachedTexture *cached)
+{
+  g_free (cached);
+}
+
+static gsize
+broadway_cached_texture_get_size (BroadwayCachedTexture *cached)
+{
+  return (gsize) cached->width * cached->height * 4;
+}
+
+static void
+evict_unused_textures (GdkBroadwayDisplay *broadway_display)
+{
+  while (broadway_display->unused_texture_size > MAX_UNUSED_TEXTURE_SIZE)
+    {
+      GList *link = g_queue_pop_tail_link (&broadway_display->unused_textures);
+      BroadwayCachedTexture *cached = link->data;
+
+      broadway_display->unused_texture_size -= broadway_cached_texture_get_size (cached);
+      gdk_broadway_server_release_texture (broadway_display->server, cached->id);
+      g_hash_table_remove (broadway_display->texture_cache, cached->digest);
+    }
+}
+
 static void
 broadway_texture_data_free (BroadwayTextureData *data)
 {
   GdkBroadwayDisplay *broadway_display = GDK_BROADWAY_DISPLAY (data->display);
+  BroadwayCachedTexture *cached = data->cached;
+
+  cached->n_users--;
+  if (cached->n_users == 0)
+    {
+      g_queue_push_head_link (&broadway_display->unused_textures, &cached->link);
+      broadway_display->unused_texture_size += broadway_cached_texture_get_size (cached);
+      evict_unused_textures (broadway_display);
+    }
 
-  gdk_broadway_server_release_texture (broadway_display->server, data->id);
   g_object_unref (data->display);
   g_free (data);
 }
@@ -375,15 +475,46 @@ gdk_broadway_display_ensure_texture (GdkDisplay *display,
   data = g_object_get_data (G_OBJECT (texture), "broadway-data");
   if (data == NULL)
     {
-      guint32 id = gdk_broadway_server_upload_texture (broadway_display->server, texture);
+      BroadwayCachedTexture *cached;
+      guint8 digest[TEXTURE_DIGEST_SIZE];
+      int width, height;
+      guchar *pixels;
+
+      width = gdk_texture_get_width (texture);
+      height = gdk_texture_get_height (texture);
+      pixels = g_malloc ((gsize) width * height * 4);
+      gdk_texture_download (texture, pixels, width * 4);
+
+      texture_digest (pixels, width, height, digest);
+      cached = g_hash_table_lookup (broadway_display->texture_cache, digest);
+      if (cached == NULL)
+        {
+          cached = g_new0 (BroadwayCachedTexture, 1);
+          memcpy (cached->digest, digest, TEXTURE_DIGEST_SIZE);
+          cached->width = width;
+          cached->height = height;
+          cached->link.data = cached;
+          cached->id = gdk_broadway_server_upload_texture (broadway_display->server,
+                                                           width, height, pixels);
+          broadway_display->n_texture_uploads++;
+          g_hash_table_insert (broadway_display->texture_cache, cached->digest, cached);
+        }
+      else if (cached->n_users == 0)
+        {
+          g_queue_unlink (&broadway_display->unused_textures, &cached->link);
+          broadway_display->unused_texture_size -= broadway_cached_texture_get_size (cached);
+        }
+
+      cached->n_users++;
+      g_free (pixels);
 
       data = g_new0 (BroadwayTextureData, 1);
-      data->id = id;
+      data->cached = cached;
       data->display = g_object_ref (display);
-     g_object_set_data_full (G_OBJECT (texture), "broadway-data", data, (GDestroyNotify)broadway_texture_data_free);
+      g_object_set_data_full (G_OBJECT (texture), "broadway-data", data, (GDestroyNotify)broadway_texture_data_free);
     }
 
-  return data->id;
+  return data->cached->id;
 }
 
 static gboolean
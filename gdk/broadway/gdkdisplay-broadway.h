@@ -58,7 +58,10 @@ struct _GdkBroadwayDisplay
   GdkMonitor *monitor;
   int scale_factor;
 
-  GHashTable *texture_cache;
+  GHashTable *texture_cache; /* content hash -> BroadwayCachedTexture */
+  GQueue unused_textures; /* Most recently used first */
+  gsize unused_texture_size;
+  guint n_texture_uploads; /* For tests */
 
   guint idle_flush_id;
 };
@@ -0,0 +1,694 @@
+/*
+ * Copyright © 2018 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors: Benjamin Otte <otte@gnome.org>
+ */
+
+#include "config.h"
+
+#include "gdkmemoryformatprivate.h"
+
+#include <string.h>
+
+#ifdef HAVE_AVX2_TARGET
+#include <immintrin.h>
+#endif
+#if defined (__ARM_NEON) && defined (__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static void
+convert_memcpy (guchar       *dest_data,
+                gsize         dest_stride,
+                const guchar *src_data,
+                gsize         src_stride,
+                gsize         width,
+                gsize         height)
+{
+  gsize y;
+
+  for (y = 0; y < height; y++)
+    memcpy (dest_data + y * dest_stride, src_data + y * src_stride, 4 * width);
+}
+
+#define SWIZZLE(A,R,G,B) \
+static void \
+convert_swizzle ## A ## R ## G ## B (guchar       *dest_data, \
+                                     gsize         dest_stride, \
+                                     const guchar *src_data, \
+                                     gsize         src_stride, \
+                                     gsize         width, \
+                                     gsize         height) \
+{ \
+  gsize x, y; \
+\
+  for (y = 0; y < height; y++) \
+    { \
+      for (x = 0; x < width; x++) \
+        { \
+          dest_data[4 * x + A] = src_data[4 * x + 0]; \
+          dest_data[4 * x + R] = src_data[4 * x + 1]; \
+          dest_data[4 * x + G] = src_data[4 * x + 2]; \
+          dest_data[4 * x + B] = src_data[4 * x + 3]; \
+        } \
+\
+      dest_data += dest_stride; \
+      src_data += src_stride; \
+    } \
+}
+
+SWIZZLE(3,2,1,0)
+SWIZZLE(2,1,0,3)
+SWIZZLE(3,0,1,2)
+SWIZZLE(1,2,3,0)
+
+#define SWIZZLE_OPAQUE(A,R,G,B) \
+static void \
+convert_swizzle_opaque_## A ## R ## G ## B (guchar       *dest_data, \
+                                            gsize         dest_stride, \
+                                            const guchar *src_data, \
+                                            gsize         src_stride, \
+                                            gsize         width, \
+                                            gsize         height) \
+{ \
+  gsize x, y; \
+\
+  for (y = 0; y < height; y++) \
+    { \
+      for (x = 0; x < width; x++) \
+        { \
+          dest_data[4 * x + A] = 0xFF; \
+          dest_data[4 * x + R] = src_data[3 * x + 0]; \
+          dest_data[4 * x + G] = src_data[3 * x + 1]; \
+          dest_data[4 * x + B] = src_data[3 * x + 2]; \
+        } \
+\
+      dest_data += dest_stride; \
+      src_data += src_stride; \
+    } \
+}
+
+SWIZZLE_OPAQUE(3,2,1,0)
+SWIZZLE_OPAQUE(3,0,1,2)
+SWIZZLE_OPAQUE(0,1,2,3)
+SWIZZLE_OPAQUE(0,3,2,1)
+
+#define PREMULTIPLY(d,c,a) G_STMT_START { guint t = c * a + 0x80; d = ((t >> 8) + t) >> 8; } G_STMT_END
+#define SWIZZLE_PREMULTIPLY(A,R,G,B, A2,R2,G2,B2) \
+static void \
+convert_swizzle_premultiply_ ## A ## R ## G ## B ## _ ## A2 ## R2 ## G2 ## B2 \
+                                    (guchar       *dest_data, \
+                                     gsize         dest_stride, \
+                                     const guchar *src_data, \
+                                     gsize         src_stride, \
+                                     gsize         width, \
+                                     gsize         height) \
+{ \
+  gsize x, y; \
+\
+  for (y = 0; y < height; y++) \
+    { \
+      for (x = 0; x < width; x++) \
+        { \
+          dest_data[4 * x + A] = src_data[4 * x + A2]; \
+          PREMULTIPLY(dest_data[4 * x + R], src_data[4 * x + R2], src_data[4 * x + A2]); \
+          PREMULTIPLY(dest_data[4 * x + G], src_data[4 * x + G2], src_data[4 * x + A2]); \
+          PREMULTIPLY(dest_data[4 * x + B], src_data[4 * x + B2], src_data[4 * x + A2]); \
+        } \
+\
+      dest_data += dest_stride; \
+      src_data += src_stride; \
+    } \
+}
+
+SWIZZLE_PREMULTIPLY (3,2,1,0, 3,2,1,0)
+SWIZZLE_PREMULTIPLY (0,1,2,3, 3,2,1,0)
+SWIZZLE_PREMULTIPLY (3,2,1,0, 0,1,2,3)
+SWIZZLE_PREMULTIPLY (0,1,2,3, 0,1,2,3)
+SWIZZLE_PREMULTIPLY (3,2,1,0, 3,0,1,2)
+SWIZZLE_PREMULTIPLY (0,1,2,3, 3,0,1,2)
+SWIZZLE_PREMULTIPLY (3,2,1,0, 0,3,2,1)
+SWIZZLE_PREMULTIPLY (0,1,2,3, 0,3,2,1)
+SWIZZLE_PREMULTIPLY (3,0,1,2, 3,2,1,0)
+SWIZZLE_PREMULTIPLY (3,0,1,2, 0,1,2,3)
+SWIZZLE_PREMULTIPLY (3,0,1,2, 3,0,1,2)
+SWIZZLE_PREMULTIPLY (3,0,1,2, 0,3,2,1)
+
+typedef void (* ConversionFunc) (guchar       *dest_data,
+                                 gsize         dest_stride,
+                                 const guchar *src_data,
+                                 gsize         src_stride,
+                                 gsize         width,
+                                 gsize         height);
+
+typedef enum {
+  CONVERSION_COPY,
+  CONVERSION_SWIZZLE,
+  CONVERSION_OPAQUE,
+  CONVERSION_PREMULTIPLY
+} ConversionType;
+
+/* Besides the C function, every conversion is described by where the
+ * bytes of a destination pixel come from, which is what the SIMD
+ * kernels use to build their shuffle masks.
+ */
+typedef struct {
+  ConversionFunc convert;
+  ConversionType type;
+  guint8 shuffle[4]; /* Byte i of a dest pixel comes from byte shuffle[i] of the source pixel */
+  guint8 alpha;      /* The byte of a dest pixel that holds alpha */
+} Conversion;
+
+#define CONVERT_COPY \
+  { convert_memcpy, CONVERSION_COPY, { 0, 1, 2, 3 }, 0 }
+#define CONVERT_SWIZZLE(A,R,G,B) \
+  { convert_swizzle ## A ## R ## G ## B, CONVERSION_SWIZZLE, \
+    { [A] = 0, [R] = 1, [G] = 2, [B] = 3 }, A }
+#define CONVERT_OPAQUE(A,R,G,B) \
+  { convert_swizzle_opaque_ ## A ## R ## G ## B, CONVERSION_OPAQUE, \
+    { [A] = 0, [R] = 0, [G] = 1, [B] = 2 }, A }
+#define CONVERT_PREMULTIPLY(A,R,G,B, A2,R2,G2,B2) \
+  { convert_swizzle_premultiply_ ## A ## R ## G ## B ## _ ## A2 ## R2 ## G2 ## B2, CONVERSION_PREMULTIPLY, \
+    { [A] = A2, [R] = R2, [G] = G2, [B] = B2 }, A }
+
+static const Conversion conversions[GDK_MEMORY_N_FORMATS][3] =
+{
+  { CONVERT_COPY, CONVERT_SWIZZLE (3,2,1,0), CONVERT_SWIZZLE (2,1,0,3) },
+  { CONVERT_SWIZZLE (3,2,1,0), CONVERT_COPY, CONVERT_SWIZZLE (3,0,1,2) },
+  { CONVERT_SWIZZLE (2,1,0,3), CONVERT_SWIZZLE (1,2,3,0), CONVERT_COPY },
+  { CONVERT_PREMULTIPLY (3,2,1,0, 3,2,1,0), CONVERT_PREMULTIPLY (0,1,2,3, 3,2,1,0), CONVERT_PREMULTIPLY (3,0,1,2, 3,2,1,0) },
+  { CONVERT_PREMULTIPLY (3,2,1,0, 0,1,2,3), CONVERT_PREMULTIPLY (0,1,2,3, 0,1,2,3), CONVERT_PREMULTIPLY (3,0,1,2, 0,1,2,3) },
+  { CONVERT_PREMULTIPLY (3,2,1,0, 3,0,1,2), CONVERT_PREMULTIPLY (0,1,2,3, 3,0,1,2), CONVERT_PREMULTIPLY (3,0,1,2, 3,0,1,2) },
+  { CONVERT_PREMULTIPLY (3,2,1,0, 0,3,2,1), CONVERT_PREMULTIPLY (0,1,2,3, 0,3,2,1), CONVERT_PREMULTIPLY (3,0,1,2, 0,3,2,1) },
+  { CONVERT_OPAQUE (3,2,1,0), CONVERT_OPAQUE (0,1,2,3), CONVERT_OPAQUE (3,0,1,2) },
+  { CONVERT_OPAQUE (3,0,1,2), CONVERT_OPAQUE (0,3,2,1), CONVERT_OPAQUE (3,2,1,0) }
+};
+
+/* Converts the pixels at the end of a row that don't fill a SIMD register */
+static void
+convert_pixels (guchar           *dest,
+                const guchar     *src,
+                gsize             n_pixels,
+                const Conversion *conversion)
+{
+  const guint8 *shuffle = conversion->shuffle;
+  guint alpha = conversion->alpha;
+  gsize x;
+  guint i;
+
+  switch (conversion->type)
+    {
+    case CONVERSION_COPY:
+      memcpy (dest, src, 4 * n_pixels);
+      break;
+
+    case CONVERSION_SWIZZLE:
+      for (x = 0; x < n_pixels; x++)
+        for (i = 0; i < 4; i++)
+          dest[4 * x + i] = src[4 * x + shuffle[i]];
+      break;
+
+    case CONVERSION_OPAQUE:
+      for (x = 0; x < n_pixels; x++)
+        for (i = 0; i < 4; i++)
+          dest[4 * x + i] = i == alpha ? 0xFF : src[3 * x + shuffle[i]];
+      break;
+
+    case CONVERSION_PREMULTIPLY:
+      for (x = 0; x < n_pixels; x++)
+        {
+          guchar a = src[4 * x + shuffle[alpha]];
+
+          for (i = 0; i < 4; i++)
+            {
+              if (i == alpha)
+                dest[4 * x + i] = a;
+              else
+                PREMULTIPLY (dest[4 * x + i], src[4 * x + shuffle[i]], a);
+            }
+        }
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+/* The shuffle masks for 4 pixels. Indexes with the high bit set
+ * produce 0 with both SSSE3 and NEON table lookups. */
+static void
+build_masks (const Conversion *conversion,
+             guint8            shuffle_mask[16],
+             guint8            alpha_shuffle_mask[16],
+             guint8            alpha_mask[16])
+{
+  guint i;
+
+  for (i = 0; i < 16; i++)
+    {
+      guint p = i / 4;
+      guint k = i % 4;
+
+      if (conversion->type == CONVERSION_OPAQUE)
+        shuffle_mask[i] = k == conversion->alpha ? 0x80 : 3 * p + conversion->shuffle[k];
+      else
+        shuffle_mask[i] = 4 * p + conversion->shuffle[k];
+
+      alpha_shuffle_mask[i] = 4 * p + conversion->shuffle[conversion->alpha];
+      alpha_mask[i] = k == conversion->alpha ? 0xFF : 0;
+    }
+}
+
+typedef void (* ConversionKernelFunc) (guchar           *dest_data,
+                                       gsize             dest_stride,
+                                       const guchar     *src_data,
+                                       gsize             src_stride,
+                                       gsize             width,
+                                       gsize             height,
+                                       const Conversion *conversion);
+
+typedef struct {
+  const char *name;
+  ConversionKernelFunc convert;
+  gboolean (* supported) (void);
+} ConversionKernel;
+
+static void
+convert_c (guchar           *dest_data,
+           gsize             dest_stride,
+           const guchar     *src_data,
+           gsize             src_stride,
+           gsize             width,
+           gsize             height,
+           const Conversion *conversion)
+{
+  conversion->convert (dest_data, dest_stride, src_data, src_stride, width, height);
+}
+
+static gboolean
+kernel_always_supported (void)
+{
+  return TRUE;
+}
+
+#ifdef HAVE_AVX2_TARGET
+/* The same compiler support that we check for AVX2 also
+ * lets us pick SSSE3 at runtime */
+
+/* Premultiplies like PREMULTIPLY() does, in 16bit lanes,
+ * and keeps the alpha bytes */
+__attribute__((target ("ssse3")))
+static inline __m128i
+premultiply_ssse3 (__m128i pixels,
+                   __m128i alpha,
+                   __m128i alpha_mask)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i bias = _mm_set1_epi16 (0x80);
+  __m128i lo, hi;
+
+  lo = _mm_add_epi16 (_mm_mullo_epi16 (_mm_unpacklo_epi8 (pixels, zero),
+                                       _mm_unpacklo_epi8 (alpha, zero)),
+                      bias);
+  hi = _mm_add_epi16 (_mm_mullo_epi16 (_mm_unpackhi_epi8 (pixels, zero),
+                                       _mm_unpackhi_epi8 (alpha, zero)),
+                      bias);
+  lo = _mm_srli_epi16 (_mm_add_epi16 (lo, _mm_srli_epi16 (lo, 8)), 8);
+  hi = _mm_srli_epi16 (_mm_add_epi16 (hi, _mm_srli_epi16 (hi, 8)), 8);
+
+  return _mm_or_si128 (_mm_andnot_si128 (alpha_mask, _mm_packus_epi16 (lo, hi)),
+                       _mm_and_si128 (alpha_mask, pixels));
+}
+
+__attribute__((target ("ssse3")))
+static void
+convert_ssse3 (guchar           *dest_data,
+               gsize             dest_stride,
+               const guchar     *src_data,
+               gsize             src_stride,
+               gsize             width,
+               gsize             height,
+               const Conversion *conversion)
+{
+  guint8 masks[3][16];
+  __m128i shuffle, alpha_shuffle, alpha_mask;
+  gsize x, y;
+
+  if (conversion->type == CONVERSION_COPY)
+    {
+      convert_memcpy (dest_data, dest_stride, src_data, src_stride, width, height);
+      return;
+    }
+
+  build_masks (conversion, masks[0], masks[1], masks[2]);
+  shuffle = _mm_loadu_si128 ((const __m128i *) masks[0]);
+  alpha_shuffle = _mm_loadu_si128 ((const __m128i *) masks[1]);
+  alpha_mask = _mm_loadu_si128 ((const __m128i *) masks[2]);
+
+  for (y = 0; y < height; y++)
+    {
+      x = 0;
+
+      switch (conversion->type)
+        {
+        case CONVERSION_SWIZZLE:
+          for (; x + 4 <= width; x += 4)
+            {
+              __m128i in = _mm_loadu_si128 ((const __m128i *) (src_data + 4 * x));
+              _mm_storeu_si128 ((__m128i *) (dest_data + 4 * x), _mm_shuffle_epi8 (in, shuffle));
+            }
+          break;
+
+        case CONVERSION_OPAQUE:
+          /* 4 pixels are 12 bytes, but we load 16 */
+          for (; x + 6 <= width; x += 4)
+            {
+              __m128i in = _mm_loadu_si128 ((const __m128i *) (src_data + 3 * x));
+              _mm_storeu_si128 ((__m128i *) (dest_data + 4 * x),
+                                _mm_or_si128 (_mm_shuffle_epi8 (in, shuffle), alpha_mask));
+            }
+          break;
+
+        case CONVERSION_PREMULTIPLY:
+          for (; x + 4 <= width; x += 4)
+            {
+              __m128i in = _mm_loadu_si128 ((const __m128i *) (src_data + 4 * x));
+              _mm_storeu_si128 ((__m128i *) (dest_data + 4 * x),
+                                premultiply_ssse3 (_mm_shuffle_epi8 (in, shuffle),
+                                                   _mm_shuffle_epi8 (in, alpha_shuffle),
+                                                   alpha_mask));
+            }
+          break;
+
+        case CONVERSION_COPY:
+        default:
+          g_assert_not_reached ();
+        }
+
+      convert_pixels (dest_data + 4 * x,
+                      src_data + (conversion->type == CONVERSION_OPAQUE ? 3 : 4) * x,
+                      width - x,
+                      conversion);
+
+      dest_data += dest_stride;
+      src_data += src_stride;
+    }
+}
+
+static gboolean
+kernel_ssse3_supported (void)
+{
+  return __builtin_cpu_supports ("ssse3");
+}
+
+/* Byte shuffles and the unpacks and packs below all work within
+ * 128bit lanes, which is fine since pixels never cross them */
+__attribute__((target ("avx2")))
+static inline __m256i
+premultiply_avx2 (__m256i pixels,
+                  __m256i alpha,
+                  __m256i alpha_mask)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i bias = _mm256_set1_epi16 (0x80);
+  __m256i lo, hi;
+
+  lo = _mm256_add_epi16 (_mm256_mullo_epi16 (_mm256_unpacklo_epi8 (pixels, zero),
+                                             _mm256_unpacklo_epi8 (alpha, zero)),
+                         bias);
+  hi = _mm256_add_epi16 (_mm256_mullo_epi16 (_mm256_unpackhi_epi8 (pixels, zero),
+                                             _mm256_unpackhi_epi8 (alpha, zero)),
+                         bias);
+  lo = _mm256_srli_epi16 (_mm256_add_epi16 (lo, _mm256_srli_epi16 (lo, 8)), 8);
+  hi = _mm256_srli_epi16 (_mm256_add_epi16 (hi, _mm256_srli_epi16 (hi, 8)), 8);
+
+  return _mm256_or_si256 (_mm256_andnot_si256 (alpha_mask, _mm256_packus_epi16 (lo, hi)),
+                          _mm256_and_si256 (alpha_mask, pixels));
+}
+
+__attribute__((target ("avx2")))
+static void
+convert_avx2 (guchar           *dest_data,
+              gsize             dest_stride,
+              const guchar     *src_data,
+              gsize             src_stride,
+              gsize             width,
+              gsize             height,
+              const Conversion *conversion)
+{
+  guint8 masks[3][16];
+  __m256i shuffle, alpha_shuffle, alpha_mask;
+  gsize x, y;
+
+  if (conversion->type == CONVERSION_COPY)
+    {
+      convert_memcpy (dest_data, dest_stride, src_data, src_stride, width, height);
+      return;
+    }
+
+  build_masks (conversion, masks[0], masks[1], masks[2]);
+  shuffle = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) masks[0]));
+  alpha_shuffle = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) masks[1]));
+  alpha_mask = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) masks[2]));
+
+  for (y = 0; y < height; y++)
+    {
+      x = 0;
+
+      switch (conversion->type)
+        {
+        case CONVERSION_SWIZZLE:
+          for (; x + 8 <= width; x += 8)
+            {
+              __m256i in = _mm256_loadu_si256 ((const __m256i *) (src_data + 4 * x));
+              _mm256_storeu_si256 ((__m256i *) (dest_data + 4 * x), _mm256_shuffle_epi8 (in, shuffle));
+            }
+          break;
+
+        case CONVERSION_OPAQUE:
+          /* Each lane gets 4 pixels, loading 16 bytes of which 12 are used */
+          for (; x + 10 <= width; x += 8)
+            {
+              __m256i in = _mm256_inserti128_si256 (_mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i *) (src_data + 3 * x))),
+                                                    _mm_loadu_si128 ((const __m128i *) (src_data + 3 * x + 12)),
+                                                    1);
+              _mm256_storeu_si256 ((__m256i *) (dest_data + 4 * x),
+                                   _mm256_or_si256 (_mm256_shuffle_epi8 (in, shuffle), alpha_mask));
+            }
+          break;
+
+        case CONVERSION_PREMULTIPLY:
+          for (; x + 8 <= width; x += 8)
+            {
+              __m256i in = _mm256_loadu_si256 ((const __m256i *) (src_data + 4 * x));
+              _mm256_storeu_si256 ((__m256i *) (dest_data + 4 * x),
+                                   premultiply_avx2 (_mm256_shuffle_epi8 (in, shuffle),
+                                                     _mm256_shuffle_epi8 (in, alpha_shuffle),
+                                                     alpha_mask));
+            }
+          break;
+
+        case CONVERSION_COPY:
+        default:
+          g_assert_not_reached ();
+        }
+
+      convert_pixels (dest_data + 4 * x,
+                      src_data + (conversion->type == CONVERSION_OPAQUE ? 3 : 4) * x,
+                      width - x,
+                      conversion);
+
+      dest_data += dest_stride;
+      src_data += src_stride;
+    }
+}
+
+static gboolean
+kernel_avx2_supported (void)
+{
+  return __builtin_cpu_supports ("avx2");
+}
+#endif
+
+#if defined (__ARM_NEON) && defined (__aarch64__)
+static inline uint8x16_t
+premultiply_neon (uint8x16_t pixels,
+                  uint8x16_t alpha,
+                  uint8x16_t alpha_mask)
+{
+  const uint16x8_t bias = vdupq_n_u16 (0x80);
+  uint16x8_t lo, hi;
+
+  lo = vaddq_u16 (vmull_u8 (vget_low_u8 (pixels), vget_low_u8 (alpha)), bias);
+  hi = vaddq_u16 (vmull_high_u8 (pixels, alpha), bias);
+  lo = vsraq_n_u16 (lo, lo, 8);
+  hi = vsraq_n_u16 (hi, hi, 8);
+
+  return vbslq_u8 (alpha_mask, pixels, vcombine_u8 (vshrn_n_u16 (lo, 8), vshrn_n_u16 (hi, 8)));
+}
+
+static void
+convert_neon (guchar           *dest_data,
+              gsize             dest_stride,
+              const guchar     *src_data,
+              gsize             src_stride,
+              gsize             width,
+              gsize             height,
+              const Conversion *conversion)
+{
+  guint8 masks[3][16];
+  uint8x16_t shuffle, alpha_shuffle, alpha_mask;
+  gsize x, y;
+
+  if (conversion->type == CONVERSION_COPY)
+    {
+      convert_memcpy (dest_data, dest_stride, src_data, src_stride, width, height);
+      return;
+    }
+
+  build_masks (conversion, masks[0], masks[1], masks[2]);
+  shuffle = vld1q_u8 (masks[0]);
+  alpha_shuffle = vld1q_u8 (masks[1]);
+  alpha_mask = vld1q_u8 (masks[2]);
+
+  for (y = 0; y < height; y++)
+    {
+      x = 0;
+
+      switch (conversion->type)
+        {
+        case CONVERSION_SWIZZLE:
+          for (; x + 4 <= width; x += 4)
+            vst1q_u8 (dest_data + 4 * x, vqtbl1q_u8 (vld1q_u8 (src_data + 4 * x), shuffle));
+          break;
+
+        case CONVERSION_OPAQUE:
+          /* 4 pixels are 12 bytes, but we load 16 */
+          for (; x + 6 <= width; x += 4)
+            vst1q_u8 (dest_data + 4 * x,
+                      vorrq_u8 (vqtbl1q_u8 (vld1q_u8 (src_data + 3 * x), shuffle), alpha_mask));
+          break;
+
+        case CONVERSION_PREMULTIPLY:
+          for (; x + 4 <= width; x += 4)
+            {
+              uint8x16_t in = vld1q_u8 (src_data + 4 * x);
+              vst1q_u8 (dest_data + 4 * x,
+                        premultiply_neon (vqtbl1q_u8 (in, shuffle),
+                                          vqtbl1q_u8 (in, alpha_shuffle),
+                                          alpha_mask));
+            }
+          break;
+
+        case CONVERSION_COPY:
+        default:
+          g_assert_not_reached ();
+        }
+
+      convert_pixels (dest_data + 4 * x,
+                      src_data + (conversion->type == CONVERSION_OPAQUE ? 3 : 4) * x,
+                      width - x,
+                      conversion);
+
+      dest_data += dest_stride;
+      src_data += src_stride;
+    }
+}
+#endif
+
+static const ConversionKernel conversion_kernels[] = {
+#ifdef HAVE_AVX2_TARGET
+  { "avx2", convert_avx2, kernel_avx2_supported },
+  { "ssse3", convert_ssse3, kernel_ssse3_supported },
+#endif
+#if defined (__ARM_NEON) && defined (__aarch64__)
+  { "neon", convert_neon, kernel_always_supported },
+#endif
+  { "c", convert_c, kernel_always_supported },
+};
+
+static const ConversionKernel *conversion_kernel = NULL;
+
+static const ConversionKernel *
+get_conversion_kernel (void)
+{
+  if (g_once_init_enter (&conversion_kernel))
+    {
+      const ConversionKernel *kernel = NULL;
+      guint i;
+
+      for (i = 0; i < G_N_ELEMENTS (conversion_kernels); i++)
+        {
+          if (conversion_kernels[i].supported ())
+            {
+              kernel = &conversion_kernels[i];
+              break;
+            }
+        }
+
+      g_once_init_leave (&conversion_kernel, kernel);
+    }
+
+  return conversion_kernel;
+}
+
+/*<private>
+ * gdk_memory_convert_set_kernel:
+ * @name: the name of a kernel, like "ssse3" or "c"
+ *
+ * Overrides the automatically selected conversion implementation.
+ * This is meant for benchmarks and tests.
+ *
+ * Returns: %TRUE if the kernel is available on this machine
+ */
+gboolean
+gdk_memory_convert_set_kernel (const char *name)
+{
+  guint i;
+
+  get_conversion_kernel ();
+
+  for (i = 0; i < G_N_ELEMENTS (conversion_kernels); i++)
+    {
+      if (strcmp (conversion_kernels[i].name, name) == 0 &&
+          conversion_kernels[i].supported ())
+        {
+          conversion_kernel = &conversion_kernels[i];
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+void
+gdk_memory_convert (guchar          *dest_data,
+                    gsize            dest_stride,
+                    GdkMemoryFormat  dest_format,
+                    const guchar    *src_data,
+                    gsize            src_stride,
+                    GdkMemoryFormat  src_format,
+                    gsize            width,
+                    gsize            height)
+{
+  g_assert (dest_format < 3);
+  g_assert (src_format < GDK_MEMORY_N_FORMATS);
+
+  get_conversion_kernel ()->convert (dest_data, dest_stride,
+                                     src_data, src_stride,
+                                     width, height,
+                                     &conversions[src_format][dest_format]);
+}
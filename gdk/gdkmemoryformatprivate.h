@@ -0,0 +1,39 @@
+/*
+ * Copyright © 2018 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors: Benjamin Otte <otte@gnome.org>
+ */
+
+#ifndef __GDK_MEMORY_FORMAT_PRIVATE_H__
+#define __GDK_MEMORY_FORMAT_PRIVATE_H__
+
+#include <gdk/gdk.h>
+
+G_BEGIN_DECLS
+
+void                    gdk_memory_convert                  (guchar            *dest_data,
+                                                             gsize              dest_stride,
+                                                             GdkMemoryFormat    dest_format,
+                                                             const guchar      *src_data,
+                                                             gsize              src_stride,
+                                                             GdkMemoryFormat    src_format,
+                                                             gsize              width,
+                                                             gsize              height);
+gboolean                gdk_memory_convert_set_kernel       (const char        *name);
+
+G_END_DECLS
+
+#endif /* __GDK_MEMORY_FORMAT_PRIVATE_H__ */
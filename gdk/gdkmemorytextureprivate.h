@@ -22,6 +22,7 @@
 
 #include "gdkmemorytexture.h"
 
+#include "gdkmemoryformatprivate.h"
 #include "gdktextureprivate.h"
 
 G_BEGIN_DECLS
@@ -37,15 +38,6 @@ GdkMemoryFormat         gdk_memory_texture_get_format       (GdkMemoryTexture  *
 const guchar *          gdk_memory_texture_get_data         (GdkMemoryTexture  *self);
 gsize                   gdk_memory_texture_get_stride       (GdkMemoryTexture  *self);
 
-void                    gdk_memory_convert                  (guchar            *dest_data,
-                                                             gsize              dest_stride,
-                                                             GdkMemoryFormat    dest_format,
-                                                             const guchar      *src_data,
-                                                             gsize              src_stride,
-                                                             GdkMemoryFormat    src_format,
-                                                             gsize              width,
-                                                             gsize              height);
-
 
 G_END_DECLS
 
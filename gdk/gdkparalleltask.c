@@ -0,0 +1,147 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkparalleltaskprivate.h"
+
+/* All users share one thread pool. Tasks may run nested, from inside
+ * other tasks, so nobody must wait for a task that hasn't started:
+ * the pool might be busy with the task that is waiting. Tasks take
+ * their work items from a shared queue, so once the calling thread
+ * returns from its own run, all work is taken and the tasks that
+ * didn't start yet are skipped.
+ */
+
+typedef struct
+{
+  GdkTaskFunc task_func;
+  gpointer task_data;
+
+  GMutex lock;
+  GCond cond;
+  guint n_running;
+  gboolean done;
+} TaskData;
+
+static void
+task_data_clear (gpointer data)
+{
+  TaskData *task = data;
+
+  g_mutex_clear (&task->lock);
+  g_cond_clear (&task->cond);
+}
+
+static void
+gdk_parallel_task_thread_func (gpointer data,
+                               gpointer unused)
+{
+  TaskData *task = data;
+
+  g_mutex_lock (&task->lock);
+  if (task->done)
+    {
+      g_mutex_unlock (&task->lock);
+      g_atomic_rc_box_release_full (task, task_data_clear);
+      return;
+    }
+  task->n_running++;
+  g_mutex_unlock (&task->lock);
+
+  task->task_func (task->task_data);
+
+  g_mutex_lock (&task->lock);
+  task->n_running--;
+  if (task->n_running == 0)
+    g_cond_signal (&task->cond);
+  g_mutex_unlock (&task->lock);
+
+  g_atomic_rc_box_release_full (task, task_data_clear);
+}
+
+static GThreadPool *
+gdk_parallel_task_get_pool (void)
+{
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool;
+
+      new_pool = g_thread_pool_new (gdk_parallel_task_thread_func,
+                                    NULL,
+                                    MAX (g_get_num_processors (), 2) - 1,
+                                    FALSE,
+                                    NULL);
+
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  return pool;
+}
+
+/*<private>
+ * gdk_parallel_task_run:
+ * @task_func: the function to run
+ * @task_data: data to pass to @task_func
+ * @max_tasks: how often @task_func may run at once
+ *
+ * Runs @task_func in up to @max_tasks threads at once, one of them
+ * the calling thread, and returns when they are all done.
+ *
+ * @task_func must take work items from a queue in @task_data, for
+ * example with g_atomic_int_add() on an index, until there are none
+ * left. It is not called for every one of the @max_tasks.
+ */
+void
+gdk_parallel_task_run (GdkTaskFunc task_func,
+                       gpointer    task_data,
+                       guint       max_tasks)
+{
+  TaskData *task;
+  guint i, n_workers;
+
+  n_workers = MIN (max_tasks, g_get_num_processors ());
+  if (n_workers > 0)
+    n_workers--;
+
+  if (n_workers == 0)
+    {
+      task_func (task_data);
+      return;
+    }
+
+  task = g_atomic_rc_box_new0 (TaskData);
+  task->task_func = task_func;
+  task->task_data = task_data;
+  g_mutex_init (&task->lock);
+  g_cond_init (&task->cond);
+
+  for (i = 0; i < n_workers; i++)
+    g_thread_pool_push (gdk_parallel_task_get_pool (), g_atomic_rc_box_acquire (task), NULL);
+
+  task_func (task_data);
+
+  g_mutex_lock (&task->lock);
+  task->done = TRUE;
+  while (task->n_running > 0)
+    g_cond_wait (&task->cond, &task->lock);
+  g_mutex_unlock (&task->lock);
+
+  g_atomic_rc_box_release_full (task, task_data_clear);
+}
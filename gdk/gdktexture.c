@@ -44,6 +44,8 @@
 #include "gdkmemorytextureprivate.h"
 #include "gdkpaintable.h"
 #include "gdksnapshot.h"
+#include "loaders/gdkpngprivate.h"
+#include "loaders/gdkjpegprivate.h"
 
 #include <graphene.h>
 
@@ -311,6 +313,76 @@ gdk_texture_new_for_pixbuf (GdkPixbuf *pixbuf)
   return texture;
 }
 
+/* Sniffs the format of the image in @stream and decodes it into
+ * a texture. PNG and JPEG are decoded directly into the memory of
+ * a #GdkMemoryTexture, everything else goes through GdkPixbuf.
+ */
+static GdkTexture *
+gdk_texture_new_from_stream (GInputStream  *stream,
+                             GCancellable  *cancellable,
+                             GError       **error)
+{
+  GBufferedInputStream *buffered;
+  GdkTexture *texture;
+  GdkPixbuf *pixbuf;
+  const guchar *data;
+  gsize size;
+
+  buffered = G_BUFFERED_INPUT_STREAM (g_buffered_input_stream_new (stream));
+  texture = NULL;
+
+  if (g_buffered_input_stream_fill (buffered, 8, cancellable, error) < 0)
+    goto out;
+
+  data = g_buffered_input_stream_peek_buffer (buffered, &size);
+
+#ifdef HAVE_PNG
+  if (gdk_is_png (data, size))
+    {
+      texture = gdk_load_png (G_INPUT_STREAM (buffered), cancellable, error);
+      goto out;
+    }
+#endif
+
+#ifdef HAVE_JPEG
+  if (gdk_is_jpeg (data, size))
+    {
+      texture = gdk_load_jpeg (G_INPUT_STREAM (buffered), cancellable, error);
+      goto out;
+    }
+#endif
+
+  pixbuf = gdk_pixbuf_new_from_stream (G_INPUT_STREAM (buffered), cancellable, error);
+  if (pixbuf == NULL)
+    goto out;
+
+  texture = gdk_texture_new_for_pixbuf (pixbuf);
+  g_object_unref (pixbuf);
+
+out:
+  g_object_unref (buffered);
+
+  return texture;
+}
+
+static GdkTexture *
+gdk_texture_new_from_file_internal (GFile         *file,
+                                    GCancellable  *cancellable,
+                                    GError       **error)
+{
+  GdkTexture *texture;
+  GInputStream *stream;
+
+  stream = G_INPUT_STREAM (g_file_read (file, cancellable, error));
+  if (stream == NULL)
+    return NULL;
+
+  texture = gdk_texture_new_from_stream (stream, cancellable, error);
+  g_object_unref (stream);
+
+  return texture;
+}
+
 /**
  * gdk_texture_new_from_resource:
  * @resource_path: the path of the resource file
@@ -332,16 +404,23 @@ gdk_texture_new_from_resource (const char *resource_path)
 {
   GError *error = NULL;
   GdkTexture *texture;
-  GdkPixbuf *pixbuf;
+  GInputStream *stream;
+  GBytes *bytes;
 
   g_return_val_if_fail (resource_path != NULL, NULL);
 
-  pixbuf = gdk_pixbuf_new_from_resource (resource_path, &error);
-  if (pixbuf == NULL)
+  /* Uncompressed resources are mapped, so this doesn't copy anything */
+  bytes = g_resources_lookup_data (resource_path, 0, &error);
+  if (bytes == NULL)
     g_error ("Resource path %s is not a valid image: %s", resource_path, error->message);
 
-  texture = gdk_texture_new_for_pixbuf (pixbuf);
-  g_object_unref (pixbuf);
+  stream = g_memory_input_stream_new_from_bytes (bytes);
+  g_bytes_unref (bytes);
+
+  texture = gdk_texture_new_from_stream (stream, NULL, &error);
+  g_object_unref (stream);
+  if (texture == NULL)
+    g_error ("Resource path %s is not a valid image: %s", resource_path, error->message);
 
   return texture;
 }
@@ -364,26 +443,87 @@ GdkTexture *
 gdk_texture_new_from_file (GFile   *file,
                            GError **error)
 {
-  GdkTexture *texture;
-  GdkPixbuf *pixbuf;
-  GInputStream *stream;
-
   g_return_val_if_fail (G_IS_FILE (file), NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  stream = G_INPUT_STREAM (g_file_read (file, NULL, error));
-  if (stream == NULL)
-    return NULL;
+  return gdk_texture_new_from_file_internal (file, NULL, error);
+}
 
-  pixbuf = gdk_pixbuf_new_from_stream (stream, NULL, error);
-  g_object_unref (stream);
-  if (pixbuf == NULL)
-    return NULL;
+static void
+load_file_in_thread (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+  GFile *file = task_data;
+  GdkTexture *texture;
+  GError *error = NULL;
 
-  texture = gdk_texture_new_for_pixbuf (pixbuf);
-  g_object_unref (pixbuf);
+  texture = gdk_texture_new_from_file_internal (file, cancellable, &error);
+  if (texture)
+    g_task_return_pointer (task, texture, g_object_unref);
+  else
+    g_task_return_error (task, error);
+}
 
-  return texture;
+/**
+ * gdk_texture_new_from_file_async:
+ * @file: #GFile to load
+ * @cancellable: (nullable): optional #GCancellable object
+ * @callback: (scope async): callback to call when the texture is loaded
+ * @user_data: (closure): the data to pass to callback function
+ *
+ * Asynchronously creates a new texture by loading an image from a file.
+ *
+ * The image is read and decoded in a worker thread, so this can be
+ * used to load many or large images without blocking the main loop.
+ * The supported formats are the same as for gdk_texture_new_from_file().
+ *
+ * When the operation is finished, @callback will be called. You can
+ * then call gdk_texture_new_from_file_finish() to get the result of
+ * the operation.
+ *
+ * Since: 4.2
+ */
+void
+gdk_texture_new_from_file_async (GFile               *file,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
+{
+  GTask *task;
+
+  g_return_if_fail (G_IS_FILE (file));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gdk_texture_new_from_file_async);
+  g_task_set_task_data (task, g_object_ref (file), g_object_unref);
+  g_task_run_in_thread (task, load_file_in_thread);
+  g_object_unref (task);
+}
+
+/**
+ * gdk_texture_new_from_file_finish:
+ * @result: a #GAsyncResult
+ * @error: Return location for an error
+ *
+ * Finishes an asynchronous load started with
+ * gdk_texture_new_from_file_async().
+ *
+ * Returns: (transfer full) (nullable): a new #GdkTexture or %NULL
+ *   if an error occurred
+ *
+ * Since: 4.2
+ */
+GdkTexture *
+gdk_texture_new_from_file_finish (GAsyncResult  *result,
+                                  GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gdk_texture_new_from_file_async, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
 }
 
 /**
@@ -0,0 +1,299 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkjpegprivate.h"
+
+#include "gdkintl.h"
+#include "gdkmemorytextureprivate.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <jpeglib.h>
+#include <jerror.h>
+
+/* Like the PNG loader, this decodes scanlines straight into the
+ * memory of the texture. With libjpeg-turbo, the decoder produces
+ * GDK_MEMORY_DEFAULT directly. Plain libjpeg gives us 3 byte RGB,
+ * which is still better than going through a GdkPixbuf.
+ */
+
+#define BUFFER_SIZE 4096
+
+typedef struct
+{
+  struct jpeg_error_mgr pub;
+  jmp_buf setjmp_buffer;
+  GError *error;
+} GdkJpegErrorManager;
+
+typedef struct
+{
+  struct jpeg_source_mgr pub;
+  GInputStream *stream;
+  GCancellable *cancellable;
+  GError **error;
+  JOCTET buffer[BUFFER_SIZE];
+} GdkJpegSource;
+
+gboolean
+gdk_is_jpeg (const guchar *data,
+             gsize         size)
+{
+  return size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff;
+}
+
+static void
+gdk_jpeg_error_exit (j_common_ptr info)
+{
+  GdkJpegErrorManager *manager = (GdkJpegErrorManager *) info->err;
+  char message[JMSG_LENGTH_MAX];
+
+  if (manager->error == NULL)
+    {
+      info->err->format_message (info, message);
+      g_set_error (&manager->error,
+                   G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   _("Error reading JPEG data: %s"), message);
+    }
+
+  longjmp (manager->setjmp_buffer, 1);
+}
+
+static void
+gdk_jpeg_output_message (j_common_ptr info)
+{
+}
+
+static void
+gdk_jpeg_init_source (j_decompress_ptr info)
+{
+}
+
+static boolean
+gdk_jpeg_fill_input_buffer (j_decompress_ptr info)
+{
+  GdkJpegSource *source = (GdkJpegSource *) info->src;
+  gssize n_read;
+
+  n_read = g_input_stream_read (source->stream,
+                                source->buffer, BUFFER_SIZE,
+                                source->cancellable,
+                                source->error);
+  if (n_read < 0)
+    ERREXIT (info, JERR_FILE_READ);
+
+  if (n_read == 0)
+    {
+      /* Insert a fake EOI marker, like jdatasrc.c does, so
+       * truncated files still produce an image.
+       */
+      WARNMS (info, JWRN_JPEG_EOF);
+      source->buffer[0] = (JOCTET) 0xff;
+      source->buffer[1] = (JOCTET) JPEG_EOI;
+      n_read = 2;
+    }
+
+  source->pub.next_input_byte = source->buffer;
+  source->pub.bytes_in_buffer = n_read;
+
+  return TRUE;
+}
+
+static void
+gdk_jpeg_skip_input_data (j_decompress_ptr info,
+                          long             num_bytes)
+{
+  GdkJpegSource *source = (GdkJpegSource *) info->src;
+
+  if (num_bytes <= 0)
+    return;
+
+  while (num_bytes > (long) source->pub.bytes_in_buffer)
+    {
+      num_bytes -= source->pub.bytes_in_buffer;
+      gdk_jpeg_fill_input_buffer (info);
+    }
+
+  source->pub.next_input_byte += num_bytes;
+  source->pub.bytes_in_buffer -= num_bytes;
+}
+
+static void
+gdk_jpeg_term_source (j_decompress_ptr info)
+{
+}
+
+static void
+convert_cmyk_to_rgba (guchar   *row,
+                      gsize     width,
+                      gboolean  inverted)
+{
+  gsize x;
+
+  for (x = 0; x < width; x++, row += 4)
+    {
+      guint c = row[0];
+      guint m = row[1];
+      guint y = row[2];
+      guint k = row[3];
+
+      if (!inverted)
+        {
+          c = 255 - c;
+          m = 255 - m;
+          y = 255 - y;
+          k = 255 - k;
+        }
+
+      row[0] = c * k / 255;
+      row[1] = m * k / 255;
+      row[2] = y * k / 255;
+      row[3] = 255;
+    }
+}
+
+#ifndef JCS_EXTENSIONS
+static void
+convert_gray_to_rgb (guchar *row,
+                     gsize   width)
+{
+  gsize x;
+
+  for (x = width; x-- > 0; )
+    row[3 * x] = row[3 * x + 1] = row[3 * x + 2] = row[x];
+}
+#endif
+
+GdkTexture *
+gdk_load_jpeg (GInputStream  *stream,
+               GCancellable  *cancellable,
+               GError       **error)
+{
+  struct jpeg_decompress_struct info;
+  GdkJpegErrorManager jerr;
+  GdkJpegSource source;
+  GdkMemoryFormat format;
+  guchar * volatile pixels;
+  gsize stride, width, height, bpp;
+  GdkTexture *texture;
+  GBytes *bytes;
+
+  pixels = NULL;
+
+  info.err = jpeg_std_error (&jerr.pub);
+  jerr.pub.error_exit = gdk_jpeg_error_exit;
+  jerr.pub.output_message = gdk_jpeg_output_message;
+  jerr.error = NULL;
+
+  source.pub.init_source = gdk_jpeg_init_source;
+  source.pub.fill_input_buffer = gdk_jpeg_fill_input_buffer;
+  source.pub.skip_input_data = gdk_jpeg_skip_input_data;
+  source.pub.resync_to_restart = jpeg_resync_to_restart;
+  source.pub.term_source = gdk_jpeg_term_source;
+  source.pub.next_input_byte = NULL;
+  source.pub.bytes_in_buffer = 0;
+  source.stream = stream;
+  source.cancellable = cancellable;
+  source.error = &jerr.error;
+
+  if (setjmp (jerr.setjmp_buffer))
+    {
+      g_free (pixels);
+      jpeg_destroy_decompress (&info);
+      g_propagate_error (error, jerr.error);
+      return NULL;
+    }
+
+  jpeg_create_decompress (&info);
+  info.src = &source.pub;
+
+  jpeg_read_header (&info, TRUE);
+
+  switch ((int) info.jpeg_color_space)
+    {
+    case JCS_CMYK:
+    case JCS_YCCK:
+      info.out_color_space = JCS_CMYK;
+      format = GDK_MEMORY_R8G8B8A8_PREMULTIPLIED;
+      bpp = 4;
+      break;
+
+#ifdef JCS_EXTENSIONS
+    default:
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+      info.out_color_space = JCS_EXT_BGRA;
+#else
+      info.out_color_space = JCS_EXT_ARGB;
+#endif
+      format = GDK_MEMORY_DEFAULT;
+      bpp = 4;
+      break;
+#else
+    case JCS_GRAYSCALE:
+      info.out_color_space = JCS_GRAYSCALE;
+      format = GDK_MEMORY_R8G8B8;
+      bpp = 3;
+      break;
+
+    default:
+      info.out_color_space = JCS_RGB;
+      format = GDK_MEMORY_R8G8B8;
+      bpp = 3;
+      break;
+#endif
+    }
+
+  jpeg_start_decompress (&info);
+
+  width = info.output_width;
+  height = info.output_height;
+  if (width > G_MAXINT / 4 || height > G_MAXSIZE / (4 * width))
+    ERREXIT1 (&info, JERR_IMAGE_TOO_BIG, G_MAXINT / 4);
+
+  stride = bpp * width;
+  pixels = g_try_malloc (stride * height);
+  if (pixels == NULL)
+    ERREXIT1 (&info, JERR_OUT_OF_MEMORY, 0);
+
+  while (info.output_scanline < height)
+    {
+      guchar *row = pixels + info.output_scanline * stride;
+
+      jpeg_read_scanlines (&info, &row, 1);
+
+      if (info.out_color_space == JCS_CMYK)
+        convert_cmyk_to_rgba (row, width, info.saw_Adobe_marker);
+#ifndef JCS_EXTENSIONS
+      else if (info.out_color_space == JCS_GRAYSCALE)
+        convert_gray_to_rgb (row, width);
+#endif
+    }
+
+  jpeg_finish_decompress (&info);
+  jpeg_destroy_decompress (&info);
+
+  bytes = g_bytes_new_take (pixels, stride * height);
+  texture = gdk_memory_texture_new (width, height,
+                                    format,
+                                    bytes,
+                                    stride);
+  g_bytes_unref (bytes);
+
+  return texture;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GDK_JPEG_PRIVATE_H__
+#define __GDK_JPEG_PRIVATE_H__
+
+#include "gdktexture.h"
+
+G_BEGIN_DECLS
+
+gboolean        gdk_is_jpeg                              (const guchar   *data,
+                                                         gsize           size);
+GdkTexture *    gdk_load_jpeg                            (GInputStream   *stream,
+                                                         GCancellable   *cancellable,
+                                                         GError        **error);
+
+G_END_DECLS
+
+#endif /* __GDK_JPEG_PRIVATE_H__ */
@@ -0,0 +1,243 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkpngprivate.h"
+
+#include "gdkintl.h"
+#include "gdkmemorytextureprivate.h"
+
+#include <png.h>
+
+/* The PNG loader decodes straight into the memory of the texture,
+ * in GDK_MEMORY_DEFAULT so that renderers can upload it without
+ * converting. libpng does all the expanding and swizzling, we only
+ * need to premultiply.
+ */
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define ALPHA 3
+#define COLOR 0
+#define FILLER PNG_FILLER_AFTER
+#else
+#define ALPHA 0
+#define COLOR 1
+#define FILLER PNG_FILLER_BEFORE
+#endif
+
+typedef struct
+{
+  GInputStream *stream;
+  GCancellable *cancellable;
+  GError *error;
+} GdkPngReader;
+
+gboolean
+gdk_is_png (const guchar *data,
+            gsize         size)
+{
+  return size >= 8 && png_sig_cmp ((png_const_bytep) data, 0, 8) == 0;
+}
+
+static void
+gdk_png_error (png_struct      *png,
+               png_const_charp  message)
+{
+  GdkPngReader *reader = png_get_error_ptr (png);
+
+  if (reader->error == NULL)
+    g_set_error (&reader->error,
+                 G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                 _("Error reading PNG data: %s"), message);
+
+  png_longjmp (png, 1);
+}
+
+static void
+gdk_png_warning (png_struct      *png,
+                 png_const_charp  message)
+{
+}
+
+static void
+gdk_png_read (png_struct *png,
+              png_byte   *data,
+              png_size_t  size)
+{
+  GdkPngReader *reader = png_get_io_ptr (png);
+  gsize n_read;
+
+  if (!g_input_stream_read_all (reader->stream,
+                                data, size,
+                                &n_read,
+                                reader->cancellable,
+                                &reader->error))
+    png_error (png, reader->error->message);
+
+  if (n_read != size)
+    png_error (png, "Unexpected end of data");
+}
+
+static void
+gdk_png_premultiply (png_struct   *png,
+                     png_row_info *row_info,
+                     png_byte     *data)
+{
+  png_uint_32 x;
+
+  for (x = 0; x < row_info->width; x++, data += 4)
+    {
+      guint a = data[ALPHA];
+      guint t;
+
+      if (a == 0xff)
+        continue;
+
+      if (a == 0)
+        {
+          data[COLOR] = data[COLOR + 1] = data[COLOR + 2] = 0;
+          continue;
+        }
+
+      t = data[COLOR] * a + 0x80;
+      data[COLOR] = ((t >> 8) + t) >> 8;
+      t = data[COLOR + 1] * a + 0x80;
+      data[COLOR + 1] = ((t >> 8) + t) >> 8;
+      t = data[COLOR + 2] * a + 0x80;
+      data[COLOR + 2] = ((t >> 8) + t) >> 8;
+    }
+}
+
+GdkTexture *
+gdk_load_png (GInputStream  *stream,
+              GCancellable  *cancellable,
+              GError       **error)
+{
+  GdkPngReader reader = { stream, cancellable, NULL };
+  png_struct *png;
+  png_info *info;
+  png_uint_32 width, height, y;
+  int depth, color_type, interlace;
+  /* Allocated after setjmp(), so they must be volatile */
+  guchar * volatile pixels;
+  guchar ** volatile rows;
+  GdkTexture *texture;
+  GBytes *bytes;
+  gsize stride;
+
+  pixels = NULL;
+  rows = NULL;
+
+  png = png_create_read_struct (PNG_LIBPNG_VER_STRING,
+                                &reader,
+                                gdk_png_error,
+                                gdk_png_warning);
+  if (png == NULL)
+    g_error ("Out of memory");
+
+  info = png_create_info_struct (png);
+  if (info == NULL)
+    g_error ("Out of memory");
+
+  png_set_read_fn (png, &reader, gdk_png_read);
+
+  if (setjmp (png_jmpbuf (png)))
+    {
+      g_free (pixels);
+      g_free (rows);
+      png_destroy_read_struct (&png, &info, NULL);
+      g_propagate_error (error, reader.error);
+      return NULL;
+    }
+
+  png_read_info (png, info);
+  png_get_IHDR (png, info,
+                &width, &height, &depth, &color_type, &interlace,
+                NULL, NULL);
+
+  if (width == 0 || height == 0 ||
+      width > G_MAXINT / 4 || height > G_MAXSIZE / (4 * width))
+    png_error (png, "Image too large");
+
+  if (color_type == PNG_COLOR_TYPE_PALETTE)
+    png_set_palette_to_rgb (png);
+
+  if (color_type == PNG_COLOR_TYPE_GRAY && depth < 8)
+    png_set_expand_gray_1_2_4_to_8 (png);
+
+  if (png_get_valid (png, info, PNG_INFO_tRNS))
+    png_set_tRNS_to_alpha (png);
+
+  if (depth == 16)
+    png_set_strip_16 (png);
+  else if (depth < 8)
+    png_set_packing (png);
+
+  if (color_type == PNG_COLOR_TYPE_GRAY ||
+      color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
+    png_set_gray_to_rgb (png);
+
+  if (interlace != PNG_INTERLACE_NONE)
+    png_set_interlace_handling (png);
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  png_set_bgr (png);
+#endif
+
+  if ((color_type & PNG_COLOR_MASK_ALPHA) ||
+      png_get_valid (png, info, PNG_INFO_tRNS))
+    {
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+      png_set_swap_alpha (png);
+#endif
+      png_set_read_user_transform_fn (png, gdk_png_premultiply);
+    }
+  else
+    {
+      png_set_filler (png, 0xff, FILLER);
+    }
+
+  png_read_update_info (png, info);
+
+  stride = 4 * width;
+  pixels = g_try_malloc (stride * height);
+  if (pixels == NULL)
+    png_error (png, "Out of memory");
+
+  rows = g_try_new (guchar *, height);
+  if (rows == NULL)
+    png_error (png, "Out of memory");
+
+  for (y = 0; y < height; y++)
+    rows[y] = pixels + y * stride;
+
+  png_read_image (png, rows);
+  png_read_end (png, info);
+
+  png_destroy_read_struct (&png, &info, NULL);
+  g_free (rows);
+
+  bytes = g_bytes_new_take (pixels, stride * height);
+  texture = gdk_memory_texture_new (width, height,
+                                    GDK_MEMORY_DEFAULT,
+                                    bytes,
+                                    stride);
+  g_bytes_unref (bytes);
+
+  return texture;
+}
@@ -25,6 +25,10 @@
 #include "gdkinternals.h"
 #include "gdkprofilerprivate.h"
 
+/* Like with buffer age, up to this many buffers are kept around, so
+ * that a released one usually exists when drawing */
+#define MAX_BUFFERS 3
+
 static const cairo_user_data_key_t gdk_wayland_cairo_context_key;
 static const cairo_user_data_key_t gdk_wayland_cairo_region_key;
 
@@ -84,6 +88,9 @@ gdk_wayland_cairo_context_remove_surface (GdkWaylandCairoContext *self,
                                           cairo_surface_t        *surface)
 {
   self->surfaces = g_slist_remove (self->surfaces, surface);
+  self->released_surfaces = g_slist_remove (self->released_surfaces, surface);
+  if (self->last_surface == surface)
+    self->last_surface = NULL;
 
   cairo_surface_set_user_data (surface, &gdk_wayland_cairo_context_key, NULL, NULL);
   cairo_surface_destroy (surface);
@@ -100,15 +107,16 @@ gdk_wayland_cairo_context_buffer_release (void             *_data,
   if (self == NULL)
     return;
 
-  /* Cache one surface for reuse when drawing */
-  if (self->cached_surface == NULL)
+  /* Keep a few surfaces for reuse when drawing, and get rid of
+   * all the extra ones */
+  if (g_slist_length (self->surfaces) > MAX_BUFFERS &&
+      cairo_surface != self->last_surface)
     {
-      self->cached_surface = cairo_surface;
+      gdk_wayland_cairo_context_remove_surface (self, cairo_surface);
       return;
     }
 
-  /* Get rid of all the extra ones */
-  gdk_wayland_cairo_context_remove_surface (self, cairo_surface);
+  self->released_surfaces = g_slist_prepend (self->released_surfaces, cairo_surface);
 }
 
 static const struct wl_buffer_listener buffer_listener = {
@@ -150,13 +158,36 @@ gdk_wayland_cairo_context_begin_frame (GdkDrawContext *draw_context,
   GSList *l;
   cairo_t *cr;
 
-  if (self->cached_surface)
-    self->paint_surface = g_steal_pointer (&self->cached_surface);
+  if (self->released_surfaces)
+    {
+      self->paint_surface = self->released_surfaces->data;
+      self->released_surfaces = g_slist_delete_link (self->released_surfaces, self->released_surfaces);
+    }
   else
     self->paint_surface = gdk_wayland_cairo_context_create_surface (self);
 
+  /* The parts that changed since the surface was last used but are not
+   * redrawn now are copied from the last frame, so that only the
+   * damaged region is in the frame region */
   surface_region = gdk_wayland_cairo_context_surface_get_region (self->paint_surface);
-  if (surface_region)
+  if (surface_region && self->last_surface && self->last_surface != self->paint_surface)
+    {
+      cairo_region_t *stale;
+
+      stale = cairo_region_copy (surface_region);
+      cairo_region_subtract (stale, region);
+      if (!cairo_region_is_empty (stale))
+        {
+          cr = cairo_create (self->paint_surface);
+          cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+          cairo_set_source_surface (cr, self->last_surface, 0, 0);
+          gdk_cairo_region (cr, stale);
+          cairo_fill (cr);
+          cairo_destroy (cr);
+        }
+      cairo_region_destroy (stale);
+    }
+  else if (surface_region)
     cairo_region_union (region, surface_region);
 
   for (l = self->surfaces; l; l = l->next)
@@ -188,13 +219,15 @@ gdk_wayland_cairo_context_end_frame (GdkDrawContext *draw_context,
   gdk_wayland_surface_notify_committed (surface);
 
   gdk_wayland_cairo_context_surface_clear_region (self->paint_surface);
+  self->last_surface = self->paint_surface;
   self->paint_surface = NULL;
 }
 
 static void
 gdk_wayland_cairo_context_clear_all_cairo_surfaces (GdkWaylandCairoContext *self)
 {
-  self->cached_surface = NULL;
+  g_clear_pointer (&self->released_surfaces, g_slist_free);
+  self->last_surface = NULL;
   while (self->surfaces)
     gdk_wayland_cairo_context_remove_surface (self, self->surfaces->data);
 }
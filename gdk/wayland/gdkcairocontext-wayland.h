@@ -40,7 +40,8 @@ struct _GdkWaylandCairoContext
   GdkCairoContext parent_instance;
 
   GSList *surfaces;
-  cairo_surface_t *cached_surface;
+  GSList *released_surfaces; /* Not used by the compositor, most recent first */
+  cairo_surface_t *last_surface; /* The one with the latest contents */
   cairo_surface_t *paint_surface;
 };
 
@@ -22,6 +22,7 @@
 
 #include "gdkcairocontext-x11.h"
 
+#include "gdkdisplay-x11.h"
 #include "gdkprivate-x11.h"
 
 #include "gdkcairo.h"
@@ -30,8 +31,306 @@
 
 #include <X11/Xlib.h>
 
+#ifdef HAVE_XSHM
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
+
 G_DEFINE_TYPE (GdkX11CairoContext, gdk_x11_cairo_context, GDK_TYPE_CAIRO_CONTEXT)
 
+#ifdef HAVE_XSHM
+
+/* With MIT-SHM we draw into an image that the X server reads from
+ * shared memory, instead of sending all pixels over the socket. The
+ * images are kept between frames, so only the frame region and what
+ * changed in the other image since are redrawn and put on the window.
+ *
+ * The last put of a frame asks for a completion event. Until it
+ * arrives, the X server may still be reading from the image, so the
+ * next frame draws into the other one.
+ */
+struct _GdkX11ShmImage
+{
+  XShmSegmentInfo info;
+  XImage *image;
+  GC gc;
+  cairo_surface_t *surface;
+  gboolean pending; /* The X server may still be reading from it */
+};
+
+static void
+gdk_x11_shm_image_free (GdkDisplay     *display,
+                        GdkX11ShmImage *shm)
+{
+  GdkX11Display *display_x11 = GDK_X11_DISPLAY (display);
+  Display *xdisplay = GDK_DISPLAY_XDISPLAY (display);
+
+  /* The segment is only detached after the X server is done with it */
+  g_hash_table_remove (display_x11->shm_images, GUINT_TO_POINTER (shm->info.shmseg));
+
+  cairo_surface_destroy (shm->surface);
+  XShmDetach (xdisplay, &shm->info);
+  XDestroyImage (shm->image);
+  shmdt (shm->info.shmaddr);
+  XFreeGC (xdisplay, shm->gc);
+  g_free (shm);
+}
+
+static GdkX11ShmImage *
+gdk_x11_shm_image_new (GdkSurface *surface,
+                       int         width,
+                       int         height)
+{
+  GdkDisplay *display = gdk_surface_get_display (surface);
+  GdkX11Display *display_x11 = GDK_X11_DISPLAY (display);
+  Display *xdisplay = GDK_DISPLAY_XDISPLAY (display);
+  Visual *visual;
+  GdkX11ShmImage *shm;
+  cairo_format_t format;
+  int depth;
+
+  if (!display_x11->have_shm ||
+      GDK_DISPLAY_DEBUG_CHECK (display, SHM_DISABLE))
+    return NULL;
+
+  /* Only pixel layouts that cairo can draw to directly */
+  visual = gdk_x11_display_get_window_visual (display_x11);
+  depth = gdk_x11_display_get_window_depth (display_x11);
+  if (depth == 32)
+    format = CAIRO_FORMAT_ARGB32;
+  else if (depth == 24)
+    format = CAIRO_FORMAT_RGB24;
+  else
+    return NULL;
+
+  if (visual->red_mask != 0xff0000 ||
+      visual->green_mask != 0xff00 ||
+      visual->blue_mask != 0xff)
+    return NULL;
+
+  shm = g_new0 (GdkX11ShmImage, 1);
+  shm->image = XShmCreateImage (xdisplay, visual, depth, ZPixmap, NULL,
+                                &shm->info, width, height);
+  if (shm->image == NULL)
+    {
+      g_free (shm);
+      return NULL;
+    }
+
+  if (shm->image->bits_per_pixel != 32 ||
+      shm->image->byte_order != (G_BYTE_ORDER == G_LITTLE_ENDIAN ? LSBFirst : MSBFirst) ||
+      shm->image->bytes_per_line != cairo_format_stride_for_width (format, width))
+    goto fail_image;
+
+  shm->info.shmid = shmget (IPC_PRIVATE, shm->image->bytes_per_line * height, IPC_CREAT | 0600);
+  if (shm->info.shmid < 0)
+    goto fail_image;
+
+  shm->info.shmaddr = shmat (shm->info.shmid, NULL, 0);
+  if (shm->info.shmaddr == (char *) -1)
+    goto fail_segment;
+
+  shm->image->data = shm->info.shmaddr;
+  shm->info.readOnly = False;
+
+  gdk_x11_display_error_trap_push (display);
+  XShmAttach (xdisplay, &shm->info);
+  if (gdk_x11_display_error_trap_pop (display))
+    {
+      /* This happens with remote displays, don't try again */
+      display_x11->have_shm = FALSE;
+      shmdt (shm->info.shmaddr);
+      goto fail_segment;
+    }
+
+  /* The segment goes away once both sides are detached */
+  shmctl (shm->info.shmid, IPC_RMID, NULL);
+
+  shm->gc = XCreateGC (xdisplay, GDK_SURFACE_XID (surface), 0, NULL);
+  shm->surface = cairo_image_surface_create_for_data ((guchar *) shm->image->data,
+                                                      format,
+                                                      width, height,
+                                                      shm->image->bytes_per_line);
+
+  if (display_x11->shm_images == NULL)
+    display_x11->shm_images = g_hash_table_new (NULL, NULL);
+  g_hash_table_insert (display_x11->shm_images, GUINT_TO_POINTER (shm->info.shmseg), shm);
+
+  return shm;
+
+fail_segment:
+  shmctl (shm->info.shmid, IPC_RMID, NULL);
+fail_image:
+  XDestroyImage (shm->image);
+  g_free (shm);
+  return NULL;
+}
+
+void
+_gdk_x11_cairo_context_shm_completed (GdkDisplay          *display,
+                                      XShmCompletionEvent *event)
+{
+  GdkX11Display *display_x11 = GDK_X11_DISPLAY (display);
+  GdkX11ShmImage *shm;
+
+  if (display_x11->shm_images == NULL)
+    return;
+
+  shm = g_hash_table_lookup (display_x11->shm_images, GUINT_TO_POINTER (event->shmseg));
+  if (shm)
+    shm->pending = FALSE;
+}
+
+static Bool
+is_shm_completion (Display  *xdisplay,
+                   XEvent   *xevent,
+                   XPointer  arg)
+{
+  GdkX11ShmImage *shm = (GdkX11ShmImage *) arg;
+  GdkDisplay *display = gdk_x11_lookup_xdisplay (xdisplay);
+
+  return xevent->type - GDK_X11_DISPLAY (display)->shm_event_base == ShmCompletion &&
+         ((XShmCompletionEvent *) xevent)->shmseg == shm->info.shmseg;
+}
+
+static void
+gdk_x11_shm_image_wait (GdkDisplay     *display,
+                        GdkX11ShmImage *shm)
+{
+  XEvent xevent;
+
+  if (!shm->pending)
+    return;
+
+  /* Only happens when frames come faster than the X server reads them */
+  XIfEvent (GDK_DISPLAY_XDISPLAY (display), &xevent, is_shm_completion, (XPointer) shm);
+  shm->pending = FALSE;
+}
+
+static void
+gdk_x11_cairo_context_clear_shm_images (GdkX11CairoContext *self)
+{
+  GdkDisplay *display = gdk_draw_context_get_display (GDK_DRAW_CONTEXT (self));
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (self->shm_images); i++)
+    {
+      if (self->shm_images[i])
+        {
+          gdk_x11_shm_image_wait (display, self->shm_images[i]);
+          gdk_x11_shm_image_free (display, self->shm_images[i]);
+          self->shm_images[i] = NULL;
+        }
+    }
+
+  g_clear_pointer (&self->shm_last_painted, cairo_region_destroy);
+}
+
+static gboolean
+gdk_x11_cairo_context_begin_shm_frame (GdkX11CairoContext *self,
+                                       cairo_region_t     *region)
+{
+  GdkSurface *surface = gdk_draw_context_get_surface (GDK_DRAW_CONTEXT (self));
+  GdkDisplay *display = gdk_surface_get_display (surface);
+  GdkX11ShmImage *shm;
+  int scale, width, height;
+  cairo_t *cr;
+
+  scale = gdk_surface_get_scale_factor (surface);
+  width = gdk_surface_get_width (surface) * scale;
+  height = gdk_surface_get_height (surface) * scale;
+
+  if (self->shm_images[0] &&
+      (cairo_image_surface_get_width (self->shm_images[0]->surface) != width ||
+       cairo_image_surface_get_height (self->shm_images[0]->surface) != height))
+    gdk_x11_cairo_context_clear_shm_images (self);
+
+  self->shm_current = 1 - self->shm_current;
+  shm = self->shm_images[self->shm_current];
+
+  if (shm == NULL)
+    {
+      shm = gdk_x11_shm_image_new (surface, width, height);
+      if (shm == NULL)
+        {
+          gdk_x11_cairo_context_clear_shm_images (self);
+          return FALSE;
+        }
+
+      self->shm_images[self->shm_current] = shm;
+
+      /* Nothing has been drawn into it yet */
+      cairo_region_union_rectangle (region, &(cairo_rectangle_int_t) {
+                                              0, 0,
+                                              gdk_surface_get_width (surface),
+                                              gdk_surface_get_height (surface)
+                                            });
+    }
+  else
+    {
+      gdk_x11_shm_image_wait (display, shm);
+
+      /* The image has the frame before the last one */
+      if (self->shm_last_painted)
+        cairo_region_union (region, self->shm_last_painted);
+    }
+
+  self->paint_surface = cairo_surface_reference (shm->surface);
+  cairo_surface_set_device_scale (self->paint_surface, scale, scale);
+
+  /* The image still has an old frame, so clear what gets repainted */
+  cr = cairo_create (self->paint_surface);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  gdk_cairo_region (cr, region);
+  cairo_fill (cr);
+  cairo_destroy (cr);
+
+  return TRUE;
+}
+
+static void
+gdk_x11_cairo_context_end_shm_frame (GdkX11CairoContext *self,
+                                     cairo_region_t     *painted)
+{
+  GdkSurface *surface = gdk_draw_context_get_surface (GDK_DRAW_CONTEXT (self));
+  Display *xdisplay = GDK_DISPLAY_XDISPLAY (gdk_surface_get_display (surface));
+  GdkX11ShmImage *shm = self->shm_images[self->shm_current];
+  cairo_region_t *region;
+  int scale, i, n_rects;
+
+  cairo_surface_flush (self->paint_surface);
+
+  scale = gdk_surface_get_scale_factor (surface);
+  region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+                                            0, 0,
+                                            gdk_surface_get_width (surface),
+                                            gdk_surface_get_height (surface)
+                                          });
+  cairo_region_intersect (region, painted);
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      XShmPutImage (xdisplay, GDK_SURFACE_XID (surface), shm->gc, shm->image,
+                    rect.x * scale, rect.y * scale,
+                    rect.x * scale, rect.y * scale,
+                    rect.width * scale, rect.height * scale,
+                    i == n_rects - 1);
+    }
+
+  if (n_rects > 0)
+    shm->pending = TRUE;
+
+  g_clear_pointer (&self->shm_last_painted, cairo_region_destroy);
+  self->shm_last_painted = region;
+}
+
+#endif /* HAVE_XSHM */
+
 static cairo_surface_t *
 create_cairo_surface_for_surface (GdkSurface *surface)
 {
@@ -63,6 +362,11 @@ gdk_x11_cairo_context_begin_frame (GdkDrawContext *draw_context,
   GdkSurface *surface;
   double sx, sy;
 
+#ifdef HAVE_XSHM
+  if (gdk_x11_cairo_context_begin_shm_frame (self, region))
+    return;
+#endif
+
   surface = gdk_draw_context_get_surface (draw_context);
   cairo_region_get_extents (region, &clip_box);
 
@@ -84,6 +388,15 @@ gdk_x11_cairo_context_end_frame (GdkDrawContext *draw_context,
   GdkX11CairoContext *self = GDK_X11_CAIRO_CONTEXT (draw_context);
   cairo_t *cr;
 
+#ifdef HAVE_XSHM
+  if (self->shm_images[self->shm_current])
+    {
+      gdk_x11_cairo_context_end_shm_frame (self, painted);
+      g_clear_pointer (&self->paint_surface, cairo_surface_destroy);
+      return;
+    }
+#endif
+
   cr = cairo_create (self->window_surface);
 
   cairo_set_source_surface (cr, self->paint_surface, 0, 0);
@@ -109,14 +422,40 @@ gdk_x11_cairo_context_cairo_create (GdkCairoContext *context)
   return cairo_create (self->paint_surface);
 }
 
+static void
+gdk_x11_cairo_context_surface_resized (GdkDrawContext *draw_context)
+{
+  GdkX11CairoContext *self = GDK_X11_CAIRO_CONTEXT (draw_context);
+
+#ifdef HAVE_XSHM
+  gdk_x11_cairo_context_clear_shm_images (self);
+#endif
+}
+
+static void
+gdk_x11_cairo_context_dispose (GObject *object)
+{
+  GdkX11CairoContext *self = GDK_X11_CAIRO_CONTEXT (object);
+
+#ifdef HAVE_XSHM
+  gdk_x11_cairo_context_clear_shm_images (self);
+#endif
+
+  G_OBJECT_CLASS (gdk_x11_cairo_context_parent_class)->dispose (object);
+}
+
 static void
 gdk_x11_cairo_context_class_init (GdkX11CairoContextClass *klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GdkDrawContextClass *draw_context_class = GDK_DRAW_CONTEXT_CLASS (klass);
   GdkCairoContextClass *cairo_context_class = GDK_CAIRO_CONTEXT_CLASS (klass);
 
+  gobject_class->dispose = gdk_x11_cairo_context_dispose;
+
   draw_context_class->begin_frame = gdk_x11_cairo_context_begin_frame;
   draw_context_class->end_frame = gdk_x11_cairo_context_end_frame;
+  draw_context_class->surface_resized = gdk_x11_cairo_context_surface_resized;
 
   cairo_context_class->cairo_create = gdk_x11_cairo_context_cairo_create;
 }
@@ -25,6 +25,12 @@
 
 #include "gdkcairocontextprivate.h"
 
+#include <X11/Xlib.h>
+
+#ifdef HAVE_XSHM
+#include <X11/extensions/XShm.h>
+#endif
+
 G_BEGIN_DECLS
 
 #define GDK_TYPE_X11_CAIRO_CONTEXT		(gdk_x11_cairo_context_get_type ())
@@ -36,6 +42,7 @@ G_BEGIN_DECLS
 
 typedef struct _GdkX11CairoContext GdkX11CairoContext;
 typedef struct _GdkX11CairoContextClass GdkX11CairoContextClass;
+typedef struct _GdkX11ShmImage GdkX11ShmImage;
 
 struct _GdkX11CairoContext
 {
@@ -43,6 +50,12 @@ struct _GdkX11CairoContext
 
   cairo_surface_t *window_surface;
   cairo_surface_t *paint_surface;
+
+  /* NULL if MIT-SHM can't be used. Frames alternate between the
+   * images, so we don't wait for the X server to read the last one */
+  GdkX11ShmImage *shm_images[2];
+  guint shm_current;
+  cairo_region_t *shm_last_painted; /* In the other image */
 };
 
 struct _GdkX11CairoContextClass
@@ -53,6 +66,11 @@ struct _GdkX11CairoContextClass
 GDK_AVAILABLE_IN_ALL
 GType gdk_x11_cairo_context_get_type (void) G_GNUC_CONST;
 
+#ifdef HAVE_XSHM
+void _gdk_x11_cairo_context_shm_completed (GdkDisplay          *display,
+                                           XShmCompletionEvent *event);
+#endif
+
 G_END_DECLS
 
 #endif /* __GDK_X11_CAIRO_CONTEXT__ */
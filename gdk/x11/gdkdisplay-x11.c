@@ -77,6 +77,10 @@
 #include <X11/extensions/Xrandr.h>
 #endif
 
+#ifdef HAVE_XSHM
+#include <X11/extensions/XShm.h>
+#endif
+
 enum {
   XEVENT,
   LAST_SIGNAL
@@ -1037,6 +1041,14 @@ gdk_x11_display_translate_event (GdkEventTranslator *translator,
       break;
 
     default:
+#ifdef HAVE_XSHM
+      if (display_x11->shm_event_base &&
+          xevent->type - display_x11->shm_event_base == ShmCompletion)
+        {
+          _gdk_x11_cairo_context_shm_completed (display, (XShmCompletionEvent *) xevent);
+        }
+      else
+#endif
 #ifdef HAVE_RANDR
       if (xevent->type - display_x11->xrandr_event_base == RRScreenChangeNotify ||
           xevent->type - display_x11->xrandr_event_base == RRNotify)
@@ -1487,6 +1499,15 @@ gdk_x11_display_open (const char *display_name)
 
   gdk_display_set_input_shapes (display, display_x11->have_input_shapes);
 
+  display_x11->have_shm = FALSE;
+#ifdef HAVE_XSHM
+  if (XShmQueryExtension (display_x11->xdisplay))
+    {
+      display_x11->have_shm = TRUE;
+      display_x11->shm_event_base = XShmGetEventBase (display_x11->xdisplay);
+    }
+#endif
+
   display_x11->trusted_client = TRUE;
   {
     Window root, child;
@@ -1936,6 +1957,8 @@ gdk_x11_display_finalize (GObject *object)
   /* X ID hashtable */
   g_hash_table_destroy (display_x11->xid_ht);
 
+  g_clear_pointer (&display_x11->shm_images, g_hash_table_destroy);
+
   XCloseDisplay (display_x11->xdisplay);
 
   /* error traps */
@@ -122,6 +122,11 @@ struct _GdkX11Display
   guint have_input_shapes : 1;
   int shape_event_base;
 
+  /* Cleared when attaching a segment fails, e.g. on remote displays */
+  guint have_shm : 1;
+  int shm_event_base;
+  GHashTable *shm_images; /* ShmSeg -> GdkX11ShmImage being put */
+
   GSList *error_traps;
 
   int wm_moveresize_button;
@@ -8,9 +8,11 @@
 
 #include "gdk/gdkglcontextprivate.h"
 #include "gdk/gdkmemorytextureprivate.h"
+#include "gdk/gdkparalleltaskprivate.h"
 
 #include <graphene.h>
 #include <cairo.h>
+#include <pango/pangocairo.h>
 #include <epoxy/gl.h>
 #include <string.h>
 
@@ -37,6 +39,7 @@ static gboolean glyph_cache_equal      (gconstpointer v1,
                                         gconstpointer v2);
 static void     glyph_cache_key_free   (gpointer      v);
 static void     glyph_cache_value_free (gpointer      v);
+static void     pending_glyph_clear    (gpointer      v);
 
 GskGLGlyphCache *
 gsk_gl_glyph_cache_new (GdkDisplay *display,
@@ -51,6 +54,8 @@ gsk_gl_glyph_cache_new (GdkDisplay *display,
                                                    glyph_cache_key_free, glyph_cache_value_free);
 
   glyph_cache->atlases = gsk_gl_texture_atlases_ref (atlases);
+  glyph_cache->pending = g_array_new (FALSE, FALSE, sizeof (GskGLPendingGlyph));
+  g_array_set_clear_func (glyph_cache->pending, pending_glyph_clear);
 
   glyph_cache->ref_count = 1;
 
@@ -73,6 +78,7 @@ gsk_gl_glyph_cache_unref (GskGLGlyphCache *self)
   if (self->ref_count == 1)
     {
       gsk_gl_texture_atlases_unref (self->atlases);
+      g_array_unref (self->pending);
       g_hash_table_unref (self->hash_table);
       g_free (self);
       return;
@@ -110,120 +116,341 @@ glyph_cache_value_free (gpointer v)
   g_free (v);
 }
 
-static gboolean
-render_glyph (GlyphCacheKey    *key,
-              GskGLCachedGlyph *value,
-              GskImageRegion   *region)
+static void
+pending_glyph_clear (gpointer v)
 {
-  cairo_surface_t *surface;
-  cairo_t *cr;
+  GskGLPendingGlyph *pending = v;
+
+  cairo_scaled_font_destroy (pending->scaled_font);
+}
+
+/* Uploads
+ *
+ * New glyphs only get a place in the atlas when they are added.
+ * They are rasterized and uploaded together, right before the
+ * frame is rendered. Rasterization is split over a thread pool
+ * when there are enough glyphs, and glyphs that are next to each
+ * other in an atlas are uploaded with a single glTexSubImage2D().
+ */
+
+#define MIN_GLYPHS_FOR_THREADS 16
+
+struct _GskGLPendingGlyph
+{
+  GlyphCacheKey *key;
+  GskGLCachedGlyph *value;
   cairo_scaled_font_t *scaled_font;
-  PangoGlyphString glyph_string;
-  PangoGlyphInfo glyph_info;
-  int surface_width, surface_height;
+
+  /* The area to upload, including padding in the atlas */
+  int x;
+  int y;
+  int width;
+  int height;
+
+  guchar *data;
   int stride;
-  unsigned char *data;
+};
 
-  scaled_font = pango_cairo_font_get_scaled_font ((PangoCairoFont *)key->data.font);
-  if (G_UNLIKELY (!scaled_font || cairo_scaled_font_status (scaled_font) != CAIRO_STATUS_SUCCESS))
-    {
-      g_warning ("Failed to get a font");
-      return FALSE;
-    }
+typedef struct
+{
+  guint texture_id;
+  int x;
+  int y;
+  int width;
+  int height;
+  gsize offset;
+} GlyphUpload;
+
+typedef struct
+{
+  GskGLPendingGlyph *glyphs;
+  guint n_glyphs;
+  int next_glyph;
+} RasterizeJob;
+
+static void
+render_glyph (GskGLPendingGlyph *pending,
+              gboolean           use_pango)
+{
+  const GlyphCacheKey *key = pending->key;
+  const GskGLCachedGlyph *value = pending->value;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  int surface_width, surface_height;
+  int x_offset, y_offset;
+  guchar *data;
 
   surface_width = value->draw_width * key->data.scale / 1024;
   surface_height = value->draw_height * key->data.scale / 1024;
 
-  stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, surface_width);
-  data = g_malloc0 (stride * surface_height);
+  /* Skip the padding */
+  data = pending->data;
+  if (value->atlas)
+    data += pending->stride + 4;
+
   surface = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32,
                                                  surface_width, surface_height,
-                                                 stride);
+                                                 pending->stride);
   cairo_surface_set_device_scale (surface, key->data.scale / 1024.0, key->data.scale / 1024.0);
 
   cr = cairo_create (surface);
 
-  cairo_set_scaled_font (cr, scaled_font);
+  cairo_set_scaled_font (cr, pending->scaled_font);
   cairo_set_source_rgba (cr, 1, 1, 1, 1);
 
-  glyph_info.glyph = key->data.glyph;
-  glyph_info.geometry.width = value->draw_width * 1024;
-  if (glyph_info.glyph & PANGO_GLYPH_UNKNOWN_FLAG)
-    glyph_info.geometry.x_offset = 250 * key->data.xshift;
+  if (key->data.glyph & PANGO_GLYPH_UNKNOWN_FLAG)
+    x_offset = 250 * key->data.xshift;
   else
-    glyph_info.geometry.x_offset = 250 * key->data.xshift - value->draw_x * 1024;
-  glyph_info.geometry.y_offset = 250 * key->data.yshift - value->draw_y * 1024;
+    x_offset = 250 * key->data.xshift - value->draw_x * 1024;
+  y_offset = 250 * key->data.yshift - value->draw_y * 1024;
 
-  glyph_string.num_glyphs = 1;
-  glyph_string.glyphs = &glyph_info;
+  if (use_pango)
+    {
+      PangoGlyphString glyph_string;
+      PangoGlyphInfo glyph_info;
 
-  pango_cairo_show_glyph_string (cr, key->data.font, &glyph_string);
-  cairo_destroy (cr);
+      glyph_info.glyph = key->data.glyph;
+      glyph_info.geometry.width = value->draw_width * 1024;
+      glyph_info.geometry.x_offset = x_offset;
+      glyph_info.geometry.y_offset = y_offset;
 
-  cairo_surface_flush (surface);
+      glyph_string.num_glyphs = 1;
+      glyph_string.glyphs = &glyph_info;
 
-  region->width = cairo_image_surface_get_width (surface);
-  region->height = cairo_image_surface_get_height (surface);
-  region->stride = cairo_image_surface_get_stride (surface);
-  region->data = data;
-  if (value->atlas)
-    {
-      region->x = (gsize)(value->tx * value->atlas->width);
-      region->y = (gsize)(value->ty * value->atlas->height);
+      pango_cairo_show_glyph_string (cr, key->data.font, &glyph_string);
     }
   else
     {
-      region->x = 0;
-      region->y = 0;
+      /* This is what pango does for regular glyphs, but only uses
+       * cairo, which is safe to use from other threads.
+       */
+      cairo_show_glyphs (cr,
+                         &(cairo_glyph_t) {
+                           key->data.glyph,
+                           (double) x_offset / PANGO_SCALE,
+                           (double) y_offset / PANGO_SCALE
+                         },
+                         1);
     }
 
+  cairo_destroy (cr);
+
+  cairo_surface_flush (surface);
   cairo_surface_destroy (surface);
+}
 
-  return TRUE;
+static inline gboolean
+needs_pango (const GskGLPendingGlyph *pending)
+{
+  /* Pango draws hex boxes for these */
+  return (pending->key->data.glyph & PANGO_GLYPH_UNKNOWN_FLAG) != 0;
 }
 
 static void
-upload_glyph (GlyphCacheKey    *key,
-              GskGLCachedGlyph *value)
+rasterize_glyphs (RasterizeJob *job)
+{
+  while (TRUE)
+    {
+      guint i = g_atomic_int_add (&job->next_glyph, 1);
+
+      if (i >= job->n_glyphs)
+        break;
+
+      if (!needs_pango (&job->glyphs[i]))
+        render_glyph (&job->glyphs[i], FALSE);
+    }
+}
+
+/* Sorts glyphs by texture, then row by row */
+static int
+compare_pending_glyphs (gconstpointer a,
+                        gconstpointer b)
+{
+  const GskGLPendingGlyph *pa = a;
+  const GskGLPendingGlyph *pb = b;
+
+  if (pa->value->texture_id != pb->value->texture_id)
+    return pa->value->texture_id < pb->value->texture_id ? -1 : 1;
+
+  if (pa->y != pb->y)
+    return pa->y < pb->y ? -1 : 1;
+
+  return pa->x < pb->x ? -1 : (pa->x > pb->x);
+}
+
+/* Glyphs that are next to each other in a row of the atlas
+ * and have the same height are uploaded together. Uploading
+ * anything more could overwrite data that was added to the
+ * atlas in the meantime, such as icons.
+ */
+static GArray *
+collect_uploads (const GskGLPendingGlyph *glyphs,
+                 guint                    n_glyphs,
+                 guint                   *upload_index)
+{
+  GArray *uploads = g_array_new (FALSE, FALSE, sizeof (GlyphUpload));
+  GlyphUpload *upload = NULL;
+  guint i;
+
+  for (i = 0; i < n_glyphs; i++)
+    {
+      const GskGLPendingGlyph *g = &glyphs[i];
+
+      if (upload != NULL &&
+          g->value->atlas != NULL &&
+          g->value->texture_id == upload->texture_id &&
+          g->y == upload->y &&
+          g->height == upload->height &&
+          g->x == upload->x + upload->width)
+        {
+          upload->width += g->width;
+          upload_index[i] = uploads->len - 1;
+          continue;
+        }
+
+      g_array_set_size (uploads, uploads->len + 1);
+      upload = &g_array_index (uploads, GlyphUpload, uploads->len - 1);
+      upload->texture_id = g->value->texture_id;
+      upload->x = g->x;
+      upload->y = g->y;
+      upload->width = g->width;
+      upload->height = g->height;
+      upload_index[i] = uploads->len - 1;
+    }
+
+  return uploads;
+}
+
+static void
+upload_region (const GlyphUpload *upload,
+               guchar            *data)
 {
-  GskImageRegion r;
   guchar *pixel_data;
   guchar *free_data = NULL;
   guint gl_format;
   guint gl_type;
 
+  glBindTexture (GL_TEXTURE_2D, upload->texture_id);
+
+  if (gdk_gl_context_get_use_es (gdk_gl_context_get_current ()))
+    {
+      pixel_data = free_data = g_malloc (upload->width * upload->height * 4);
+      gdk_memory_convert (pixel_data, upload->width * 4,
+                          GDK_MEMORY_R8G8B8A8_PREMULTIPLIED,
+                          data, upload->width * 4,
+                          GDK_MEMORY_DEFAULT, upload->width, upload->height);
+      gl_format = GL_RGBA;
+      gl_type = GL_UNSIGNED_BYTE;
+    }
+  else
+    {
+      pixel_data = data;
+      gl_format = GL_BGRA;
+      gl_type = GL_UNSIGNED_INT_8_8_8_8_REV;
+    }
+
+  glTexSubImage2D (GL_TEXTURE_2D, 0, upload->x, upload->y, upload->width, upload->height,
+                   gl_format, gl_type, pixel_data);
+
+  g_free (free_data);
+}
+
+/**
+ * gsk_gl_glyph_cache_upload_pending:
+ * @self: a #GskGLGlyphCache
+ * @threaded: whether to rasterize glyphs in a thread pool
+ *
+ * Rasterizes and uploads all glyphs that were added since the
+ * last call. This must happen before any of them are drawn.
+ */
+void
+gsk_gl_glyph_cache_upload_pending (GskGLGlyphCache *self,
+                                   gboolean         threaded)
+{
+  GskGLPendingGlyph *glyphs;
+  guint n_glyphs;
+  GArray *uploads;
+  guint *upload_index;
+  guchar *arena;
+  gsize arena_size;
+  guint i;
+
+  n_glyphs = self->pending->len;
+  if (n_glyphs == 0)
+    return;
+
   gdk_gl_context_push_debug_group_printf (gdk_gl_context_get_current (),
-                                          "Uploading glyph %d",
-                                          key->data.glyph);
+                                          "Uploading %u glyphs", n_glyphs);
+
+  glyphs = (GskGLPendingGlyph *) self->pending->data;
+  qsort (glyphs, n_glyphs, sizeof (GskGLPendingGlyph), compare_pending_glyphs);
 
-  if (render_glyph (key, value, &r))
+  upload_index = g_new (guint, n_glyphs);
+  uploads = collect_uploads (glyphs, n_glyphs, upload_index);
+
+  /* All glyphs are rasterized straight into the staging data
+   * for their upload.
+   */
+  arena_size = 0;
+  for (i = 0; i < uploads->len; i++)
     {
-      glPixelStorei (GL_UNPACK_ROW_LENGTH, r.stride / 4);
-      glBindTexture (GL_TEXTURE_2D, value->texture_id);
+      GlyphUpload *upload = &g_array_index (uploads, GlyphUpload, i);
 
-      if (gdk_gl_context_get_use_es (gdk_gl_context_get_current ()))
-        {
-          pixel_data = free_data = g_malloc (r.width * r.height * 4);
-          gdk_memory_convert (pixel_data, r.width * 4,
-                              GDK_MEMORY_R8G8B8A8_PREMULTIPLIED,
-                              r.data, r.width * 4,
-                              GDK_MEMORY_DEFAULT, r.width, r.height);
-          gl_format = GL_RGBA;
-          gl_type = GL_UNSIGNED_BYTE;
-        }
-      else
+      upload->offset = arena_size;
+      arena_size += (gsize) upload->width * upload->height * 4;
+    }
+  arena = g_malloc0 (arena_size);
+
+  for (i = 0; i < n_glyphs; i++)
+    {
+      GskGLPendingGlyph *g = &glyphs[i];
+      const GlyphUpload *upload = &g_array_index (uploads, GlyphUpload, upload_index[i]);
+
+      g->stride = upload->width * 4;
+      g->data = arena + upload->offset +
+                (gsize) (g->y - upload->y) * g->stride +
+                (g->x - upload->x) * 4;
+    }
+
+  if (threaded && n_glyphs >= MIN_GLYPHS_FOR_THREADS && g_get_num_processors () > 1)
+    {
+      RasterizeJob job = { 0, };
+
+      job.glyphs = glyphs;
+      job.n_glyphs = n_glyphs;
+
+      gdk_parallel_task_run ((GdkTaskFunc) rasterize_glyphs, &job, n_glyphs / MIN_GLYPHS_FOR_THREADS + 1);
+    }
+  else
+    {
+      for (i = 0; i < n_glyphs; i++)
         {
-          pixel_data = r.data;
-          gl_format = GL_BGRA;
-          gl_type = GL_UNSIGNED_INT_8_8_8_8_REV;
+          if (!needs_pango (&glyphs[i]))
+            render_glyph (&glyphs[i], FALSE);
         }
+    }
+
+  for (i = 0; i < n_glyphs; i++)
+    {
+      if (needs_pango (&glyphs[i]))
+        render_glyph (&glyphs[i], TRUE);
+    }
+
+  for (i = 0; i < uploads->len; i++)
+    {
+      const GlyphUpload *upload = &g_array_index (uploads, GlyphUpload, i);
 
-      glTexSubImage2D (GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height,
-                       gl_format, gl_type, pixel_data);
-      glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
-      g_free (r.data);
-      g_free (free_data);
+      glPixelStorei (GL_UNPACK_ROW_LENGTH, upload->width);
+      upload_region (upload, arena + upload->offset);
     }
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+
+  GSK_NOTE (GLYPH_CACHE, g_message ("Uploaded %u glyphs in %u uploads", n_glyphs, uploads->len));
+
+  g_free (arena);
+  g_free (upload_index);
+  g_array_unref (uploads);
+  g_array_set_size (self->pending, 0);
 
   gdk_gl_context_pop_debug_group (gdk_gl_context_get_current ());
 }
@@ -236,6 +463,15 @@ add_to_cache (GskGLGlyphCache  *self,
 {
   const int width = value->draw_width * key->data.scale / 1024;
   const int height = value->draw_height * key->data.scale / 1024;
+  cairo_scaled_font_t *scaled_font;
+  GskGLPendingGlyph pending;
+
+  scaled_font = pango_cairo_font_get_scaled_font ((PangoCairoFont *)key->data.font);
+  if (G_UNLIKELY (!scaled_font || cairo_scaled_font_status (scaled_font) != CAIRO_STATUS_SUCCESS))
+    {
+      g_warning ("Failed to get a font");
+      return;
+    }
 
   if (width < MAX_GLYPH_SIZE && height < MAX_GLYPH_SIZE)
     {
@@ -253,6 +489,11 @@ add_to_cache (GskGLGlyphCache  *self,
 
       value->atlas = atlas;
       value->texture_id = atlas->texture_id;
+
+      pending.x = packed_x;
+      pending.y = packed_y;
+      pending.width = width + 2;
+      pending.height = height + 2;
     }
   else
     {
@@ -267,9 +508,19 @@ add_to_cache (GskGLGlyphCache  *self,
       value->ty = 0.0f;
       value->tw = 1.0f;
       value->th = 1.0f;
+
+      pending.x = 0;
+      pending.y = 0;
+      pending.width = width;
+      pending.height = height;
     }
 
-  upload_glyph (key, value);
+  pending.key = key;
+  pending.value = value;
+  pending.scaled_font = cairo_scaled_font_reference (scaled_font);
+  pending.data = NULL;
+  pending.stride = 0;
+  g_array_append_val (self->pending, pending);
 }
 
 void
@@ -334,6 +585,66 @@ gsk_gl_glyph_cache_lookup_or_add (GskGLGlyphCache         *cache,
   }
 }
 
+/* Like gsk_gl_glyph_cache_lookup_or_add(), but only finds glyphs that
+ * are cached already. Unlike that function, this may be called from
+ * multiple threads at once, as long as nothing is added meanwhile.
+ */
+gboolean
+gsk_gl_glyph_cache_lookup (GskGLGlyphCache         *cache,
+                           GlyphCacheKey           *lookup,
+                           const GskGLCachedGlyph **cached_glyph_out)
+{
+  GskGLCachedGlyph *value;
+
+  value = g_hash_table_lookup (cache->hash_table, lookup);
+  if (value == NULL)
+    return FALSE;
+
+  if (!value->accessed || (value->atlas && !value->used))
+    {
+      g_mutex_lock (&cache->atlases->lock);
+
+      if (value->atlas && !value->used)
+        {
+          gsk_gl_texture_atlas_mark_used (value->atlas, value->draw_width, value->draw_height);
+          value->used = TRUE;
+        }
+      value->accessed = TRUE;
+
+      g_mutex_unlock (&cache->atlases->lock);
+    }
+
+  *cached_glyph_out = value;
+  return TRUE;
+}
+
+static void
+relocate_glyph (GskGLGlyphCache  *self,
+                GlyphCacheKey    *key,
+                GskGLCachedGlyph *value)
+{
+  const int width = value->draw_width * key->data.scale / 1024;
+  const int height = value->draw_height * key->data.scale / 1024;
+  GskGLTextureAtlas *atlas = NULL;
+  int packed_x = 0;
+  int packed_y = 0;
+
+  gsk_gl_texture_atlases_relocate (self->atlases,
+                                   value->atlas,
+                                   (int) (value->tx * value->atlas->width + 0.5f) - 1,
+                                   (int) (value->ty * value->atlas->height + 0.5f) - 1,
+                                   width + 2, height + 2,
+                                   &atlas, &packed_x, &packed_y);
+
+  value->tx = (float)(packed_x + 1) / atlas->width;
+  value->ty = (float)(packed_y + 1) / atlas->height;
+  value->tw = (float)width / atlas->width;
+  value->th = (float)height / atlas->height;
+
+  value->atlas = atlas;
+  value->texture_id = atlas->texture_id;
+}
+
 void
 gsk_gl_glyph_cache_begin_frame (GskGLGlyphCache *self,
                                 GskGLDriver     *driver,
@@ -359,6 +670,32 @@ gsk_gl_glyph_cache_begin_frame (GskGLGlyphCache *self,
         }
     }
 
+  if (self->atlases->compacting->len > 0)
+    {
+      guint evicted = 0;
+
+      g_hash_table_iter_init (&iter, self->hash_table);
+      while (g_hash_table_iter_next (&iter, (gpointer *)&key, (gpointer *)&value))
+        {
+          if (value->atlas == NULL ||
+              !gsk_gl_texture_atlases_is_compacting (self->atlases, value->atlas))
+            continue;
+
+          if (value->used)
+            {
+              relocate_glyph (self, key, value);
+            }
+          else
+            {
+              g_hash_table_iter_remove (&iter);
+              evicted++;
+            }
+        }
+
+      self->atlases->stats.evicted += evicted;
+      dropped += evicted;
+    }
+
   if (self->timestamp % MAX_FRAME_AGE == 30)
     {
       g_hash_table_iter_init (&iter, self->hash_table);
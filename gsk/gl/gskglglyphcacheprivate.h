@@ -15,9 +15,13 @@ typedef struct
   GHashTable *hash_table;
   GskGLTextureAtlases *atlases;
 
+  GArray *pending; /* GskGLPendingGlyph, not uploaded yet */
+
   int timestamp;
 } GskGLGlyphCache;
 
+typedef struct _GskGLPendingGlyph GskGLPendingGlyph;
+
 struct _CacheKeyData
 {
   PangoFont *font;
@@ -88,5 +92,10 @@ void                     gsk_gl_glyph_cache_lookup_or_add   (GskGLGlyphCache
                                                              GlyphCacheKey          *lookup,
                                                              GskGLDriver            *driver,
                                                              const GskGLCachedGlyph **cached_glyph_out);
+gboolean                 gsk_gl_glyph_cache_lookup          (GskGLGlyphCache        *self,
+                                                             GlyphCacheKey          *lookup,
+                                                             const GskGLCachedGlyph **cached_glyph_out);
+void                     gsk_gl_glyph_cache_upload_pending  (GskGLGlyphCache        *self,
+                                                             gboolean                threaded);
 
 #endif
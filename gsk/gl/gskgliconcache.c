@@ -55,6 +55,31 @@ gsk_gl_icon_cache_unref (GskGLIconCache *self)
   self->ref_count--;
 }
 
+static void
+relocate_icon (GskGLIconCache *self,
+               IconData       *icon_data)
+{
+  const int width = icon_data->source_texture->width;
+  const int height = icon_data->source_texture->height;
+  GskGLTextureAtlas *atlas = NULL;
+  int packed_x = 0;
+  int packed_y = 0;
+
+  gsk_gl_texture_atlases_relocate (self->atlases,
+                                   icon_data->atlas,
+                                   (int) (icon_data->x * icon_data->atlas->width + 0.5f) - 1,
+                                   (int) (icon_data->y * icon_data->atlas->height + 0.5f) - 1,
+                                   width + 2, height + 2,
+                                   &atlas, &packed_x, &packed_y);
+
+  icon_data->atlas = atlas;
+  icon_data->texture_id = atlas->texture_id;
+  icon_data->x = (float)(packed_x + 1) / atlas->width;
+  icon_data->y = (float)(packed_y + 1) / atlas->height;
+  icon_data->x2 = icon_data->x + (float)width / atlas->width;
+  icon_data->y2 = icon_data->y + (float)height / atlas->height;
+}
+
 void
 gsk_gl_icon_cache_begin_frame (GskGLIconCache *self,
                                GPtrArray      *removed_atlases)
@@ -83,6 +108,33 @@ gsk_gl_icon_cache_begin_frame (GskGLIconCache *self,
       GSK_NOTE(GLYPH_CACHE, if (dropped > 0) g_message ("Dropped %d icons", dropped));
     }
 
+  /* Move icons off atlases that are being compacted */
+  if (self->atlases->compacting->len > 0)
+    {
+      guint evicted = 0;
+
+      g_hash_table_iter_init (&iter, self->icons);
+      while (g_hash_table_iter_next (&iter, (gpointer *)&texture, (gpointer *)&icon_data))
+        {
+          if (!gsk_gl_texture_atlases_is_compacting (self->atlases, icon_data->atlas))
+            continue;
+
+          if (icon_data->used)
+            {
+              relocate_icon (self, icon_data);
+            }
+          else
+            {
+              g_hash_table_iter_remove (&iter);
+              evicted++;
+            }
+        }
+
+      self->atlases->stats.evicted += evicted;
+
+      GSK_NOTE(GLYPH_CACHE, if (evicted > 0) g_message ("Dropped %d icons", evicted));
+    }
+
   if (self->timestamp % MAX_FRAME_AGE == 0)
     {
       g_hash_table_iter_init (&iter, self->icons);
@@ -106,6 +158,38 @@ gsk_gl_icon_cache_begin_frame (GskGLIconCache *self,
     }
 }
 
+/* Like gsk_gl_icon_cache_lookup_or_add(), but only finds icons that
+ * are cached already. Unlike that function, this may be called from
+ * multiple threads at once, as long as nothing is added meanwhile.
+ */
+gboolean
+gsk_gl_icon_cache_lookup (GskGLIconCache  *self,
+                          GdkTexture      *texture,
+                          const IconData **out_icon_data)
+{
+  IconData *icon_data = g_hash_table_lookup (self->icons, texture);
+
+  if (icon_data == NULL)
+    return FALSE;
+
+  if (!icon_data->accessed || !icon_data->used)
+    {
+      g_mutex_lock (&self->atlases->lock);
+
+      if (!icon_data->used)
+        {
+          gsk_gl_texture_atlas_mark_used (icon_data->atlas, texture->width + 2, texture->height + 2);
+          icon_data->used = TRUE;
+        }
+      icon_data->accessed = TRUE;
+
+      g_mutex_unlock (&self->atlases->lock);
+    }
+
+  *out_icon_data = icon_data;
+  return TRUE;
+}
+
 void
 gsk_gl_icon_cache_lookup_or_add (GskGLIconCache  *self,
                                  GdkTexture      *texture,
@@ -40,5 +40,8 @@ void             gsk_gl_icon_cache_begin_frame    (GskGLIconCache        *self,
 void             gsk_gl_icon_cache_lookup_or_add  (GskGLIconCache        *self,
                                                    GdkTexture            *texture,
                                                    const IconData       **out_icon_data);
+gboolean         gsk_gl_icon_cache_lookup         (GskGLIconCache        *self,
+                                                   GdkTexture            *texture,
+                                                   const IconData       **out_icon_data);
 
 #endif
@@ -26,6 +26,7 @@
 #include "gdk/gdkgltextureprivate.h"
 #include "gdk/gdkglcontextprivate.h"
 #include "gdk/gdkprofilerprivate.h"
+#include "gdk/gdkparalleltaskprivate.h"
 #include "gdk/gdkrgbaprivate.h"
 
 #include <epoxy/gl.h>
@@ -546,6 +547,16 @@ struct _GskGLRenderer
 #ifdef G_ENABLE_DEBUG
   struct {
     GQuark frames;
+    GQuark branches;
+    GQuark failed_branches;
+    GQuark draws_recorded;
+    GQuark draws;
+    GQuark atlases;
+    GQuark atlas_occupancy;
+    GQuark atlas_compactions;
+    GQuark atlas_relocations;
+    GQuark atlas_item_evictions;
+    GQuark atlases_dropped;
   } profile_counters;
   struct {
     GQuark cpu_time;
@@ -572,6 +583,10 @@ init_shader_builder (GskGLRenderer       *self,
     shader_builder->debugging = TRUE;
 #endif
 
+  /* We want to see the shader sources when debugging them */
+  shader_builder->program_cache = !shader_builder->debugging &&
+                                  g_getenv ("GSK_NO_PROGRAM_CACHE") == NULL;
+
   if (gdk_gl_context_get_use_es (self->gl_context))
     {
       gsk_gl_shader_builder_set_glsl_version (shader_builder, SHADER_VERSION_GLES);
@@ -812,10 +827,20 @@ render_text_node (GskGLRenderer   *self,
 
       glyph_cache_key_set_glyph_and_shift (&lookup, gi->glyph, x + cx, y + cy);
 
-      gsk_gl_glyph_cache_lookup_or_add (self->glyph_cache,
-                                        &lookup,
-                                        self->gl_driver,
-                                        &glyph);
+      if (ops_is_branch (builder))
+        {
+          /* New glyphs need to be added on the main thread */
+          if (!gsk_gl_glyph_cache_lookup (self->glyph_cache, &lookup, &glyph))
+            {
+              builder->failed = TRUE;
+              return;
+            }
+        }
+      else
+        gsk_gl_glyph_cache_lookup_or_add (self->glyph_cache,
+                                          &lookup,
+                                          self->gl_driver,
+                                          &glyph);
 
       if (glyph->texture_id == 0)
         goto next;
@@ -997,14 +1022,20 @@ render_color_node (GskGLRenderer   *self,
   load_vertex_data (ops_draw (builder, NULL), &node->bounds, builder);
 }
 
+static inline gboolean
+texture_is_icon (GdkTexture *texture)
+{
+  return texture->width <= 128 &&
+         texture->height <= 128 &&
+         !GDK_IS_GL_TEXTURE (texture);
+}
+
 static inline void
 upload_texture (GskGLRenderer *self,
                 GdkTexture    *texture,
                 TextureRegion *out_region)
 {
-  if (texture->width <= 128 &&
-      texture->height <= 128 &&
-      !GDK_IS_GL_TEXTURE (texture))
+  if (texture_is_icon (texture))
     {
       const IconData *icon_data;
 
@@ -1054,6 +1085,12 @@ render_texture_node (GskGLRenderer       *self,
       guint n_slices;
       guint i;
 
+      if (ops_is_branch (builder))
+        {
+          builder->failed = TRUE;
+          return;
+        }
+
       gsk_gl_driver_slice_texture (self->gl_driver, texture, &slices, &n_slices);
 
       ops_set_program (builder, &self->programs->blit_program);
@@ -1083,7 +1120,27 @@ render_texture_node (GskGLRenderer       *self,
     {
       TextureRegion r;
 
-      upload_texture (self, texture, &r);
+      if (ops_is_branch (builder))
+        {
+          const IconData *icon_data;
+
+          /* Only icons that have been uploaded before can be used
+           * off the main thread */
+          if (!texture_is_icon (texture) ||
+              !gsk_gl_icon_cache_lookup (self->icon_cache, texture, &icon_data))
+            {
+              builder->failed = TRUE;
+              return;
+            }
+
+          r.texture_id = icon_data->texture_id;
+          r.x = icon_data->x;
+          r.y = icon_data->y;
+          r.x2 = icon_data->x2;
+          r.y2 = icon_data->y2;
+        }
+      else
+        upload_texture (self, texture, &r);
 
       ops_set_program (builder, &self->programs->blit_program);
       ops_set_texture (builder, r.texture_id);
@@ -1658,7 +1715,14 @@ render_clipped_child (GskGLRenderer         *self,
                               child,
                               &region, &is_offscreen,
                               FORCE_OFFSCREEN))
-        g_assert_not_reached ();
+        {
+          /* Only branches fail to record, and are redone serially */
+          if (!ops_is_branch (builder))
+            g_assert_not_reached ();
+
+          ops_pop_clip (builder);
+          return;
+        }
       ops_pop_clip (builder);
 
       ops_set_program (builder, &self->programs->blit_program);
@@ -1761,7 +1825,14 @@ render_rounded_clip_node (GskGLRenderer       *self,
                               child,
                               &region, &is_offscreen,
                               0))
-        g_assert_not_reached ();
+        {
+          /* Only branches fail to record, and are redone serially */
+          if (!ops_is_branch (builder))
+            g_assert_not_reached ();
+
+          ops_pop_clip (builder);
+          return;
+        }
 
       ops_pop_clip (builder);
 
@@ -3670,6 +3741,179 @@ gsk_gl_renderer_setup_render_mode (GskGLRenderer *self)
     }
 }
 
+/* Containers with this many children get them recorded in parallel,
+ * in branches of consecutive children.
+ */
+#define MIN_CHILDREN_FOR_BRANCHES 16
+#define MIN_CHILDREN_PER_BRANCH    4
+
+typedef struct {
+  GskGLRenderer *renderer;
+  GskRenderNode *container;
+  guint n_children;
+
+  RenderOpBuilder *branches;
+  guint n_branches;
+  int next_branch;
+} BranchJob;
+
+static inline void
+get_branch_children (const BranchJob *job,
+                     guint            branch,
+                     guint           *start,
+                     guint           *end)
+{
+  *start = job->n_children * branch / job->n_branches;
+  *end = job->n_children * (branch + 1) / job->n_branches;
+}
+
+static void
+record_branches (BranchJob *job)
+{
+  while (TRUE)
+    {
+      guint i = g_atomic_int_add (&job->next_branch, 1);
+      RenderOpBuilder *branch;
+      guint j, start, end;
+
+      if (i >= job->n_branches)
+        break;
+
+      branch = &job->branches[i];
+      get_branch_children (job, i, &start, &end);
+
+      for (j = start; j < end && !branch->failed; j ++)
+        gsk_gl_renderer_add_render_ops (job->renderer,
+                                        gsk_container_node_get_child (job->container, j),
+                                        branch);
+    }
+}
+
+/* Whether the ops for @node can be recorded in a branch. That
+ * excludes everything that needs offscreens, uploads or caches
+ * that are not safe to use from other threads. Some of the nodes
+ * allowed here still need those sometimes, the branch fails then.
+ */
+static gboolean
+node_can_record_in_branch (GskRenderNode *node)
+{
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+    case GSK_DEBUG_NODE:
+    case GSK_COLOR_NODE:
+    case GSK_TEXTURE_NODE:
+    case GSK_TRANSFORM_NODE:
+    case GSK_OPACITY_NODE:
+    case GSK_CLIP_NODE:
+    case GSK_ROUNDED_CLIP_NODE:
+    case GSK_TEXT_NODE:
+    case GSK_BORDER_NODE:
+      return TRUE;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      return gsk_linear_gradient_node_get_n_color_stops (node) < GL_MAX_GRADIENT_STOPS;
+
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+      return gsk_radial_gradient_node_get_n_color_stops (node) < GL_MAX_GRADIENT_STOPS;
+
+    case GSK_CONIC_GRADIENT_NODE:
+      return gsk_conic_gradient_node_get_n_color_stops (node) < GL_MAX_GRADIENT_STOPS;
+
+    case GSK_INSET_SHADOW_NODE:
+      return gsk_inset_shadow_node_get_blur_radius (node) <= 0;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      return gsk_outset_shadow_node_get_blur_radius (node) <= 0;
+
+    case GSK_NOT_A_RENDER_NODE:
+    case GSK_CAIRO_NODE:
+    case GSK_COLOR_MATRIX_NODE:
+    case GSK_REPEAT_NODE:
+    case GSK_SHADOW_NODE:
+    case GSK_BLEND_NODE:
+    case GSK_CROSS_FADE_NODE:
+    case GSK_BLUR_NODE:
+    case GSK_GL_SHADER_NODE:
+    default:
+      return FALSE;
+    }
+}
+
+/* Records the children of @node in branches on multiple threads and
+ * appends them to @builder in order. Branches that fail are recorded
+ * again here. Returns %FALSE if @node should be handled serially.
+ *
+ * GL calls still only happen on the main thread, after recording.
+ */
+static gboolean
+add_container_ops_threaded (GskGLRenderer   *self,
+                            GskRenderNode   *node,
+                            RenderOpBuilder *builder)
+{
+  BranchJob job = { 0, };
+  guint n_failed;
+  guint i, j, start, end;
+
+  /* No nested branches */
+  if (ops_is_branch (builder))
+    return FALSE;
+
+  job.n_children = gsk_container_node_get_n_children (node);
+  if (job.n_children < MIN_CHILDREN_FOR_BRANCHES)
+    return FALSE;
+
+  if (g_get_num_processors () < 2)
+    return FALSE;
+
+  if (GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), GL_NO_THREADS))
+    return FALSE;
+
+  job.renderer = self;
+  job.container = node;
+  job.n_branches = MIN (job.n_children / MIN_CHILDREN_PER_BRANCH, 2 * g_get_num_processors ());
+  job.branches = g_new (RenderOpBuilder, job.n_branches);
+  for (i = 0; i < job.n_branches; i ++)
+    ops_init_branch (&job.branches[i], builder);
+
+  gdk_parallel_task_run ((GdkTaskFunc) record_branches, &job, job.n_branches);
+
+  n_failed = 0;
+  for (i = 0; i < job.n_branches; i ++)
+    {
+      RenderOpBuilder *branch = &job.branches[i];
+
+      if (branch->failed)
+        {
+          get_branch_children (&job, i, &start, &end);
+          for (j = start; j < end; j ++)
+            gsk_gl_renderer_add_render_ops (self, gsk_container_node_get_child (node, j), builder);
+          n_failed ++;
+        }
+      else
+        {
+          ops_append_branch (builder, branch);
+        }
+
+      ops_free_branch (branch);
+    }
+
+#ifdef G_ENABLE_DEBUG
+  {
+    GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
+
+    gsk_profiler_counter_add (profiler, self->profile_counters.branches, job.n_branches);
+    gsk_profiler_counter_add (profiler, self->profile_counters.failed_branches, n_failed);
+  }
+#endif
+
+  g_free (job.branches);
+
+  return TRUE;
+}
+
 static void
 gsk_gl_renderer_add_render_ops (GskGLRenderer   *self,
                                 GskRenderNode   *node,
@@ -3694,6 +3938,18 @@ gsk_gl_renderer_add_render_ops (GskGLRenderer   *self,
       return;
   }
 
+  if (ops_is_branch (builder))
+    {
+      if (builder->failed)
+        return;
+
+      if (!node_can_record_in_branch (node))
+        {
+          builder->failed = TRUE;
+          return;
+        }
+    }
+
   switch (gsk_render_node_get_node_type (node))
     {
     case GSK_NOT_A_RENDER_NODE:
@@ -3703,6 +3959,9 @@ gsk_gl_renderer_add_render_ops (GskGLRenderer   *self,
       {
         guint i, p;
 
+        if (add_container_ops_threaded (self, node, builder))
+          break;
+
         for (i = 0, p = gsk_container_node_get_n_children (node); i < p; i ++)
           {
             GskRenderNode *child = gsk_container_node_get_child (node, i);
@@ -3856,6 +4115,16 @@ add_offscreen_ops (GskGLRenderer         *self,
       return FALSE;
     }
 
+  /* Render targets are created right away, so this needs to
+   * happen on the main thread */
+  if (ops_is_branch (builder))
+    {
+      builder->failed = TRUE;
+      *is_offscreen = FALSE;
+      init_full_texture_region (texture_region_out, 0);
+      return FALSE;
+    }
+
   /* We need the child node as a texture. If it already is one, we don't need to draw
    * it on a framebuffer of course. */
   if (gsk_render_node_get_node_type (child_node) == GSK_TEXTURE_NODE &&
@@ -4003,6 +4272,9 @@ gsk_gl_renderer_render_ops (GskGLRenderer *self)
   g_print ("============================================\n");
 #endif
 
+  gsk_gl_glyph_cache_upload_pending (self->glyph_cache,
+                                     !GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), GL_NO_THREADS));
+
   glGenVertexArrays (1, &vao_id);
   glBindVertexArray (vao_id);
 
@@ -4213,6 +4485,8 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   gint64 start_time G_GNUC_UNUSED;
 #endif
   GPtrArray *removed;
+  guint n_draws_before G_GNUC_UNUSED;
+  guint n_draws_after G_GNUC_UNUSED;
 
 #ifdef G_ENABLE_DEBUG
   profiler = gsk_renderer_get_profiler (renderer);
@@ -4231,8 +4505,19 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   gsk_gl_glyph_cache_begin_frame (self->glyph_cache, self->gl_driver, removed);
   gsk_gl_icon_cache_begin_frame (self->icon_cache, removed);
   gsk_gl_shadow_cache_begin_frame (&self->shadow_cache, self->gl_driver);
+  gsk_gl_texture_atlases_compact (self->atlases);
   g_ptr_array_unref (removed);
 
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_set (profiler, self->profile_counters.atlases, self->atlases->atlases->len);
+  gsk_profiler_counter_set (profiler, self->profile_counters.atlas_occupancy,
+                            100 * gsk_gl_texture_atlases_get_occupancy (self->atlases));
+  gsk_profiler_counter_add (profiler, self->profile_counters.atlas_compactions, self->atlases->stats.compacted);
+  gsk_profiler_counter_add (profiler, self->profile_counters.atlas_relocations, self->atlases->stats.relocated);
+  gsk_profiler_counter_add (profiler, self->profile_counters.atlas_item_evictions, self->atlases->stats.evicted);
+  gsk_profiler_counter_add (profiler, self->profile_counters.atlases_dropped, self->atlases->stats.dropped);
+#endif
+
   /* Set up the modelview and projection matrices to fit our viewport */
   init_projection_matrix (&projection, viewport);
   ops_set_projection (&self->op_builder, &projection);
@@ -4281,6 +4566,11 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   ops_pop_clip (&self->op_builder);
   ops_finish (&self->op_builder);
 
+  if (GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), GL_NO_MERGE))
+    n_draws_before = n_draws_after = ops_get_n_draws (&self->op_builder);
+  else
+    ops_merge_draws (&self->op_builder, &n_draws_before, &n_draws_after);
+
   /*g_message ("Ops: %u", self->render_ops->len);*/
 
   /* Now actually draw things... */
@@ -4311,6 +4601,8 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
 
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_counter_inc (profiler, self->profile_counters.frames);
+  gsk_profiler_counter_add (profiler, self->profile_counters.draws_recorded, n_draws_before);
+  gsk_profiler_counter_add (profiler, self->profile_counters.draws, n_draws_after);
 
   start_time = gsk_profiler_timer_get_start (profiler, self->profile_timers.cpu_time);
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
@@ -4546,6 +4838,16 @@ gsk_gl_renderer_init (GskGLRenderer *self)
     GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
 
     self->profile_counters.frames = gsk_profiler_add_counter (profiler, "frames", "Frames", FALSE);
+    self->profile_counters.branches = gsk_profiler_add_counter (profiler, "branches", "Branches recorded in parallel", TRUE);
+    self->profile_counters.failed_branches = gsk_profiler_add_counter (profiler, "failed-branches", "Branches redone serially", TRUE);
+    self->profile_counters.draws_recorded = gsk_profiler_add_counter (profiler, "draws-recorded", "Draws before merging", TRUE);
+    self->profile_counters.draws = gsk_profiler_add_counter (profiler, "draws", "Draw calls", TRUE);
+    self->profile_counters.atlases = gsk_profiler_add_counter (profiler, "atlases", "Texture atlases", FALSE);
+    self->profile_counters.atlas_occupancy = gsk_profiler_add_counter (profiler, "atlas-occupancy", "Percentage of atlas pixels in use", FALSE);
+    self->profile_counters.atlas_compactions = gsk_profiler_add_counter (profiler, "atlas-compactions", "Atlases compacted", TRUE);
+    self->profile_counters.atlas_relocations = gsk_profiler_add_counter (profiler, "atlas-relocations", "Atlas items moved", TRUE);
+    self->profile_counters.atlas_item_evictions = gsk_profiler_add_counter (profiler, "atlas-item-evictions", "Atlas items evicted", TRUE);
+    self->profile_counters.atlases_dropped = gsk_profiler_add_counter (profiler, "atlases-dropped", "Atlases dropped", TRUE);
 
     self->profile_timers.cpu_time = gsk_profiler_add_timer (profiler, "cpu-time", "CPU time", FALSE, TRUE);
     self->profile_timers.gpu_time = gsk_profiler_add_timer (profiler, "gpu-time", "GPU time", FALSE, TRUE);
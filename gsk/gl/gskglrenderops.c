@@ -1,6 +1,8 @@
 #include "gskglrenderopsprivate.h"
 #include "gsktransform.h"
 
+#include <math.h>
+
 typedef struct
 {
   GskRoundedRect rect;
@@ -61,9 +63,28 @@ get_current_program_state (RenderOpBuilder *builder)
   if (!builder->current_program)
     return NULL;
 
+  if (builder->program_states != NULL)
+    {
+      g_assert (builder->current_program->index >= 0);
+      return &builder->program_states[builder->current_program->index];
+    }
+
   return &builder->current_program->state;
 }
 
+/* All bits set is a NaN for floats and -1 for ints, so nothing
+ * compares equal to this and the next op sends all of the state.
+ */
+static void
+program_state_invalidate (ProgramState *state)
+{
+  GskTransform *modelview = state->modelview;
+
+  memset (state, 0xff, sizeof (ProgramState));
+  state->modelview = NULL;
+  gsk_transform_unref (modelview);
+}
+
 void
 ops_finish (RenderOpBuilder *builder)
 {
@@ -684,6 +705,11 @@ ops_draw (RenderOpBuilder     *builder,
       op = op_buffer_add (&builder->render_ops, OP_DRAW);
       op->vao_offset = builder->vertices->len;
       op->vao_size = GL_N_VERTICES;
+      op->is_affine = gsk_transform_get_category (builder->current_modelview) >= GSK_TRANSFORM_CATEGORY_2D_AFFINE;
+      if (op->is_affine)
+        gsk_transform_to_affine (builder->current_modelview,
+                                 &op->scale_x, &op->scale_y,
+                                 &op->dx, &op->dy);
     }
 
   if (vertex_data)
@@ -728,6 +754,105 @@ ops_get_buffer (RenderOpBuilder *builder)
   return &builder->render_ops;
 }
 
+/* Sets up @branch to record ops for a part of the tree that
+ * @builder is currently at, possibly on another thread.
+ *
+ * The branch starts with the modelview, clip and offset of
+ * @builder, but doesn't assume any program state, so its ops
+ * can be appended to @builder later, after whatever other
+ * ops were recorded in the meantime.
+ */
+void
+ops_init_branch (RenderOpBuilder       *branch,
+                 const RenderOpBuilder *builder)
+{
+  MatrixStackEntry *entry;
+  int i;
+
+  g_assert (builder->mv_stack != NULL);
+  g_assert (builder->clip_stack != NULL);
+
+  ops_init (branch);
+
+  branch->programs = builder->programs;
+  branch->renderer = builder->renderer;
+  branch->current_render_target = builder->current_render_target;
+  branch->current_texture = -1;
+  branch->current_projection = builder->current_projection;
+  branch->current_viewport = builder->current_viewport;
+  branch->current_opacity = builder->current_opacity;
+  branch->dx = builder->dx;
+  branch->dy = builder->dy;
+  branch->scale_x = builder->scale_x;
+  branch->scale_y = builder->scale_y;
+
+  branch->mv_stack = g_array_new (FALSE, TRUE, sizeof (MatrixStackEntry));
+  g_array_set_size (branch->mv_stack, 1);
+  entry = &g_array_index (branch->mv_stack, MatrixStackEntry, 0);
+  *entry = g_array_index (builder->mv_stack, MatrixStackEntry, builder->mv_stack->len - 1);
+  gsk_transform_ref (entry->transform);
+  branch->current_modelview = entry->transform;
+
+  /* Copy the whole stack, ops_has_clip() looks at its depth */
+  branch->clip_stack = g_array_copy (builder->clip_stack);
+  branch->current_clip = &g_array_index (branch->clip_stack, ClipStackEntry, branch->clip_stack->len - 1).rect;
+  branch->clip_is_rectilinear = builder->clip_is_rectilinear;
+
+  branch->program_states = g_new0 (ProgramState, GL_N_PROGRAMS);
+  for (i = 0; i < GL_N_PROGRAMS; i ++)
+    program_state_invalidate (&branch->program_states[i]);
+}
+
+void
+ops_free_branch (RenderOpBuilder *branch)
+{
+  int i;
+
+  g_assert (branch->mv_stack->len == 1);
+
+  gsk_transform_unref (g_array_index (branch->mv_stack, MatrixStackEntry, 0).transform);
+
+  for (i = 0; i < GL_N_PROGRAMS; i ++)
+    gsk_transform_unref (branch->program_states[i].modelview);
+  g_free (branch->program_states);
+
+  ops_finish (branch);
+  ops_free (branch);
+}
+
+/* Appends the ops recorded by @branch. Since we don't know which
+ * state they leave behind, all program state is sent again after.
+ */
+void
+ops_append_branch (RenderOpBuilder       *builder,
+                   const RenderOpBuilder *branch)
+{
+  OpBuffer *buffer = &builder->render_ops;
+  const guint vertex_offset = builder->vertices->len;
+  guint first = buffer->index->len;
+  guint i;
+
+  if (op_buffer_n_ops ((OpBuffer *) &branch->render_ops) == 0)
+    return;
+
+  op_buffer_append (buffer, &branch->render_ops);
+
+  for (i = first; i < buffer->index->len; i ++)
+    {
+      const OpBufferEntry *entry = &g_array_index (buffer->index, OpBufferEntry, i);
+
+      if (entry->kind == OP_DRAW)
+        ((OpDraw *) &buffer->buf[entry->pos])->vao_offset += vertex_offset;
+    }
+
+  g_array_append_vals (builder->vertices, branch->vertices->data, branch->vertices->len);
+
+  builder->current_program = NULL;
+  builder->current_texture = -1;
+  for (i = 0; i < GL_N_PROGRAMS; i ++)
+    program_state_invalidate (&builder->programs->programs[i].state);
+}
+
 void
 ops_set_inset_shadow (RenderOpBuilder      *self,
                       const GskRoundedRect  outline,
@@ -974,3 +1099,415 @@ ops_set_conic_gradient (RenderOpBuilder    *self,
   op->angle = angle;
 }
 
+
+/* Draw merging
+ *
+ * Draws are only merged within segments of the op stream that
+ * consist of nothing but program, source texture and color changes
+ * and draws. Everything else that a draw depends on can only change
+ * between segments.
+ *
+ * Within a segment, every draw is moved back to the latest earlier
+ * batch that uses the same program, texture and color, as long as it
+ * doesn't overlap any of the batches it is moved across. The batches
+ * are then emitted with one draw each, followed by whatever state
+ * changes are needed to leave GL as the original ops would have.
+ */
+
+/* How many batches we look back to find one to merge into */
+#define MAX_BATCH_LOOKBACK 32
+
+/* Texture ids in batch keys, besides real ones */
+#define TEXTURE_UNUSED     0
+#define TEXTURE_UNKNOWN   -1
+
+typedef struct
+{
+  const Program *program;
+  int texture_id;
+  const GdkRGBA *color; /* NULL if not set in this segment */
+} BatchKey;
+
+typedef struct
+{
+  BatchKey key;
+  graphene_rect_t bounds;
+  guint first_draw;
+  guint last_draw;
+} Batch;
+
+typedef struct
+{
+  gsize vao_offset;
+  gsize vao_size;
+  guint next; /* Next draw in the same batch, or G_MAXUINT */
+} BatchDraw;
+
+typedef struct
+{
+  const GskGLRendererPrograms *programs;
+  const GArray *vertices;
+
+  OpBuffer *out_ops;
+  GArray *out_vertices;
+
+  /* State at the start of the segment */
+  const Program *program;
+  int texture_id;
+
+  /* State after the ops of the segment seen so far */
+  const Program *in_program;
+  int in_texture_id;
+  const GdkRGBA *in_colors[GL_N_PROGRAMS];
+
+  GArray *batches;
+  GArray *draws;
+
+  guint n_draws_before;
+  guint n_draws_after;
+} DrawMerger;
+
+static inline gboolean
+program_uses_source (const GskGLRendererPrograms *programs,
+                     const Program               *program)
+{
+  return program != NULL &&
+         program != &programs->color_program &&
+         program != &programs->border_program &&
+         program != &programs->linear_gradient_program &&
+         program != &programs->radial_gradient_program &&
+         program != &programs->conic_gradient_program &&
+         program != &programs->inset_shadow_program &&
+         program != &programs->unblurred_outset_shadow_program;
+}
+
+static inline gboolean
+batch_key_equal (const BatchKey *key1,
+                 const BatchKey *key2)
+{
+  if (key1->program != key2->program ||
+      key1->texture_id != key2->texture_id)
+    return FALSE;
+
+  if (key1->color == NULL || key2->color == NULL)
+    return key1->color == key2->color;
+
+  return gdk_rgba_equal (key1->color, key2->color);
+}
+
+static inline gboolean
+bounds_overlap (const graphene_rect_t *r1,
+                const graphene_rect_t *r2)
+{
+  return r1->origin.x < r2->origin.x + r2->size.width &&
+         r2->origin.x < r1->origin.x + r1->size.width &&
+         r1->origin.y < r2->origin.y + r2->size.height &&
+         r2->origin.y < r1->origin.y + r1->size.height;
+}
+
+static void
+get_draw_bounds (const DrawMerger *merger,
+                 const OpDraw     *op,
+                 graphene_rect_t  *bounds)
+{
+  float min_x = G_MAXFLOAT, min_y = G_MAXFLOAT;
+  float max_x = -G_MAXFLOAT, max_y = -G_MAXFLOAT;
+  float x1, y1, x2, y2;
+  gsize i;
+
+  if (!op->is_affine)
+    {
+      /* Assume it covers everything */
+      *bounds = GRAPHENE_RECT_INIT (-G_MAXFLOAT / 2, -G_MAXFLOAT / 2, G_MAXFLOAT, G_MAXFLOAT);
+      return;
+    }
+
+  for (i = op->vao_offset; i < op->vao_offset + op->vao_size; i ++)
+    {
+      const GskQuadVertex *v = &g_array_index (merger->vertices, GskQuadVertex, i);
+
+      min_x = MIN (min_x, v->position[0]);
+      min_y = MIN (min_y, v->position[1]);
+      max_x = MAX (max_x, v->position[0]);
+      max_y = MAX (max_y, v->position[1]);
+    }
+
+  x1 = min_x * op->scale_x + op->dx;
+  x2 = max_x * op->scale_x + op->dx;
+  y1 = min_y * op->scale_y + op->dy;
+  y2 = max_y * op->scale_y + op->dy;
+
+  graphene_rect_init (bounds, MIN (x1, x2), MIN (y1, y2), fabsf (x2 - x1), fabsf (y2 - y1));
+}
+
+static void
+draw_merger_add_draw (DrawMerger   *merger,
+                      const OpDraw *op)
+{
+  BatchDraw draw = { op->vao_offset, op->vao_size, G_MAXUINT };
+  const Program *program = merger->in_program;
+  graphene_rect_t bounds;
+  BatchKey key;
+  Batch *batch;
+  guint i;
+
+  /* Draws without a program are skipped when rendering */
+  if (program == NULL)
+    return;
+
+  key.program = program;
+  if (program_uses_source (merger->programs, program))
+    key.texture_id = merger->in_texture_id;
+  else
+    key.texture_id = TEXTURE_UNUSED;
+  if (program->index >= 0)
+    key.color = merger->in_colors[program->index];
+  else
+    key.color = NULL;
+
+  get_draw_bounds (merger, op, &bounds);
+
+  g_array_append_val (merger->draws, draw);
+  merger->n_draws_before ++;
+
+  for (i = merger->batches->len; i > 0 && merger->batches->len - i < MAX_BATCH_LOOKBACK; i --)
+    {
+      batch = &g_array_index (merger->batches, Batch, i - 1);
+
+      if (batch_key_equal (&batch->key, &key))
+        {
+          g_array_index (merger->draws, BatchDraw, batch->last_draw).next = merger->draws->len - 1;
+          batch->last_draw = merger->draws->len - 1;
+          graphene_rect_union (&batch->bounds, &bounds, &batch->bounds);
+          return;
+        }
+
+      if (bounds_overlap (&batch->bounds, &bounds))
+        break;
+    }
+
+  g_array_set_size (merger->batches, merger->batches->len + 1);
+  batch = &g_array_index (merger->batches, Batch, merger->batches->len - 1);
+  batch->key = key;
+  batch->bounds = bounds;
+  batch->first_draw = merger->draws->len - 1;
+  batch->last_draw = merger->draws->len - 1;
+}
+
+static void
+emit_program (DrawMerger     *merger,
+              const Program **out_program,
+              const Program  *program)
+{
+  OpProgram *op;
+
+  if (program == NULL || program == *out_program)
+    return;
+
+  op = op_buffer_add (merger->out_ops, OP_CHANGE_PROGRAM);
+  op->program = program;
+  *out_program = program;
+}
+
+static void
+emit_texture (DrawMerger *merger,
+              int        *out_texture_id,
+              int         texture_id)
+{
+  OpTexture *op;
+
+  if (texture_id == TEXTURE_UNUSED || texture_id == *out_texture_id)
+    return;
+
+  /* Batches that use the texture from before the segment come first */
+  g_assert (texture_id != TEXTURE_UNKNOWN);
+
+  op = op_buffer_add (merger->out_ops, OP_CHANGE_SOURCE_TEXTURE);
+  op->texture_id = texture_id;
+  *out_texture_id = texture_id;
+}
+
+static void
+emit_color (DrawMerger     *merger,
+            const GdkRGBA **out_color,
+            const GdkRGBA  *color)
+{
+  OpColor *op;
+
+  if (color == NULL ||
+      (*out_color != NULL && gdk_rgba_equal (*out_color, color)))
+    return;
+
+  op = op_buffer_add (merger->out_ops, OP_CHANGE_COLOR);
+  op->rgba = color;
+  *out_color = color;
+}
+
+static void
+draw_merger_flush (DrawMerger *merger)
+{
+  const Program *out_program = merger->program;
+  int out_texture_id = merger->texture_id;
+  const GdkRGBA *out_colors[GL_N_PROGRAMS] = { NULL, };
+  guint i, j;
+
+  for (i = 0; i < merger->batches->len; i ++)
+    {
+      const Batch *batch = &g_array_index (merger->batches, Batch, i);
+      OpDraw *op;
+
+      emit_program (merger, &out_program, batch->key.program);
+      if (out_program != NULL)
+        {
+          emit_texture (merger, &out_texture_id, batch->key.texture_id);
+          if (out_program->index >= 0)
+            emit_color (merger, &out_colors[out_program->index], batch->key.color);
+        }
+
+      op = op_buffer_add (merger->out_ops, OP_DRAW);
+      op->vao_offset = merger->out_vertices->len;
+      op->vao_size = 0;
+      op->is_affine = FALSE;
+
+      for (j = batch->first_draw; j != G_MAXUINT; j = g_array_index (merger->draws, BatchDraw, j).next)
+        {
+          const BatchDraw *draw = &g_array_index (merger->draws, BatchDraw, j);
+
+          g_array_append_vals (merger->out_vertices,
+                               &g_array_index (merger->vertices, GskQuadVertex, draw->vao_offset),
+                               draw->vao_size);
+          op->vao_size += draw->vao_size;
+        }
+
+      merger->n_draws_after ++;
+    }
+
+  /* Leave the state as the original ops would have */
+  for (i = 0; i < GL_N_PROGRAMS; i ++)
+    {
+      const GdkRGBA *color = merger->in_colors[i];
+
+      if (color == NULL ||
+          (out_colors[i] != NULL && gdk_rgba_equal (out_colors[i], color)))
+        continue;
+
+      emit_program (merger, &out_program, &merger->programs->programs[i]);
+      emit_color (merger, &out_colors[i], color);
+    }
+
+  if (merger->in_program != NULL)
+    {
+      emit_program (merger, &out_program, merger->in_program);
+      if (merger->in_texture_id != TEXTURE_UNKNOWN)
+        emit_texture (merger, &out_texture_id, merger->in_texture_id);
+    }
+
+  merger->program = merger->in_program;
+  merger->texture_id = merger->in_texture_id;
+  memset (merger->in_colors, 0, sizeof (merger->in_colors));
+  g_array_set_size (merger->batches, 0);
+  g_array_set_size (merger->draws, 0);
+}
+
+/**
+ * ops_merge_draws:
+ * @builder: a #RenderOpBuilder with all ops recorded
+ * @n_draws_before: (out): return location for the number of draws before merging
+ * @n_draws_after: (out): return location for the number of draws after merging
+ *
+ * Reorders the draws recorded in @builder to merge those that use
+ * the same state and don't overlap into a single draw.
+ */
+void
+ops_merge_draws (RenderOpBuilder *builder,
+                 guint           *n_draws_before,
+                 guint           *n_draws_after)
+{
+  DrawMerger merger = { 0, };
+  OpBuffer out_ops;
+  OpBufferIter iter;
+  OpKind kind;
+  gpointer ptr;
+
+  op_buffer_init (&out_ops);
+
+  merger.programs = builder->programs;
+  merger.vertices = builder->vertices;
+  merger.out_ops = &out_ops;
+  merger.out_vertices = g_array_sized_new (FALSE, TRUE, sizeof (GskQuadVertex), builder->vertices->len);
+  merger.program = NULL;
+  merger.texture_id = TEXTURE_UNKNOWN;
+  merger.in_program = NULL;
+  merger.in_texture_id = TEXTURE_UNKNOWN;
+  merger.batches = g_array_new (FALSE, FALSE, sizeof (Batch));
+  merger.draws = g_array_new (FALSE, FALSE, sizeof (BatchDraw));
+
+  op_buffer_iter_init (&iter, &builder->render_ops);
+  while ((ptr = op_buffer_iter_next (&iter, &kind)))
+    {
+      switch (kind)
+        {
+        case OP_CHANGE_PROGRAM:
+          merger.in_program = ((const OpProgram *) ptr)->program;
+          continue;
+
+        case OP_CHANGE_SOURCE_TEXTURE:
+          if (merger.in_program == NULL)
+            break;
+          merger.in_texture_id = ((const OpTexture *) ptr)->texture_id;
+          continue;
+
+        case OP_CHANGE_COLOR:
+          if (merger.in_program == NULL || merger.in_program->index < 0)
+            break;
+          merger.in_colors[merger.in_program->index] = ((const OpColor *) ptr)->rgba;
+          continue;
+
+        case OP_DRAW:
+          draw_merger_add_draw (&merger, ptr);
+          continue;
+
+        default:
+          break;
+        }
+
+      draw_merger_flush (&merger);
+      op_buffer_add_copy (&out_ops, kind, ptr);
+    }
+
+  draw_merger_flush (&merger);
+
+  *n_draws_before = merger.n_draws_before;
+  *n_draws_after = merger.n_draws_after;
+
+  op_buffer_destroy (&builder->render_ops);
+  builder->render_ops = out_ops;
+  g_array_unref (builder->vertices);
+  builder->vertices = merger.out_vertices;
+
+  g_array_unref (merger.batches);
+  g_array_unref (merger.draws);
+}
+
+/**
+ * ops_get_n_draws:
+ * @builder: a #RenderOpBuilder
+ *
+ * Returns: the number of draws recorded in @builder
+ */
+guint
+ops_get_n_draws (RenderOpBuilder *builder)
+{
+  OpBufferIter iter;
+  OpKind kind;
+  guint n_draws = 0;
+
+  op_buffer_iter_init (&iter, &builder->render_ops);
+  while (op_buffer_iter_next (&iter, &kind))
+    {
+      if (kind == OP_DRAW)
+        n_draws++;
+    }
+
+  return n_draws;
+}
@@ -233,6 +233,14 @@ typedef struct
   /* Pointer into clip_stack */
   const GskRoundedRect *current_clip;
   bool clip_is_rectilinear;
+
+  /* Only set for builders recording a branch of the node tree on
+   * another thread. They track program state in here instead of the
+   * shared programs, and set failed if they run into something that
+   * needs to be done on the main thread.
+   */
+  ProgramState *program_states;
+  bool failed;
 } RenderOpBuilder;
 
 
@@ -243,6 +251,23 @@ void              ops_dump_framebuffer   (RenderOpBuilder         *builder,
 void              ops_init               (RenderOpBuilder         *builder);
 void              ops_free               (RenderOpBuilder         *builder);
 void              ops_reset              (RenderOpBuilder         *builder);
+
+void              ops_merge_draws        (RenderOpBuilder         *builder,
+                                          guint                   *n_draws_before,
+                                          guint                   *n_draws_after);
+guint             ops_get_n_draws        (RenderOpBuilder         *builder);
+
+void              ops_init_branch        (RenderOpBuilder         *branch,
+                                          const RenderOpBuilder   *builder);
+void              ops_free_branch        (RenderOpBuilder         *branch);
+void              ops_append_branch      (RenderOpBuilder         *builder,
+                                          const RenderOpBuilder   *branch);
+
+static inline bool
+ops_is_branch (const RenderOpBuilder *builder)
+{
+  return builder->program_states != NULL;
+}
 void              ops_push_debug_group    (RenderOpBuilder         *builder,
                                            const char              *text);
 void              ops_pop_debug_group     (RenderOpBuilder         *builder);
@@ -6,6 +6,7 @@
 
 #include <gdk/gdk.h>
 #include <epoxy/gl.h>
+#include <glib/gstdio.h>
 
 void
 gsk_gl_shader_builder_init (GskGLShaderBuilder *self,
@@ -130,6 +131,198 @@ print_shader_info (const char *prefix,
     }
 }
 
+/* Program binary cache
+ *
+ * Linked programs are stored in the user cache dir, keyed by a hash
+ * of the GL vendor, renderer and version strings and the complete
+ * shader sources. A binary that the driver rejects is removed and
+ * the program is compiled again.
+ */
+
+#define PROGRAM_CACHE_MAGIC "GSKPROG1"
+#define PROGRAM_CACHE_HEADER_SIZE (sizeof (PROGRAM_CACHE_MAGIC) - 1 + sizeof (guint32))
+
+/* This depends on the context, so it is checked once per context and
+ * remembered on it, for all builders and custom shaders that use it */
+static gboolean
+program_binaries_supported (void)
+{
+  GdkGLContext *context = gdk_gl_context_get_current ();
+  gpointer checked;
+
+  checked = g_object_get_data (G_OBJECT (context), "gsk-gl-program-binaries");
+  if (G_UNLIKELY (checked == NULL))
+    {
+      gboolean supported;
+      int n_formats = 0;
+
+      if (epoxy_is_desktop_gl ())
+        supported = epoxy_gl_version () >= 41 ||
+                    epoxy_has_gl_extension ("GL_ARB_get_program_binary");
+      else
+        supported = epoxy_gl_version () >= 30 ||
+                    epoxy_has_gl_extension ("GL_OES_get_program_binary");
+
+      if (supported)
+        {
+          glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+          supported = n_formats > 0;
+        }
+
+      checked = GINT_TO_POINTER (supported ? 2 : 1);
+      g_object_set_data (G_OBJECT (context), "gsk-gl-program-binaries", checked);
+    }
+
+  return GPOINTER_TO_INT (checked) == 2;
+}
+
+static gboolean
+has_program_parameters (void)
+{
+  if (epoxy_is_desktop_gl ())
+    return epoxy_gl_version () >= 41 || epoxy_has_gl_extension ("GL_ARB_get_program_binary");
+  else
+    return epoxy_gl_version () >= 30;
+}
+
+static char *
+get_program_cache_path (const char * const *vertex_sources,
+                        const int          *vertex_lengths,
+                        int                 n_vertex_sources,
+                        const char * const *fragment_sources,
+                        const int          *fragment_lengths,
+                        int                 n_fragment_sources)
+{
+  const char *gl_strings[] = {
+    (const char *) glGetString (GL_VENDOR),
+    (const char *) glGetString (GL_RENDERER),
+    (const char *) glGetString (GL_VERSION),
+  };
+  GChecksum *checksum;
+  char *dir;
+  char *basename;
+  char *path;
+  int i;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+  /* Include the terminating nul bytes, to keep the parts apart */
+  for (i = 0; i < G_N_ELEMENTS (gl_strings); i++)
+    {
+      if (gl_strings[i] != NULL)
+        g_checksum_update (checksum, (const guchar *) gl_strings[i], strlen (gl_strings[i]) + 1);
+    }
+
+  for (i = 0; i < n_vertex_sources; i++)
+    g_checksum_update (checksum, (const guchar *) vertex_sources[i], vertex_lengths[i]);
+  g_checksum_update (checksum, (const guchar *) "", 1);
+  for (i = 0; i < n_fragment_sources; i++)
+    g_checksum_update (checksum, (const guchar *) fragment_sources[i], fragment_lengths[i]);
+
+  basename = g_strdup_printf ("%s.bin", g_checksum_get_string (checksum));
+  dir = g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "gl-programs", NULL);
+  path = g_build_filename (dir, basename, NULL);
+
+  g_checksum_free (checksum);
+  g_free (basename);
+  g_free (dir);
+
+  return path;
+}
+
+static int
+load_cached_program (const char *path)
+{
+  char *contents;
+  gsize length;
+  guint32 format;
+  int program_id;
+  int status;
+  GLenum gl_error;
+
+  if (!g_file_get_contents (path, &contents, &length, NULL))
+    return -1;
+
+  if (length <= PROGRAM_CACHE_HEADER_SIZE ||
+      memcmp (contents, PROGRAM_CACHE_MAGIC, strlen (PROGRAM_CACHE_MAGIC)) != 0)
+    {
+      g_free (contents);
+      g_unlink (path);
+      return -1;
+    }
+
+  memcpy (&format, contents + strlen (PROGRAM_CACHE_MAGIC), sizeof (guint32));
+
+  /* So that an error after glProgramBinary() is known to be its own */
+  gl_error = glGetError ();
+  if (gl_error != GL_NO_ERROR)
+    GSK_NOTE (SHADERS, g_message ("GL error 0x%x before loading program %s", gl_error, path));
+
+  program_id = glCreateProgram ();
+  glProgramBinary (program_id, format,
+                   contents + PROGRAM_CACHE_HEADER_SIZE,
+                   length - PROGRAM_CACHE_HEADER_SIZE);
+  g_free (contents);
+
+  /* An unknown format is a GL_INVALID_ENUM, which must not show
+   * up in the error checks of whatever comes next */
+  gl_error = glGetError ();
+
+  glGetProgramiv (program_id, GL_LINK_STATUS, &status);
+  if (gl_error != GL_NO_ERROR || status == GL_FALSE)
+    {
+      /* Probably a driver update, recompile */
+      GSK_NOTE (SHADERS, g_message ("Cached program %s rejected", path));
+      glDeleteProgram (program_id);
+      g_unlink (path);
+      return -1;
+    }
+
+  GSK_NOTE (SHADERS, g_message ("Loaded cached program %s", path));
+
+  return program_id;
+}
+
+static void
+save_cached_program (const char *path,
+                     int         program_id)
+{
+  GError *error = NULL;
+  char *dir;
+  char *contents;
+  int binary_length = 0;
+  GLenum format;
+  guint32 format32;
+
+  glGetProgramiv (program_id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+  if (binary_length <= 0)
+    return;
+
+  dir = g_path_get_dirname (path);
+  if (g_mkdir_with_parents (dir, 0755) != 0)
+    {
+      g_free (dir);
+      return;
+    }
+  g_free (dir);
+
+  contents = g_malloc (PROGRAM_CACHE_HEADER_SIZE + binary_length);
+  glGetProgramBinary (program_id, binary_length, &binary_length, &format,
+                      contents + PROGRAM_CACHE_HEADER_SIZE);
+
+  memcpy (contents, PROGRAM_CACHE_MAGIC, strlen (PROGRAM_CACHE_MAGIC));
+  format32 = format;
+  memcpy (contents + strlen (PROGRAM_CACHE_MAGIC), &format32, sizeof (guint32));
+
+  if (!g_file_set_contents (path, contents, PROGRAM_CACHE_HEADER_SIZE + binary_length, &error))
+    {
+      GSK_NOTE (SHADERS, g_message ("Failed to save program %s: %s", path, error->message));
+      g_error_free (error);
+    }
+
+  g_free (contents);
+}
+
 int
 gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
                                       const char          *resource_path,
@@ -140,6 +333,11 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
 
   GBytes *source_bytes = g_resources_lookup_data (resource_path, 0, NULL);
   char version_buffer[64];
+  const char *vertex_sources[8];
+  int vertex_lengths[8];
+  const char *fragment_sources[9];
+  int fragment_lengths[9];
+  char *cache_path = NULL;
   const char *source;
   const char *vertex_shader_start;
   const char *fragment_shader_start;
@@ -147,6 +345,7 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
   int fragment_id;
   int program_id = -1;
   int status;
+  int i;
 
   g_assert (source_bytes);
 
@@ -164,28 +363,42 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
   g_snprintf (version_buffer, sizeof (version_buffer),
               "#version %d\n", self->version);
 
+  vertex_sources[0] = version_buffer;
+  vertex_sources[1] = self->debugging ? "#define GSK_DEBUG 1\n" : "";
+  vertex_sources[2] = self->legacy ? "#define GSK_LEGACY 1\n" : "";
+  vertex_sources[3] = self->gl3 ? "#define GSK_GL3 1\n" : "";
+  vertex_sources[4] = self->gles ? "#define GSK_GLES 1\n" : "";
+  vertex_sources[5] = g_bytes_get_data (self->preamble, NULL);
+  vertex_sources[6] = g_bytes_get_data (self->vs_preamble, NULL);
+  vertex_sources[7] = vertex_shader_start;
+  for (i = 0; i < 7; i++)
+    vertex_lengths[i] = strlen (vertex_sources[i]);
+  vertex_lengths[7] = fragment_shader_start - vertex_shader_start;
+
+  fragment_sources[0] = vertex_sources[0];
+  fragment_sources[1] = vertex_sources[1];
+  fragment_sources[2] = vertex_sources[2];
+  fragment_sources[3] = vertex_sources[3];
+  fragment_sources[4] = vertex_sources[4];
+  fragment_sources[5] = g_bytes_get_data (self->preamble, NULL);
+  fragment_sources[6] = g_bytes_get_data (self->fs_preamble, NULL);
+  fragment_sources[7] = fragment_shader_start;
+  fragment_sources[8] = extra_fragment_snippet ? extra_fragment_snippet : "";
+  for (i = 0; i < 8; i++)
+    fragment_lengths[i] = strlen (fragment_sources[i]);
+  fragment_lengths[8] = extra_fragment_snippet ? extra_fragment_length : 0;
+
+  if (self->program_cache && program_binaries_supported ())
+    {
+      cache_path = get_program_cache_path (vertex_sources, vertex_lengths, G_N_ELEMENTS (vertex_sources),
+                                           fragment_sources, fragment_lengths, G_N_ELEMENTS (fragment_sources));
+      program_id = load_cached_program (cache_path);
+      if (program_id >= 0)
+        goto out;
+    }
+
   vertex_id = glCreateShader (GL_VERTEX_SHADER);
-  glShaderSource (vertex_id, 8,
-                  (const char *[]) {
-                    version_buffer,
-                    self->debugging ? "#define GSK_DEBUG 1\n" : "",
-                    self->legacy ? "#define GSK_LEGACY 1\n" : "",
-                    self->gl3 ? "#define GSK_GL3 1\n" : "",
-                    self->gles ? "#define GSK_GLES 1\n" : "",
-                    g_bytes_get_data (self->preamble, NULL),
-                    g_bytes_get_data (self->vs_preamble, NULL),
-                    vertex_shader_start
-                  },
-                  (int[]) {
-                    -1,
-                    -1,
-                    -1,
-                    -1,
-                    -1,
-                    -1,
-                    -1,
-                    fragment_shader_start - vertex_shader_start
-                  });
+  glShaderSource (vertex_id, G_N_ELEMENTS (vertex_sources), vertex_sources, vertex_lengths);
   glCompileShader (vertex_id);
 
   if (!check_shader_error (vertex_id, GL_VERTEX_SHADER, resource_path, error))
@@ -197,29 +410,7 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
   print_shader_info ("Vertex shader", vertex_id, resource_path);
 
   fragment_id = glCreateShader (GL_FRAGMENT_SHADER);
-  glShaderSource (fragment_id, 9,
-                  (const char *[]) {
-                    version_buffer,
-                    self->debugging ? "#define GSK_DEBUG 1\n" : "",
-                    self->legacy ? "#define GSK_LEGACY 1\n" : "",
-                    self->gl3 ? "#define GSK_GL3 1\n" : "",
-                    self->gles ? "#define GSK_GLES 1\n" : "",
-                    g_bytes_get_data (self->preamble, NULL),
-                    g_bytes_get_data (self->fs_preamble, NULL),
-                    fragment_shader_start,
-                    extra_fragment_snippet ? extra_fragment_snippet : ""
-                  },
-                  (int[]) {
-                    -1,
-                    -1,
-                    -1,
-                    -1,
-                    -1,
-                    -1,
-                    -1,
-                    -1,
-                    extra_fragment_length,
-                  });
+  glShaderSource (fragment_id, G_N_ELEMENTS (fragment_sources), fragment_sources, fragment_lengths);
   glCompileShader (fragment_id);
 
   if (!check_shader_error (fragment_id, GL_FRAGMENT_SHADER, resource_path, error))
@@ -235,6 +426,8 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
   glAttachShader (program_id, fragment_id);
   glBindAttribLocation (program_id, 0, "aPosition");
   glBindAttribLocation (program_id, 1, "aUv");
+  if (cache_path != NULL && has_program_parameters ())
+    glProgramParameteri (program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
   glLinkProgram (program_id);
   glDetachShader (program_id, vertex_id);
   glDetachShader (program_id, fragment_id);
@@ -259,12 +452,17 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
       glDeleteProgram (program_id);
       program_id = -1;
     }
+  else if (cache_path != NULL)
+    {
+      save_cached_program (cache_path, program_id);
+    }
 
   glDeleteShader (vertex_id);
   glDeleteShader (fragment_id);
 
 out:
   g_bytes_unref (source_bytes);
+  g_free (cache_path);
 
   return program_id;
 }
@@ -7,6 +7,34 @@
 
 #define ATLAS_SIZE (512)
 #define MAX_OLD_RATIO 0.5
+#define MIN_LIVE_RATIO 0.25
+#define MAX_COMPACTIONS_PER_FRAME 1
+
+/* Compaction
+ *
+ * Instead of dropping atlases that are mostly taken up by old
+ * items, we move the items that are still in use to other atlases,
+ * so they don't have to be uploaded again. The same is done for
+ * atlases that are only sparsely used, so they don't stick around
+ * forever.
+ *
+ * At the start of a frame, at most MAX_COMPACTIONS_PER_FRAME atlases
+ * are taken out of use. The caches then relocate their live items on
+ * those atlases and drop the others, and the items are copied over on
+ * the GPU, by reading from a framebuffer with the old atlas attached.
+ */
+
+typedef struct
+{
+  GskGLTextureAtlas *src;
+  GskGLTextureAtlas *dst;
+  int src_x;
+  int src_y;
+  int dst_x;
+  int dst_y;
+  int width;
+  int height;
+} AtlasCopy;
 
 static void
 free_atlas (gpointer v)
@@ -25,6 +53,10 @@ gsk_gl_texture_atlases_new (void)
 
   self = g_new (GskGLTextureAtlases, 1);
   self->atlases = g_ptr_array_new_with_free_func (free_atlas);
+  self->compacting = g_ptr_array_new_with_free_func (free_atlas);
+  self->copies = g_array_new (FALSE, FALSE, sizeof (AtlasCopy));
+  memset (&self->stats, 0, sizeof (self->stats));
+  g_mutex_init (&self->lock);
 
   self->ref_count = 1;
 
@@ -47,6 +79,9 @@ gsk_gl_texture_atlases_unref (GskGLTextureAtlases *self)
   if (self->ref_count == 1)
     {
       g_ptr_array_unref (self->atlases);
+      g_ptr_array_unref (self->compacting);
+      g_array_unref (self->copies);
+      g_mutex_clear (&self->lock);
       g_free (self);
       return;
     }
@@ -73,17 +108,50 @@ write_atlas_to_png (GskGLTextureAtlas *atlas,
 }
 #endif
 
+static gboolean
+should_compact (const GskGLTextureAtlas *atlas,
+                gboolean                 is_newest)
+{
+  if (gsk_gl_texture_atlas_get_unused_ratio (atlas) > MAX_OLD_RATIO)
+    return TRUE;
+
+  /* The newest atlas is still being filled */
+  return !is_newest &&
+         atlas->unused_pixels > 0 &&
+         gsk_gl_texture_atlas_get_live_ratio (atlas) < MIN_LIVE_RATIO;
+}
+
 void
 gsk_gl_texture_atlases_begin_frame (GskGLTextureAtlases *self,
                                     GPtrArray           *removed)
 {
   int i;
 
+  g_assert (self->compacting->len == 0);
+
+  memset (&self->stats, 0, sizeof (self->stats));
+
   for (i = self->atlases->len - 1; i >= 0; i--)
     {
       GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i);
 
-      if (gsk_gl_texture_atlas_get_unused_ratio (atlas) > MAX_OLD_RATIO)
+      if (!should_compact (atlas, i == self->atlases->len - 1))
+        continue;
+
+      if (gsk_gl_texture_atlas_get_live_ratio (atlas) > 0)
+        {
+          if (self->compacting->len >= MAX_COMPACTIONS_PER_FRAME)
+            continue;
+
+          GSK_NOTE(GLYPH_CACHE,
+                   g_message ("Compacting atlas %d (%.2g%% old, %.2g%% live)", i,
+                              100.0 * gsk_gl_texture_atlas_get_unused_ratio (atlas),
+                              100.0 * gsk_gl_texture_atlas_get_live_ratio (atlas)));
+
+          g_ptr_array_add (self->compacting, g_ptr_array_steal_index (self->atlases, i));
+          self->stats.compacted++;
+        }
+      else
         {
           GSK_NOTE(GLYPH_CACHE,
                    g_message ("Dropping atlas %d (%g.2%% old)", i,
@@ -97,7 +165,8 @@ gsk_gl_texture_atlases_begin_frame (GskGLTextureAtlases *self,
 
           g_ptr_array_add (removed, atlas);
           g_ptr_array_remove_index (self->atlases, i);
-       }
+          self->stats.dropped++;
+        }
     }
 
   GSK_NOTE(GLYPH_CACHE, {
@@ -179,6 +248,132 @@ gsk_gl_texture_atlases_pack (GskGLTextureAtlases *self,
   return TRUE;
 }
 
+gboolean
+gsk_gl_texture_atlases_is_compacting (GskGLTextureAtlases     *self,
+                                      const GskGLTextureAtlas *atlas)
+{
+  return self->compacting->len > 0 &&
+         g_ptr_array_find (self->compacting, atlas, NULL);
+}
+
+/* Moves the item at @x, @y on @atlas, which is being compacted,
+ * to another atlas. The size includes the padding of the item.
+ */
+void
+gsk_gl_texture_atlases_relocate (GskGLTextureAtlases *self,
+                                 GskGLTextureAtlas   *atlas,
+                                 int                  x,
+                                 int                  y,
+                                 int                  width,
+                                 int                  height,
+                                 GskGLTextureAtlas  **atlas_out,
+                                 int                 *out_x,
+                                 int                 *out_y)
+{
+  AtlasCopy copy;
+
+  g_assert (gsk_gl_texture_atlases_is_compacting (self, atlas));
+
+  gsk_gl_texture_atlases_pack (self, width, height, atlas_out, out_x, out_y);
+
+  copy.src = atlas;
+  copy.dst = *atlas_out;
+  copy.src_x = x;
+  copy.src_y = y;
+  copy.dst_x = *out_x;
+  copy.dst_y = *out_y;
+  copy.width = width;
+  copy.height = height;
+  g_array_append_val (self->copies, copy);
+
+  self->stats.relocated++;
+}
+
+/* Copies all relocated items and frees the atlases they were on.
+ * Must be called after the caches had a chance to relocate their
+ * items, and before any of them are drawn.
+ */
+void
+gsk_gl_texture_atlases_compact (GskGLTextureAtlases *self)
+{
+  const GskGLTextureAtlas *src = NULL;
+  const GskGLTextureAtlas *dst = NULL;
+  int prev_fbo;
+  guint fbo_id;
+  guint i;
+
+  if (self->compacting->len == 0)
+    return;
+
+  if (self->copies->len > 0)
+    {
+      gdk_gl_context_push_debug_group_printf (gdk_gl_context_get_current (),
+                                              "Compacting atlases (%u items)", self->copies->len);
+
+      glGetIntegerv (GL_FRAMEBUFFER_BINDING, &prev_fbo);
+      glGenFramebuffers (1, &fbo_id);
+      glBindFramebuffer (GL_FRAMEBUFFER, fbo_id);
+
+      for (i = 0; i < self->copies->len; i++)
+        {
+          const AtlasCopy *copy = &g_array_index (self->copies, AtlasCopy, i);
+
+          if (copy->src != src)
+            {
+              glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                      GL_TEXTURE_2D, copy->src->texture_id, 0);
+              src = copy->src;
+            }
+
+          if (copy->dst != dst)
+            {
+              glBindTexture (GL_TEXTURE_2D, copy->dst->texture_id);
+              dst = copy->dst;
+            }
+
+          glCopyTexSubImage2D (GL_TEXTURE_2D, 0,
+                               copy->dst_x, copy->dst_y,
+                               copy->src_x, copy->src_y,
+                               copy->width, copy->height);
+        }
+
+      glBindFramebuffer (GL_FRAMEBUFFER, prev_fbo);
+      glDeleteFramebuffers (1, &fbo_id);
+
+      gdk_gl_context_pop_debug_group (gdk_gl_context_get_current ());
+    }
+
+  GSK_NOTE(GLYPH_CACHE, g_message ("Compacted %u atlases, moved %u items, dropped %u",
+                                   self->compacting->len, self->copies->len, self->stats.evicted));
+
+  g_array_set_size (self->copies, 0);
+  g_ptr_array_set_size (self->compacting, 0);
+}
+
+/* The fraction of the pixels in all atlases that are taken
+ * by items that are in use.
+ */
+double
+gsk_gl_texture_atlases_get_occupancy (GskGLTextureAtlases *self)
+{
+  gint64 live = 0;
+  gint64 total = 0;
+  guint i;
+
+  for (i = 0; i < self->atlases->len; i++)
+    {
+      const GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i);
+
+      live += atlas->packed_pixels - atlas->unused_pixels;
+      total += atlas->width * atlas->height;
+    }
+
+  if (total == 0)
+    return 0.0;
+
+  return (double) live / (double) total;
+}
+
 void
 gsk_gl_texture_atlas_init (GskGLTextureAtlas *self,
                            int                width,
@@ -253,6 +448,7 @@ gsk_gl_texture_atlas_pack (GskGLTextureAtlas *self,
     {
       *out_x = rect.x;
       *out_y = rect.y;
+      self->packed_pixels += width * height;
     }
 
   return rect.was_packed;
@@ -267,6 +463,12 @@ gsk_gl_texture_atlas_get_unused_ratio (const GskGLTextureAtlas *self)
   return 0.0;
 }
 
+double
+gsk_gl_texture_atlas_get_live_ratio (const GskGLTextureAtlas *self)
+{
+  return (double)(self->packed_pixels - self->unused_pixels) / (double)(self->width * self->height);
+}
+
 /* Not using gdk_gl_driver_create_texture here, since we want
  * this texture to survive the driver and stay around until
  * the display gets closed.
@@ -18,6 +18,7 @@ struct _GskGLTextureAtlas
 
   int unused_pixels; /* Pixels of rects that have been used at some point,
                         But are now unused. */
+  int packed_pixels; /* Pixels of all rects that have been packed */
 
   void *user_data;
 };
@@ -28,6 +29,23 @@ struct _GskGLTextureAtlases
   int ref_count;
 
   GPtrArray *atlases;
+
+  /* Atlases that are being compacted in this frame, and the
+   * copies of the items that were moved out of them */
+  GPtrArray *compacting;
+  GArray *copies;
+
+  /* For the profiler, reset every frame */
+  struct {
+    guint dropped;     /* atlases */
+    guint compacted;   /* atlases */
+    guint relocated;   /* items */
+    guint evicted;     /* items, counted by the caches */
+  } stats;
+
+  /* Protects the usage accounting of items in the atlases when
+   * they are looked up while recording ops on other threads */
+  GMutex lock;
 };
 typedef struct _GskGLTextureAtlases GskGLTextureAtlases;
 
@@ -43,6 +61,19 @@ gboolean             gsk_gl_texture_atlases_pack        (GskGLTextureAtlases *at
                                                          GskGLTextureAtlas  **atlas_out,
                                                          int                 *out_x,
                                                          int                 *out_y);
+gboolean             gsk_gl_texture_atlases_is_compacting (GskGLTextureAtlases     *atlases,
+                                                           const GskGLTextureAtlas *atlas);
+void                 gsk_gl_texture_atlases_relocate    (GskGLTextureAtlases *atlases,
+                                                         GskGLTextureAtlas   *atlas,
+                                                         int                  x,
+                                                         int                  y,
+                                                         int                  width,
+                                                         int                  height,
+                                                         GskGLTextureAtlas  **atlas_out,
+                                                         int                 *out_x,
+                                                         int                 *out_y);
+void                 gsk_gl_texture_atlases_compact     (GskGLTextureAtlases *atlases);
+double               gsk_gl_texture_atlases_get_occupancy (GskGLTextureAtlases *atlases);
 
 void        gsk_gl_texture_atlas_init              (GskGLTextureAtlas       *self,
                                                     int                      width,
@@ -68,5 +99,6 @@ gboolean    gsk_gl_texture_atlas_pack              (GskGLTextureAtlas       *sel
                                                     int                     *out_y);
 
 double      gsk_gl_texture_atlas_get_unused_ratio  (const GskGLTextureAtlas *self);
+double      gsk_gl_texture_atlas_get_live_ratio    (const GskGLTextureAtlas *self);
 
 #endif
@@ -135,3 +135,30 @@ op_buffer_add (OpBuffer *buffer,
 
   return &buffer->buf[entry.pos];
 }
+
+gpointer
+op_buffer_add_copy (OpBuffer      *buffer,
+                    OpKind         kind,
+                    gconstpointer  data)
+{
+  gpointer op = op_buffer_add (buffer, kind);
+
+  memcpy (op, data, op_sizes[kind]);
+
+  return op;
+}
+
+/* Appends all ops of @other, except for the leading OP_NONE */
+void
+op_buffer_append (OpBuffer       *buffer,
+                  const OpBuffer *other)
+{
+  guint i;
+
+  for (i = 1; i < other->index->len; i++)
+    {
+      const OpBufferEntry *entry = &g_array_index (other->index, OpBufferEntry, i);
+
+      op_buffer_add_copy (buffer, entry->kind, &other->buf[entry->pos]);
+    }
+}
@@ -138,6 +138,13 @@ typedef struct
 {
   gsize vao_offset;
   gsize vao_size;
+  /* The modelview, if it is affine. Used to tell whether
+   * draws overlap when merging them. */
+  float scale_x;
+  float scale_y;
+  float dx;
+  float dy;
+  guint is_affine : 1;
 } OpDraw;
 
 typedef struct
@@ -230,6 +237,11 @@ void     op_buffer_destroy         (OpBuffer *buffer);
 void     op_buffer_clear           (OpBuffer *buffer);
 gpointer op_buffer_add             (OpBuffer *buffer,
                                     OpKind    kind);
+gpointer op_buffer_add_copy        (OpBuffer      *buffer,
+                                    OpKind         kind,
+                                    gconstpointer  data);
+void     op_buffer_append          (OpBuffer       *buffer,
+                                    const OpBuffer *other);
 
 typedef struct
 {
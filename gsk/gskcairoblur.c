@@ -20,11 +20,23 @@
  *     Owen Taylor <otaylor@redhat.com>
  */
 
+#include "config.h"
+
 #include "gskcairoblurprivate.h"
 
 #include <math.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_TARGET
+#include <immintrin.h>
+#endif
+#if defined (__ARM_NEON) && defined (__aarch64__)
+#include <arm_neon.h>
+#endif
+
 /*
  * Gets the size for a single box blur.
  *
@@ -51,109 +63,507 @@
 #define BOX_FILTER_SIZE_9 16
 #define BOX_FILTER_SIZE_10 18
 
-/* This applies a single box blur pass to a horizontal range of pixels;
- * since the box blur has the same weight for all pixels, we can
- * implement an efficient sliding window algorithm where we add
- * in pixels coming into the window from the right and remove
- * them when they leave the windw to the left.
+/* The blur is a series of box blurs, which are applied to the columns
+ * of the buffer. Blurring rows is done by transposing the buffer first.
+ *
+ * A single box blur pass uses a sliding window: since the box blur has
+ * the same weight for all pixels, we add in pixels coming into the
+ * window and remove them when they leave it. Going down all columns at
+ * once means that neighbouring pixels of a row are independent, which
+ * is what the SIMD kernels below make use of.
  *
  * d is the filter width; for even d shift indicates how the blurred
  * result is aligned with the original - does ' x ' go to ' yy' (shift=1)
  * or 'yy ' (shift=-1)
  */
-static void
-blur_xspan (guchar *row,
-            guchar *tmp_buffer,
-            int     row_width,
-            int     d,
-            int     shift)
-{
-  int offset;
-  int sum = 0;
-  int i;
+typedef void (* BlurColumnsFunc) (guchar       *dst,
+                                  const guchar *src,
+                                  int           width,
+                                  int           height,
+                                  int           d,
+                                  int           shift);
+
+typedef struct {
+  const char *name;
+  BlurColumnsFunc blur_columns;
+  gboolean (* supported) (void);
+} BlurKernel;
+
+/* The SIMD kernels replace the division by d with a multiplication
+ * by 1/d in single precision. Computing (n + 0.5) / d that way
+ * truncates to the same result as the integer division n / d for
+ * all n < 256 * d as long as d is not larger than this.
+ */
+#define MAX_SIMD_FILTER_SIZE 2048
 
+static inline int
+get_blur_offset (int d,
+                 int shift)
+{
   if (d % 2 == 1)
-    offset = d / 2;
+    return d / 2;
   else
-    offset = (d - shift) / 2;
-
-  /* All the conditionals in here look slow, but the branches will
-   * be well predicted and there are enough different possibilities
-   * that trying to write this as a series of unconditional loops
-   * is hard and not an obvious win. The main slow down here seems
-   * to be the integer division per pixel; one possible optimization
-   * would be to accumulate into two 16-bit integer buffers and
-   * only divide down after all three passes. (SSE parallel implementation
-   * of the divide step is possible.)
-   */
+    return (d - shift) / 2;
+}
+
+static void
+blur_columns_range (guchar       *dst,
+                    const guchar *src,
+                    int           width,
+                    int           height,
+                    int           x_start,
+                    int           x_end,
+                    int           d,
+                    int           shift)
+{
+  int offset = get_blur_offset (d, shift);
+  int *sums;
+  int i, x;
 
-#define BLUR_ROW_KERNEL(D)                                      \
-  for (i = -(D) + offset; i < row_width + offset; i++)		\
-    {                                                           \
-      if (i >= 0 && i < row_width)                              \
-        sum += row[i];                                          \
-                                                                \
-      if (i >= offset)						\
-	{							\
-	  if (i >= (D))						\
-	    sum -= row[i - (D)];				\
-                                                                \
-	  tmp_buffer[i - offset] = (sum + (D) / 2) / (D);	\
-	}							\
-    }								\
+  if (x_start >= x_end)
+    return;
+
+  sums = g_new0 (int, x_end - x_start);
+
+#define BLUR_COLUMNS_KERNEL(D)                                          \
+  for (i = -(D) + offset; i < height + offset; i++)                     \
+    {                                                                   \
+      if (i >= 0 && i < height)                                         \
+        {                                                               \
+          const guchar *in = src + i * width;                           \
+          for (x = x_start; x < x_end; x++)                             \
+            sums[x - x_start] += in[x];                                 \
+        }                                                               \
+                                                                        \
+      if (i >= offset)                                                  \
+        {                                                               \
+          guchar *out = dst + (i - offset) * width;                     \
+                                                                        \
+          if (i >= (D))                                                 \
+            {                                                           \
+              const guchar *old = src + (i - (D)) * width;              \
+              for (x = x_start; x < x_end; x++)                         \
+                sums[x - x_start] -= old[x];                            \
+            }                                                           \
+                                                                        \
+          for (x = x_start; x < x_end; x++)                             \
+            out[x] = (sums[x - x_start] + (D) / 2) / (D);               \
+        }                                                               \
+    }                                                                   \
   break;
 
   /* We unroll the values for d for radius 2-10 to avoid a generic
    * divide operation (not radius 1, because its a no-op) */
   switch (d)
     {
-    case BOX_FILTER_SIZE_2: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_2);
-    case BOX_FILTER_SIZE_3: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_3);
-    case BOX_FILTER_SIZE_4: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_4);
-    case BOX_FILTER_SIZE_5: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_5);
-    case BOX_FILTER_SIZE_6: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_6);
-    case BOX_FILTER_SIZE_7: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_7);
-    case BOX_FILTER_SIZE_8: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_8);
-    case BOX_FILTER_SIZE_9: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_9);
-    case BOX_FILTER_SIZE_10: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_10);
-    default: BLUR_ROW_KERNEL (d);
+    case BOX_FILTER_SIZE_2: BLUR_COLUMNS_KERNEL (BOX_FILTER_SIZE_2);
+    case BOX_FILTER_SIZE_3: BLUR_COLUMNS_KERNEL (BOX_FILTER_SIZE_3);
+    case BOX_FILTER_SIZE_4: BLUR_COLUMNS_KERNEL (BOX_FILTER_SIZE_4);
+    case BOX_FILTER_SIZE_5: BLUR_COLUMNS_KERNEL (BOX_FILTER_SIZE_5);
+    case BOX_FILTER_SIZE_6: BLUR_COLUMNS_KERNEL (BOX_FILTER_SIZE_6);
+    case BOX_FILTER_SIZE_7: BLUR_COLUMNS_KERNEL (BOX_FILTER_SIZE_7);
+    case BOX_FILTER_SIZE_8: BLUR_COLUMNS_KERNEL (BOX_FILTER_SIZE_8);
+    case BOX_FILTER_SIZE_9: BLUR_COLUMNS_KERNEL (BOX_FILTER_SIZE_9);
+    case BOX_FILTER_SIZE_10: BLUR_COLUMNS_KERNEL (BOX_FILTER_SIZE_10);
+    default: BLUR_COLUMNS_KERNEL (d);
     }
 
-  memcpy (row, tmp_buffer, row_width);
+#undef BLUR_COLUMNS_KERNEL
+
+  g_free (sums);
 }
 
 static void
-blur_rows (guchar *dst_buffer,
-           guchar *tmp_buffer,
-           int     buffer_width,
-           int     buffer_height,
-           int     d)
+blur_columns_c (guchar       *dst,
+                const guchar *src,
+                int           width,
+                int           height,
+                int           d,
+                int           shift)
 {
-  int i;
+  blur_columns_range (dst, src, width, height, 0, width, d, shift);
+}
 
-  for (i = 0; i < buffer_height; i++)
+static gboolean
+kernel_always_supported (void)
+{
+  return TRUE;
+}
+
+#ifdef __SSE2__
+static void
+blur_columns_sse2 (guchar       *dst,
+                   const guchar *src,
+                   int           width,
+                   int           height,
+                   int           d,
+                   int           shift)
+{
+  int offset = get_blur_offset (d, shift);
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128 half = _mm_set1_ps (0.5f);
+  const __m128 inv_d = _mm_set1_ps (1.0f / d);
+  const __m128i round = _mm_set1_epi32 (d / 2);
+  int i, x, k;
+
+  for (x = 0; x + 16 <= width; x += 16)
     {
-      guchar *row = dst_buffer + i * buffer_width;
-
-      /* We want to produce a symmetric blur that spreads a pixel
-       * equally far to the left and right. If d is odd that happens
-       * naturally, but for d even, we approximate by using a blur
-       * on either side and then a centered blur of size d + 1.
-       * (technique also from the SVG specification)
-       */
-      if (d % 2 == 1)
+      __m128i sums[4] = { zero, zero, zero, zero };
+
+      for (i = -d + offset; i < height + offset; i++)
         {
-          blur_xspan (row, tmp_buffer, buffer_width, d, 0);
-          blur_xspan (row, tmp_buffer, buffer_width, d, 0);
-          blur_xspan (row, tmp_buffer, buffer_width, d, 0);
+          if (i >= 0 && i < height)
+            {
+              __m128i in = _mm_loadu_si128 ((const __m128i *) (src + i * width + x));
+              __m128i lo = _mm_unpacklo_epi8 (in, zero);
+              __m128i hi = _mm_unpackhi_epi8 (in, zero);
+
+              sums[0] = _mm_add_epi32 (sums[0], _mm_unpacklo_epi16 (lo, zero));
+              sums[1] = _mm_add_epi32 (sums[1], _mm_unpackhi_epi16 (lo, zero));
+              sums[2] = _mm_add_epi32 (sums[2], _mm_unpacklo_epi16 (hi, zero));
+              sums[3] = _mm_add_epi32 (sums[3], _mm_unpackhi_epi16 (hi, zero));
+            }
+
+          if (i >= offset)
+            {
+              __m128i out[4];
+
+              if (i >= d)
+                {
+                  __m128i old = _mm_loadu_si128 ((const __m128i *) (src + (i - d) * width + x));
+                  __m128i lo = _mm_unpacklo_epi8 (old, zero);
+                  __m128i hi = _mm_unpackhi_epi8 (old, zero);
+
+                  sums[0] = _mm_sub_epi32 (sums[0], _mm_unpacklo_epi16 (lo, zero));
+                  sums[1] = _mm_sub_epi32 (sums[1], _mm_unpackhi_epi16 (lo, zero));
+                  sums[2] = _mm_sub_epi32 (sums[2], _mm_unpacklo_epi16 (hi, zero));
+                  sums[3] = _mm_sub_epi32 (sums[3], _mm_unpackhi_epi16 (hi, zero));
+                }
+
+              for (k = 0; k < 4; k++)
+                {
+                  __m128 n = _mm_cvtepi32_ps (_mm_add_epi32 (sums[k], round));
+                  out[k] = _mm_cvttps_epi32 (_mm_mul_ps (_mm_add_ps (n, half), inv_d));
+                }
+
+              _mm_storeu_si128 ((__m128i *) (dst + (i - offset) * width + x),
+                                _mm_packus_epi16 (_mm_packs_epi32 (out[0], out[1]),
+                                                  _mm_packs_epi32 (out[2], out[3])));
+            }
         }
-      else
+    }
+
+  blur_columns_range (dst, src, width, height, x, width, d, shift);
+}
+
+/* Transposes a 16x16 block by interleaving the upper and lower
+ * halves of the rows 4 times. */
+static inline void
+flip_block_sse2 (guchar       *dst,
+                 const guchar *src,
+                 int           src_stride,
+                 int           dst_stride)
+{
+  __m128i a[16], b[16];
+  int i, k;
+
+  for (i = 0; i < 16; i++)
+    a[i] = _mm_loadu_si128 ((const __m128i *) (src + i * src_stride));
+
+  for (k = 0; k < 2; k++)
+    {
+      for (i = 0; i < 8; i++)
+        {
+          b[2 * i] = _mm_unpacklo_epi8 (a[i], a[i + 8]);
+          b[2 * i + 1] = _mm_unpackhi_epi8 (a[i], a[i + 8]);
+        }
+      for (i = 0; i < 8; i++)
         {
-          blur_xspan (row, tmp_buffer, buffer_width, d, 1);
-          blur_xspan (row, tmp_buffer, buffer_width, d, -1);
-          blur_xspan (row, tmp_buffer, buffer_width, d + 1, 0);
+          a[2 * i] = _mm_unpacklo_epi8 (b[i], b[i + 8]);
+          a[2 * i + 1] = _mm_unpackhi_epi8 (b[i], b[i + 8]);
         }
     }
+
+  for (i = 0; i < 16; i++)
+    _mm_storeu_si128 ((__m128i *) (dst + i * dst_stride), a[i]);
+}
+#endif
+
+#ifdef HAVE_AVX2_TARGET
+__attribute__((target ("avx2")))
+static void
+blur_columns_avx2 (guchar       *dst,
+                   const guchar *src,
+                   int           width,
+                   int           height,
+                   int           d,
+                   int           shift)
+{
+  int offset = get_blur_offset (d, shift);
+  const __m256 half = _mm256_set1_ps (0.5f);
+  const __m256 inv_d = _mm256_set1_ps (1.0f / d);
+  const __m256i round = _mm256_set1_epi32 (d / 2);
+  const __m256i order = _mm256_setr_epi32 (0, 4, 1, 5, 2, 6, 3, 7);
+  int i, x, k;
+
+  for (x = 0; x + 32 <= width; x += 32)
+    {
+      __m256i sums[4];
+
+      for (k = 0; k < 4; k++)
+        sums[k] = _mm256_setzero_si256 ();
+
+      for (i = -d + offset; i < height + offset; i++)
+        {
+          if (i >= 0 && i < height)
+            {
+              const guchar *in = src + i * width + x;
+
+              for (k = 0; k < 4; k++)
+                sums[k] = _mm256_add_epi32 (sums[k],
+                                            _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) (in + 8 * k))));
+            }
+
+          if (i >= offset)
+            {
+              __m256i out[4];
+
+              if (i >= d)
+                {
+                  const guchar *old = src + (i - d) * width + x;
+
+                  for (k = 0; k < 4; k++)
+                    sums[k] = _mm256_sub_epi32 (sums[k],
+                                                _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) (old + 8 * k))));
+                }
+
+              for (k = 0; k < 4; k++)
+                {
+                  __m256 n = _mm256_cvtepi32_ps (_mm256_add_epi32 (sums[k], round));
+                  out[k] = _mm256_cvttps_epi32 (_mm256_mul_ps (_mm256_add_ps (n, half), inv_d));
+                }
+
+              /* The packs work per 128bit lane, so fix up the order afterwards */
+              _mm256_storeu_si256 ((__m256i *) (dst + (i - offset) * width + x),
+                                   _mm256_permutevar8x32_epi32 (_mm256_packus_epi16 (_mm256_packs_epi32 (out[0], out[1]),
+                                                                                     _mm256_packs_epi32 (out[2], out[3])),
+                                                                order));
+            }
+        }
+    }
+
+  blur_columns_range (dst, src, width, height, x, width, d, shift);
+}
+
+static gboolean
+kernel_avx2_supported (void)
+{
+  return __builtin_cpu_supports ("avx2");
+}
+#endif
+
+#if defined (__ARM_NEON) && defined (__aarch64__)
+static void
+blur_columns_neon (guchar       *dst,
+                   const guchar *src,
+                   int           width,
+                   int           height,
+                   int           d,
+                   int           shift)
+{
+  int offset = get_blur_offset (d, shift);
+  const float32x4_t half = vdupq_n_f32 (0.5f);
+  const float32x4_t inv_d = vdupq_n_f32 (1.0f / d);
+  const uint32x4_t round = vdupq_n_u32 (d / 2);
+  int i, x, k;
+
+  for (x = 0; x + 16 <= width; x += 16)
+    {
+      uint32x4_t sums[4];
+
+      for (k = 0; k < 4; k++)
+        sums[k] = vdupq_n_u32 (0);
+
+      for (i = -d + offset; i < height + offset; i++)
+        {
+          if (i >= 0 && i < height)
+            {
+              uint8x16_t in = vld1q_u8 (src + i * width + x);
+              uint16x8_t lo = vmovl_u8 (vget_low_u8 (in));
+              uint16x8_t hi = vmovl_u8 (vget_high_u8 (in));
+
+              sums[0] = vaddw_u16 (sums[0], vget_low_u16 (lo));
+              sums[1] = vaddw_u16 (sums[1], vget_high_u16 (lo));
+              sums[2] = vaddw_u16 (sums[2], vget_low_u16 (hi));
+              sums[3] = vaddw_u16 (sums[3], vget_high_u16 (hi));
+            }
+
+          if (i >= offset)
+            {
+              uint32x4_t out[4];
+
+              if (i >= d)
+                {
+                  uint8x16_t old = vld1q_u8 (src + (i - d) * width + x);
+                  uint16x8_t lo = vmovl_u8 (vget_low_u8 (old));
+                  uint16x8_t hi = vmovl_u8 (vget_high_u8 (old));
+
+                  sums[0] = vsubw_u16 (sums[0], vget_low_u16 (lo));
+                  sums[1] = vsubw_u16 (sums[1], vget_high_u16 (lo));
+                  sums[2] = vsubw_u16 (sums[2], vget_low_u16 (hi));
+                  sums[3] = vsubw_u16 (sums[3], vget_high_u16 (hi));
+                }
+
+              for (k = 0; k < 4; k++)
+                {
+                  float32x4_t n = vcvtq_f32_u32 (vaddq_u32 (sums[k], round));
+                  out[k] = vcvtq_u32_f32 (vmulq_f32 (vaddq_f32 (n, half), inv_d));
+                }
+
+              vst1q_u8 (dst + (i - offset) * width + x,
+                        vcombine_u8 (vmovn_u16 (vcombine_u16 (vmovn_u32 (out[0]), vmovn_u32 (out[1]))),
+                                     vmovn_u16 (vcombine_u16 (vmovn_u32 (out[2]), vmovn_u32 (out[3])))));
+            }
+        }
+    }
+
+  blur_columns_range (dst, src, width, height, x, width, d, shift);
+}
+
+static inline void
+flip_block_neon (guchar       *dst,
+                 const guchar *src,
+                 int           src_stride,
+                 int           dst_stride)
+{
+  uint8x16_t a[16], b[16];
+  int i, k;
+
+  for (i = 0; i < 16; i++)
+    a[i] = vld1q_u8 (src + i * src_stride);
+
+  for (k = 0; k < 2; k++)
+    {
+      for (i = 0; i < 8; i++)
+        {
+          b[2 * i] = vzip1q_u8 (a[i], a[i + 8]);
+          b[2 * i + 1] = vzip2q_u8 (a[i], a[i + 8]);
+        }
+      for (i = 0; i < 8; i++)
+        {
+          a[2 * i] = vzip1q_u8 (b[i], b[i + 8]);
+          a[2 * i + 1] = vzip2q_u8 (b[i], b[i + 8]);
+        }
+    }
+
+  for (i = 0; i < 16; i++)
+    vst1q_u8 (dst + i * dst_stride, a[i]);
+}
+#endif
+
+static const BlurKernel blur_kernels[] = {
+#ifdef HAVE_AVX2_TARGET
+  { "avx2", blur_columns_avx2, kernel_avx2_supported },
+#endif
+#ifdef __SSE2__
+  { "sse2", blur_columns_sse2, kernel_always_supported },
+#endif
+#if defined (__ARM_NEON) && defined (__aarch64__)
+  { "neon", blur_columns_neon, kernel_always_supported },
+#endif
+  { "c", blur_columns_c, kernel_always_supported },
+};
+
+static const BlurKernel *blur_kernel = NULL;
+
+static const BlurKernel *
+get_blur_kernel (void)
+{
+  if (g_once_init_enter (&blur_kernel))
+    {
+      const BlurKernel *kernel = NULL;
+      guint i;
+
+      for (i = 0; i < G_N_ELEMENTS (blur_kernels); i++)
+        {
+          if (blur_kernels[i].supported ())
+            {
+              kernel = &blur_kernels[i];
+              break;
+            }
+        }
+
+      g_once_init_leave (&blur_kernel, kernel);
+    }
+
+  return g_atomic_pointer_get (&blur_kernel);
+}
+
+/*<private>
+ * gsk_cairo_blur_set_kernel:
+ * @name: the name of a kernel, like "sse2" or "c"
+ *
+ * Overrides the automatically selected blur implementation.
+ * This is meant for benchmarks and tests. Blurs that are already
+ * running on other threads finish with the kernel they started with.
+ *
+ * Returns: %TRUE if the kernel is available on this machine
+ */
+gboolean
+gsk_cairo_blur_set_kernel (const char *name)
+{
+  guint i;
+
+  get_blur_kernel ();
+
+  for (i = 0; i < G_N_ELEMENTS (blur_kernels); i++)
+    {
+      if (strcmp (blur_kernels[i].name, name) == 0 &&
+          blur_kernels[i].supported ())
+        {
+          g_atomic_pointer_set (&blur_kernel, &blur_kernels[i]);
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static void
+blur_columns (const BlurKernel *kernel,
+              guchar           *buffer,
+              guchar           *tmp_buffer,
+              int               width,
+              int               height,
+              int               d)
+{
+  BlurColumnsFunc blur_func;
+
+  if (d + 1 > MAX_SIMD_FILTER_SIZE)
+    blur_func = blur_columns_c;
+  else
+    blur_func = kernel->blur_columns;
+
+  /* We want to produce a symmetric blur that spreads a pixel
+   * equally far to both sides. If d is odd that happens
+   * naturally, but for d even, we approximate by using a blur
+   * on either side and then a centered blur of size d + 1.
+   * (technique also from the SVG specification)
+   */
+  if (d % 2 == 1)
+    {
+      blur_func (tmp_buffer, buffer, width, height, d, 0);
+      blur_func (buffer, tmp_buffer, width, height, d, 0);
+      blur_func (tmp_buffer, buffer, width, height, d, 0);
+    }
+  else
+    {
+      blur_func (tmp_buffer, buffer, width, height, d, 1);
+      blur_func (buffer, tmp_buffer, width, height, d, -1);
+      blur_func (tmp_buffer, buffer, width, height, d + 1, 0);
+    }
+
+  memcpy (buffer, tmp_buffer, width * height);
 }
 
 /* Swaps width and height.
@@ -178,6 +588,24 @@ flip_buffer (guchar *dst_buffer,
         int max_i = MIN(i0 + BLOCK_SIZE, width);
         int i, j;
 
+#if defined (__SSE2__)
+        if (max_i - i0 == BLOCK_SIZE && max_j - j0 == BLOCK_SIZE)
+          {
+            flip_block_sse2 (dst_buffer + i0 * height + j0,
+                             src_buffer + j0 * width + i0,
+                             width, height);
+            continue;
+          }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+        if (max_i - i0 == BLOCK_SIZE && max_j - j0 == BLOCK_SIZE)
+          {
+            flip_block_neon (dst_buffer + i0 * height + j0,
+                             src_buffer + j0 * width + i0,
+                             width, height);
+            continue;
+          }
+#endif
+
         for (i = i0; i < max_i; i++)
           for (j = j0; j < max_j; j++)
             dst_buffer[i * height + j] = src_buffer[j * width + i];
@@ -192,6 +620,7 @@ _boxblur (guchar      *buffer,
           int          radius,
           GskBlurFlags flags)
 {
+  const BlurKernel *kernel = get_blur_kernel ();
   guchar *flipped_buffer;
   int d = get_box_filter_size (radius);
 
@@ -199,20 +628,20 @@ _boxblur (guchar      *buffer,
 
   if (flags & GSK_BLUR_Y)
     {
-      /* Step 1: swap rows and columns */
-      flip_buffer (flipped_buffer, buffer, width, height);
-
-      /* Step 2: blur rows (really columns) */
-      blur_rows (flipped_buffer, buffer, height, width, d);
-
-      /* Step 3: swap rows and columns */
-      flip_buffer (buffer, flipped_buffer, height, width);
+      /* Step 1: blur columns */
+      blur_columns (kernel, buffer, flipped_buffer, width, height, d);
     }
 
   if (flags & GSK_BLUR_X)
     {
-      /* Step 4: blur rows */
-      blur_rows (buffer, flipped_buffer, width, height, d);
+      /* Step 2: swap rows and columns */
+      flip_buffer (flipped_buffer, buffer, width, height);
+
+      /* Step 3: blur columns (really rows) */
+      blur_columns (kernel, flipped_buffer, buffer, height, width, d);
+
+      /* Step 4: swap rows and columns */
+      flip_buffer (buffer, flipped_buffer, height, width);
     }
 
   g_free (flipped_buffer);
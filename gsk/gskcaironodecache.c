@@ -0,0 +1,749 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gskcaironodecacheprivate.h"
+
+#include "gskdebugprivate.h"
+#include "gskrendernodeprivate.h"
+#include "gsktransformprivate.h"
+
+/* The cache keeps rasterized copies of expensive subtrees that widgets
+ * hand back unchanged from frame to frame. Nodes are immutable, so a
+ * node pointer (which the cache keeps a reference to) identifies the
+ * content. What it looks like on screen additionally depends on the
+ * scale and on the subpixel position of the node, so those are part
+ * of the key, too.
+ *
+ * A node has to show up in two consecutive frames before it gets an
+ * entry, so content that changes every frame doesn't pay for the extra
+ * copy and isn't kept alive by the cache. Until then, only its address
+ * and hash are remembered. Entries keep their nodes alive, so the
+ * memory of the subtree counts against the budget next to the surface.
+ *
+ * Surfaces only cover the visible part of a node, plus a margin so that
+ * scrolling a little doesn't need a new one. Positions in a surface are
+ * counted in device pixels from the pixel that the node origin is in.
+ */
+
+#define MAX_UNUSED_FRAMES 60
+#define MIN_CACHED_PIXELS (32 * 32)
+#define MIN_TEXT_CHILDREN 8
+#define VISIBLE_MARGIN 256
+
+typedef struct
+{
+  GskRenderNode *node;
+  GList link;
+
+  cairo_surface_t *surface;
+  double x_scale, y_scale;
+  double x_fraction, y_fraction;
+  int x, y;                     /* Position of the surface */
+  gsize surface_size;
+
+  /* An estimate of the memory that the node keeps alive */
+  gsize node_size;
+
+  guint64 last_used;
+} CacheEntry;
+
+struct _GskCairoNodeCache
+{
+  GHashTable *entries;
+  GQueue lru;
+
+  /* Nodes without entries that were looked at in this frame and the
+   * last one, mapped to their hash. They are not referenced, so the
+   * hash guards against new nodes that reuse the address of old ones.
+   */
+  GHashTable *seen;
+  GHashTable *seen_before;
+
+  gsize size;
+  gsize max_bytes;
+
+  guint64 frame;
+
+  /* Nodes drawn from the cache since the last prepare */
+  int hits;
+};
+
+typedef struct
+{
+  GskCairoNodeCache *self;
+  graphene_rect_t clip;
+  double x_scale, y_scale;
+  double x_offset, y_offset;
+} PrepareData;
+
+static const cairo_user_data_key_t node_cache_key;
+
+static void
+cache_entry_clear_surface (GskCairoNodeCache *self,
+                           CacheEntry        *entry)
+{
+  if (entry->surface == NULL)
+    return;
+
+  self->size -= entry->surface_size;
+  entry->surface_size = 0;
+  g_clear_pointer (&entry->surface, cairo_surface_destroy);
+}
+
+static void
+cache_entry_free (gpointer data)
+{
+  CacheEntry *entry = data;
+
+  if (entry->surface)
+    cairo_surface_destroy (entry->surface);
+  gsk_render_node_unref (entry->node);
+  g_slice_free (CacheEntry, entry);
+}
+
+static void
+gsk_cairo_node_cache_remove (GskCairoNodeCache *self,
+                             CacheEntry        *entry)
+{
+  cache_entry_clear_surface (self, entry);
+  self->size -= entry->node_size;
+  g_queue_unlink (&self->lru, &entry->link);
+  g_hash_table_remove (self->entries, entry->node);
+}
+
+GskCairoNodeCache *
+gsk_cairo_node_cache_new (gsize max_bytes)
+{
+  GskCairoNodeCache *self;
+
+  self = g_slice_new0 (GskCairoNodeCache);
+  self->entries = g_hash_table_new_full (NULL, NULL, NULL, cache_entry_free);
+  g_queue_init (&self->lru);
+  self->seen = g_hash_table_new (NULL, NULL);
+  self->seen_before = g_hash_table_new (NULL, NULL);
+  self->max_bytes = max_bytes;
+
+  return self;
+}
+
+void
+gsk_cairo_node_cache_clear (GskCairoNodeCache *self)
+{
+  g_queue_init (&self->lru);
+  g_hash_table_remove_all (self->entries);
+  g_hash_table_remove_all (self->seen);
+  g_hash_table_remove_all (self->seen_before);
+  self->size = 0;
+}
+
+void
+gsk_cairo_node_cache_free (GskCairoNodeCache *self)
+{
+  gsk_cairo_node_cache_clear (self);
+  g_hash_table_unref (self->entries);
+  g_hash_table_unref (self->seen);
+  g_hash_table_unref (self->seen_before);
+  g_slice_free (GskCairoNodeCache, self);
+}
+
+gsize
+gsk_cairo_node_cache_get_size (GskCairoNodeCache *self)
+{
+  return self->size;
+}
+
+guint
+gsk_cairo_node_cache_get_hits (GskCairoNodeCache *self)
+{
+  return g_atomic_int_get (&self->hits);
+}
+
+static gboolean
+node_is_expensive (GskRenderNode *node)
+{
+  guint i, n_text;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_BLUR_NODE:
+    case GSK_SHADOW_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_CONIC_GRADIENT_NODE:
+      return TRUE;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      return gsk_outset_shadow_node_get_blur_radius (node) > 0;
+
+    case GSK_INSET_SHADOW_NODE:
+      return gsk_inset_shadow_node_get_blur_radius (node) > 0;
+
+    case GSK_CONTAINER_NODE:
+      n_text = 0;
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        {
+          if (gsk_render_node_get_node_type (gsk_container_node_get_child (node, i)) == GSK_TEXT_NODE)
+            n_text++;
+        }
+      return n_text >= MIN_TEXT_CHILDREN;
+
+    case GSK_NOT_A_RENDER_NODE:
+    case GSK_CAIRO_NODE:
+    case GSK_COLOR_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_TEXTURE_NODE:
+    case GSK_TRANSFORM_NODE:
+    case GSK_OPACITY_NODE:
+    case GSK_COLOR_MATRIX_NODE:
+    case GSK_REPEAT_NODE:
+    case GSK_CLIP_NODE:
+    case GSK_ROUNDED_CLIP_NODE:
+    case GSK_BLEND_NODE:
+    case GSK_CROSS_FADE_NODE:
+    case GSK_TEXT_NODE:
+    case GSK_DEBUG_NODE:
+    case GSK_GL_SHADER_NODE:
+    default:
+      return FALSE;
+    }
+}
+
+/* What @node and its children keep alive. Textures and glyphs are
+ * counted, other data that nodes point to is assumed to be small.
+ */
+static gsize
+get_node_size (GskRenderNode *node)
+{
+  GTypeQuery query;
+  gsize size;
+  guint i;
+
+  g_type_query (G_TYPE_FROM_INSTANCE (node), &query);
+  size = query.instance_size;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        size += get_node_size (gsk_container_node_get_child (node, i));
+      break;
+
+    case GSK_TEXTURE_NODE:
+      {
+        GdkTexture *texture = gsk_texture_node_get_texture (node);
+
+        size += (gsize) gdk_texture_get_width (texture) * gdk_texture_get_height (texture) * 4;
+      }
+      break;
+
+    case GSK_TEXT_NODE:
+      size += gsk_text_node_get_num_glyphs (node) * sizeof (PangoGlyphInfo);
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      size += get_node_size (gsk_transform_node_get_child (node));
+      break;
+
+    case GSK_OPACITY_NODE:
+      size += get_node_size (gsk_opacity_node_get_child (node));
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      size += get_node_size (gsk_color_matrix_node_get_child (node));
+      break;
+
+    case GSK_REPEAT_NODE:
+      size += get_node_size (gsk_repeat_node_get_child (node));
+      break;
+
+    case GSK_CLIP_NODE:
+      size += get_node_size (gsk_clip_node_get_child (node));
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      size += get_node_size (gsk_rounded_clip_node_get_child (node));
+      break;
+
+    case GSK_SHADOW_NODE:
+      size += get_node_size (gsk_shadow_node_get_child (node));
+      break;
+
+    case GSK_BLUR_NODE:
+      size += get_node_size (gsk_blur_node_get_child (node));
+      break;
+
+    case GSK_DEBUG_NODE:
+      size += get_node_size (gsk_debug_node_get_child (node));
+      break;
+
+    case GSK_BLEND_NODE:
+      size += get_node_size (gsk_blend_node_get_bottom_child (node));
+      size += get_node_size (gsk_blend_node_get_top_child (node));
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      size += get_node_size (gsk_cross_fade_node_get_start_child (node));
+      size += get_node_size (gsk_cross_fade_node_get_end_child (node));
+      break;
+
+    case GSK_GL_SHADER_NODE:
+      for (i = 0; i < gsk_gl_shader_node_get_n_children (node); i++)
+        size += get_node_size (gsk_gl_shader_node_get_child (node, i));
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    case GSK_CAIRO_NODE:
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_CONIC_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+    default:
+      break;
+    }
+
+  return size;
+}
+
+/* Converts the range from @start to @end, relative to the node origin,
+ * to the pixels that it touches, relative to the pixel of the origin.
+ * Prepare and draw must agree on this, so both use it.
+ */
+static void
+get_pixel_range (double  fraction,
+                 double  scale,
+                 double  start,
+                 double  end,
+                 int     n_pixels,
+                 int    *first,
+                 int    *last)
+{
+  *first = MAX (floor (fraction + start * scale + 0.001), 0);
+  *last = MIN (ceil (fraction + end * scale - 0.001), n_pixels);
+}
+
+static cairo_surface_t *
+rasterize_node (GskRenderNode *node,
+                double         x_scale,
+                double         y_scale,
+                double         x_offset,
+                double         y_offset,
+                int            width,
+                int            height)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cairo_surface_set_device_scale (surface, x_scale, y_scale);
+  cairo_surface_set_device_offset (surface,
+                                   x_offset - node->bounds.origin.x * x_scale,
+                                   y_offset - node->bounds.origin.y * y_scale);
+
+  cr = cairo_create (surface);
+  gsk_render_node_draw (node, cr);
+  cairo_destroy (cr);
+
+  return surface;
+}
+
+/* Returns %TRUE if @node is drawn from the cache */
+static gboolean
+gsk_cairo_node_cache_prepare_entry (PrepareData   *data,
+                                    GskRenderNode *node,
+                                    float          dx,
+                                    float          dy)
+{
+  GskCairoNodeCache *self = data->self;
+  CacheEntry *entry;
+  graphene_rect_t bounds, visible;
+  double x, y, x_fraction, y_fraction;
+  int node_width, node_height;
+  int visible_x1, visible_y1, visible_x2, visible_y2;
+  int x1, y1, x2, y2;
+  gpointer hash, seen_hash;
+
+  x = (node->bounds.origin.x + dx) * data->x_scale + data->x_offset;
+  y = (node->bounds.origin.y + dy) * data->y_scale + data->y_offset;
+  x_fraction = x - floor (x);
+  y_fraction = y - floor (y);
+
+  node_width = ceil (x_fraction + node->bounds.size.width * data->x_scale);
+  node_height = ceil (y_fraction + node->bounds.size.height * data->y_scale);
+
+  graphene_rect_offset_r (&node->bounds, dx, dy, &bounds);
+  if (!graphene_rect_intersection (&bounds, &data->clip, &visible))
+    return FALSE;
+
+  get_pixel_range (x_fraction, data->x_scale,
+                   visible.origin.x - bounds.origin.x,
+                   visible.origin.x + visible.size.width - bounds.origin.x,
+                   node_width, &visible_x1, &visible_x2);
+  get_pixel_range (y_fraction, data->y_scale,
+                   visible.origin.y - bounds.origin.y,
+                   visible.origin.y + visible.size.height - bounds.origin.y,
+                   node_height, &visible_y1, &visible_y2);
+  if ((visible_x2 - visible_x1) * (visible_y2 - visible_y1) < MIN_CACHED_PIXELS)
+    return FALSE;
+
+  x1 = MAX (visible_x1 - VISIBLE_MARGIN, 0);
+  y1 = MAX (visible_y1 - VISIBLE_MARGIN, 0);
+  x2 = MIN (visible_x2 + VISIBLE_MARGIN, node_width);
+  y2 = MIN (visible_y2 + VISIBLE_MARGIN, node_height);
+  if ((gsize) (x2 - x1) * (y2 - y1) * 4 > self->max_bytes / 4)
+    return FALSE;
+
+  entry = g_hash_table_lookup (self->entries, node);
+  if (entry == NULL)
+    {
+      /* Only content that survived a frame is worth keeping */
+      hash = GUINT_TO_POINTER ((guint) gsk_render_node_get_hash (node));
+      g_hash_table_insert (self->seen, node, hash);
+      if (!g_hash_table_lookup_extended (self->seen_before, node, NULL, &seen_hash) ||
+          seen_hash != hash)
+        return FALSE;
+
+      entry = g_slice_new0 (CacheEntry);
+      entry->node = gsk_render_node_ref (node);
+      entry->link.data = entry;
+      entry->node_size = get_node_size (node);
+      self->size += entry->node_size;
+      g_hash_table_insert (self->entries, node, entry);
+      g_queue_push_head_link (&self->lru, &entry->link);
+    }
+  else
+    {
+      g_queue_unlink (&self->lru, &entry->link);
+      g_queue_push_head_link (&self->lru, &entry->link);
+
+      if (entry->surface &&
+          entry->x_scale == data->x_scale && entry->y_scale == data->y_scale &&
+          G_APPROX_VALUE (entry->x_fraction, x_fraction, 0.001) &&
+          G_APPROX_VALUE (entry->y_fraction, y_fraction, 0.001) &&
+          entry->x <= visible_x1 && entry->y <= visible_y1 &&
+          entry->x + cairo_image_surface_get_width (entry->surface) >= visible_x2 &&
+          entry->y + cairo_image_surface_get_height (entry->surface) >= visible_y2)
+        {
+          entry->last_used = self->frame;
+          return TRUE;
+        }
+
+      cache_entry_clear_surface (self, entry);
+
+      /* After a change of scale or position, wait for it to settle again */
+      if (entry->last_used + 1 < self->frame)
+        {
+          entry->last_used = self->frame;
+          return FALSE;
+        }
+    }
+
+  entry->last_used = self->frame;
+
+  entry->surface = rasterize_node (node,
+                                   data->x_scale, data->y_scale,
+                                   x_fraction - x1, y_fraction - y1,
+                                   x2 - x1, y2 - y1);
+  entry->x_scale = data->x_scale;
+  entry->y_scale = data->y_scale;
+  entry->x_fraction = x_fraction;
+  entry->y_fraction = y_fraction;
+  entry->x = x1;
+  entry->y = y1;
+  entry->surface_size = cairo_image_surface_get_stride (entry->surface) * (y2 - y1);
+  self->size += entry->surface_size;
+
+  GSK_NOTE (CAIRO, g_message ("Caching %s[%p] as %dx%d surface of %dx%d",
+                              g_type_name_from_instance ((GTypeInstance *) node),
+                              node, x2 - x1, y2 - y1, node_width, node_height));
+
+  return TRUE;
+}
+
+static void
+gsk_cairo_node_cache_prepare_node (PrepareData   *data,
+                                   GskRenderNode *node,
+                                   float          dx,
+                                   float          dy)
+{
+  graphene_rect_t bounds;
+  guint i;
+
+  graphene_rect_offset_r (&node->bounds, dx, dy, &bounds);
+  if (!graphene_rect_intersection (&bounds, &data->clip, NULL))
+    return;
+
+  if (node_is_expensive (node) &&
+      gsk_cairo_node_cache_prepare_entry (data, node, dx, dy))
+    return;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        gsk_cairo_node_cache_prepare_node (data, gsk_container_node_get_child (node, i), dx, dy);
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskTransform *transform = gsk_transform_node_get_transform (node);
+        float tx, ty;
+
+        /* Scaled or rotated content would need a different key */
+        if (gsk_transform_get_category (transform) < GSK_TRANSFORM_CATEGORY_2D_TRANSLATE)
+          break;
+
+        gsk_transform_to_translate (transform, &tx, &ty);
+        gsk_cairo_node_cache_prepare_node (data, gsk_transform_node_get_child (node), dx + tx, dy + ty);
+      }
+      break;
+
+    case GSK_OPACITY_NODE:
+      gsk_cairo_node_cache_prepare_node (data, gsk_opacity_node_get_child (node), dx, dy);
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      gsk_cairo_node_cache_prepare_node (data, gsk_color_matrix_node_get_child (node), dx, dy);
+      break;
+
+    case GSK_CLIP_NODE:
+      gsk_cairo_node_cache_prepare_node (data, gsk_clip_node_get_child (node), dx, dy);
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      gsk_cairo_node_cache_prepare_node (data, gsk_rounded_clip_node_get_child (node), dx, dy);
+      break;
+
+    case GSK_SHADOW_NODE:
+      gsk_cairo_node_cache_prepare_node (data, gsk_shadow_node_get_child (node), dx, dy);
+      break;
+
+    case GSK_BLUR_NODE:
+      gsk_cairo_node_cache_prepare_node (data, gsk_blur_node_get_child (node), dx, dy);
+      break;
+
+    case GSK_DEBUG_NODE:
+      gsk_cairo_node_cache_prepare_node (data, gsk_debug_node_get_child (node), dx, dy);
+      break;
+
+    case GSK_BLEND_NODE:
+      gsk_cairo_node_cache_prepare_node (data, gsk_blend_node_get_bottom_child (node), dx, dy);
+      gsk_cairo_node_cache_prepare_node (data, gsk_blend_node_get_top_child (node), dx, dy);
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      gsk_cairo_node_cache_prepare_node (data, gsk_cross_fade_node_get_start_child (node), dx, dy);
+      gsk_cairo_node_cache_prepare_node (data, gsk_cross_fade_node_get_end_child (node), dx, dy);
+      break;
+
+    /* Repeat nodes draw their child to a separate surface */
+    case GSK_REPEAT_NODE:
+    case GSK_NOT_A_RENDER_NODE:
+    case GSK_CAIRO_NODE:
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_CONIC_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_TEXTURE_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+    case GSK_TEXT_NODE:
+    case GSK_GL_SHADER_NODE:
+    default:
+      break;
+    }
+}
+
+static void
+gsk_cairo_node_cache_evict (GskCairoNodeCache *self)
+{
+  GList *l, *prev;
+
+  for (l = self->lru.tail; l; l = prev)
+    {
+      CacheEntry *entry = l->data;
+
+      prev = l->prev;
+
+      if (entry->last_used + MAX_UNUSED_FRAMES < self->frame ||
+          self->size > self->max_bytes)
+        gsk_cairo_node_cache_remove (self, entry);
+      else
+        break;
+    }
+}
+
+/**
+ * gsk_cairo_node_cache_prepare:
+ * @self: a #GskCairoNodeCache
+ * @cr: the cairo context that @root is going to be drawn to
+ * @root: the root node of the frame
+ *
+ * Starts a new frame. This looks up the cacheable nodes of @root
+ * that are visible in the clip of @cr, rasterizes the ones that
+ * are seen again and drops entries that haven't been used for
+ * a while or don't fit into the budget.
+ *
+ * This must be called on the thread that owns @self, before any
+ * cairo context that @self is attached to draws @root.
+ */
+void
+gsk_cairo_node_cache_prepare (GskCairoNodeCache *self,
+                              cairo_t           *cr,
+                              GskRenderNode     *root)
+{
+  PrepareData data;
+  cairo_matrix_t ctm;
+  double x1, y1, x2, y2;
+  GHashTable *seen;
+
+  self->frame++;
+  g_atomic_int_set (&self->hits, 0);
+
+  seen = self->seen_before;
+  self->seen_before = self->seen;
+  self->seen = seen;
+  g_hash_table_remove_all (self->seen);
+
+  /* Keep things simple by only handling translations, which is
+   * all the renderer ever sets up. */
+  cairo_get_matrix (cr, &ctm);
+  if (ctm.xx == 1 && ctm.yy == 1 && ctm.xy == 0 && ctm.yx == 0)
+    {
+      data.self = self;
+      cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+      graphene_rect_init (&data.clip, x1, y1, x2 - x1, y2 - y1);
+      cairo_surface_get_device_scale (cairo_get_target (cr), &data.x_scale, &data.y_scale);
+      cairo_surface_get_device_offset (cairo_get_target (cr), &data.x_offset, &data.y_offset);
+      data.x_offset += ctm.x0 * data.x_scale;
+      data.y_offset += ctm.y0 * data.y_scale;
+
+      gsk_cairo_node_cache_prepare_node (&data, root, 0, 0);
+    }
+
+  gsk_cairo_node_cache_evict (self);
+}
+
+/**
+ * gsk_cairo_node_cache_attach:
+ * @self: a #GskCairoNodeCache
+ * @cr: a cairo context
+ *
+ * Makes gsk_render_node_draw() use the surfaces in @self when drawing
+ * to @cr. The cache must stay alive until @cr is done drawing and must
+ * not be prepared again in the meantime. Multiple threads may draw
+ * from the same cache at once.
+ *
+ * Contexts that don't draw a frame, like the ones for rendering to a
+ * texture, can use the cache without preparing it. They only get the
+ * surfaces that happen to cover what they draw, and don't make the
+ * cache forget the nodes of the frames.
+ */
+void
+gsk_cairo_node_cache_attach (GskCairoNodeCache *self,
+                             cairo_t           *cr)
+{
+  cairo_set_user_data (cr, &node_cache_key, self, NULL);
+}
+
+/*< private >
+ * gsk_cairo_node_cache_draw:
+ * @cr: a cairo context
+ * @node: the node to draw
+ *
+ * Draws @node from the cache attached to @cr, if there is one and
+ * it has a surface for @node that matches the current transform and
+ * covers the part of @node inside the clip.
+ *
+ * Returns: %TRUE if @node was drawn
+ */
+gboolean
+gsk_cairo_node_cache_draw (cairo_t       *cr,
+                           GskRenderNode *node)
+{
+  GskCairoNodeCache *self;
+  CacheEntry *entry;
+  graphene_rect_t clip;
+  double x, y, xx, xy, yx, yy;
+  double x1, y1, x2, y2;
+  int visible_x1, visible_y1, visible_x2, visible_y2;
+
+  self = cairo_get_user_data (cr, &node_cache_key);
+  if (self == NULL)
+    return FALSE;
+
+  entry = g_hash_table_lookup (self->entries, node);
+  if (entry == NULL || entry->surface == NULL)
+    return FALSE;
+
+  xx = 1; xy = 0;
+  yx = 0; yy = 1;
+  cairo_user_to_device_distance (cr, &xx, &xy);
+  cairo_user_to_device_distance (cr, &yx, &yy);
+  if (xx != entry->x_scale || yy != entry->y_scale || xy != 0 || yx != 0)
+    return FALSE;
+
+  x = node->bounds.origin.x;
+  y = node->bounds.origin.y;
+  cairo_user_to_device (cr, &x, &y);
+  if (!G_APPROX_VALUE (x - floor (x), entry->x_fraction, 0.001) ||
+      !G_APPROX_VALUE (y - floor (y), entry->y_fraction, 0.001))
+    return FALSE;
+
+  cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+  graphene_rect_init (&clip, x1, y1, x2 - x1, y2 - y1);
+  if (!graphene_rect_intersection (&clip, &node->bounds, &clip))
+    return TRUE;
+
+  get_pixel_range (entry->x_fraction, entry->x_scale,
+                   clip.origin.x - node->bounds.origin.x,
+                   clip.origin.x + clip.size.width - node->bounds.origin.x,
+                   G_MAXINT, &visible_x1, &visible_x2);
+  get_pixel_range (entry->y_fraction, entry->y_scale,
+                   clip.origin.y - node->bounds.origin.y,
+                   clip.origin.y + clip.size.height - node->bounds.origin.y,
+                   G_MAXINT, &visible_y1, &visible_y2);
+  if (visible_x1 < entry->x || visible_y1 < entry->y ||
+      visible_x2 > entry->x + cairo_image_surface_get_width (entry->surface) ||
+      visible_y2 > entry->y + cairo_image_surface_get_height (entry->surface))
+    return FALSE;
+
+  /* The surface is aligned to the device pixel grid, so filling
+   * whole pixels avoids antialiasing its edges a second time. */
+  cairo_set_source_surface (cr, entry->surface, 0, 0);
+  cairo_rectangle (cr,
+                   node->bounds.origin.x + (entry->x - entry->x_fraction) / entry->x_scale,
+                   node->bounds.origin.y + (entry->y - entry->y_fraction) / entry->y_scale,
+                   cairo_image_surface_get_width (entry->surface) / entry->x_scale,
+                   cairo_image_surface_get_height (entry->surface) / entry->y_scale);
+  cairo_fill (cr);
+
+  g_atomic_int_inc (&self->hits);
+
+  return TRUE;
+}
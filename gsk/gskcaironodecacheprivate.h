@@ -0,0 +1,47 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GSK_CAIRO_NODE_CACHE_PRIVATE_H__
+#define __GSK_CAIRO_NODE_CACHE_PRIVATE_H__
+
+#include "gskrendernode.h"
+
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GskCairoNodeCache GskCairoNodeCache;
+
+GskCairoNodeCache *     gsk_cairo_node_cache_new                (gsize               max_bytes);
+void                    gsk_cairo_node_cache_free               (GskCairoNodeCache  *self);
+void                    gsk_cairo_node_cache_clear              (GskCairoNodeCache  *self);
+
+void                    gsk_cairo_node_cache_prepare            (GskCairoNodeCache  *self,
+                                                                 cairo_t            *cr,
+                                                                 GskRenderNode      *root);
+void                    gsk_cairo_node_cache_attach             (GskCairoNodeCache  *self,
+                                                                 cairo_t            *cr);
+
+gboolean                gsk_cairo_node_cache_draw               (cairo_t            *cr,
+                                                                 GskRenderNode      *node);
+
+gsize                   gsk_cairo_node_cache_get_size           (GskCairoNodeCache  *self);
+guint                   gsk_cairo_node_cache_get_hits           (GskCairoNodeCache  *self);
+
+G_END_DECLS
+
+#endif /* __GSK_CAIRO_NODE_CACHE_PRIVATE_H__ */
@@ -22,25 +22,59 @@
 
 #include "gskcairorenderer.h"
 
+#include "gskcaironodecacheprivate.h"
 #include "gskdebugprivate.h"
 #include "gskrendererprivate.h"
 #include "gskrendernodeprivate.h"
 #include "gdk/gdktextureprivate.h"
+#include "gdk/gdkparalleltaskprivate.h"
+
+#include <pango/pangocairo.h>
+
+/* Size of a tile in device pixels when rendering in parallel */
+#define TILE_SIZE 256
+/* Areas smaller than this are not worth dispatching to threads */
+#define MIN_TILED_PIXELS (512 * 512)
+/* Memory budget for rasterized subtrees */
+#define NODE_CACHE_MAX_BYTES (32 * 1024 * 1024)
 
 #ifdef G_ENABLE_DEBUG
+typedef struct {
+  GQuark tiles;
+  GQuark node_cache_size;
+  GQuark node_cache_hits;
+} ProfileCounters;
+
 typedef struct {
   GQuark cpu_time;
   GQuark gpu_time;
 } ProfileTimers;
 #endif
 
+typedef struct {
+  GskRenderNode *root;
+  GskCairoNodeCache *node_cache;
+  const cairo_matrix_t *ctm;
+
+  cairo_surface_t *target;
+  double x_scale, y_scale;
+  double x_offset, y_offset;
+
+  cairo_rectangle_int_t *tiles;
+  guint n_tiles;
+  int next_tile;
+} TileJob;
+
 struct _GskCairoRenderer
 {
   GskRenderer parent_instance;
 
   GdkCairoContext *cairo_context;
 
+  GskCairoNodeCache *node_cache;
+
 #ifdef G_ENABLE_DEBUG
+  ProfileCounters profile_counters;
   ProfileTimers profile_timers;
 #endif
 };
@@ -70,15 +104,303 @@ gsk_cairo_renderer_unrealize (GskRenderer *renderer)
   GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
 
   g_clear_object (&self->cairo_context);
+
+  gsk_cairo_node_cache_clear (self->node_cache);
+}
+
+/* Checks if @node can be drawn from multiple threads at once and
+ * does the lazy initialization that would otherwise race. */
+static gboolean
+gsk_cairo_renderer_prepare_threaded (GskRenderNode *node)
+{
+  guint i;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        {
+          if (!gsk_cairo_renderer_prepare_threaded (gsk_container_node_get_child (node, i)))
+            return FALSE;
+        }
+      return TRUE;
+
+    case GSK_TEXTURE_NODE:
+      /* Downloading GL textures needs the GL context */
+      return GDK_IS_MEMORY_TEXTURE (gsk_texture_node_get_texture (node));
+
+    case GSK_CAIRO_NODE:
+      /* Replaying recording surfaces is not safe from multiple threads */
+      return FALSE;
+
+    case GSK_TEXT_NODE:
+      /* Make sure the scaled font exists before workers look it up,
+       * so they only wait for the lock in gsk_text_node_draw() briefly */
+      pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (gsk_text_node_get_font (node)));
+      return TRUE;
+
+    case GSK_TRANSFORM_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_transform_node_get_child (node));
+
+    case GSK_OPACITY_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_opacity_node_get_child (node));
+
+    case GSK_COLOR_MATRIX_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_color_matrix_node_get_child (node));
+
+    case GSK_REPEAT_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_repeat_node_get_child (node));
+
+    case GSK_CLIP_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_clip_node_get_child (node));
+
+    case GSK_ROUNDED_CLIP_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_rounded_clip_node_get_child (node));
+
+    case GSK_SHADOW_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_shadow_node_get_child (node));
+
+    case GSK_BLUR_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_blur_node_get_child (node));
+
+    case GSK_DEBUG_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_debug_node_get_child (node));
+
+    case GSK_BLEND_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_blend_node_get_bottom_child (node)) &&
+             gsk_cairo_renderer_prepare_threaded (gsk_blend_node_get_top_child (node));
+
+    case GSK_CROSS_FADE_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_cross_fade_node_get_start_child (node)) &&
+             gsk_cairo_renderer_prepare_threaded (gsk_cross_fade_node_get_end_child (node));
+
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_CONIC_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+    case GSK_GL_SHADER_NODE:
+      return TRUE;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_assert_not_reached ();
+      return FALSE;
+    }
+}
+
+static gboolean
+is_integer (double value)
+{
+  return value == floor (value);
+}
+
+/* Splits the clip of @cr into tiles in device space. Returns %FALSE
+ * if the clip cannot be split without tiles sharing pixels.
+ */
+static gboolean
+gsk_cairo_renderer_collect_tiles (TileJob *job,
+                                  cairo_t *cr,
+                                  GArray  *tiles)
+{
+  cairo_rectangle_list_t *list;
+  int surface_width, surface_height;
+  gsize n_pixels = 0;
+  int i;
+
+  list = cairo_copy_clip_rectangle_list (cr);
+  if (list->status != CAIRO_STATUS_SUCCESS)
+    {
+      cairo_rectangle_list_destroy (list);
+      return FALSE;
+    }
+
+  surface_width = cairo_image_surface_get_width (job->target);
+  surface_height = cairo_image_surface_get_height (job->target);
+
+  for (i = 0; i < list->num_rectangles; i++)
+    {
+      const cairo_rectangle_t *r = &list->rectangles[i];
+      double x1, y1, x2, y2;
+      int tx, ty;
+
+      x1 = (r->x + job->ctm->x0) * job->x_scale + job->x_offset;
+      y1 = (r->y + job->ctm->y0) * job->y_scale + job->y_offset;
+      x2 = (r->x + r->width + job->ctm->x0) * job->x_scale + job->x_offset;
+      y2 = (r->y + r->height + job->ctm->y0) * job->y_scale + job->y_offset;
+
+      if (!is_integer (x1) || !is_integer (y1) ||
+          !is_integer (x2) || !is_integer (y2))
+        {
+          cairo_rectangle_list_destroy (list);
+          return FALSE;
+        }
+
+      x1 = MAX (x1, 0);
+      y1 = MAX (y1, 0);
+      x2 = MIN (x2, surface_width);
+      y2 = MIN (y2, surface_height);
+
+      /* Align tiles to a grid so neighbouring rectangles don't
+       * create lots of slivers. */
+      for (ty = (int) y1 - (int) y1 % TILE_SIZE; ty < y2; ty += TILE_SIZE)
+        {
+          for (tx = (int) x1 - (int) x1 % TILE_SIZE; tx < x2; tx += TILE_SIZE)
+            {
+              cairo_rectangle_int_t tile;
+
+              tile.x = MAX (tx, (int) x1);
+              tile.y = MAX (ty, (int) y1);
+              tile.width = MIN (tx + TILE_SIZE, (int) x2) - tile.x;
+              tile.height = MIN (ty + TILE_SIZE, (int) y2) - tile.y;
+
+              if (tile.width <= 0 || tile.height <= 0)
+                continue;
+
+              g_array_append_val (tiles, tile);
+              n_pixels += tile.width * tile.height;
+            }
+        }
+    }
+
+  cairo_rectangle_list_destroy (list);
+
+  return tiles->len > 1 && n_pixels >= MIN_TILED_PIXELS;
+}
+
+static void
+gsk_cairo_renderer_render_tile (TileJob                     *job,
+                                const cairo_rectangle_int_t *tile)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  int stride;
+  guchar *data;
+
+  /* Every tile gets its own surface sharing the pixels of the target,
+   * so threads never touch the same cairo object. The surface size
+   * clips drawing to the tile.
+   */
+  stride = cairo_image_surface_get_stride (job->target);
+  data = cairo_image_surface_get_data (job->target) + tile->y * stride + tile->x * 4;
+
+  surface = cairo_image_surface_create_for_data (data,
+                                                 cairo_image_surface_get_format (job->target),
+                                                 tile->width, tile->height,
+                                                 stride);
+  cairo_surface_set_device_scale (surface, job->x_scale, job->y_scale);
+  cairo_surface_set_device_offset (surface,
+                                   job->x_offset - tile->x,
+                                   job->y_offset - tile->y);
+
+  cr = cairo_create (surface);
+  cairo_set_matrix (cr, job->ctm);
+  gsk_cairo_node_cache_attach (job->node_cache, cr);
+
+  gsk_render_node_draw (job->root, cr);
+
+  cairo_destroy (cr);
+  cairo_surface_finish (surface);
+  cairo_surface_destroy (surface);
+}
+
+static void
+gsk_cairo_renderer_render_tiles (TileJob *job)
+{
+  while (TRUE)
+    {
+      guint i = g_atomic_int_add (&job->next_tile, 1);
+
+      if (i >= job->n_tiles)
+        break;
+
+      gsk_cairo_renderer_render_tile (job, &job->tiles[i]);
+    }
+}
+
+/* Renders @root by splitting the clip region of @cr into tiles and
+ * drawing them in parallel. Returns %FALSE if @cr is not suitable
+ * for that, and nothing was drawn.
+ */
+static gboolean
+gsk_cairo_renderer_do_render_tiled (GskRenderer   *renderer,
+                                    cairo_t       *cr,
+                                    GskRenderNode *root)
+{
+  TileJob job = { 0, };
+  cairo_matrix_t ctm;
+  GArray *tiles;
+
+  if (g_get_num_processors () < 2)
+    return FALSE;
+
+  if (GSK_RENDERER_DEBUG_CHECK (renderer, CAIRO_NO_THREADS))
+    return FALSE;
+
+  job.target = cairo_get_target (cr);
+  if (cairo_surface_get_type (job.target) != CAIRO_SURFACE_TYPE_IMAGE ||
+      cairo_image_surface_get_format (job.target) != CAIRO_FORMAT_ARGB32)
+    return FALSE;
+
+  /* Only handle the translations we get from the draw context and
+   * gsk_renderer_render_texture(); anything else draws serially. */
+  cairo_get_matrix (cr, &ctm);
+  if (ctm.xx != 1 || ctm.yy != 1 || ctm.xy != 0 || ctm.yx != 0)
+    return FALSE;
+
+  job.root = root;
+  job.node_cache = GSK_CAIRO_RENDERER (renderer)->node_cache;
+  job.ctm = &ctm;
+  cairo_surface_get_device_scale (job.target, &job.x_scale, &job.y_scale);
+  cairo_surface_get_device_offset (job.target, &job.x_offset, &job.y_offset);
+
+  tiles = g_array_new (FALSE, FALSE, sizeof (cairo_rectangle_int_t));
+  if (!gsk_cairo_renderer_collect_tiles (&job, cr, tiles) ||
+      !gsk_cairo_renderer_prepare_threaded (root))
+    {
+      g_array_free (tiles, TRUE);
+      return FALSE;
+    }
+
+  job.tiles = (cairo_rectangle_int_t *) tiles->data;
+  job.n_tiles = tiles->len;
+
+  cairo_surface_flush (job.target);
+
+  gdk_parallel_task_run ((GdkTaskFunc) gsk_cairo_renderer_render_tiles, &job, job.n_tiles);
+
+  cairo_surface_mark_dirty (job.target);
+
+#ifdef G_ENABLE_DEBUG
+  {
+    GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
+
+    gsk_profiler_counter_add (gsk_renderer_get_profiler (renderer),
+                              self->profile_counters.tiles,
+                              job.n_tiles);
+  }
+#endif
+
+  g_array_free (tiles, TRUE);
+
+  return TRUE;
 }
 
+/* Only frames prepare the node cache. Rendering to a texture uses
+ * what is there, without making it forget the nodes of the frames.
+ */
 static void
 gsk_cairo_renderer_do_render (GskRenderer   *renderer,
                               cairo_t       *cr,
-                              GskRenderNode *root)
+                              GskRenderNode *root,
+                              gboolean       is_frame)
 {
-#ifdef G_ENABLE_DEBUG
   GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
+#ifdef G_ENABLE_DEBUG
   GskProfiler *profiler;
   gint64 cpu_time;
 #endif
@@ -88,12 +410,25 @@ gsk_cairo_renderer_do_render (GskRenderer   *renderer,
   gsk_profiler_timer_begin (profiler, self->profile_timers.cpu_time);
 #endif
 
-  gsk_render_node_draw (root, cr);
+  if (is_frame)
+    gsk_cairo_node_cache_prepare (self->node_cache, cr, root);
+  gsk_cairo_node_cache_attach (self->node_cache, cr);
+
+  if (!gsk_cairo_renderer_do_render_tiled (renderer, cr, root))
+    gsk_render_node_draw (root, cr);
+
+  gsk_cairo_node_cache_attach (NULL, cr);
 
 #ifdef G_ENABLE_DEBUG
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
 
+  gsk_profiler_counter_set (profiler, self->profile_counters.node_cache_size,
+                            gsk_cairo_node_cache_get_size (self->node_cache));
+  if (is_frame)
+    gsk_profiler_counter_set (profiler, self->profile_counters.node_cache_hits,
+                              gsk_cairo_node_cache_get_hits (self->node_cache));
+
   gsk_profiler_push_samples (profiler);
 #endif
 }
@@ -112,7 +447,7 @@ gsk_cairo_renderer_render_texture (GskRenderer           *renderer,
 
   cairo_translate (cr, - viewport->origin.x, - viewport->origin.y);
 
-  gsk_cairo_renderer_do_render (renderer, cr, root);
+  gsk_cairo_renderer_do_render (renderer, cr, root, FALSE);
 
   cairo_destroy (cr);
 
@@ -152,18 +487,31 @@ gsk_cairo_renderer_render (GskRenderer          *renderer,
     }
 #endif
 
-  gsk_cairo_renderer_do_render (renderer, cr, root);
+  gsk_cairo_renderer_do_render (renderer, cr, root, TRUE);
 
   cairo_destroy (cr);
 
   gdk_draw_context_end_frame (GDK_DRAW_CONTEXT (self->cairo_context));
 }
 
+static void
+gsk_cairo_renderer_finalize (GObject *object)
+{
+  GskCairoRenderer *self = GSK_CAIRO_RENDERER (object);
+
+  gsk_cairo_node_cache_free (self->node_cache);
+
+  G_OBJECT_CLASS (gsk_cairo_renderer_parent_class)->finalize (object);
+}
+
 static void
 gsk_cairo_renderer_class_init (GskCairoRendererClass *klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GskRendererClass *renderer_class = GSK_RENDERER_CLASS (klass);
 
+  gobject_class->finalize = gsk_cairo_renderer_finalize;
+
   renderer_class->realize = gsk_cairo_renderer_realize;
   renderer_class->unrealize = gsk_cairo_renderer_unrealize;
   renderer_class->render = gsk_cairo_renderer_render;
@@ -174,7 +522,17 @@ static void
 gsk_cairo_renderer_init (GskCairoRenderer *self)
 {
 #ifdef G_ENABLE_DEBUG
-  GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
+  GskProfiler *profiler;
+#endif
+
+  self->node_cache = gsk_cairo_node_cache_new (NODE_CACHE_MAX_BYTES);
+
+#ifdef G_ENABLE_DEBUG
+  profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
+
+  self->profile_counters.tiles = gsk_profiler_add_counter (profiler, "tiles", "Tiles rendered in parallel", TRUE);
+  self->profile_counters.node_cache_size = gsk_profiler_add_counter (profiler, "node-cache-size", "Bytes of cached node surfaces", FALSE);
+  self->profile_counters.node_cache_hits = gsk_profiler_add_counter (profiler, "node-cache-hits", "Nodes drawn from the cache", FALSE);
 
   self->profile_timers.cpu_time = gsk_profiler_add_timer (profiler, "cpu-time", "CPU time", FALSE, TRUE);
 #endif
@@ -0,0 +1,404 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gskcairoshadowcacheprivate.h"
+
+#include "gskcairoblurprivate.h"
+#include "gskdebugprivate.h"
+#include "gskroundedrectprivate.h"
+
+#include <math.h>
+
+/* This is the cairo equivalent of GskGLShadowCache. Blurred outset
+ * shadows are drawn from a nine-slice mask: the corners are copied
+ * as is, while the edges and the center are stretched from a single
+ * row or column of pixels, which is far enough from the corners that
+ * the blur doesn't vary along it.
+ *
+ * So the mask only depends on the corner sizes, the blur radius and
+ * the scale, not on the size of the box. Boxes that are too small
+ * to be stretched get a mask of their exact size instead.
+ *
+ * The masks are alpha-only, and the color is applied when drawing,
+ * so shadows in different colors share them.
+ *
+ * Masks are only used for boxes that are aligned to whole pixels in
+ * device space, so they never need to be shifted by a fraction of a
+ * pixel. Other boxes are left to the caller.
+ *
+ * The cache is shared by all renderers drawing with cairo, including
+ * the fallbacks of the Broadway renderer, and may be used from
+ * multiple threads.
+ */
+
+#define MAX_CACHE_BYTES (8 * 1024 * 1024)
+
+typedef struct
+{
+  graphene_size_t corner[4];
+  float blur_radius;
+  int scale;
+  /* 0 if the mask is stretched in that direction */
+  int width;
+  int height;
+} CacheKey;
+
+typedef struct
+{
+  CacheKey key;
+  GList link;
+  cairo_surface_t *mask;
+  gsize size;
+} CacheEntry;
+
+typedef struct
+{
+  int mask_start;
+  int mask_size;
+  int dest_start;
+  int dest_size;
+} Slice;
+
+G_LOCK_DEFINE_STATIC (shadow_cache);
+static GHashTable *shadow_cache = NULL;
+static GQueue shadow_cache_lru = G_QUEUE_INIT;
+static gsize shadow_cache_size = 0;
+
+static guint
+cache_key_hash (gconstpointer data)
+{
+  const CacheKey *key = data;
+  guint hash;
+  int i;
+
+  hash = (guint) (key->blur_radius * 16) ^ (key->scale << 28);
+  for (i = 0; i < 4; i++)
+    {
+      hash = (hash << 5) - hash + (guint) (key->corner[i].width * 4);
+      hash = (hash << 5) - hash + (guint) (key->corner[i].height * 4);
+    }
+
+  return hash ^ (key->width << 16) ^ key->height;
+}
+
+static gboolean
+cache_key_equal (gconstpointer data1,
+                 gconstpointer data2)
+{
+  const CacheKey *key1 = data1;
+  const CacheKey *key2 = data2;
+
+  return key1->blur_radius == key2->blur_radius &&
+         key1->scale == key2->scale &&
+         key1->width == key2->width &&
+         key1->height == key2->height &&
+         graphene_size_equal (&key1->corner[0], &key2->corner[0]) &&
+         graphene_size_equal (&key1->corner[1], &key2->corner[1]) &&
+         graphene_size_equal (&key1->corner[2], &key2->corner[2]) &&
+         graphene_size_equal (&key1->corner[3], &key2->corner[3]);
+}
+
+static void
+cache_entry_free (gpointer data)
+{
+  CacheEntry *entry = data;
+
+  cairo_surface_destroy (entry->mask);
+  g_slice_free (CacheEntry, entry);
+}
+
+/* Must be called with the lock held */
+static cairo_surface_t *
+gsk_cairo_shadow_cache_lookup (const CacheKey *key)
+{
+  CacheEntry *entry;
+
+  if (shadow_cache == NULL)
+    return NULL;
+
+  entry = g_hash_table_lookup (shadow_cache, key);
+  if (entry == NULL)
+    return NULL;
+
+  g_queue_unlink (&shadow_cache_lru, &entry->link);
+  g_queue_push_head_link (&shadow_cache_lru, &entry->link);
+
+  return cairo_surface_reference (entry->mask);
+}
+
+/* Must be called with the lock held */
+static void
+gsk_cairo_shadow_cache_insert (const CacheKey  *key,
+                               cairo_surface_t *mask)
+{
+  CacheEntry *entry;
+  gsize size;
+
+  size = cairo_image_surface_get_stride (mask) * cairo_image_surface_get_height (mask);
+  if (size > MAX_CACHE_BYTES / 4)
+    return;
+
+  if (shadow_cache == NULL)
+    shadow_cache = g_hash_table_new_full (cache_key_hash, cache_key_equal, NULL, cache_entry_free);
+
+  /* Another thread might have been faster */
+  if (g_hash_table_contains (shadow_cache, key))
+    return;
+
+  while (shadow_cache_size + size > MAX_CACHE_BYTES)
+    {
+      CacheEntry *last = g_queue_peek_tail (&shadow_cache_lru);
+
+      g_queue_unlink (&shadow_cache_lru, &last->link);
+      shadow_cache_size -= last->size;
+      g_hash_table_remove (shadow_cache, &last->key);
+    }
+
+  entry = g_slice_new0 (CacheEntry);
+  entry->key = *key;
+  entry->link.data = entry;
+  entry->mask = cairo_surface_reference (mask);
+  entry->size = size;
+
+  g_hash_table_insert (shadow_cache, &entry->key, entry);
+  g_queue_push_head_link (&shadow_cache_lru, &entry->link);
+  shadow_cache_size += size;
+}
+
+static cairo_surface_t *
+create_mask (const CacheKey *key,
+             int             width,
+             int             height,
+             int             clip_radius)
+{
+  cairo_surface_t *mask;
+  GskRoundedRect box;
+  cairo_t *cr;
+  int i;
+
+  mask = cairo_image_surface_create (CAIRO_FORMAT_A8,
+                                     (width + 2 * clip_radius) * key->scale,
+                                     (height + 2 * clip_radius) * key->scale);
+  cairo_surface_set_device_scale (mask, key->scale, key->scale);
+
+  gsk_rounded_rect_init_from_rect (&box, &GRAPHENE_RECT_INIT (clip_radius, clip_radius, width, height), 0);
+  for (i = 0; i < 4; i++)
+    box.corner[i] = key->corner[i];
+
+  cr = cairo_create (mask);
+  gsk_rounded_rect_path (&box, cr);
+  cairo_fill (cr);
+  cairo_destroy (cr);
+
+  gsk_cairo_blur_surface (mask, key->blur_radius * key->scale, GSK_BLUR_X | GSK_BLUR_Y);
+
+  return mask;
+}
+
+/* Splits the range covered by the shadow of a box from @start to
+ * @end into slices. Returns the number of slices and sets @mask_size
+ * to the size of the box in the mask, or 0 if it is stretched.
+ */
+static guint
+compute_slices (int    start,
+                int    end,
+                int    before,
+                int    after,
+                int    clip_radius,
+                Slice  slices[3],
+                int   *mask_size)
+{
+  int min_size = before + after + 2 * clip_radius + 1;
+
+  if (end - start <= min_size)
+    {
+      slices[0] = (Slice) { 0, end - start + 2 * clip_radius,
+                            start - clip_radius, end - start + 2 * clip_radius };
+      *mask_size = end - start;
+      return 1;
+    }
+
+  slices[0] = (Slice) { 0, before + 2 * clip_radius,
+                        start - clip_radius, before + 2 * clip_radius };
+  slices[1] = (Slice) { before + 2 * clip_radius, 1,
+                        start + before + clip_radius, end - start - min_size + 1 };
+  slices[2] = (Slice) { before + 2 * clip_radius + 1, after + 2 * clip_radius,
+                        end - after - clip_radius, after + 2 * clip_radius };
+  *mask_size = 0;
+  return 3;
+}
+
+static int
+get_scale (cairo_t *cr)
+{
+  double x_scale = 1, y_scale = 0;
+  double dx = 0, dy = 1;
+
+  cairo_user_to_device_distance (cr, &x_scale, &y_scale);
+  cairo_user_to_device_distance (cr, &dx, &dy);
+
+  return CLAMP (ceil (MAX (hypot (x_scale, y_scale), hypot (dx, dy))), 1, 8);
+}
+
+/* Whether @rect has whole pixel coordinates, in user space as well
+ * as in device space, where it must only be scaled by @scale
+ */
+static gboolean
+is_pixel_aligned (cairo_t               *cr,
+                  const graphene_rect_t *rect,
+                  int                    scale)
+{
+  double xx = 1, xy = 0, yx = 0, yy = 1;
+  double x, y;
+
+  if (rect->origin.x != floorf (rect->origin.x) ||
+      rect->origin.y != floorf (rect->origin.y) ||
+      rect->size.width != floorf (rect->size.width) ||
+      rect->size.height != floorf (rect->size.height))
+    return FALSE;
+
+  cairo_user_to_device_distance (cr, &xx, &xy);
+  cairo_user_to_device_distance (cr, &yx, &yy);
+  if (xx != scale || yy != scale || xy != 0 || yx != 0)
+    return FALSE;
+
+  x = rect->origin.x;
+  y = rect->origin.y;
+  cairo_user_to_device (cr, &x, &y);
+
+  return x == floor (x) && y == floor (y);
+}
+
+/*<private>
+ * gsk_cairo_shadow_cache_draw_outset:
+ * @cr: the cairo context to draw to
+ * @box: the shadow box, with offset and spread applied
+ * @blur_radius: the blur radius
+ * @color: the shadow color
+ *
+ * Draws a blurred outset shadow for @box, reusing the blurred
+ * mask from previous calls where possible.
+ *
+ * Returns: %FALSE if @box is not aligned to the pixel grid of @cr,
+ *   and nothing was drawn
+ */
+gboolean
+gsk_cairo_shadow_cache_draw_outset (cairo_t              *cr,
+                                    const GskRoundedRect *box,
+                                    float                 blur_radius,
+                                    const GdkRGBA        *color)
+{
+  cairo_surface_t *mask;
+  CacheKey key;
+  Slice h_slices[3], v_slices[3];
+  guint n_h_slices, n_v_slices, h, v;
+  int clip_radius;
+  int x1, y1, x2, y2;
+  int left, right, top, bottom;
+  int i;
+
+  key.scale = get_scale (cr);
+  if (!is_pixel_aligned (cr, &box->bounds, key.scale))
+    return FALSE;
+
+  clip_radius = gsk_cairo_blur_compute_pixels (blur_radius);
+
+  x1 = box->bounds.origin.x;
+  y1 = box->bounds.origin.y;
+  x2 = box->bounds.origin.x + box->bounds.size.width;
+  y2 = box->bounds.origin.y + box->bounds.size.height;
+
+  left = ceil (MAX (box->corner[GSK_CORNER_TOP_LEFT].width, box->corner[GSK_CORNER_BOTTOM_LEFT].width));
+  right = ceil (MAX (box->corner[GSK_CORNER_TOP_RIGHT].width, box->corner[GSK_CORNER_BOTTOM_RIGHT].width));
+  top = ceil (MAX (box->corner[GSK_CORNER_TOP_LEFT].height, box->corner[GSK_CORNER_TOP_RIGHT].height));
+  bottom = ceil (MAX (box->corner[GSK_CORNER_BOTTOM_LEFT].height, box->corner[GSK_CORNER_BOTTOM_RIGHT].height));
+
+  n_h_slices = compute_slices (x1, x2, left, right, clip_radius, h_slices, &key.width);
+  n_v_slices = compute_slices (y1, y2, top, bottom, clip_radius, v_slices, &key.height);
+
+  for (i = 0; i < 4; i++)
+    key.corner[i] = box->corner[i];
+  key.blur_radius = blur_radius;
+
+  G_LOCK (shadow_cache);
+  mask = gsk_cairo_shadow_cache_lookup (&key);
+  G_UNLOCK (shadow_cache);
+
+  if (mask == NULL)
+    {
+      mask = create_mask (&key,
+                          key.width > 0 ? key.width : left + right + 2 * clip_radius + 1,
+                          key.height > 0 ? key.height : top + bottom + 2 * clip_radius + 1,
+                          clip_radius);
+
+      GSK_NOTE (CAIRO, g_message ("Caching %dx%d shadow mask for blur radius %g",
+                                  cairo_image_surface_get_width (mask),
+                                  cairo_image_surface_get_height (mask),
+                                  blur_radius));
+
+      G_LOCK (shadow_cache);
+      gsk_cairo_shadow_cache_insert (&key, mask);
+      G_UNLOCK (shadow_cache);
+    }
+
+  gdk_cairo_set_source_rgba (cr, color);
+
+  for (v = 0; v < n_v_slices; v++)
+    {
+      const Slice *vs = &v_slices[v];
+
+      if (vs->dest_size <= 0)
+        continue;
+
+      for (h = 0; h < n_h_slices; h++)
+        {
+          const Slice *hs = &h_slices[h];
+          cairo_pattern_t *pattern;
+          cairo_matrix_t matrix;
+
+          if (hs->dest_size <= 0)
+            continue;
+
+          cairo_save (cr);
+          cairo_rectangle (cr, hs->dest_start, vs->dest_start, hs->dest_size, vs->dest_size);
+          cairo_clip (cr);
+
+          pattern = cairo_pattern_create_for_surface (mask);
+          cairo_matrix_init (&matrix,
+                             (double) hs->mask_size / hs->dest_size, 0,
+                             0, (double) vs->mask_size / vs->dest_size,
+                             hs->mask_start - hs->dest_start * (double) hs->mask_size / hs->dest_size,
+                             vs->mask_start - vs->dest_start * (double) vs->mask_size / vs->dest_size);
+          cairo_pattern_set_matrix (pattern, &matrix);
+
+          /* Stretched slices must only ever sample their own pixels */
+          if (hs->mask_size != hs->dest_size || vs->mask_size != vs->dest_size)
+            cairo_pattern_set_filter (pattern, CAIRO_FILTER_NEAREST);
+
+          cairo_mask (cr, pattern);
+          cairo_pattern_destroy (pattern);
+
+          cairo_restore (cr);
+        }
+    }
+
+  cairo_surface_destroy (mask);
+
+  return TRUE;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GSK_CAIRO_SHADOW_CACHE_PRIVATE_H__
+#define __GSK_CAIRO_SHADOW_CACHE_PRIVATE_H__
+
+#include "gskroundedrect.h"
+
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+gboolean        gsk_cairo_shadow_cache_draw_outset      (cairo_t              *cr,
+                                                         const GskRoundedRect *box,
+                                                         float                 blur_radius,
+                                                         const GdkRGBA        *color);
+
+G_END_DECLS
+
+#endif /* __GSK_CAIRO_SHADOW_CACHE_PRIVATE_H__ */
@@ -14,7 +14,11 @@ static const GdkDebugKey gsk_debug_keys[] = {
   { "full-redraw", GSK_DEBUG_FULL_REDRAW, "Force full redraws" },
   { "sync", GSK_DEBUG_SYNC, "Sync after each frame" },
   { "vulkan-staging-image", GSK_DEBUG_VULKAN_STAGING_IMAGE, "Use a staging image for Vulkan texture upload" },
-  { "vulkan-staging-buffer", GSK_DEBUG_VULKAN_STAGING_BUFFER, "Use a staging buffer for Vulkan texture upload" }
+  { "vulkan-staging-buffer", GSK_DEBUG_VULKAN_STAGING_BUFFER, "Use a staging buffer for Vulkan texture upload" },
+  { "cairo-no-threads", GSK_DEBUG_CAIRO_NO_THREADS, "Don't render tiles in parallel with cairo" },
+  { "gl-no-threads", GSK_DEBUG_GL_NO_THREADS, "Don't use threads in the GL renderer" },
+  { "no-culling", GSK_DEBUG_NO_CULLING, "Don't leave out nodes covered by opaque nodes" },
+  { "gl-no-merge", GSK_DEBUG_GL_NO_MERGE, "Don't merge draws in the GL renderer" }
 };
 
 static guint gsk_debug_flags;
@@ -0,0 +1,525 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gskocclusionprivate.h"
+
+#include "gskrendernodeprivate.h"
+#include "gsktransformprivate.h"
+
+#include "gdk/gdkmemorytextureprivate.h"
+
+#include <math.h>
+
+/* Occlusion culling
+ *
+ * The tree is walked from front to back, collecting the area that
+ * is covered by opaque nodes in a region. Nodes that lie completely
+ * inside that region when we get to them can't be seen, and are
+ * left out of the tree that is handed to the renderer.
+ *
+ * Only color nodes and textures without alpha count as opaque.
+ * We look into containers and the nodes that don't change how
+ * their child is drawn, as long as the transform stays affine.
+ * Nodes that are left out are replaced by copies of their parents
+ * without them, everything else is reused as is. Copies are kept
+ * for the next frame, and reused as long as the same children are
+ * left out.
+ */
+
+typedef struct
+{
+  cairo_region_t *opaque; /* in root coordinates */
+
+  /* Transform to root coordinates */
+  float scale_x;
+  float scale_y;
+  float dx;
+  float dy;
+
+  /* Where opaque nodes can be seen, in root coordinates */
+  graphene_rect_t clip;
+
+  /* Nodes inside translucent ones don't cover anything */
+  guint translucent;
+
+  guint n_culled;
+
+  /* Maps nodes to the copies made of them without culled children,
+   * for this frame and the last one
+   */
+  GHashTable *copies;
+  GHashTable *previous;
+} Culler;
+
+static GskRenderNode *cull_node (Culler        *culler,
+                                 GskRenderNode *node);
+
+static void
+transform_rect (const Culler          *culler,
+                const graphene_rect_t *rect,
+                graphene_rect_t       *res)
+{
+  float x1 = rect->origin.x * culler->scale_x + culler->dx;
+  float y1 = rect->origin.y * culler->scale_y + culler->dy;
+  float x2 = (rect->origin.x + rect->size.width) * culler->scale_x + culler->dx;
+  float y2 = (rect->origin.y + rect->size.height) * culler->scale_y + culler->dy;
+
+  graphene_rect_init (res, MIN (x1, x2), MIN (y1, y2), fabsf (x2 - x1), fabsf (y2 - y1));
+}
+
+static gboolean
+is_occluded (const Culler          *culler,
+             const graphene_rect_t *bounds)
+{
+  graphene_rect_t r;
+  cairo_rectangle_int_t rect;
+
+  if (cairo_region_is_empty (culler->opaque))
+    return FALSE;
+
+  transform_rect (culler, bounds, &r);
+
+  /* Round outwards */
+  rect.x = floorf (r.origin.x);
+  rect.y = floorf (r.origin.y);
+  rect.width = ceilf (r.origin.x + r.size.width) - rect.x;
+  rect.height = ceilf (r.origin.y + r.size.height) - rect.y;
+
+  if (rect.width <= 0 || rect.height <= 0)
+    return FALSE;
+
+  return cairo_region_contains_rectangle (culler->opaque, &rect) == CAIRO_REGION_OVERLAP_IN;
+}
+
+static void
+add_opaque_rect (Culler                *culler,
+                 const graphene_rect_t *bounds)
+{
+  graphene_rect_t r;
+  cairo_rectangle_int_t rect;
+  int x2, y2;
+
+  if (culler->translucent > 0)
+    return;
+
+  transform_rect (culler, bounds, &r);
+  if (!graphene_rect_intersection (&r, &culler->clip, &r))
+    return;
+
+  /* Round inwards */
+  rect.x = ceilf (r.origin.x);
+  rect.y = ceilf (r.origin.y);
+  x2 = floorf (r.origin.x + r.size.width);
+  y2 = floorf (r.origin.y + r.size.height);
+
+  if (x2 <= rect.x || y2 <= rect.y)
+    return;
+
+  rect.width = x2 - rect.x;
+  rect.height = y2 - rect.y;
+
+  cairo_region_union_rectangle (culler->opaque, &rect);
+}
+
+static gboolean
+texture_is_opaque (GdkTexture *texture)
+{
+  if (!GDK_IS_MEMORY_TEXTURE (texture))
+    return FALSE;
+
+  switch (gdk_memory_texture_get_format (GDK_MEMORY_TEXTURE (texture)))
+    {
+    case GDK_MEMORY_R8G8B8:
+    case GDK_MEMORY_B8G8R8:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+/* The largest rectangle inside @rounded that is easy to find */
+static void
+rounded_rect_get_inner_rect (const GskRoundedRect *rounded,
+                             graphene_rect_t      *rect)
+{
+  float left = MAX (rounded->corner[GSK_CORNER_TOP_LEFT].width,
+                    rounded->corner[GSK_CORNER_BOTTOM_LEFT].width);
+  float right = MAX (rounded->corner[GSK_CORNER_TOP_RIGHT].width,
+                     rounded->corner[GSK_CORNER_BOTTOM_RIGHT].width);
+  float top = MAX (rounded->corner[GSK_CORNER_TOP_LEFT].height,
+                   rounded->corner[GSK_CORNER_TOP_RIGHT].height);
+  float bottom = MAX (rounded->corner[GSK_CORNER_BOTTOM_LEFT].height,
+                      rounded->corner[GSK_CORNER_BOTTOM_RIGHT].height);
+
+  /* Either the rect without the left and right corners,
+   * or the one without the top and bottom ones */
+  if ((rounded->bounds.size.width - left - right) * rounded->bounds.size.height >
+      rounded->bounds.size.width * (rounded->bounds.size.height - top - bottom))
+    graphene_rect_init (rect,
+                        rounded->bounds.origin.x + left,
+                        rounded->bounds.origin.y,
+                        MAX (0, rounded->bounds.size.width - left - right),
+                        rounded->bounds.size.height);
+  else
+    graphene_rect_init (rect,
+                        rounded->bounds.origin.x,
+                        rounded->bounds.origin.y + top,
+                        rounded->bounds.size.width,
+                        MAX (0, rounded->bounds.size.height - top - bottom));
+}
+
+static gboolean
+copy_has_children (GskRenderNode  *copy,
+                   GskRenderNode **children,
+                   guint           n_children)
+{
+  guint i;
+
+  switch (gsk_render_node_get_node_type (copy))
+    {
+    case GSK_CONTAINER_NODE:
+      if (gsk_container_node_get_n_children (copy) != n_children)
+        return FALSE;
+      for (i = 0; i < n_children; i++)
+        {
+          if (gsk_container_node_get_child (copy, i) != children[i])
+            return FALSE;
+        }
+      return TRUE;
+
+    case GSK_TRANSFORM_NODE:
+      return gsk_transform_node_get_child (copy) == children[0];
+
+    case GSK_CLIP_NODE:
+      return gsk_clip_node_get_child (copy) == children[0];
+
+    case GSK_ROUNDED_CLIP_NODE:
+      return gsk_rounded_clip_node_get_child (copy) == children[0];
+
+    case GSK_OPACITY_NODE:
+      return gsk_opacity_node_get_child (copy) == children[0];
+
+    case GSK_DEBUG_NODE:
+      return gsk_debug_node_get_child (copy) == children[0];
+
+    default:
+      g_assert_not_reached ();
+      return FALSE;
+    }
+}
+
+/* Returns a copy of @node with @children instead of its own.
+ * The copy that was made for @node in the last frame is reused if
+ * it has the same children, so that renderers and the diff see the
+ * same nodes from frame to frame.
+ */
+static GskRenderNode *
+copy_node (Culler         *culler,
+           GskRenderNode  *node,
+           GskRenderNode **children,
+           guint           n_children)
+{
+  GskRenderNode *copy = NULL;
+
+  if (culler->previous)
+    {
+      copy = g_hash_table_lookup (culler->previous, node);
+      if (copy && copy_has_children (copy, children, n_children))
+        gsk_render_node_ref (copy);
+      else
+        copy = NULL;
+    }
+
+  if (copy == NULL)
+    {
+      switch (gsk_render_node_get_node_type (node))
+        {
+        case GSK_CONTAINER_NODE:
+          copy = gsk_container_node_new (children, n_children);
+          break;
+
+        case GSK_TRANSFORM_NODE:
+          copy = gsk_transform_node_new (children[0], gsk_transform_node_get_transform (node));
+          break;
+
+        case GSK_CLIP_NODE:
+          copy = gsk_clip_node_new (children[0], gsk_clip_node_get_clip (node));
+          break;
+
+        case GSK_ROUNDED_CLIP_NODE:
+          copy = gsk_rounded_clip_node_new (children[0], gsk_rounded_clip_node_get_clip (node));
+          break;
+
+        case GSK_OPACITY_NODE:
+          copy = gsk_opacity_node_new (children[0], gsk_opacity_node_get_opacity (node));
+          break;
+
+        case GSK_DEBUG_NODE:
+          copy = gsk_debug_node_new (children[0], g_strdup (gsk_debug_node_get_message (node)));
+          break;
+
+        default:
+          g_assert_not_reached ();
+        }
+    }
+
+  /* The key keeps @node alive, so its address can't be reused */
+  g_hash_table_insert (culler->copies, gsk_render_node_ref (node), gsk_render_node_ref (copy));
+
+  return copy;
+}
+
+/* For nodes with a single child: @node itself if the child was
+ * kept as is, %NULL if it was dropped, or a copy of @node
+ */
+static GskRenderNode *
+replace_child (Culler        *culler,
+               GskRenderNode *node,
+               GskRenderNode *child,
+               GskRenderNode *result)
+{
+  GskRenderNode *copy;
+
+  if (result == NULL)
+    return NULL;
+
+  if (result == child)
+    {
+      gsk_render_node_unref (result);
+      return gsk_render_node_ref (node);
+    }
+
+  copy = copy_node (culler, node, &result, 1);
+  gsk_render_node_unref (result);
+
+  return copy;
+}
+
+static GskRenderNode *
+cull_container (Culler        *culler,
+                GskRenderNode *node)
+{
+  guint n_children = gsk_container_node_get_n_children (node);
+  GskRenderNode **children;
+  GskRenderNode *result;
+  gboolean changed = FALSE;
+  guint n_kept = 0;
+  int i;
+
+  children = g_new (GskRenderNode *, n_children);
+
+  /* Front to back */
+  for (i = n_children - 1; i >= 0; i--)
+    {
+      GskRenderNode *child = gsk_container_node_get_child (node, i);
+
+      children[i] = cull_node (culler, child);
+      if (children[i] != child)
+        changed = TRUE;
+      if (children[i] != NULL)
+        n_kept++;
+    }
+
+  if (!changed)
+    result = gsk_render_node_ref (node);
+  else if (n_kept == 0)
+    result = NULL;
+  else
+    {
+      GskRenderNode **kept = g_new (GskRenderNode *, n_kept);
+      guint j = 0;
+
+      for (i = 0; i < n_children; i++)
+        {
+          if (children[i] != NULL)
+            kept[j++] = children[i];
+        }
+
+      result = copy_node (culler, node, kept, n_kept);
+      g_free (kept);
+    }
+
+  for (i = 0; i < n_children; i++)
+    g_clear_pointer (&children[i], gsk_render_node_unref);
+  g_free (children);
+
+  return result;
+}
+
+static GskRenderNode *
+cull_transform (Culler        *culler,
+                GskRenderNode *node)
+{
+  GskTransform *transform = gsk_transform_node_get_transform (node);
+  GskRenderNode *child = gsk_transform_node_get_child (node);
+  GskRenderNode *result;
+  Culler saved = *culler;
+  float scale_x, scale_y, dx, dy;
+
+  if (gsk_transform_get_category (transform) < GSK_TRANSFORM_CATEGORY_2D_AFFINE)
+    return gsk_render_node_ref (node);
+
+  gsk_transform_to_affine (transform, &scale_x, &scale_y, &dx, &dy);
+
+  culler->dx += dx * culler->scale_x;
+  culler->dy += dy * culler->scale_y;
+  culler->scale_x *= scale_x;
+  culler->scale_y *= scale_y;
+
+  result = cull_node (culler, child);
+
+  culler->scale_x = saved.scale_x;
+  culler->scale_y = saved.scale_y;
+  culler->dx = saved.dx;
+  culler->dy = saved.dy;
+
+  return replace_child (culler, node, child, result);
+}
+
+static GskRenderNode *
+cull_node (Culler        *culler,
+           GskRenderNode *node)
+{
+  GskRenderNode *child, *result;
+  graphene_rect_t saved_clip;
+
+  if (is_occluded (culler, &node->bounds))
+    {
+      culler->n_culled++;
+      return NULL;
+    }
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      return cull_container (culler, node);
+
+    case GSK_TRANSFORM_NODE:
+      return cull_transform (culler, node);
+
+    case GSK_CLIP_NODE:
+      child = gsk_clip_node_get_child (node);
+      saved_clip = culler->clip;
+
+      transform_rect (culler, gsk_clip_node_get_clip (node), &culler->clip);
+      if (!graphene_rect_intersection (&culler->clip, &saved_clip, &culler->clip))
+        graphene_rect_init (&culler->clip, 0, 0, 0, 0);
+      result = cull_node (culler, child);
+      culler->clip = saved_clip;
+
+      return replace_child (culler, node, child, result);
+
+    case GSK_ROUNDED_CLIP_NODE:
+      {
+        graphene_rect_t inner;
+
+        child = gsk_rounded_clip_node_get_child (node);
+        saved_clip = culler->clip;
+
+        rounded_rect_get_inner_rect (gsk_rounded_clip_node_get_clip (node), &inner);
+        transform_rect (culler, &inner, &culler->clip);
+        if (!graphene_rect_intersection (&culler->clip, &saved_clip, &culler->clip))
+          graphene_rect_init (&culler->clip, 0, 0, 0, 0);
+        result = cull_node (culler, child);
+        culler->clip = saved_clip;
+
+        return replace_child (culler, node, child, result);
+      }
+
+    case GSK_OPACITY_NODE:
+      child = gsk_opacity_node_get_child (node);
+
+      if (gsk_opacity_node_get_opacity (node) < 1)
+        culler->translucent++;
+      result = cull_node (culler, child);
+      if (gsk_opacity_node_get_opacity (node) < 1)
+        culler->translucent--;
+
+      return replace_child (culler, node, child, result);
+
+    case GSK_DEBUG_NODE:
+      child = gsk_debug_node_get_child (node);
+      result = cull_node (culler, child);
+
+      return replace_child (culler, node, child, result);
+
+    case GSK_COLOR_NODE:
+      if (gsk_color_node_get_color (node)->alpha >= 1.0)
+        add_opaque_rect (culler, &node->bounds);
+      return gsk_render_node_ref (node);
+
+    case GSK_TEXTURE_NODE:
+      if (texture_is_opaque (gsk_texture_node_get_texture (node)))
+        add_opaque_rect (culler, &node->bounds);
+      return gsk_render_node_ref (node);
+
+    default:
+      return gsk_render_node_ref (node);
+    }
+}
+
+/**
+ * gsk_occlusion_cull:
+ * @root: the root of a render node tree
+ * @copies: (inout) (nullable): the copies of nodes that were made for
+ *   the last frame, or %NULL. Set to the copies made for this frame,
+ *   to pass in for the next one. Free it with g_hash_table_unref().
+ * @n_culled: (out): return location for the number of subtrees
+ *   that were left out
+ *
+ * Returns a tree that draws the same as @root, but without
+ * the nodes that are completely covered by opaque nodes.
+ *
+ * Returns: (transfer full): the culled tree, which may be @root
+ */
+GskRenderNode *
+gsk_occlusion_cull (GskRenderNode  *root,
+                    GHashTable    **copies,
+                    guint          *n_culled)
+{
+  Culler culler;
+  GskRenderNode *result;
+
+  culler.opaque = cairo_region_create ();
+  culler.scale_x = 1;
+  culler.scale_y = 1;
+  culler.dx = 0;
+  culler.dy = 0;
+  culler.clip = GRAPHENE_RECT_INIT (-G_MAXFLOAT / 2, -G_MAXFLOAT / 2, G_MAXFLOAT, G_MAXFLOAT);
+  culler.translucent = 0;
+  culler.n_culled = 0;
+  culler.previous = *copies;
+  culler.copies = g_hash_table_new_full (NULL, NULL,
+                                         (GDestroyNotify) gsk_render_node_unref,
+                                         (GDestroyNotify) gsk_render_node_unref);
+
+  result = cull_node (&culler, root);
+
+  /* Nothing is in front of the root */
+  g_assert (result != NULL);
+
+  cairo_region_destroy (culler.opaque);
+  g_clear_pointer (copies, g_hash_table_unref);
+  *copies = culler.copies;
+
+  *n_culled = culler.n_culled;
+
+  return result;
+}
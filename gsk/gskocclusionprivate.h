@@ -0,0 +1,31 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GSK_OCCLUSION_PRIVATE_H__
+#define __GSK_OCCLUSION_PRIVATE_H__
+
+#include "gskrendernode.h"
+
+G_BEGIN_DECLS
+
+GskRenderNode *         gsk_occlusion_cull                      (GskRenderNode          *root,
+                                                                 GHashTable            **copies,
+                                                                 guint                  *n_culled);
+
+G_END_DECLS
+
+#endif /* __GSK_OCCLUSION_PRIVATE_H__ */
@@ -39,6 +39,7 @@
 #include "gskcairorenderer.h"
 #include "gskdebugprivate.h"
 #include "gl/gskglrenderer.h"
+#include "gskocclusionprivate.h"
 #include "gskprofilerprivate.h"
 #include "gskrendernodeprivate.h"
 
@@ -78,9 +79,16 @@ typedef struct
   GdkSurface *surface;
   GskRenderNode *prev_node;
   GskRenderNode *root_node;
+  GHashTable *occlusion_copies;
 
   GskProfiler *profiler;
 
+#ifdef G_ENABLE_DEBUG
+  GQuark culled_nodes;
+  GQuark diff_nodes;
+  GQuark diff_pruned;
+#endif
+
   GskDebugFlags debug_flags;
 
   gboolean is_realized : 1;
@@ -210,6 +218,12 @@ gsk_renderer_init (GskRenderer *self)
 
   priv->profiler = gsk_profiler_new ();
   priv->debug_flags = gsk_get_debug_flags ();
+
+#ifdef G_ENABLE_DEBUG
+  priv->culled_nodes = gsk_profiler_add_counter (priv->profiler, "culled-nodes", "Nodes covered by opaque nodes", TRUE);
+  priv->diff_nodes = gsk_profiler_add_counter (priv->profiler, "diff-nodes", "Nodes compared for damage", TRUE);
+  priv->diff_pruned = gsk_profiler_add_counter (priv->profiler, "diff-pruned", "Identical subtrees skipped for damage", TRUE);
+#endif
 }
 
 /**
@@ -319,10 +333,35 @@ gsk_renderer_unrealize (GskRenderer *renderer)
   GSK_RENDERER_GET_CLASS (renderer)->unrealize (renderer);
 
   g_clear_pointer (&priv->prev_node, gsk_render_node_unref);
+  g_clear_pointer (&priv->occlusion_copies, g_hash_table_unref);
 
   priv->is_realized = FALSE;
 }
 
+/* Leaves out the parts of @root that are covered by opaque nodes */
+static GskRenderNode *
+gsk_renderer_cull_occluded (GskRenderer   *renderer,
+                            GskRenderNode *root)
+{
+  GskRendererPrivate *priv = gsk_renderer_get_instance_private (renderer);
+  GskRenderNode *culled;
+  guint n_culled;
+
+  if (GSK_RENDERER_DEBUG_CHECK (renderer, NO_CULLING))
+    {
+      g_clear_pointer (&priv->occlusion_copies, g_hash_table_unref);
+      return gsk_render_node_ref (root);
+    }
+
+  culled = gsk_occlusion_cull (root, &priv->occlusion_copies, &n_culled);
+
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_add (priv->profiler, priv->culled_nodes, n_culled);
+#endif
+
+  return culled;
+}
+
 /**
  * gsk_renderer_render_texture:
  * @renderer: a realized #GskRenderer
@@ -427,8 +466,15 @@ gsk_renderer_render (GskRenderer          *renderer,
     }
   else
     {
+      GskDiffStats stats;
+
       clip = cairo_region_copy (region);
-      gsk_render_node_diff (priv->prev_node, root, clip);
+      gsk_render_node_diff_with_stats (priv->prev_node, root, clip, &stats);
+
+#ifdef G_ENABLE_DEBUG
+      gsk_profiler_counter_add (priv->profiler, priv->diff_nodes, stats.n_compared);
+      gsk_profiler_counter_add (priv->profiler, priv->diff_pruned, stats.n_pruned);
+#endif
 
       if (cairo_region_is_empty (clip))
         {
@@ -439,7 +485,10 @@ gsk_renderer_render (GskRenderer          *renderer,
 
   priv->root_node = gsk_render_node_ref (root);
 
+  /* The diff above and the one for the next frame use the full tree */
+  root = gsk_renderer_cull_occluded (renderer, root);
   GSK_RENDERER_GET_CLASS (renderer)->render (renderer, root, clip);
+  gsk_render_node_unref (root);
 
 #ifdef G_ENABLE_DEBUG
   if (GSK_RENDERER_DEBUG_CHECK (renderer, RENDERER))
@@ -40,8 +40,10 @@
 
 #include "gskrendernodeprivate.h"
 
+#include "gskcaironodecacheprivate.h"
 #include "gskdebugprivate.h"
 #include "gskrendererprivate.h"
+#include "gskrendernodebinaryprivate.h"
 #include "gskrendernodeparserprivate.h"
 
 #include <graphene-gobject.h>
@@ -165,6 +167,21 @@ gsk_render_node_real_diff (GskRenderNode  *node1,
 {
 }
 
+/* Without knowing the contents, a node is only identical to itself */
+static guint64
+gsk_render_node_real_hash (GskRenderNode *node,
+                           guint64        hash)
+{
+  return gsk_hash_pointer (hash, node);
+}
+
+static gboolean
+gsk_render_node_real_equal (GskRenderNode *node1,
+                            GskRenderNode *node2)
+{
+  return FALSE;
+}
+
 static void
 gsk_render_node_class_init (GskRenderNodeClass *klass)
 {
@@ -173,6 +190,8 @@ gsk_render_node_class_init (GskRenderNodeClass *klass)
   klass->draw = gsk_render_node_real_draw;
   klass->can_diff = gsk_render_node_real_can_diff;
   klass->diff = gsk_render_node_real_diff;
+  klass->hash = gsk_render_node_real_hash;
+  klass->equal = gsk_render_node_real_equal;
 }
 
 static void
@@ -248,6 +267,10 @@ typedef struct
   void     (* diff)     (GskRenderNode        *node1,
                          GskRenderNode        *node2,
                          cairo_region_t       *region);
+  guint64  (* hash)     (GskRenderNode        *node,
+                         guint64               hash);
+  gboolean (* equal)    (GskRenderNode        *node1,
+                         GskRenderNode        *node2);
 } RenderNodeClassData;
 
 static void
@@ -265,6 +288,10 @@ gsk_render_node_generic_class_init (gpointer g_class,
     node_class->finalize = node_data->finalize;
   if (node_data->can_diff != NULL)
     node_class->can_diff = node_data->can_diff;
+  if (node_data->hash != NULL)
+    node_class->hash = node_data->hash;
+  if (node_data->equal != NULL)
+    node_class->equal = node_data->equal;
 
   /* Mandatory */
   node_class->draw = node_data->draw;
@@ -316,6 +343,8 @@ gsk_render_node_type_register_static (const char                  *node_name,
   ((RenderNodeClassData *) info.class_data)->diff = node_info->diff != NULL
                                                   ? node_info->diff
                                                   : gsk_render_node_diff_impossible;
+  ((RenderNodeClassData *) info.class_data)->hash = node_info->hash;
+  ((RenderNodeClassData *) info.class_data)->equal = node_info->equal;
 
   info.instance_size = node_info->instance_size;
   info.n_preallocs = 0;
@@ -449,7 +478,8 @@ gsk_render_node_draw (GskRenderNode *node,
                               g_type_name_from_instance ((GTypeInstance *) node),
                               node));
 
-  GSK_RENDER_NODE_GET_CLASS (node)->draw (node, cr);
+  if (!gsk_cairo_node_cache_draw (cr, node))
+    GSK_RENDER_NODE_GET_CLASS (node)->draw (node, cr);
 
 #ifdef G_ENABLE_DEBUG
   if (GSK_DEBUG_CHECK (GEOMETRY))
@@ -523,6 +553,72 @@ gsk_render_node_diff_impossible (GskRenderNode  *node1,
   cairo_region_union_rectangle (region, &rect);
 }
 
+/*< private >
+ * gsk_render_node_get_hash:
+ * @node: a #GskRenderNode
+ *
+ * Gets a hash of the contents of @node including all its children.
+ * Nodes with different hashes render differently. Nodes with the same
+ * hash render identically unless the hashes collide, use
+ * gsk_render_node_equal() where that matters.
+ *
+ * The hash is computed on first use and cached. Nodes are immutable, and
+ * diffing happens on the main thread, so this is not locked.
+ *
+ * Returns: the hash of @node, never 0
+ */
+guint64
+gsk_render_node_get_hash (GskRenderNode *node)
+{
+  if (G_UNLIKELY (node->hash == 0))
+    {
+      guint64 hash;
+
+      hash = gsk_hash_uint64 (0, _gsk_render_node_get_node_type (node));
+      hash = gsk_hash_rect (hash, &node->bounds);
+      hash = GSK_RENDER_NODE_GET_CLASS (node)->hash (node, hash);
+
+      node->hash = hash != 0 ? hash : 1;
+    }
+
+  return node->hash;
+}
+
+/*< private >
+ * gsk_render_node_equal:
+ * @node1: a #GskRenderNode
+ * @node2: the #GskRenderNode to compare with
+ *
+ * Checks if @node1 and @node2 render identically. Nodes with different
+ * hashes are rejected right away, for others the contents and children
+ * are compared.
+ *
+ * Returns: %TRUE if the nodes are known to render identically
+ */
+gboolean
+gsk_render_node_equal (GskRenderNode *node1,
+                       GskRenderNode *node2)
+{
+  if (node1 == node2)
+    return TRUE;
+
+  if (_gsk_render_node_get_node_type (node1) != _gsk_render_node_get_node_type (node2))
+    return FALSE;
+
+  if (gsk_render_node_get_hash (node1) != gsk_render_node_get_hash (node2))
+    return FALSE;
+
+  if (!graphene_rect_equal (&node1->bounds, &node2->bounds))
+    return FALSE;
+
+  return GSK_RENDER_NODE_GET_CLASS (node1)->equal (node1, node2);
+}
+
+/* Only set during gsk_render_node_diff_with_stats(). The diff vfuncs
+ * recurse through gsk_render_node_diff(), so the stats are kept per
+ * thread to not mix up diffs running at the same time */
+static GPrivate diff_stats_key = G_PRIVATE_INIT (NULL);
+
 /**
  * gsk_render_node_diff:
  * @node1: a #GskRenderNode
@@ -545,15 +641,59 @@ gsk_render_node_diff (GskRenderNode  *node1,
                       GskRenderNode  *node2,
                       cairo_region_t *region)
 {
+  GskDiffStats *diff_stats;
+
   if (node1 == node2)
     return;
 
+  diff_stats = g_private_get (&diff_stats_key);
+  if (diff_stats)
+    diff_stats->n_compared++;
+
   if (_gsk_render_node_get_node_type (node1) != _gsk_render_node_get_node_type (node2))
     return gsk_render_node_diff_impossible (node1, node2, region);
 
+  /* Snapshotting often recreates identical subtrees. The hash covers
+   * the whole subtree, so a matching one is trusted here: comparing the
+   * contents with gsk_render_node_equal() would walk every skipped
+   * subtree again, and a 64-bit collision is far less likely than
+   * anything else going wrong in a frame */
+  if (gsk_render_node_get_hash (node1) == gsk_render_node_get_hash (node2) &&
+      graphene_rect_equal (&node1->bounds, &node2->bounds))
+    {
+      if (diff_stats)
+        diff_stats->n_pruned++;
+      return;
+    }
+
   return GSK_RENDER_NODE_GET_CLASS (node1)->diff (node1, node2, region);
 }
 
+/*< private >
+ * gsk_render_node_diff_with_stats:
+ * @node1: a #GskRenderNode
+ * @node2: the #GskRenderNode to compare with
+ * @region: a #cairo_region_t to add the differences to
+ * @stats: (out caller-allocates): return location for statistics
+ *
+ * Like gsk_render_node_diff(), but also counts how much work the
+ * comparison took, for the profiler.
+ */
+void
+gsk_render_node_diff_with_stats (GskRenderNode  *node1,
+                                 GskRenderNode  *node2,
+                                 cairo_region_t *region,
+                                 GskDiffStats   *stats)
+{
+  g_assert (g_private_get (&diff_stats_key) == NULL);
+
+  memset (stats, 0, sizeof (GskDiffStats));
+
+  g_private_set (&diff_stats_key, stats);
+  gsk_render_node_diff (node1, node2, region);
+  g_private_set (&diff_stats_key, NULL);
+}
+
 /**
  * gsk_render_node_write_to_file:
  * @node: a #GskRenderNode
@@ -597,8 +737,9 @@ gsk_render_node_write_to_file (GskRenderNode *node,
  * @error_func: (nullable) (scope call): Callback on parsing errors or %NULL
  * @user_data: (closure error_func): user_data for @error_func
  *
- * Loads data previously created via gsk_render_node_serialize(). For a
- * discussion of the supported format, see that function.
+ * Loads data previously created via gsk_render_node_serialize() or
+ * gsk_render_node_serialize_binary(). The format is detected automatically.
+ * For a discussion of the supported formats, see those functions.
  *
  * Returns: (nullable) (transfer full): a new #GskRenderNode or %NULL on
  *     error.
@@ -610,7 +751,10 @@ gsk_render_node_deserialize (GBytes            *bytes,
 {
   GskRenderNode *node = NULL;
 
-  node = gsk_render_node_deserialize_from_bytes (bytes, error_func, user_data);
+  if (gsk_render_node_is_binary (bytes))
+    node = gsk_render_node_deserialize_binary (bytes, error_func, user_data);
+  else
+    node = gsk_render_node_deserialize_from_bytes (bytes, error_func, user_data);
 
   return node;
 }
@@ -0,0 +1,2053 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gskrendernodebinaryprivate.h"
+
+#include "gskrendernodeprivate.h"
+#include "gskroundedrectprivate.h"
+
+#include "gdk/gdkmemorytextureprivate.h"
+#include "gdk/gdktextureprivate.h"
+
+#include <gio/gio.h>
+#include <pango/pangocairo.h>
+#include <math.h>
+#include <string.h>
+
+/* The binary node format is a header followed by four length-prefixed
+ * sections: strings, fonts, textures and nodes.
+ *
+ * All values are 32-bit little-endian and everything is padded to 4 bytes,
+ * so a mapped file can be read in place. Strings, fonts and textures are
+ * deduplicated and referred to by their index. Texture pixels are stored
+ * raw in their memory format, or zlib compressed if that saves enough.
+ * Raw pixels that make up most of the data are not copied on load, the
+ * resulting textures reference the #GBytes that were passed in. Smaller
+ * ones are copied, so they don't keep the whole input alive.
+ *
+ * Nodes are stored in pre-order: the node type, the node's values and
+ * then its children. Trees deeper than MAX_NODE_DEPTH are rejected.
+ */
+
+#define BINARY_MAGIC "GSKB"
+#define BINARY_VERSION 1
+
+#define NO_INDEX G_MAXUINT32
+
+/* Below this, compressing isn't worth the time */
+#define MIN_COMPRESS_SIZE 4096
+
+/* The best ratio zlib can achieve, used to reject bogus texture sizes */
+#define MAX_ZLIB_RATIO 1032
+
+/* Nodes are read recursively, so deeper trees are rejected instead of
+ * running out of stack */
+#define MAX_NODE_DEPTH 1024
+
+typedef enum {
+  TEXTURE_RAW,
+  TEXTURE_ZLIB
+} TextureEncoding;
+
+typedef enum {
+  TRANSFORM_STRING,
+  TRANSFORM_TRANSLATE
+} TransformEncoding;
+
+/*** WRITING ***/
+
+typedef struct
+{
+  GByteArray *nodes;
+
+  GHashTable *string_indices;   /* char * => index + 1 */
+  GPtrArray *strings;
+
+  GHashTable *font_indices;     /* PangoFont * => index + 1 */
+  GHashTable *font_strings;     /* string index + 1 => font index + 1 */
+  GArray *fonts;                /* guint32 string index */
+
+  GHashTable *texture_indices;  /* GdkTexture * => index + 1 */
+  GByteArray *textures;
+  guint n_textures;
+} Writer;
+
+static void
+append_uint32 (GByteArray *array,
+               guint32     value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (guint32));
+}
+
+static void
+append_float (GByteArray *array,
+              float       value)
+{
+  union {
+    float f;
+    guint32 u;
+  } u = { value };
+
+  append_uint32 (array, u.u);
+}
+
+static void
+append_data (GByteArray   *array,
+             const guchar *data,
+             gsize         size)
+{
+  static const guchar zeroes[4] = { 0, };
+
+  g_byte_array_append (array, data, size);
+  if (size % 4)
+    g_byte_array_append (array, zeroes, 4 - size % 4);
+}
+
+static void
+writer_init (Writer *w)
+{
+  w->nodes = g_byte_array_new ();
+
+  w->string_indices = g_hash_table_new (g_str_hash, g_str_equal);
+  w->strings = g_ptr_array_new_with_free_func (g_free);
+
+  w->font_indices = g_hash_table_new (NULL, NULL);
+  w->font_strings = g_hash_table_new (NULL, NULL);
+  w->fonts = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  w->texture_indices = g_hash_table_new (NULL, NULL);
+  w->textures = g_byte_array_new ();
+  w->n_textures = 0;
+}
+
+static void
+writer_finish (Writer *w)
+{
+  g_byte_array_unref (w->nodes);
+
+  g_hash_table_unref (w->string_indices);
+  g_ptr_array_unref (w->strings);
+
+  g_hash_table_unref (w->font_indices);
+  g_hash_table_unref (w->font_strings);
+  g_array_unref (w->fonts);
+
+  g_hash_table_unref (w->texture_indices);
+  g_byte_array_unref (w->textures);
+}
+
+static void
+write_uint32 (Writer  *w,
+              guint32  value)
+{
+  append_uint32 (w->nodes, value);
+}
+
+static void
+write_float (Writer *w,
+             float   value)
+{
+  append_float (w->nodes, value);
+}
+
+static void
+write_point (Writer                 *w,
+             const graphene_point_t *point)
+{
+  write_float (w, point->x);
+  write_float (w, point->y);
+}
+
+static void
+write_rect (Writer                *w,
+            const graphene_rect_t *rect)
+{
+  write_float (w, rect->origin.x);
+  write_float (w, rect->origin.y);
+  write_float (w, rect->size.width);
+  write_float (w, rect->size.height);
+}
+
+static void
+write_rounded_rect (Writer               *w,
+                    const GskRoundedRect *rect)
+{
+  guint i;
+
+  write_rect (w, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      write_float (w, rect->corner[i].width);
+      write_float (w, rect->corner[i].height);
+    }
+}
+
+static void
+write_rgba (Writer        *w,
+            const GdkRGBA *rgba)
+{
+  write_float (w, rgba->red);
+  write_float (w, rgba->green);
+  write_float (w, rgba->blue);
+  write_float (w, rgba->alpha);
+}
+
+static void
+write_stops (Writer             *w,
+             const GskColorStop *stops,
+             gsize               n_stops)
+{
+  gsize i;
+
+  write_uint32 (w, n_stops);
+  for (i = 0; i < n_stops; i++)
+    {
+      write_float (w, stops[i].offset);
+      write_rgba (w, &stops[i].color);
+    }
+}
+
+static guint32
+writer_add_string (Writer     *w,
+                   const char *string)
+{
+  guint index;
+
+  index = GPOINTER_TO_UINT (g_hash_table_lookup (w->string_indices, string));
+  if (index == 0)
+    {
+      char *copy = g_strdup (string);
+
+      g_ptr_array_add (w->strings, copy);
+      index = w->strings->len;
+      g_hash_table_insert (w->string_indices, copy, GUINT_TO_POINTER (index));
+    }
+
+  return index - 1;
+}
+
+static guint32
+writer_add_font (Writer    *w,
+                 PangoFont *font)
+{
+  PangoFontDescription *desc;
+  char *name;
+  guint index;
+  guint32 string;
+
+  index = GPOINTER_TO_UINT (g_hash_table_lookup (w->font_indices, font));
+  if (index != 0)
+    return index - 1;
+
+  /* Different font objects can describe the same font */
+  desc = pango_font_describe (font);
+  name = pango_font_description_to_string (desc);
+  string = writer_add_string (w, name);
+  g_free (name);
+  pango_font_description_free (desc);
+
+  index = GPOINTER_TO_UINT (g_hash_table_lookup (w->font_strings, GUINT_TO_POINTER (string + 1)));
+  if (index == 0)
+    {
+      g_array_append_val (w->fonts, string);
+      index = w->fonts->len;
+      g_hash_table_insert (w->font_strings, GUINT_TO_POINTER (string + 1), GUINT_TO_POINTER (index));
+    }
+
+  g_hash_table_insert (w->font_indices, font, GUINT_TO_POINTER (index));
+
+  return index - 1;
+}
+
+static GBytes *
+compress_pixels (const guchar *data,
+                 gsize         size)
+{
+  GConverter *compressor;
+  GConverterResult result;
+  gsize max_size, in_pos, out_pos, bytes_read, bytes_written;
+  guchar *out;
+
+  /* Only keep the result if it saves at least a quarter */
+  max_size = size - size / 4;
+  out = g_malloc (max_size);
+  compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB, 1));
+  in_pos = out_pos = 0;
+
+  while (TRUE)
+    {
+      if (out_pos == max_size)
+        {
+          result = G_CONVERTER_ERROR;
+          break;
+        }
+
+      result = g_converter_convert (compressor,
+                                    data + in_pos, size - in_pos,
+                                    out + out_pos, max_size - out_pos,
+                                    G_CONVERTER_INPUT_AT_END,
+                                    &bytes_read, &bytes_written,
+                                    NULL);
+      in_pos += bytes_read;
+      out_pos += bytes_written;
+
+      if (result != G_CONVERTER_CONVERTED)
+        break;
+    }
+
+  g_object_unref (compressor);
+
+  if (result != G_CONVERTER_FINISHED)
+    {
+      g_free (out);
+      return NULL;
+    }
+
+  return g_bytes_new_take (out, out_pos);
+}
+
+static guint32
+writer_add_pixels (Writer          *w,
+                   int              width,
+                   int              height,
+                   GdkMemoryFormat  format,
+                   const guchar    *data,
+                   gsize            stride)
+{
+  gsize row_size, size;
+  const guchar *pixels;
+  guchar *packed = NULL;
+  GBytes *compressed = NULL;
+
+  row_size = width * gdk_memory_format_bytes_per_pixel (format);
+  size = row_size * height;
+
+  if (stride != row_size)
+    {
+      int y;
+
+      packed = g_malloc (size);
+      for (y = 0; y < height; y++)
+        memcpy (packed + y * row_size, data + y * stride, row_size);
+      pixels = packed;
+    }
+  else
+    {
+      pixels = data;
+    }
+
+  if (size >= MIN_COMPRESS_SIZE)
+    compressed = compress_pixels (pixels, size);
+
+  append_uint32 (w->textures, width);
+  append_uint32 (w->textures, height);
+  append_uint32 (w->textures, format);
+  append_uint32 (w->textures, row_size);
+
+  if (compressed)
+    {
+      append_uint32 (w->textures, TEXTURE_ZLIB);
+      append_uint32 (w->textures, g_bytes_get_size (compressed));
+      append_data (w->textures, g_bytes_get_data (compressed, NULL), g_bytes_get_size (compressed));
+      g_bytes_unref (compressed);
+    }
+  else
+    {
+      append_uint32 (w->textures, TEXTURE_RAW);
+      append_uint32 (w->textures, size);
+      append_data (w->textures, pixels, size);
+    }
+
+  g_free (packed);
+
+  return w->n_textures++;
+}
+
+static guint32
+writer_add_texture (Writer     *w,
+                    GdkTexture *texture)
+{
+  int width, height;
+  guint index;
+
+  index = GPOINTER_TO_UINT (g_hash_table_lookup (w->texture_indices, texture));
+  if (index != 0)
+    return index - 1;
+
+  width = gdk_texture_get_width (texture);
+  height = gdk_texture_get_height (texture);
+
+  if (GDK_IS_MEMORY_TEXTURE (texture))
+    {
+      GdkMemoryTexture *memory = GDK_MEMORY_TEXTURE (texture);
+
+      /* Keep the format, so neither saving nor loading has to convert */
+      index = writer_add_pixels (w, width, height,
+                                 gdk_memory_texture_get_format (memory),
+                                 gdk_memory_texture_get_data (memory),
+                                 gdk_memory_texture_get_stride (memory));
+    }
+  else
+    {
+      guchar *data;
+
+      data = g_malloc (width * height * 4);
+      gdk_texture_download (texture, data, width * 4);
+      index = writer_add_pixels (w, width, height, GDK_MEMORY_DEFAULT, data, width * 4);
+      g_free (data);
+    }
+
+  g_hash_table_insert (w->texture_indices, texture, GUINT_TO_POINTER (index + 1));
+
+  return index;
+}
+
+static guint32
+writer_add_cairo_surface (Writer        *w,
+                          GskRenderNode *node)
+{
+  cairo_surface_t *surface, *image;
+  cairo_t *cr;
+  int x, y, width, height;
+  guint32 index;
+
+  surface = gsk_cairo_node_get_surface (node);
+  if (surface == NULL)
+    return NO_INDEX;
+
+  /* Rasterize on the pixel grid, so loading only needs to
+   * translate by whole pixels.
+   */
+  x = floorf (node->bounds.origin.x);
+  y = floorf (node->bounds.origin.y);
+  width = ceilf (node->bounds.origin.x + node->bounds.size.width) - x;
+  height = ceilf (node->bounds.origin.y + node->bounds.size.height) - y;
+  if (width <= 0 || height <= 0)
+    return NO_INDEX;
+
+  image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cr = cairo_create (image);
+  cairo_set_source_surface (cr, surface, -x, -y);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+  cairo_surface_flush (image);
+
+  index = writer_add_pixels (w, width, height, GDK_MEMORY_CAIRO_FORMAT_ARGB32,
+                             cairo_image_surface_get_data (image),
+                             cairo_image_surface_get_stride (image));
+
+  cairo_surface_destroy (image);
+
+  return index;
+}
+
+static void
+write_transform (Writer       *w,
+                 GskTransform *transform)
+{
+  char *string;
+
+  /* Translations are by far the most common transforms, so
+   * avoid having to parse them when loading.
+   */
+  if (gsk_transform_get_category (transform) >= GSK_TRANSFORM_CATEGORY_2D_TRANSLATE)
+    {
+      GskTransform *translate;
+      float dx, dy;
+      gboolean equal;
+
+      gsk_transform_to_translate (transform, &dx, &dy);
+      translate = gsk_transform_translate (NULL, &GRAPHENE_POINT_INIT (dx, dy));
+      equal = gsk_transform_equal (transform, translate);
+      gsk_transform_unref (translate);
+
+      if (equal)
+        {
+          write_uint32 (w, TRANSFORM_TRANSLATE);
+          write_float (w, dx);
+          write_float (w, dy);
+          return;
+        }
+    }
+
+  string = gsk_transform_to_string (transform);
+  write_uint32 (w, TRANSFORM_STRING);
+  write_uint32 (w, writer_add_string (w, string));
+  g_free (string);
+}
+
+static void
+write_node (Writer        *w,
+            GskRenderNode *node)
+{
+  GskRenderNodeType type = gsk_render_node_get_node_type (node);
+
+  write_uint32 (w, type);
+
+  switch (type)
+    {
+    case GSK_CONTAINER_NODE:
+      {
+        guint i, n = gsk_container_node_get_n_children (node);
+
+        write_uint32 (w, n);
+        for (i = 0; i < n; i++)
+          write_node (w, gsk_container_node_get_child (node, i));
+      }
+      break;
+
+    case GSK_CAIRO_NODE:
+      write_rect (w, &node->bounds);
+      write_uint32 (w, writer_add_cairo_surface (w, node));
+      break;
+
+    case GSK_COLOR_NODE:
+      write_rect (w, &node->bounds);
+      write_rgba (w, gsk_color_node_get_color (node));
+      break;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      write_rect (w, &node->bounds);
+      write_point (w, gsk_linear_gradient_node_get_start (node));
+      write_point (w, gsk_linear_gradient_node_get_end (node));
+      write_stops (w, gsk_linear_gradient_node_get_color_stops (node, NULL),
+                      gsk_linear_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+      write_rect (w, &node->bounds);
+      write_point (w, gsk_radial_gradient_node_get_center (node));
+      write_float (w, gsk_radial_gradient_node_get_hradius (node));
+      write_float (w, gsk_radial_gradient_node_get_vradius (node));
+      write_float (w, gsk_radial_gradient_node_get_start (node));
+      write_float (w, gsk_radial_gradient_node_get_end (node));
+      write_stops (w, gsk_radial_gradient_node_get_color_stops (node, NULL),
+                      gsk_radial_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_CONIC_GRADIENT_NODE:
+      write_rect (w, &node->bounds);
+      write_point (w, gsk_conic_gradient_node_get_center (node));
+      write_float (w, gsk_conic_gradient_node_get_rotation (node));
+      write_stops (w, gsk_conic_gradient_node_get_color_stops (node, NULL),
+                      gsk_conic_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        const float *widths = gsk_border_node_get_widths (node);
+        const GdkRGBA *colors = gsk_border_node_get_colors (node);
+        guint i;
+
+        write_rounded_rect (w, gsk_border_node_get_outline (node));
+        for (i = 0; i < 4; i++)
+          write_float (w, widths[i]);
+        for (i = 0; i < 4; i++)
+          write_rgba (w, &colors[i]);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      write_rect (w, &node->bounds);
+      write_uint32 (w, writer_add_texture (w, gsk_texture_node_get_texture (node)));
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+      write_rounded_rect (w, gsk_inset_shadow_node_get_outline (node));
+      write_rgba (w, gsk_inset_shadow_node_get_color (node));
+      write_float (w, gsk_inset_shadow_node_get_dx (node));
+      write_float (w, gsk_inset_shadow_node_get_dy (node));
+      write_float (w, gsk_inset_shadow_node_get_spread (node));
+      write_float (w, gsk_inset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      write_rounded_rect (w, gsk_outset_shadow_node_get_outline (node));
+      write_rgba (w, gsk_outset_shadow_node_get_color (node));
+      write_float (w, gsk_outset_shadow_node_get_dx (node));
+      write_float (w, gsk_outset_shadow_node_get_dy (node));
+      write_float (w, gsk_outset_shadow_node_get_spread (node));
+      write_float (w, gsk_outset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      write_transform (w, gsk_transform_node_get_transform (node));
+      write_node (w, gsk_transform_node_get_child (node));
+      break;
+
+    case GSK_OPACITY_NODE:
+      write_float (w, gsk_opacity_node_get_opacity (node));
+      write_node (w, gsk_opacity_node_get_child (node));
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        float values[16];
+        guint i;
+
+        graphene_matrix_to_float (gsk_color_matrix_node_get_color_matrix (node), values);
+        for (i = 0; i < 16; i++)
+          write_float (w, values[i]);
+        graphene_vec4_to_float (gsk_color_matrix_node_get_color_offset (node), values);
+        for (i = 0; i < 4; i++)
+          write_float (w, values[i]);
+        write_node (w, gsk_color_matrix_node_get_child (node));
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      write_rect (w, &node->bounds);
+      write_rect (w, gsk_repeat_node_get_child_bounds (node));
+      write_node (w, gsk_repeat_node_get_child (node));
+      break;
+
+    case GSK_CLIP_NODE:
+      write_rect (w, gsk_clip_node_get_clip (node));
+      write_node (w, gsk_clip_node_get_child (node));
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      write_rounded_rect (w, gsk_rounded_clip_node_get_clip (node));
+      write_node (w, gsk_rounded_clip_node_get_child (node));
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        gsize i, n = gsk_shadow_node_get_n_shadows (node);
+
+        write_uint32 (w, n);
+        for (i = 0; i < n; i++)
+          {
+            const GskShadow *shadow = gsk_shadow_node_get_shadow (node, i);
+
+            write_rgba (w, &shadow->color);
+            write_float (w, shadow->dx);
+            write_float (w, shadow->dy);
+            write_float (w, shadow->radius);
+          }
+        write_node (w, gsk_shadow_node_get_child (node));
+      }
+      break;
+
+    case GSK_BLEND_NODE:
+      write_uint32 (w, gsk_blend_node_get_blend_mode (node));
+      write_node (w, gsk_blend_node_get_bottom_child (node));
+      write_node (w, gsk_blend_node_get_top_child (node));
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      write_float (w, gsk_cross_fade_node_get_progress (node));
+      write_node (w, gsk_cross_fade_node_get_start_child (node));
+      write_node (w, gsk_cross_fade_node_get_end_child (node));
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        const PangoGlyphInfo *glyphs;
+        guint i, n;
+
+        glyphs = gsk_text_node_get_glyphs (node, &n);
+
+        write_uint32 (w, writer_add_font (w, gsk_text_node_get_font (node)));
+        write_rgba (w, gsk_text_node_get_color (node));
+        write_point (w, gsk_text_node_get_offset (node));
+        write_uint32 (w, n);
+        for (i = 0; i < n; i++)
+          {
+            write_uint32 (w, glyphs[i].glyph);
+            write_uint32 (w, glyphs[i].geometry.width);
+            write_uint32 (w, glyphs[i].geometry.x_offset);
+            write_uint32 (w, glyphs[i].geometry.y_offset);
+            write_uint32 (w, glyphs[i].attr.is_cluster_start);
+          }
+      }
+      break;
+
+    case GSK_BLUR_NODE:
+      write_float (w, gsk_blur_node_get_radius (node));
+      write_node (w, gsk_blur_node_get_child (node));
+      break;
+
+    case GSK_DEBUG_NODE:
+      {
+        const char *message = gsk_debug_node_get_message (node);
+
+        write_uint32 (w, message ? writer_add_string (w, message) : NO_INDEX);
+        write_node (w, gsk_debug_node_get_child (node));
+      }
+      break;
+
+    case GSK_GL_SHADER_NODE:
+      {
+        GskGLShader *shader = gsk_gl_shader_node_get_shader (node);
+        GBytes *source = gsk_gl_shader_get_source (shader);
+        GBytes *args = gsk_gl_shader_node_get_args (node);
+        guint i, n = gsk_gl_shader_node_get_n_children (node);
+        char *sourcecode;
+
+        /* Ensure we are zero-terminated */
+        sourcecode = g_strndup (g_bytes_get_data (source, NULL), g_bytes_get_size (source));
+
+        write_rect (w, &node->bounds);
+        write_uint32 (w, writer_add_string (w, sourcecode));
+        if (args)
+          {
+            write_uint32 (w, g_bytes_get_size (args));
+            append_data (w->nodes, g_bytes_get_data (args, NULL), g_bytes_get_size (args));
+          }
+        else
+          {
+            write_uint32 (w, 0);
+          }
+        write_uint32 (w, n);
+        for (i = 0; i < n; i++)
+          write_node (w, gsk_gl_shader_node_get_child (node, i));
+
+        g_free (sourcecode);
+      }
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_error ("Unhandled node: %s", g_type_name_from_instance ((GTypeInstance *) node));
+      break;
+    }
+}
+
+static void
+append_section (GByteArray   *array,
+                const guchar *data,
+                gsize         size)
+{
+  append_uint32 (array, size);
+  g_byte_array_append (array, data, size);
+}
+
+/**
+ * gsk_render_node_serialize_binary:
+ * @node: a #GskRenderNode
+ *
+ * Serializes the @node like gsk_render_node_serialize(), but in a compact
+ * binary format instead of the textual one.
+ *
+ * The result is much faster to save and to load, in particular if the
+ * nodes contain textures. gsk_render_node_deserialize() recognizes this
+ * format automatically. If the data is loaded from a mapped file, the
+ * loaded textures will refer to the file's contents instead of copying
+ * them.
+ *
+ * The same caveats as for gsk_render_node_serialize() apply: this is not
+ * meant as a permanent storage format.
+ *
+ * Returns: a #GBytes representing the node.
+ *
+ * Since: 4.2
+ **/
+GBytes *
+gsk_render_node_serialize_binary (GskRenderNode *node)
+{
+  GByteArray *result, *section;
+  Writer w;
+  guint i;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE (node), NULL);
+
+  writer_init (&w);
+  write_node (&w, node);
+
+  result = g_byte_array_sized_new (64 + w.textures->len + w.nodes->len);
+  g_byte_array_append (result, (const guint8 *) BINARY_MAGIC, 4);
+  append_uint32 (result, BINARY_VERSION);
+  append_uint32 (result, 0); /* flags */
+
+  section = g_byte_array_new ();
+  append_uint32 (section, w.strings->len);
+  for (i = 0; i < w.strings->len; i++)
+    {
+      const char *string = g_ptr_array_index (w.strings, i);
+      gsize len = strlen (string);
+
+      append_uint32 (section, len);
+      append_data (section, (const guchar *) string, len + 1);
+    }
+  append_section (result, section->data, section->len);
+
+  g_byte_array_set_size (section, 0);
+  append_uint32 (section, w.fonts->len);
+  for (i = 0; i < w.fonts->len; i++)
+    append_uint32 (section, g_array_index (w.fonts, guint32, i));
+  append_section (result, section->data, section->len);
+
+  append_uint32 (result, 4 + w.textures->len);
+  append_uint32 (result, w.n_textures);
+  g_byte_array_append (result, w.textures->data, w.textures->len);
+
+  append_section (result, w.nodes->data, w.nodes->len);
+
+  g_byte_array_unref (section);
+  writer_finish (&w);
+
+  return g_byte_array_free_to_bytes (result);
+}
+
+/*** READING ***/
+
+typedef struct
+{
+  const char *string;
+  gsize length;
+} StringEntry;
+
+typedef struct
+{
+  guint32 width;
+  guint32 height;
+  guint32 format;
+  guint32 stride;
+  guint32 encoding;
+  gsize offset;
+  gsize size;
+  GdkTexture *texture;
+} TextureEntry;
+
+typedef struct
+{
+  GBytes *bytes;
+  const guchar *data;
+  gsize pos;
+  gsize end;
+  gboolean failed;
+  guint depth;
+
+  GskParseErrorFunc error_func;
+  gpointer user_data;
+
+  GArray *strings;
+  GArray *fonts;
+  PangoFont **font_cache;
+  GArray *textures;
+  GHashTable *transforms;       /* string index + 1 => GskTransform */
+  GHashTable *shaders;          /* string index + 1 => GskGLShader */
+
+  PangoFontMap *font_map;
+  PangoContext *context;
+} Reader;
+
+static void
+clear_texture_entry (gpointer data)
+{
+  TextureEntry *entry = data;
+
+  g_clear_object (&entry->texture);
+}
+
+static void
+reader_init (Reader            *r,
+             GBytes            *bytes,
+             GskParseErrorFunc  error_func,
+             gpointer           user_data)
+{
+  gsize size;
+
+  memset (r, 0, sizeof (Reader));
+
+  r->bytes = bytes;
+  r->data = g_bytes_get_data (bytes, &size);
+  r->end = size;
+  r->error_func = error_func;
+  r->user_data = user_data;
+
+  r->strings = g_array_new (FALSE, FALSE, sizeof (StringEntry));
+  r->fonts = g_array_new (FALSE, FALSE, sizeof (guint32));
+  r->textures = g_array_new (FALSE, FALSE, sizeof (TextureEntry));
+  g_array_set_clear_func (r->textures, clear_texture_entry);
+  r->transforms = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) gsk_transform_unref);
+  r->shaders = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+}
+
+static void
+reader_finish (Reader *r)
+{
+  guint i;
+
+  if (r->font_cache)
+    {
+      for (i = 0; i < r->fonts->len; i++)
+        g_clear_object (&r->font_cache[i]);
+      g_free (r->font_cache);
+    }
+
+  g_array_unref (r->strings);
+  g_array_unref (r->fonts);
+  g_array_unref (r->textures);
+  g_hash_table_unref (r->transforms);
+  g_hash_table_unref (r->shaders);
+
+  g_clear_object (&r->context);
+}
+
+static void G_GNUC_PRINTF (3, 4)
+reader_error (Reader     *r,
+              int         code,
+              const char *format,
+              ...)
+{
+  GskParseLocation location;
+  GError *error;
+  va_list args;
+
+  /* Only report the first error, everything after it is garbage */
+  if (r->failed)
+    return;
+
+  r->failed = TRUE;
+
+  if (r->error_func == NULL)
+    return;
+
+  location.bytes = r->pos;
+  location.chars = r->pos;
+  location.lines = 0;
+  location.line_bytes = r->pos;
+  location.line_chars = r->pos;
+
+  va_start (args, format);
+  error = g_error_new_valist (GSK_SERIALIZATION_ERROR, code, format, args);
+  va_end (args);
+
+  r->error_func (&location, &location, error, r->user_data);
+
+  g_error_free (error);
+}
+
+static guint32
+read_uint32 (Reader *r)
+{
+  guint32 value;
+
+  if (r->failed)
+    return 0;
+
+  if (r->end - r->pos < sizeof (guint32))
+    {
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Unexpected end of data");
+      return 0;
+    }
+
+  memcpy (&value, r->data + r->pos, sizeof (guint32));
+  r->pos += sizeof (guint32);
+
+  return GUINT32_FROM_LE (value);
+}
+
+static float
+read_float (Reader *r)
+{
+  union {
+    guint32 u;
+    float f;
+  } u = { read_uint32 (r) };
+
+  return u.f;
+}
+
+static void
+read_floats (Reader *r,
+             float  *values,
+             guint   n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    values[i] = read_float (r);
+}
+
+/* Returns the offset of the data */
+static gsize
+read_data (Reader *r,
+           gsize   size)
+{
+  gsize offset, padded;
+
+  if (r->failed)
+    return 0;
+
+  padded = size + (4 - size % 4) % 4;
+  if (padded < size || r->end - r->pos < padded)
+    {
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Unexpected end of data");
+      return 0;
+    }
+
+  offset = r->pos;
+  r->pos += padded;
+
+  return offset;
+}
+
+static void
+read_point (Reader           *r,
+            graphene_point_t *point)
+{
+  point->x = read_float (r);
+  point->y = read_float (r);
+}
+
+static void
+read_rect (Reader          *r,
+           graphene_rect_t *rect)
+{
+  float values[4];
+
+  read_floats (r, values, 4);
+  graphene_rect_init (rect, values[0], values[1], values[2], values[3]);
+}
+
+static void
+read_rounded_rect (Reader         *r,
+                   GskRoundedRect *rect)
+{
+  guint i;
+
+  read_rect (r, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      rect->corner[i].width = read_float (r);
+      rect->corner[i].height = read_float (r);
+    }
+}
+
+static void
+read_rgba (Reader  *r,
+           GdkRGBA *rgba)
+{
+  rgba->red = read_float (r);
+  rgba->green = read_float (r);
+  rgba->blue = read_float (r);
+  rgba->alpha = read_float (r);
+}
+
+/* Checks that @n items of at least @item_size bytes can still follow */
+static gboolean
+check_count (Reader *r,
+             guint32 n,
+             gsize   item_size)
+{
+  if (r->failed)
+    return FALSE;
+
+  if (n > (r->end - r->pos) / item_size)
+    {
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Invalid number of items: %u", n);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static GskColorStop *
+read_stops (Reader *r,
+            gsize  *n_stops)
+{
+  GskColorStop *stops;
+  guint32 i, n;
+
+  n = read_uint32 (r);
+  if (!check_count (r, n, 5 * sizeof (float)))
+    return NULL;
+
+  if (n < 2)
+    {
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Gradients need at least 2 color stops");
+      return NULL;
+    }
+
+  stops = g_new (GskColorStop, n);
+  for (i = 0; i < n; i++)
+    {
+      stops[i].offset = read_float (r);
+      read_rgba (r, &stops[i].color);
+
+      if (!r->failed &&
+          (stops[i].offset < (i > 0 ? stops[i - 1].offset : 0.f) || stops[i].offset > 1.f))
+        reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Color stop offsets must be increasing");
+    }
+
+  if (r->failed)
+    {
+      g_free (stops);
+      return NULL;
+    }
+
+  *n_stops = n;
+
+  return stops;
+}
+
+static const StringEntry *
+reader_get_string (Reader  *r,
+                   guint32  index)
+{
+  if (r->failed)
+    return NULL;
+
+  if (index >= r->strings->len)
+    {
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Invalid string index %u", index);
+      return NULL;
+    }
+
+  return &g_array_index (r->strings, StringEntry, index);
+}
+
+static PangoFont *
+reader_get_font (Reader  *r,
+                 guint32  index)
+{
+  if (r->failed)
+    return NULL;
+
+  if (index >= r->fonts->len)
+    {
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Invalid font index %u", index);
+      return NULL;
+    }
+
+  if (r->font_cache == NULL)
+    r->font_cache = g_new0 (PangoFont *, r->fonts->len);
+
+  if (r->font_cache[index] == NULL)
+    {
+      const StringEntry *name;
+      PangoFontDescription *desc;
+
+      name = &g_array_index (r->strings, StringEntry, g_array_index (r->fonts, guint32, index));
+
+      if (r->context == NULL)
+        {
+          r->font_map = pango_cairo_font_map_get_default ();
+          r->context = pango_font_map_create_context (r->font_map);
+        }
+
+      desc = pango_font_description_from_string (name->string);
+      r->font_cache[index] = pango_font_map_load_font (r->font_map, r->context, desc);
+      pango_font_description_free (desc);
+
+      if (r->font_cache[index] == NULL)
+        {
+          reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "The font \"%s\" does not exist", name->string);
+          return NULL;
+        }
+    }
+
+  return r->font_cache[index];
+}
+
+/* Slices keep all of the input alive, so small ones are copied */
+static GBytes *
+reader_get_bytes (Reader *r,
+                  gsize   offset,
+                  gsize   size)
+{
+  if (size < g_bytes_get_size (r->bytes) / 2)
+    return g_bytes_new (r->data + offset, size);
+
+  return g_bytes_new_from_bytes (r->bytes, offset, size);
+}
+
+static GBytes *
+decompress_pixels (const guchar *data,
+                   gsize         size,
+                   gsize         expected_size)
+{
+  GConverter *decompressor;
+  GConverterResult result;
+  gsize in_pos, out_pos, bytes_read, bytes_written;
+  guchar *out;
+
+  /* One byte of slack, so the decompressor always has room to
+   * report the end of the stream.
+   */
+  out = g_malloc (expected_size + 1);
+  decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB));
+  in_pos = out_pos = 0;
+
+  do
+    {
+      result = g_converter_convert (decompressor,
+                                    data + in_pos, size - in_pos,
+                                    out + out_pos, expected_size + 1 - out_pos,
+                                    G_CONVERTER_INPUT_AT_END,
+                                    &bytes_read, &bytes_written,
+                                    NULL);
+      in_pos += bytes_read;
+      out_pos += bytes_written;
+    }
+  while (result == G_CONVERTER_CONVERTED && out_pos <= expected_size);
+
+  g_object_unref (decompressor);
+
+  if (result != G_CONVERTER_FINISHED || out_pos != expected_size)
+    {
+      g_free (out);
+      return NULL;
+    }
+
+  return g_bytes_new_take (out, expected_size);
+}
+
+static GdkTexture *
+reader_get_texture (Reader  *r,
+                    guint32  index)
+{
+  TextureEntry *entry;
+
+  if (r->failed)
+    return NULL;
+
+  if (index >= r->textures->len)
+    {
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Invalid texture index %u", index);
+      return NULL;
+    }
+
+  entry = &g_array_index (r->textures, TextureEntry, index);
+  if (entry->texture == NULL)
+    {
+      GBytes *pixels;
+
+      if (entry->encoding == TEXTURE_RAW)
+        {
+          pixels = reader_get_bytes (r, entry->offset, entry->size);
+        }
+      else
+        {
+          pixels = decompress_pixels (r->data + entry->offset, entry->size,
+                                      (gsize) entry->stride * entry->height);
+          if (pixels == NULL)
+            {
+              reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Invalid compressed data for texture %u", index);
+              return NULL;
+            }
+        }
+
+      entry->texture = gdk_memory_texture_new (entry->width, entry->height,
+                                               entry->format,
+                                               pixels,
+                                               entry->stride);
+      g_bytes_unref (pixels);
+    }
+
+  return entry->texture;
+}
+
+static GskGLShader *
+reader_get_shader (Reader  *r,
+                   guint32  index)
+{
+  const StringEntry *source;
+  GskGLShader *shader;
+
+  source = reader_get_string (r, index);
+  if (source == NULL)
+    return NULL;
+
+  shader = g_hash_table_lookup (r->shaders, GUINT_TO_POINTER (index + 1));
+  if (shader == NULL)
+    {
+      GBytes *bytes;
+
+      bytes = reader_get_bytes (r, (const guchar *) source->string - r->data, source->length);
+      shader = gsk_gl_shader_new_from_bytes (bytes);
+      g_bytes_unref (bytes);
+
+      g_hash_table_insert (r->shaders, GUINT_TO_POINTER (index + 1), shader);
+    }
+
+  return shader;
+}
+
+static GskTransform *
+read_transform (Reader *r)
+{
+  guint32 encoding;
+
+  encoding = read_uint32 (r);
+  if (r->failed)
+    return NULL;
+
+  switch (encoding)
+    {
+    case TRANSFORM_TRANSLATE:
+      {
+        graphene_point_t offset;
+
+        read_point (r, &offset);
+        if (r->failed)
+          return NULL;
+
+        return gsk_transform_translate (NULL, &offset);
+      }
+
+    case TRANSFORM_STRING:
+      {
+        guint32 index = read_uint32 (r);
+        const StringEntry *string;
+        GskTransform *transform;
+
+        string = reader_get_string (r, index);
+        if (string == NULL)
+          return NULL;
+
+        /* Parse each string only once */
+        if (g_hash_table_lookup_extended (r->transforms, GUINT_TO_POINTER (index + 1),
+                                          NULL, (gpointer *) &transform))
+          return gsk_transform_ref (transform);
+
+        if (!gsk_transform_parse (string->string, &transform))
+          {
+            reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Invalid transform \"%s\"", string->string);
+            return NULL;
+          }
+
+        g_hash_table_insert (r->transforms, GUINT_TO_POINTER (index + 1), gsk_transform_ref (transform));
+
+        return transform;
+      }
+
+    default:
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Unknown transform encoding %u", encoding);
+      return NULL;
+    }
+}
+
+static GskRenderNode *read_node (Reader *r);
+
+static gboolean
+read_children (Reader         *r,
+               guint           n,
+               GskRenderNode **children)
+{
+  guint i;
+
+  if (r->failed)
+    return FALSE;
+
+  for (i = 0; i < n; i++)
+    {
+      children[i] = read_node (r);
+      if (children[i] == NULL)
+        {
+          while (i > 0)
+            gsk_render_node_unref (children[--i]);
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static void
+clear_children (GskRenderNode **children,
+                guint           n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    gsk_render_node_unref (children[i]);
+}
+
+static GskRenderNode *
+read_node_contents (Reader *r)
+{
+  GskRenderNodeType type;
+  GskRenderNode *node = NULL;
+  GskRenderNode *child[2];
+
+  type = read_uint32 (r);
+  if (r->failed)
+    return NULL;
+
+  switch (type)
+    {
+    case GSK_CONTAINER_NODE:
+      {
+        GskRenderNode **children;
+        guint32 n;
+
+        n = read_uint32 (r);
+        if (!check_count (r, n, sizeof (guint32)))
+          return NULL;
+
+        children = g_new (GskRenderNode *, MAX (n, 1));
+        if (read_children (r, n, children))
+          {
+            node = gsk_container_node_new (children, n);
+            clear_children (children, n);
+          }
+        g_free (children);
+      }
+      break;
+
+    case GSK_CAIRO_NODE:
+      {
+        graphene_rect_t bounds;
+        guint32 index;
+
+        read_rect (r, &bounds);
+        index = read_uint32 (r);
+        if (r->failed)
+          return NULL;
+
+        if (index != NO_INDEX)
+          {
+            GdkTexture *texture = reader_get_texture (r, index);
+            cairo_surface_t *surface;
+            cairo_t *cr;
+
+            if (texture == NULL)
+              return NULL;
+
+            node = gsk_cairo_node_new (&bounds);
+            surface = gdk_texture_download_surface (texture);
+            cr = gsk_cairo_node_get_draw_context (node);
+            cairo_set_source_surface (cr, surface, floorf (bounds.origin.x), floorf (bounds.origin.y));
+            cairo_paint (cr);
+            cairo_destroy (cr);
+            cairo_surface_destroy (surface);
+          }
+        else
+          {
+            node = gsk_cairo_node_new (&bounds);
+          }
+      }
+      break;
+
+    case GSK_COLOR_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkRGBA color;
+
+        read_rect (r, &bounds);
+        read_rgba (r, &color);
+        if (!r->failed)
+          node = gsk_color_node_new (&color, &bounds);
+      }
+      break;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t start, end;
+        GskColorStop *stops;
+        gsize n_stops;
+
+        read_rect (r, &bounds);
+        read_point (r, &start);
+        read_point (r, &end);
+        stops = read_stops (r, &n_stops);
+        if (stops == NULL)
+          return NULL;
+
+        if (type == GSK_LINEAR_GRADIENT_NODE)
+          node = gsk_linear_gradient_node_new (&bounds, &start, &end, stops, n_stops);
+        else
+          node = gsk_repeating_linear_gradient_node_new (&bounds, &start, &end, stops, n_stops);
+        g_free (stops);
+      }
+      break;
+
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t center;
+        float values[4];
+        GskColorStop *stops;
+        gsize n_stops;
+
+        read_rect (r, &bounds);
+        read_point (r, &center);
+        read_floats (r, values, 4);
+        stops = read_stops (r, &n_stops);
+        if (stops == NULL)
+          return NULL;
+
+        if (type == GSK_RADIAL_GRADIENT_NODE)
+          node = gsk_radial_gradient_node_new (&bounds, &center,
+                                               values[0], values[1], values[2], values[3],
+                                               stops, n_stops);
+        else
+          node = gsk_repeating_radial_gradient_node_new (&bounds, &center,
+                                                         values[0], values[1], values[2], values[3],
+                                                         stops, n_stops);
+        g_free (stops);
+      }
+      break;
+
+    case GSK_CONIC_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t center;
+        float rotation;
+        GskColorStop *stops;
+        gsize n_stops;
+
+        read_rect (r, &bounds);
+        read_point (r, &center);
+        rotation = read_float (r);
+        stops = read_stops (r, &n_stops);
+        if (stops == NULL)
+          return NULL;
+
+        node = gsk_conic_gradient_node_new (&bounds, &center, rotation, stops, n_stops);
+        g_free (stops);
+      }
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        GskRoundedRect outline;
+        float widths[4];
+        GdkRGBA colors[4];
+        guint i;
+
+        read_rounded_rect (r, &outline);
+        read_floats (r, widths, 4);
+        for (i = 0; i < 4; i++)
+          read_rgba (r, &colors[i]);
+        if (!r->failed)
+          node = gsk_border_node_new (&outline, widths, colors);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkTexture *texture;
+
+        read_rect (r, &bounds);
+        texture = reader_get_texture (r, read_uint32 (r));
+        if (texture)
+          node = gsk_texture_node_new (texture, &bounds);
+      }
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+      {
+        GskRoundedRect outline;
+        GdkRGBA color;
+        float values[4];
+
+        read_rounded_rect (r, &outline);
+        read_rgba (r, &color);
+        read_floats (r, values, 4);
+        if (r->failed)
+          return NULL;
+
+        if (type == GSK_INSET_SHADOW_NODE)
+          node = gsk_inset_shadow_node_new (&outline, &color, values[0], values[1], values[2], values[3]);
+        else
+          node = gsk_outset_shadow_node_new (&outline, &color, values[0], values[1], values[2], values[3]);
+      }
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskTransform *transform;
+
+        transform = read_transform (r);
+        if (r->failed || !read_children (r, 1, child))
+          {
+            gsk_transform_unref (transform);
+            return NULL;
+          }
+
+        if (transform == NULL)
+          transform = gsk_transform_new ();
+
+        node = gsk_transform_node_new (child[0], transform);
+        gsk_transform_unref (transform);
+        clear_children (child, 1);
+      }
+      break;
+
+    case GSK_OPACITY_NODE:
+      {
+        float opacity = read_float (r);
+
+        if (read_children (r, 1, child))
+          {
+            node = gsk_opacity_node_new (child[0], opacity);
+            clear_children (child, 1);
+          }
+      }
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        float values[16];
+        graphene_matrix_t matrix;
+        graphene_vec4_t offset;
+
+        read_floats (r, values, 16);
+        graphene_matrix_init_from_float (&matrix, values);
+        read_floats (r, values, 4);
+        graphene_vec4_init_from_float (&offset, values);
+
+        if (read_children (r, 1, child))
+          {
+            node = gsk_color_matrix_node_new (child[0], &matrix, &offset);
+            clear_children (child, 1);
+          }
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      {
+        graphene_rect_t bounds, child_bounds;
+
+        read_rect (r, &bounds);
+        read_rect (r, &child_bounds);
+
+        if (read_children (r, 1, child))
+          {
+            node = gsk_repeat_node_new (&bounds, child[0], &child_bounds);
+            clear_children (child, 1);
+          }
+      }
+      break;
+
+    case GSK_CLIP_NODE:
+      {
+        graphene_rect_t clip;
+
+        read_rect (r, &clip);
+
+        if (read_children (r, 1, child))
+          {
+            node = gsk_clip_node_new (child[0], &clip);
+            clear_children (child, 1);
+          }
+      }
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      {
+        GskRoundedRect clip;
+
+        read_rounded_rect (r, &clip);
+
+        if (read_children (r, 1, child))
+          {
+            node = gsk_rounded_clip_node_new (child[0], &clip);
+            clear_children (child, 1);
+          }
+      }
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        GskShadow *shadows;
+        guint32 i, n;
+
+        n = read_uint32 (r);
+        if (!check_count (r, n, 7 * sizeof (float)))
+          return NULL;
+
+        if (n == 0)
+          {
+            reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Shadow nodes need at least one shadow");
+            return NULL;
+          }
+
+        shadows = g_new (GskShadow, n);
+        for (i = 0; i < n; i++)
+          {
+            read_rgba (r, &shadows[i].color);
+            shadows[i].dx = read_float (r);
+            shadows[i].dy = read_float (r);
+            shadows[i].radius = read_float (r);
+          }
+
+        if (read_children (r, 1, child))
+          {
+            node = gsk_shadow_node_new (child[0], shadows, n);
+            clear_children (child, 1);
+          }
+        g_free (shadows);
+      }
+      break;
+
+    case GSK_BLEND_NODE:
+      {
+        guint32 mode = read_uint32 (r);
+
+        if (!r->failed && mode > GSK_BLEND_MODE_LUMINOSITY)
+          {
+            reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Unknown blend mode %u", mode);
+            return NULL;
+          }
+
+        if (read_children (r, 2, child))
+          {
+            node = gsk_blend_node_new (child[0], child[1], (GskBlendMode) mode);
+            clear_children (child, 2);
+          }
+      }
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      {
+        float progress = read_float (r);
+
+        if (read_children (r, 2, child))
+          {
+            node = gsk_cross_fade_node_new (child[0], child[1], progress);
+            clear_children (child, 2);
+          }
+      }
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        PangoFont *font;
+        PangoGlyphString *glyphs;
+        graphene_point_t offset;
+        GdkRGBA color;
+        guint32 i, n;
+
+        font = reader_get_font (r, read_uint32 (r));
+        read_rgba (r, &color);
+        read_point (r, &offset);
+        n = read_uint32 (r);
+        if (!check_count (r, n, 5 * sizeof (guint32)))
+          return NULL;
+
+        if (font == NULL)
+          return NULL;
+
+        glyphs = pango_glyph_string_new ();
+        pango_glyph_string_set_size (glyphs, n);
+        for (i = 0; i < n; i++)
+          {
+            PangoGlyphInfo *gi = &glyphs->glyphs[i];
+
+            gi->glyph = read_uint32 (r);
+            gi->geometry.width = (gint32) read_uint32 (r);
+            gi->geometry.x_offset = (gint32) read_uint32 (r);
+            gi->geometry.y_offset = (gint32) read_uint32 (r);
+            gi->attr.is_cluster_start = read_uint32 (r) != 0;
+          }
+
+        node = gsk_text_node_new (font, glyphs, &color, &offset);
+        pango_glyph_string_free (glyphs);
+
+        /* Glyphs without ink don't produce a node, but they
+         * are not an error either.
+         */
+        if (node == NULL)
+          node = gsk_container_node_new (NULL, 0);
+      }
+      break;
+
+    case GSK_BLUR_NODE:
+      {
+        float radius = read_float (r);
+
+        if (read_children (r, 1, child))
+          {
+            node = gsk_blur_node_new (child[0], radius);
+            clear_children (child, 1);
+          }
+      }
+      break;
+
+    case GSK_DEBUG_NODE:
+      {
+        const StringEntry *message = NULL;
+        guint32 index;
+
+        index = read_uint32 (r);
+        if (index != NO_INDEX)
+          message = reader_get_string (r, index);
+
+        if (read_children (r, 1, child))
+          {
+            node = gsk_debug_node_new (child[0], message ? g_strdup (message->string) : NULL);
+            clear_children (child, 1);
+          }
+      }
+      break;
+
+    case GSK_GL_SHADER_NODE:
+      {
+        GskRenderNode *children[4];
+        graphene_rect_t bounds;
+        GskGLShader *shader;
+        GBytes *args;
+        guint32 args_size, n;
+        gsize offset;
+
+        read_rect (r, &bounds);
+        shader = reader_get_shader (r, read_uint32 (r));
+        args_size = read_uint32 (r);
+        offset = read_data (r, args_size);
+        n = read_uint32 (r);
+        if (r->failed)
+          return NULL;
+
+        if (args_size != gsk_gl_shader_get_args_size (shader) ||
+            n != (guint32) gsk_gl_shader_get_n_textures (shader))
+          {
+            reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Arguments don't match the shader");
+            return NULL;
+          }
+
+        if (read_children (r, n, children))
+          {
+            args = reader_get_bytes (r, offset, args_size);
+            node = gsk_gl_shader_node_new (shader, &bounds, args, n > 0 ? children : NULL, n);
+            g_bytes_unref (args);
+            clear_children (children, n);
+          }
+      }
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Unknown node type %u", type);
+      return NULL;
+    }
+
+  if (r->failed)
+    g_clear_pointer (&node, gsk_render_node_unref);
+
+  return node;
+}
+
+static GskRenderNode *
+read_node (Reader *r)
+{
+  GskRenderNode *node;
+
+  if (r->failed)
+    return NULL;
+
+  if (r->depth >= MAX_NODE_DEPTH)
+    {
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Nodes are nested more than %u levels deep", MAX_NODE_DEPTH);
+      return NULL;
+    }
+
+  r->depth++;
+  node = read_node_contents (r);
+  r->depth--;
+
+  return node;
+}
+
+/* Sets the end to the end of the section and returns the
+ * previous end, to be passed to end_section().
+ */
+static gsize
+begin_section (Reader *r)
+{
+  gsize end = r->end;
+  guint32 size;
+
+  size = read_uint32 (r);
+  if (r->failed)
+    return end;
+
+  if (size > r->end - r->pos)
+    {
+      reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Invalid section size");
+      return end;
+    }
+
+  r->end = r->pos + size;
+
+  return end;
+}
+
+static void
+end_section (Reader *r,
+             gsize   end)
+{
+  /* Skip anything we don't know about */
+  r->pos = r->end;
+  r->end = end;
+}
+
+static void
+read_strings (Reader *r)
+{
+  gsize end;
+  guint32 i, n;
+
+  end = begin_section (r);
+  n = read_uint32 (r);
+  if (check_count (r, n, 2 * sizeof (guint32)))
+    {
+      for (i = 0; i < n; i++)
+        {
+          StringEntry entry;
+          gsize offset;
+
+          entry.length = read_uint32 (r);
+          offset = read_data (r, entry.length + 1);
+          if (r->failed)
+            break;
+
+          entry.string = (const char *) r->data + offset;
+          if (entry.string[entry.length] != '\0')
+            {
+              reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "String %u is not terminated", i);
+              break;
+            }
+
+          g_array_append_val (r->strings, entry);
+        }
+    }
+  end_section (r, end);
+}
+
+static void
+read_fonts (Reader *r)
+{
+  gsize end;
+  guint32 i, n;
+
+  end = begin_section (r);
+  n = read_uint32 (r);
+  if (check_count (r, n, sizeof (guint32)))
+    {
+      for (i = 0; i < n; i++)
+        {
+          guint32 index = read_uint32 (r);
+
+          if (reader_get_string (r, index) == NULL)
+            break;
+
+          g_array_append_val (r->fonts, index);
+        }
+    }
+  end_section (r, end);
+}
+
+static void
+read_textures (Reader *r)
+{
+  gsize end;
+  guint32 i, n;
+
+  end = begin_section (r);
+  n = read_uint32 (r);
+  if (check_count (r, n, 6 * sizeof (guint32)))
+    {
+      for (i = 0; i < n; i++)
+        {
+          TextureEntry entry = { 0, };
+          guint64 min_stride, expected_size;
+
+          entry.width = read_uint32 (r);
+          entry.height = read_uint32 (r);
+          entry.format = read_uint32 (r);
+          entry.stride = read_uint32 (r);
+          entry.encoding = read_uint32 (r);
+          entry.size = read_uint32 (r);
+          entry.offset = read_data (r, entry.size);
+          if (r->failed)
+            break;
+
+          if (entry.width == 0 || entry.width > G_MAXINT ||
+              entry.height == 0 || entry.height > G_MAXINT ||
+              entry.format >= GDK_MEMORY_N_FORMATS)
+            {
+              reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Invalid size or format for texture %u", i);
+              break;
+            }
+
+          min_stride = (guint64) entry.width * gdk_memory_format_bytes_per_pixel (entry.format);
+          expected_size = (guint64) entry.stride * entry.height;
+          if (entry.stride < min_stride ||
+              expected_size > G_MAXSIZE ||
+              (entry.encoding == TEXTURE_RAW && entry.size != expected_size) ||
+              (entry.encoding == TEXTURE_ZLIB && expected_size > (guint64) entry.size * MAX_ZLIB_RATIO) ||
+              entry.encoding > TEXTURE_ZLIB)
+            {
+              reader_error (r, GSK_SERIALIZATION_INVALID_DATA, "Invalid data for texture %u", i);
+              break;
+            }
+
+          g_array_append_val (r->textures, entry);
+        }
+    }
+  end_section (r, end);
+}
+
+gboolean
+gsk_render_node_is_binary (GBytes *bytes)
+{
+  gsize size;
+  const guchar *data;
+
+  data = g_bytes_get_data (bytes, &size);
+
+  return size >= strlen (BINARY_MAGIC) &&
+         memcmp (data, BINARY_MAGIC, strlen (BINARY_MAGIC)) == 0;
+}
+
+GskRenderNode *
+gsk_render_node_deserialize_binary (GBytes            *bytes,
+                                    GskParseErrorFunc  error_func,
+                                    gpointer           user_data)
+{
+  GskRenderNode *root = NULL;
+  Reader r;
+  guint32 version;
+  gsize end;
+
+  reader_init (&r, bytes, error_func, user_data);
+
+  r.pos = strlen (BINARY_MAGIC);
+  version = read_uint32 (&r);
+  read_uint32 (&r); /* flags */
+  if (!r.failed && version != BINARY_VERSION)
+    reader_error (&r, GSK_SERIALIZATION_UNSUPPORTED_VERSION,
+                  "Unsupported version %u of the binary node format", version);
+
+  read_strings (&r);
+  read_fonts (&r);
+  read_textures (&r);
+
+  end = begin_section (&r);
+  root = read_node (&r);
+  end_section (&r, end);
+
+  reader_finish (&r);
+
+  return root;
+}
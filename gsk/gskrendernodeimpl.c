@@ -21,6 +21,7 @@
 #include "gskrendernodeprivate.h"
 
 #include "gskcairoblurprivate.h"
+#include "gskcairoshadowcacheprivate.h"
 #include "gskdebugprivate.h"
 #include "gskdiffprivate.h"
 #include "gskrendererprivate.h"
@@ -63,6 +64,25 @@ struct _GskColorNode
   GdkRGBA color;
 };
 
+static guint64
+gsk_color_node_hash (GskRenderNode *node,
+                     guint64        hash)
+{
+  GskColorNode *self = (GskColorNode *) node;
+
+  return gsk_hash_rgba (hash, &self->color);
+}
+
+static gboolean
+gsk_color_node_equal (GskRenderNode *node1,
+                      GskRenderNode *node2)
+{
+  GskColorNode *self1 = (GskColorNode *) node1;
+  GskColorNode *self2 = (GskColorNode *) node2;
+
+  return gdk_rgba_equal (&self1->color, &self2->color);
+}
+
 static void
 gsk_color_node_draw (GskRenderNode *node,
                      cairo_t       *cr)
@@ -172,6 +192,68 @@ gsk_linear_gradient_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_hash_color_stops (guint64             hash,
+                      const GskColorStop *stops,
+                      gsize               n_stops)
+{
+  gsize i;
+
+  hash = gsk_hash_uint64 (hash, n_stops);
+  for (i = 0; i < n_stops; i++)
+    {
+      hash = gsk_hash_float (hash, stops[i].offset);
+      hash = gsk_hash_rgba (hash, &stops[i].color);
+    }
+
+  return hash;
+}
+
+static gboolean
+gsk_color_stops_equal (const GskColorStop *stops1,
+                       gsize               n_stops1,
+                       const GskColorStop *stops2,
+                       gsize               n_stops2)
+{
+  gsize i;
+
+  if (n_stops1 != n_stops2)
+    return FALSE;
+
+  for (i = 0; i < n_stops1; i++)
+    {
+      if (stops1[i].offset != stops2[i].offset ||
+          !gdk_rgba_equal (&stops1[i].color, &stops2[i].color))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static guint64
+gsk_linear_gradient_node_hash (GskRenderNode *node,
+                               guint64        hash)
+{
+  GskLinearGradientNode *self = (GskLinearGradientNode *) node;
+
+  hash = gsk_hash_point (hash, &self->start);
+  hash = gsk_hash_point (hash, &self->end);
+  return gsk_hash_color_stops (hash, self->stops, self->n_stops);
+}
+
+static gboolean
+gsk_linear_gradient_node_equal (GskRenderNode *node1,
+                                GskRenderNode *node2)
+{
+  GskLinearGradientNode *self1 = (GskLinearGradientNode *) node1;
+  GskLinearGradientNode *self2 = (GskLinearGradientNode *) node2;
+
+  return graphene_point_equal (&self1->start, &self2->start) &&
+         graphene_point_equal (&self1->end, &self2->end) &&
+         gsk_color_stops_equal (self1->stops, self1->n_stops,
+                                self2->stops, self2->n_stops);
+}
+
 static void
 gsk_linear_gradient_node_draw (GskRenderNode *node,
                                cairo_t       *cr)
@@ -445,6 +527,36 @@ gsk_radial_gradient_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_radial_gradient_node_hash (GskRenderNode *node,
+                               guint64        hash)
+{
+  GskRadialGradientNode *self = (GskRadialGradientNode *) node;
+
+  hash = gsk_hash_point (hash, &self->center);
+  hash = gsk_hash_float (hash, self->hradius);
+  hash = gsk_hash_float (hash, self->vradius);
+  hash = gsk_hash_float (hash, self->start);
+  hash = gsk_hash_float (hash, self->end);
+  return gsk_hash_color_stops (hash, self->stops, self->n_stops);
+}
+
+static gboolean
+gsk_radial_gradient_node_equal (GskRenderNode *node1,
+                                GskRenderNode *node2)
+{
+  GskRadialGradientNode *self1 = (GskRadialGradientNode *) node1;
+  GskRadialGradientNode *self2 = (GskRadialGradientNode *) node2;
+
+  return graphene_point_equal (&self1->center, &self2->center) &&
+         self1->hradius == self2->hradius &&
+         self1->vradius == self2->vradius &&
+         self1->start == self2->start &&
+         self1->end == self2->end &&
+         gsk_color_stops_equal (self1->stops, self1->n_stops,
+                                self2->stops, self2->n_stops);
+}
+
 static void
 gsk_radial_gradient_node_draw (GskRenderNode *node,
                                cairo_t       *cr)
@@ -881,6 +993,30 @@ gdk_rgba_color_interpolate (GdkRGBA       *dest,
     }
 }
 
+static guint64
+gsk_conic_gradient_node_hash (GskRenderNode *node,
+                              guint64        hash)
+{
+  GskConicGradientNode *self = (GskConicGradientNode *) node;
+
+  hash = gsk_hash_point (hash, &self->center);
+  hash = gsk_hash_float (hash, self->rotation);
+  return gsk_hash_color_stops (hash, self->stops, self->n_stops);
+}
+
+static gboolean
+gsk_conic_gradient_node_equal (GskRenderNode *node1,
+                               GskRenderNode *node2)
+{
+  GskConicGradientNode *self1 = (GskConicGradientNode *) node1;
+  GskConicGradientNode *self2 = (GskConicGradientNode *) node2;
+
+  return graphene_point_equal (&self1->center, &self2->center) &&
+         self1->rotation == self2->rotation &&
+         gsk_color_stops_equal (self1->stops, self1->n_stops,
+                                self2->stops, self2->n_stops);
+}
+
 static void
 gsk_conic_gradient_node_draw (GskRenderNode *node,
                               cairo_t       *cr)
@@ -1163,6 +1299,43 @@ gsk_border_node_mesh_add_patch (cairo_pattern_t *pattern,
   cairo_mesh_pattern_end_patch (pattern);
 }
 
+static guint64
+gsk_border_node_hash (GskRenderNode *node,
+                      guint64        hash)
+{
+  GskBorderNode *self = (GskBorderNode *) node;
+  guint i;
+
+  hash = gsk_hash_rounded_rect (hash, &self->outline);
+  hash = gsk_hash_floats (hash, self->border_width, 4);
+  for (i = 0; i < 4; i++)
+    hash = gsk_hash_rgba (hash, &self->border_color[i]);
+
+  return hash;
+}
+
+static gboolean
+gsk_border_node_equal (GskRenderNode *node1,
+                       GskRenderNode *node2)
+{
+  GskBorderNode *self1 = (GskBorderNode *) node1;
+  GskBorderNode *self2 = (GskBorderNode *) node2;
+
+  guint i;
+
+  if (!gsk_rounded_rect_equal (&self1->outline, &self2->outline))
+    return FALSE;
+
+  for (i = 0; i < 4; i++)
+    {
+      if (self1->border_width[i] != self2->border_width[i] ||
+          !gdk_rgba_equal (&self1->border_color[i], &self2->border_color[i]))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 static void
 gsk_border_node_draw (GskRenderNode *node,
                        cairo_t       *cr)
@@ -1443,6 +1616,26 @@ gsk_texture_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_texture_node_hash (GskRenderNode *node,
+                       guint64        hash)
+{
+  GskTextureNode *self = (GskTextureNode *) node;
+
+  /* Textures are immutable */
+  return gsk_hash_pointer (hash, self->texture);
+}
+
+static gboolean
+gsk_texture_node_equal (GskRenderNode *node1,
+                        GskRenderNode *node2)
+{
+  GskTextureNode *self1 = (GskTextureNode *) node1;
+  GskTextureNode *self2 = (GskTextureNode *) node2;
+
+  return self1->texture == self2->texture;
+}
+
 static void
 gsk_texture_node_draw (GskRenderNode *node,
                        cairo_t       *cr)
@@ -1592,8 +1785,18 @@ draw_shadow (cairo_t              *cr,
 typedef struct {
   float radius;
   graphene_size_t corner;
+  /* How far the box edges are from whole pixels */
+  float x_offset;
+  float y_offset;
 } CornerMask;
 
+/* Masks for shadows at fractional positions are only reused while
+ * they stay at the same position, so don't let them pile up.
+ */
+#define MAX_CORNER_MASKS 256
+
+G_LOCK_DEFINE_STATIC (corner_mask_cache);
+
 typedef enum {
   TOP,
   RIGHT,
@@ -1606,7 +1809,9 @@ corner_mask_hash (CornerMask *mask)
 {
   return ((guint)mask->radius << 24) ^
     ((guint)(mask->corner.width*4)) << 12 ^
-    ((guint)(mask->corner.height*4)) << 0;
+    ((guint)(mask->corner.height*4)) << 0 ^
+    ((guint)(mask->x_offset*256)) << 16 ^
+    ((guint)(mask->y_offset*256)) << 4;
 }
 
 static gboolean
@@ -1616,7 +1821,9 @@ corner_mask_equal (CornerMask *mask1,
   return
     mask1->radius == mask2->radius &&
     mask1->corner.width == mask2->corner.width &&
-    mask1->corner.height == mask2->corner.height;
+    mask1->corner.height == mask2->corner.height &&
+    mask1->x_offset == mask2->x_offset &&
+    mask1->y_offset == mask2->y_offset;
 }
 
 static void
@@ -1651,6 +1858,7 @@ draw_shadow_corner (cairo_t               *cr,
       x2 = ceil (box->bounds.origin.x + box->corner[corner].width + clip_radius);
       x = x1;
       sx = 1;
+      key.x_offset = box->bounds.origin.x - clip_radius - x1;
       max_other = MAX(box->corner[GSK_CORNER_TOP_RIGHT].width, box->corner[GSK_CORNER_BOTTOM_RIGHT].width);
       x3 = floor (box->bounds.origin.x + box->bounds.size.width - max_other - clip_radius);
       if (x2 > x3)
@@ -1662,6 +1870,7 @@ draw_shadow_corner (cairo_t               *cr,
       x2 = ceil (box->bounds.origin.x + box->bounds.size.width + clip_radius);
       x = x2;
       sx = -1;
+      key.x_offset = x2 - clip_radius - (box->bounds.origin.x + box->bounds.size.width);
       max_other = MAX(box->corner[GSK_CORNER_TOP_LEFT].width, box->corner[GSK_CORNER_BOTTOM_LEFT].width);
       x3 = ceil (box->bounds.origin.x + max_other + clip_radius);
       if (x3 > x1)
@@ -1674,6 +1883,7 @@ draw_shadow_corner (cairo_t               *cr,
       y2 = ceil (box->bounds.origin.y + box->corner[corner].height + clip_radius);
       y = y1;
       sy = 1;
+      key.y_offset = box->bounds.origin.y - clip_radius - y1;
       max_other = MAX(box->corner[GSK_CORNER_BOTTOM_LEFT].height, box->corner[GSK_CORNER_BOTTOM_RIGHT].height);
       y3 = floor (box->bounds.origin.y + box->bounds.size.height - max_other - clip_radius);
       if (y2 > y3)
@@ -1685,6 +1895,7 @@ draw_shadow_corner (cairo_t               *cr,
       y2 = ceil (box->bounds.origin.y + box->bounds.size.height + clip_radius);
       y = y2;
       sy = -1;
+      key.y_offset = y2 - clip_radius - (box->bounds.origin.y + box->bounds.size.height);
       max_other = MAX(box->corner[GSK_CORNER_TOP_LEFT].height, box->corner[GSK_CORNER_TOP_RIGHT].height);
       y3 = ceil (box->bounds.origin.y + max_other + clip_radius);
       if (y3 > y1)
@@ -1710,9 +1921,10 @@ draw_shadow_corner (cairo_t               *cr,
   if (has_empty_clip (cr))
     return;
 
-  /* At this point we're drawing a blurred outset corner. The only
-   * things that affect the output of the blurred mask in this case
-   * is:
+  /* At this point we're drawing a blurred outset corner of a box that
+   * is not pixel-aligned, those go through gskcairoshadowcache.c.
+   * The only things that affect the output of the blurred mask in
+   * this case are:
    *
    * What corner this is, which defines the orientation (sx,sy)
    * and position (x,y)
@@ -1721,10 +1933,14 @@ draw_shadow_corner (cairo_t               *cr,
    *
    * The horizontal and vertical corner radius
    *
+   * The fractional offset of the box edges from (x,y)
+   *
    * We apply the first position and orientation when drawing the
-   * mask, so we cache rendered masks based on the blur radius and the
-   * corner radius.
+   * mask, so we cache rendered masks based on the rest.
    */
+  /* The cairo renderer may draw tiles from multiple threads */
+  G_LOCK (corner_mask_cache);
+
   if (corner_mask_cache == NULL)
     corner_mask_cache = g_hash_table_new_full ((GHashFunc)corner_mask_hash,
                                                (GEqualFunc)corner_mask_equal,
@@ -1736,11 +1952,18 @@ draw_shadow_corner (cairo_t               *cr,
   mask = g_hash_table_lookup (corner_mask_cache, &key);
   if (mask == NULL)
     {
+      if (g_hash_table_size (corner_mask_cache) >= MAX_CORNER_MASKS)
+        g_hash_table_remove_all (corner_mask_cache);
+
       mask = cairo_surface_create_similar_image (cairo_get_target (cr), CAIRO_FORMAT_A8,
                                                  drawn_rect->width + clip_radius,
                                                  drawn_rect->height + clip_radius);
       mask_cr = cairo_create (mask);
-      gsk_rounded_rect_init_from_rect (&corner_box, &GRAPHENE_RECT_INIT (clip_radius, clip_radius, 2*drawn_rect->width, 2*drawn_rect->height), 0);
+      gsk_rounded_rect_init_from_rect (&corner_box,
+                                       &GRAPHENE_RECT_INIT (clip_radius + key.x_offset,
+                                                            clip_radius + key.y_offset,
+                                                            2*drawn_rect->width, 2*drawn_rect->height),
+                                       0);
       corner_box.corner[0] = box->corner[corner];
       gsk_rounded_rect_path (&corner_box, mask_cr);
       cairo_fill (mask_cr);
@@ -1749,6 +1972,10 @@ draw_shadow_corner (cairo_t               *cr,
       g_hash_table_insert (corner_mask_cache, g_memdup (&key, sizeof (key)), mask);
     }
 
+  cairo_surface_reference (mask);
+
+  G_UNLOCK (corner_mask_cache);
+
   gdk_cairo_set_source_rgba (cr, color);
   pattern = cairo_pattern_create_for_surface (mask);
   cairo_matrix_init_identity (&matrix);
@@ -1757,6 +1984,7 @@ draw_shadow_corner (cairo_t               *cr,
   cairo_pattern_set_matrix (pattern, &matrix);
   cairo_mask (cr, pattern);
   cairo_pattern_destroy (pattern);
+  cairo_surface_destroy (mask);
 }
 
 static void
@@ -1830,6 +2058,35 @@ needs_blur (double radius)
   return TRUE;
 }
 
+static guint64
+gsk_inset_shadow_node_hash (GskRenderNode *node,
+                            guint64        hash)
+{
+  GskInsetShadowNode *self = (GskInsetShadowNode *) node;
+
+  hash = gsk_hash_rounded_rect (hash, &self->outline);
+  hash = gsk_hash_rgba (hash, &self->color);
+  hash = gsk_hash_float (hash, self->dx);
+  hash = gsk_hash_float (hash, self->dy);
+  hash = gsk_hash_float (hash, self->spread);
+  return gsk_hash_float (hash, self->blur_radius);
+}
+
+static gboolean
+gsk_inset_shadow_node_equal (GskRenderNode *node1,
+                             GskRenderNode *node2)
+{
+  GskInsetShadowNode *self1 = (GskInsetShadowNode *) node1;
+  GskInsetShadowNode *self2 = (GskInsetShadowNode *) node2;
+
+  return gsk_rounded_rect_equal (&self1->outline, &self2->outline) &&
+         gdk_rgba_equal (&self1->color, &self2->color) &&
+         self1->dx == self2->dx &&
+         self1->dy == self2->dy &&
+         self1->spread == self2->spread &&
+         self1->blur_radius == self2->blur_radius;
+}
+
 static void
 gsk_inset_shadow_node_draw (GskRenderNode *node,
                             cairo_t       *cr)
@@ -2133,6 +2390,35 @@ gsk_outset_shadow_get_extents (GskOutsetShadowNode *self,
   *left = MAX (0, ceil (clip_radius + self->spread - self->dx));
 }
 
+static guint64
+gsk_outset_shadow_node_hash (GskRenderNode *node,
+                             guint64        hash)
+{
+  GskOutsetShadowNode *self = (GskOutsetShadowNode *) node;
+
+  hash = gsk_hash_rounded_rect (hash, &self->outline);
+  hash = gsk_hash_rgba (hash, &self->color);
+  hash = gsk_hash_float (hash, self->dx);
+  hash = gsk_hash_float (hash, self->dy);
+  hash = gsk_hash_float (hash, self->spread);
+  return gsk_hash_float (hash, self->blur_radius);
+}
+
+static gboolean
+gsk_outset_shadow_node_equal (GskRenderNode *node1,
+                              GskRenderNode *node2)
+{
+  GskOutsetShadowNode *self1 = (GskOutsetShadowNode *) node1;
+  GskOutsetShadowNode *self2 = (GskOutsetShadowNode *) node2;
+
+  return gsk_rounded_rect_equal (&self1->outline, &self2->outline) &&
+         gdk_rgba_equal (&self1->color, &self2->color) &&
+         self1->dx == self2->dx &&
+         self1->dy == self2->dy &&
+         self1->spread == self2->spread &&
+         self1->blur_radius == self2->blur_radius;
+}
+
 static void
 gsk_outset_shadow_node_draw (GskRenderNode *node,
                              cairo_t       *cr)
@@ -2151,8 +2437,6 @@ gsk_outset_shadow_node_draw (GskRenderNode *node,
   if (gsk_rounded_rect_contains_rect (&self->outline, &GRAPHENE_RECT_INIT (x1c, y1c, x2c - x1c, y2c - y1c)))
     return;
 
-  clip_radius = gsk_cairo_blur_compute_pixels (self->blur_radius);
-
   cairo_save (cr);
 
   gsk_rounded_rect_init_copy (&clip_box, &self->outline);
@@ -2171,13 +2455,16 @@ gsk_outset_shadow_node_draw (GskRenderNode *node,
 
   if (!needs_blur (self->blur_radius))
     draw_shadow (cr, FALSE, &box, &clip_box, self->blur_radius, &self->color, GSK_BLUR_NONE);
-  else
+  else if (!gsk_cairo_shadow_cache_draw_outset (cr, &box, self->blur_radius, &self->color))
     {
       int i;
       cairo_region_t *remaining;
       cairo_rectangle_int_t r;
 
-      /* For the blurred case we divide the rendering into 9 parts,
+      /* Blurred shadows of pixel-aligned boxes are drawn as 9 slices
+       * of a cached mask, see gskcairoshadowcache.c for the details.
+       *
+       * For the others we divide the rendering into 9 parts,
        * 4 of the corners, 4 for the horizonat/vertical lines and
        * one for the interior. We make the non-interior parts
        * large enough to fit the full radius of the blur, so that
@@ -2186,6 +2473,7 @@ gsk_outset_shadow_node_draw (GskRenderNode *node,
 
       /* In the outset case we want to paint the entire box, plus as far
        * as the radius reaches from it */
+      clip_radius = gsk_cairo_blur_compute_pixels (self->blur_radius);
       r.x = floor (box.bounds.origin.x - clip_radius);
       r.y = floor (box.bounds.origin.y - clip_radius);
       r.width = ceil (box.bounds.origin.x + box.bounds.size.width + clip_radius) - r.x;
@@ -2577,16 +2865,63 @@ gsk_container_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_container_node_hash (GskRenderNode *node,
+                         guint64        hash)
+{
+  GskContainerNode *self = (GskContainerNode *) node;
+  guint i;
+
+  hash = gsk_hash_uint64 (hash, self->n_children);
+  for (i = 0; i < self->n_children; i++)
+    hash = gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->children[i]));
+
+  return hash;
+}
+
+static gboolean
+gsk_container_node_equal (GskRenderNode *node1,
+                          GskRenderNode *node2)
+{
+  GskContainerNode *self1 = (GskContainerNode *) node1;
+  GskContainerNode *self2 = (GskContainerNode *) node2;
+
+  guint i;
+
+  if (self1->n_children != self2->n_children)
+    return FALSE;
+
+  for (i = 0; i < self1->n_children; i++)
+    {
+      if (!gsk_render_node_equal (self1->children[i], self2->children[i]))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 static void
 gsk_container_node_draw (GskRenderNode *node,
                          cairo_t       *cr)
 {
   GskContainerNode *container = (GskContainerNode *) node;
+  graphene_rect_t clip;
+  double x1, y1, x2, y2;
   guint i;
 
+  /* Skip children that are entirely clipped away. This makes drawing
+   * a small part of a big tree, like a single tile, cheap. */
+  cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+  graphene_rect_init (&clip, x1, y1, x2 - x1, y2 - y1);
+
   for (i = 0; i < container->n_children; i++)
     {
-      gsk_render_node_draw (container->children[i], cr);
+      GskRenderNode *child = container->children[i];
+
+      if (!graphene_rect_intersection (&child->bounds, &clip, NULL))
+        continue;
+
+      gsk_render_node_draw (child, cr);
     }
 }
 
@@ -2767,6 +3102,32 @@ gsk_transform_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_transform_node_hash (GskRenderNode *node,
+                         guint64        hash)
+{
+  GskTransformNode *self = (GskTransformNode *) node;
+  graphene_matrix_t matrix;
+  float values[16];
+
+  gsk_transform_to_matrix (self->transform, &matrix);
+  graphene_matrix_to_float (&matrix, values);
+
+  hash = gsk_hash_floats (hash, values, 16);
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->child));
+}
+
+static gboolean
+gsk_transform_node_equal (GskRenderNode *node1,
+                          GskRenderNode *node2)
+{
+  GskTransformNode *self1 = (GskTransformNode *) node1;
+  GskTransformNode *self2 = (GskTransformNode *) node2;
+
+  return gsk_transform_equal (self1->transform, self2->transform) &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
 static void
 gsk_transform_node_draw (GskRenderNode *node,
                          cairo_t       *cr)
@@ -2974,6 +3335,27 @@ gsk_opacity_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_opacity_node_hash (GskRenderNode *node,
+                       guint64        hash)
+{
+  GskOpacityNode *self = (GskOpacityNode *) node;
+
+  hash = gsk_hash_float (hash, self->opacity);
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->child));
+}
+
+static gboolean
+gsk_opacity_node_equal (GskRenderNode *node1,
+                        GskRenderNode *node2)
+{
+  GskOpacityNode *self1 = (GskOpacityNode *) node1;
+  GskOpacityNode *self2 = (GskOpacityNode *) node2;
+
+  return self1->opacity == self2->opacity &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
 static void
 gsk_opacity_node_draw (GskRenderNode *node,
                        cairo_t       *cr)
@@ -3103,6 +3485,39 @@ gsk_color_matrix_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_color_matrix_node_hash (GskRenderNode *node,
+                            guint64        hash)
+{
+  GskColorMatrixNode *self = (GskColorMatrixNode *) node;
+  float values[16];
+
+  graphene_matrix_to_float (&self->color_matrix, values);
+  hash = gsk_hash_floats (hash, values, 16);
+  graphene_vec4_to_float (&self->color_offset, values);
+  hash = gsk_hash_floats (hash, values, 4);
+
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->child));
+}
+
+static gboolean
+gsk_color_matrix_node_equal (GskRenderNode *node1,
+                             GskRenderNode *node2)
+{
+  GskColorMatrixNode *self1 = (GskColorMatrixNode *) node1;
+  GskColorMatrixNode *self2 = (GskColorMatrixNode *) node2;
+
+  float values1[16], values2[16];
+
+  graphene_matrix_to_float (&self1->color_matrix, values1);
+  graphene_matrix_to_float (&self2->color_matrix, values2);
+  if (memcmp (values1, values2, sizeof (values1)) != 0)
+    return FALSE;
+
+  return graphene_vec4_equal (&self1->color_offset, &self2->color_offset) &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
 static void
 gsk_color_matrix_node_draw (GskRenderNode *node,
                             cairo_t       *cr)
@@ -3328,6 +3743,27 @@ gsk_repeat_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_repeat_node_hash (GskRenderNode *node,
+                      guint64        hash)
+{
+  GskRepeatNode *self = (GskRepeatNode *) node;
+
+  hash = gsk_hash_rect (hash, &self->child_bounds);
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->child));
+}
+
+static gboolean
+gsk_repeat_node_equal (GskRenderNode *node1,
+                       GskRenderNode *node2)
+{
+  GskRepeatNode *self1 = (GskRepeatNode *) node1;
+  GskRepeatNode *self2 = (GskRepeatNode *) node2;
+
+  return graphene_rect_equal (&self1->child_bounds, &self2->child_bounds) &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
 static void
 gsk_repeat_node_draw (GskRenderNode *node,
                       cairo_t       *cr)
@@ -3465,6 +3901,27 @@ gsk_clip_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_clip_node_hash (GskRenderNode *node,
+                    guint64        hash)
+{
+  GskClipNode *self = (GskClipNode *) node;
+
+  hash = gsk_hash_rect (hash, &self->clip);
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->child));
+}
+
+static gboolean
+gsk_clip_node_equal (GskRenderNode *node1,
+                     GskRenderNode *node2)
+{
+  GskClipNode *self1 = (GskClipNode *) node1;
+  GskClipNode *self2 = (GskClipNode *) node2;
+
+  return graphene_rect_equal (&self1->clip, &self2->clip) &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
 static void
 gsk_clip_node_draw (GskRenderNode *node,
                     cairo_t       *cr)
@@ -3600,6 +4057,27 @@ gsk_rounded_clip_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_rounded_clip_node_hash (GskRenderNode *node,
+                            guint64        hash)
+{
+  GskRoundedClipNode *self = (GskRoundedClipNode *) node;
+
+  hash = gsk_hash_rounded_rect (hash, &self->clip);
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->child));
+}
+
+static gboolean
+gsk_rounded_clip_node_equal (GskRenderNode *node1,
+                             GskRenderNode *node2)
+{
+  GskRoundedClipNode *self1 = (GskRoundedClipNode *) node1;
+  GskRoundedClipNode *self2 = (GskRoundedClipNode *) node2;
+
+  return gsk_rounded_rect_equal (&self1->clip, &self2->clip) &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
 static void
 gsk_rounded_clip_node_draw (GskRenderNode *node,
                             cairo_t       *cr)
@@ -3738,6 +4216,52 @@ gsk_shadow_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_shadow_node_hash (GskRenderNode *node,
+                      guint64        hash)
+{
+  GskShadowNode *self = (GskShadowNode *) node;
+  gsize i;
+
+  hash = gsk_hash_uint64 (hash, self->n_shadows);
+  for (i = 0; i < self->n_shadows; i++)
+    {
+      hash = gsk_hash_rgba (hash, &self->shadows[i].color);
+      hash = gsk_hash_float (hash, self->shadows[i].dx);
+      hash = gsk_hash_float (hash, self->shadows[i].dy);
+      hash = gsk_hash_float (hash, self->shadows[i].radius);
+    }
+
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->child));
+}
+
+static gboolean
+gsk_shadow_node_equal (GskRenderNode *node1,
+                       GskRenderNode *node2)
+{
+  GskShadowNode *self1 = (GskShadowNode *) node1;
+  GskShadowNode *self2 = (GskShadowNode *) node2;
+
+  gsize i;
+
+  if (self1->n_shadows != self2->n_shadows)
+    return FALSE;
+
+  for (i = 0; i < self1->n_shadows; i++)
+    {
+      const GskShadow *shadow1 = &self1->shadows[i];
+      const GskShadow *shadow2 = &self2->shadows[i];
+
+      if (!gdk_rgba_equal (&shadow1->color, &shadow2->color) ||
+          shadow1->dx != shadow2->dx ||
+          shadow1->dy != shadow2->dy ||
+          shadow1->radius != shadow2->radius)
+        return FALSE;
+    }
+
+  return gsk_render_node_equal (self1->child, self2->child);
+}
+
 static void
 gsk_shadow_node_draw (GskRenderNode *node,
                       cairo_t       *cr)
@@ -4023,6 +4547,29 @@ gsk_blend_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_blend_node_hash (GskRenderNode *node,
+                     guint64        hash)
+{
+  GskBlendNode *self = (GskBlendNode *) node;
+
+  hash = gsk_hash_uint64 (hash, self->blend_mode);
+  hash = gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->bottom));
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->top));
+}
+
+static gboolean
+gsk_blend_node_equal (GskRenderNode *node1,
+                      GskRenderNode *node2)
+{
+  GskBlendNode *self1 = (GskBlendNode *) node1;
+  GskBlendNode *self2 = (GskBlendNode *) node2;
+
+  return self1->blend_mode == self2->blend_mode &&
+         gsk_render_node_equal (self1->bottom, self2->bottom) &&
+         gsk_render_node_equal (self1->top, self2->top);
+}
+
 static void
 gsk_blend_node_draw (GskRenderNode *node,
                      cairo_t       *cr)
@@ -4178,6 +4725,29 @@ gsk_cross_fade_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_cross_fade_node_hash (GskRenderNode *node,
+                          guint64        hash)
+{
+  GskCrossFadeNode *self = (GskCrossFadeNode *) node;
+
+  hash = gsk_hash_float (hash, self->progress);
+  hash = gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->start));
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->end));
+}
+
+static gboolean
+gsk_cross_fade_node_equal (GskRenderNode *node1,
+                           GskRenderNode *node2)
+{
+  GskCrossFadeNode *self1 = (GskCrossFadeNode *) node1;
+  GskCrossFadeNode *self2 = (GskCrossFadeNode *) node2;
+
+  return self1->progress == self2->progress &&
+         gsk_render_node_equal (self1->start, self2->start) &&
+         gsk_render_node_equal (self1->end, self2->end);
+}
+
 static void
 gsk_cross_fade_node_draw (GskRenderNode *node,
                           cairo_t       *cr)
@@ -4337,22 +4907,152 @@ gsk_text_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_text_node_hash (GskRenderNode *node,
+                    guint64        hash)
+{
+  GskTextNode *self = (GskTextNode *) node;
+  guint i;
+
+  /* Pango caches fonts, so equal fonts are usually the same object */
+  hash = gsk_hash_pointer (hash, self->font);
+  hash = gsk_hash_rgba (hash, &self->color);
+  hash = gsk_hash_point (hash, &self->offset);
+  hash = gsk_hash_uint64 (hash, self->num_glyphs);
+  for (i = 0; i < self->num_glyphs; i++)
+    {
+      const PangoGlyphInfo *gi = &self->glyphs[i];
+
+      hash = gsk_hash_uint64 (hash, gi->glyph);
+      hash = gsk_hash_uint64 (hash, (guint32) gi->geometry.width);
+      hash = gsk_hash_uint64 (hash, (guint32) gi->geometry.x_offset);
+      hash = gsk_hash_uint64 (hash, (guint32) gi->geometry.y_offset);
+      hash = gsk_hash_uint64 (hash, gi->attr.is_cluster_start);
+    }
+
+  return hash;
+}
+
+static gboolean
+gsk_text_node_equal (GskRenderNode *node1,
+                     GskRenderNode *node2)
+{
+  GskTextNode *self1 = (GskTextNode *) node1;
+  GskTextNode *self2 = (GskTextNode *) node2;
+
+  guint i;
+
+  if (self1->font != self2->font ||
+      !gdk_rgba_equal (&self1->color, &self2->color) ||
+      !graphene_point_equal (&self1->offset, &self2->offset) ||
+      self1->num_glyphs != self2->num_glyphs)
+    return FALSE;
+
+  for (i = 0; i < self1->num_glyphs; i++)
+    {
+      const PangoGlyphInfo *gi1 = &self1->glyphs[i];
+      const PangoGlyphInfo *gi2 = &self2->glyphs[i];
+
+      if (gi1->glyph != gi2->glyph ||
+          gi1->geometry.width != gi2->geometry.width ||
+          gi1->geometry.x_offset != gi2->geometry.x_offset ||
+          gi1->geometry.y_offset != gi2->geometry.y_offset ||
+          gi1->attr.is_cluster_start != gi2->attr.is_cluster_start)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Pango caches the scaled font and the hex boxes for unknown glyphs
+ * in the font without locking, and the cairo renderer may draw text
+ * nodes from multiple threads, one per tile. Cairo scaled fonts are
+ * thread-safe, so glyphs are drawn with cairo outside of the lock.
+ */
+G_LOCK_DEFINE_STATIC (text_node_font);
+
+#define N_STACK_GLYPHS 128
+
 static void
 gsk_text_node_draw (GskRenderNode *node,
                     cairo_t       *cr)
 {
   GskTextNode *self = (GskTextNode *) node;
-  PangoGlyphString glyphs;
-
-  glyphs.num_glyphs = self->num_glyphs;
-  glyphs.glyphs = self->glyphs;
-  glyphs.log_clusters = NULL;
+  cairo_glyph_t stack_glyphs[N_STACK_GLYPHS];
+  cairo_glyph_t *cairo_glyphs;
+  cairo_scaled_font_t *scaled_font;
+  int x_position = 0;
+  guint i, n;
 
   cairo_save (cr);
 
   gdk_cairo_set_source_rgba (cr, &self->color);
   cairo_translate (cr, self->offset.x, self->offset.y);
-  pango_cairo_show_glyph_string (cr, self->font, &glyphs);
+
+  for (i = 0; i < self->num_glyphs; i++)
+    {
+      if (self->glyphs[i].glyph != PANGO_GLYPH_EMPTY &&
+          (self->glyphs[i].glyph & PANGO_GLYPH_UNKNOWN_FLAG))
+        break;
+    }
+
+  /* Pango draws the unknown glyphs itself */
+  if (i < self->num_glyphs)
+    {
+      PangoGlyphString glyphs;
+
+      glyphs.num_glyphs = self->num_glyphs;
+      glyphs.glyphs = self->glyphs;
+      glyphs.log_clusters = NULL;
+
+      G_LOCK (text_node_font);
+      pango_cairo_show_glyph_string (cr, self->font, &glyphs);
+      G_UNLOCK (text_node_font);
+
+      cairo_restore (cr);
+      return;
+    }
+
+  G_LOCK (text_node_font);
+  scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (self->font));
+  if (scaled_font)
+    cairo_scaled_font_reference (scaled_font);
+  G_UNLOCK (text_node_font);
+
+  if (scaled_font == NULL)
+    {
+      cairo_restore (cr);
+      return;
+    }
+
+  if (self->num_glyphs > N_STACK_GLYPHS)
+    cairo_glyphs = g_new (cairo_glyph_t, self->num_glyphs);
+  else
+    cairo_glyphs = stack_glyphs;
+
+  /* The same positions as pango_cairo_show_glyph_string() */
+  n = 0;
+  for (i = 0; i < self->num_glyphs; i++)
+    {
+      PangoGlyphInfo *gi = &self->glyphs[i];
+
+      if (gi->glyph != PANGO_GLYPH_EMPTY)
+        {
+          cairo_glyphs[n].index = gi->glyph;
+          cairo_glyphs[n].x = (double) (x_position + gi->geometry.x_offset) / PANGO_SCALE;
+          cairo_glyphs[n].y = (double) gi->geometry.y_offset / PANGO_SCALE;
+          n++;
+        }
+
+      x_position += gi->geometry.width;
+    }
+
+  cairo_set_scaled_font (cr, scaled_font);
+  cairo_show_glyphs (cr, cairo_glyphs, n);
+
+  if (cairo_glyphs != stack_glyphs)
+    g_free (cairo_glyphs);
+  cairo_scaled_font_destroy (scaled_font);
 
   cairo_restore (cr);
 }
@@ -4748,6 +5448,27 @@ blur_image_surface (cairo_surface_t *surface, int radius, int iterations)
   cairo_surface_destroy (tmp);
 }
 
+static guint64
+gsk_blur_node_hash (GskRenderNode *node,
+                    guint64        hash)
+{
+  GskBlurNode *self = (GskBlurNode *) node;
+
+  hash = gsk_hash_float (hash, self->radius);
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->child));
+}
+
+static gboolean
+gsk_blur_node_equal (GskRenderNode *node1,
+                     GskRenderNode *node2)
+{
+  GskBlurNode *self1 = (GskBlurNode *) node1;
+  GskBlurNode *self2 = (GskBlurNode *) node2;
+
+  return self1->radius == self2->radius &&
+         gsk_render_node_equal (self1->child, self2->child);
+}
+
 static void
 gsk_blur_node_draw (GskRenderNode *node,
                     cairo_t       *cr)
@@ -4919,6 +5640,26 @@ gsk_debug_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_debug_node_hash (GskRenderNode *node,
+                     guint64        hash)
+{
+  GskDebugNode *self = (GskDebugNode *) node;
+
+  /* The message doesn't affect rendering */
+  return gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->child));
+}
+
+static gboolean
+gsk_debug_node_equal (GskRenderNode *node1,
+                      GskRenderNode *node2)
+{
+  GskDebugNode *self1 = (GskDebugNode *) node1;
+  GskDebugNode *self2 = (GskDebugNode *) node2;
+
+  return gsk_render_node_equal (self1->child, self2->child);
+}
+
 static void
 gsk_debug_node_draw (GskRenderNode *node,
                       cairo_t       *cr)
@@ -5051,6 +5792,49 @@ gsk_gl_shader_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static guint64
+gsk_gl_shader_node_hash (GskRenderNode *node,
+                         guint64        hash)
+{
+  GskGLShaderNode *self = (GskGLShaderNode *) node;
+  guint i;
+
+  hash = gsk_hash_pointer (hash, self->shader);
+  if (self->args)
+    hash = gsk_hash_data (hash, g_bytes_get_data (self->args, NULL), g_bytes_get_size (self->args));
+  for (i = 0; i < self->n_children; i++)
+    hash = gsk_hash_uint64 (hash, gsk_render_node_get_hash (self->children[i]));
+
+  return hash;
+}
+
+static gboolean
+gsk_gl_shader_node_equal (GskRenderNode *node1,
+                          GskRenderNode *node2)
+{
+  GskGLShaderNode *self1 = (GskGLShaderNode *) node1;
+  GskGLShaderNode *self2 = (GskGLShaderNode *) node2;
+
+  guint i;
+
+  if (self1->shader != self2->shader ||
+      self1->n_children != self2->n_children)
+    return FALSE;
+
+  if (self1->args != self2->args &&
+      (self1->args == NULL || self2->args == NULL ||
+       !g_bytes_equal (self1->args, self2->args)))
+    return FALSE;
+
+  for (i = 0; i < self1->n_children; i++)
+    {
+      if (!gsk_render_node_equal (self1->children[i], self2->children[i]))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 static void
 gsk_gl_shader_node_draw (GskRenderNode *node,
                          cairo_t       *cr)
@@ -5278,6 +6062,8 @@ gsk_render_node_init_types_once (void)
       gsk_container_node_draw,
       NULL,
       gsk_container_node_diff,
+      gsk_container_node_hash,
+      gsk_container_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskContainerNode"), &node_info);
@@ -5310,6 +6096,8 @@ gsk_render_node_init_types_once (void)
       gsk_color_node_draw,
       NULL,
       gsk_color_node_diff,
+      gsk_color_node_hash,
+      gsk_color_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskColorNode"), &node_info);
@@ -5326,6 +6114,8 @@ gsk_render_node_init_types_once (void)
       gsk_linear_gradient_node_draw,
       NULL,
       gsk_linear_gradient_node_diff,
+      gsk_linear_gradient_node_hash,
+      gsk_linear_gradient_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskLinearGradientNode"), &node_info);
@@ -5342,6 +6132,8 @@ gsk_render_node_init_types_once (void)
       gsk_linear_gradient_node_draw,
       NULL,
       gsk_linear_gradient_node_diff,
+      gsk_linear_gradient_node_hash,
+      gsk_linear_gradient_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskRepeatingLinearGradientNode"), &node_info);
@@ -5358,6 +6150,8 @@ gsk_render_node_init_types_once (void)
       gsk_radial_gradient_node_draw,
       NULL,
       gsk_radial_gradient_node_diff,
+      gsk_radial_gradient_node_hash,
+      gsk_radial_gradient_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskRadialGradientNode"), &node_info);
@@ -5374,6 +6168,8 @@ gsk_render_node_init_types_once (void)
       gsk_radial_gradient_node_draw,
       NULL,
       gsk_radial_gradient_node_diff,
+      gsk_radial_gradient_node_hash,
+      gsk_radial_gradient_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskRepeatingRadialGradientNode"), &node_info);
@@ -5390,6 +6186,8 @@ gsk_render_node_init_types_once (void)
       gsk_conic_gradient_node_draw,
       NULL,
       gsk_conic_gradient_node_diff,
+      gsk_conic_gradient_node_hash,
+      gsk_conic_gradient_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskConicGradientNode"), &node_info);
@@ -5406,6 +6204,8 @@ gsk_render_node_init_types_once (void)
       gsk_border_node_draw,
       NULL,
       gsk_border_node_diff,
+      gsk_border_node_hash,
+      gsk_border_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskBorderNode"), &node_info);
@@ -5422,6 +6222,8 @@ gsk_render_node_init_types_once (void)
       gsk_texture_node_draw,
       NULL,
       gsk_texture_node_diff,
+      gsk_texture_node_hash,
+      gsk_texture_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskTextureNode"), &node_info);
@@ -5438,6 +6240,8 @@ gsk_render_node_init_types_once (void)
       gsk_inset_shadow_node_draw,
       NULL,
       gsk_inset_shadow_node_diff,
+      gsk_inset_shadow_node_hash,
+      gsk_inset_shadow_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskInsetShadowNode"), &node_info);
@@ -5454,6 +6258,8 @@ gsk_render_node_init_types_once (void)
       gsk_outset_shadow_node_draw,
       NULL,
       gsk_outset_shadow_node_diff,
+      gsk_outset_shadow_node_hash,
+      gsk_outset_shadow_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskOutsetShadowNode"), &node_info);
@@ -5470,6 +6276,8 @@ gsk_render_node_init_types_once (void)
       gsk_transform_node_draw,
       gsk_transform_node_can_diff,
       gsk_transform_node_diff,
+      gsk_transform_node_hash,
+      gsk_transform_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskTransformNode"), &node_info);
@@ -5486,6 +6294,8 @@ gsk_render_node_init_types_once (void)
       gsk_opacity_node_draw,
       NULL,
       gsk_opacity_node_diff,
+      gsk_opacity_node_hash,
+      gsk_opacity_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskOpacityNode"), &node_info);
@@ -5502,6 +6312,8 @@ gsk_render_node_init_types_once (void)
       gsk_color_matrix_node_draw,
       NULL,
       gsk_color_matrix_node_diff,
+      gsk_color_matrix_node_hash,
+      gsk_color_matrix_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskColorMatrixNode"), &node_info);
@@ -5518,6 +6330,8 @@ gsk_render_node_init_types_once (void)
       gsk_repeat_node_draw,
       NULL,
       NULL,
+      gsk_repeat_node_hash,
+      gsk_repeat_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskRepeatNode"), &node_info);
@@ -5534,6 +6348,8 @@ gsk_render_node_init_types_once (void)
       gsk_clip_node_draw,
       NULL,
       gsk_clip_node_diff,
+      gsk_clip_node_hash,
+      gsk_clip_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskClipNode"), &node_info);
@@ -5550,6 +6366,8 @@ gsk_render_node_init_types_once (void)
       gsk_rounded_clip_node_draw,
       NULL,
       gsk_rounded_clip_node_diff,
+      gsk_rounded_clip_node_hash,
+      gsk_rounded_clip_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskRoundedClipNode"), &node_info);
@@ -5566,6 +6384,8 @@ gsk_render_node_init_types_once (void)
       gsk_shadow_node_draw,
       NULL,
       gsk_shadow_node_diff,
+      gsk_shadow_node_hash,
+      gsk_shadow_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskShadowNode"), &node_info);
@@ -5582,6 +6402,8 @@ gsk_render_node_init_types_once (void)
       gsk_blend_node_draw,
       NULL,
       gsk_blend_node_diff,
+      gsk_blend_node_hash,
+      gsk_blend_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskBlendNode"), &node_info);
@@ -5598,6 +6420,8 @@ gsk_render_node_init_types_once (void)
       gsk_cross_fade_node_draw,
       NULL,
       gsk_cross_fade_node_diff,
+      gsk_cross_fade_node_hash,
+      gsk_cross_fade_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskCrossFadeNode"), &node_info);
@@ -5614,6 +6438,8 @@ gsk_render_node_init_types_once (void)
       gsk_text_node_draw,
       NULL,
       gsk_text_node_diff,
+      gsk_text_node_hash,
+      gsk_text_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskTextNode"), &node_info);
@@ -5630,6 +6456,8 @@ gsk_render_node_init_types_once (void)
       gsk_blur_node_draw,
       NULL,
       gsk_blur_node_diff,
+      gsk_blur_node_hash,
+      gsk_blur_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskBlurNode"), &node_info);
@@ -5646,6 +6474,8 @@ gsk_render_node_init_types_once (void)
       gsk_gl_shader_node_draw,
       NULL,
       gsk_gl_shader_node_diff,
+      gsk_gl_shader_node_hash,
+      gsk_gl_shader_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskGLShaderNode"), &node_info);
@@ -5662,6 +6492,8 @@ gsk_render_node_init_types_once (void)
       gsk_debug_node_draw,
       gsk_debug_node_can_diff,
       gsk_debug_node_diff,
+      gsk_debug_node_hash,
+      gsk_debug_node_equal,
     };
 
     GType node_type = gsk_render_node_type_register_static (I_("GskDebugNode"), &node_info);
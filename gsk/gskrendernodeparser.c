@@ -3022,6 +3022,9 @@ render_node_print (Printer       *p,
  * The intended use of this functions is testing, benchmarking and debugging.
  * The format is not meant as a permanent storage format.
  *
+ * For large nodes, in particular ones containing textures, consider
+ * gsk_render_node_serialize_binary() instead.
+ *
  * Returns: a #GBytes representing the node.
  **/
 GBytes *
@@ -3,6 +3,7 @@
 
 #include "gskrendernode.h"
 #include <cairo.h>
+#include <string.h>
 
 G_BEGIN_DECLS
 
@@ -27,6 +28,9 @@ struct _GskRenderNode
   gatomicrefcount ref_count;
 
   graphene_rect_t bounds;
+
+  /* Structural hash, computed on first use. 0 if not computed yet */
+  guint64 hash;
 };
 
 struct _GskRenderNodeClass
@@ -43,6 +47,10 @@ struct _GskRenderNodeClass
   void            (* diff)        (GskRenderNode  *node1,
                                    GskRenderNode  *node2,
                                    cairo_region_t *region);
+  guint64         (* hash)        (GskRenderNode  *node,
+                                   guint64         hash);
+  gboolean        (* equal)       (GskRenderNode  *node1,
+                                   GskRenderNode  *node2);
 };
 
 /*< private >
@@ -57,6 +65,12 @@ struct _GskRenderNodeClass
  *   unset, gsk_render_node_can_diff_true() will be used
  * @diff: (nullable): the function called by gsk_render_node_diff(); if unset,
  *   gsk_render_node_diff_impossible() will be used
+ * @hash: (nullable): the function called by gsk_render_node_get_hash() to mix
+ *   the node's contents and children into the hash; if unset, the node is
+ *   only considered identical to itself
+ * @equal: (nullable): the function called by gsk_render_node_equal() to
+ *   compare the contents and children of two nodes with equal hashes; if
+ *   unset, the node is only considered equal to itself
  *
  * A struction that contains the type information for a #GskRenderNode subclass,
  * to be used by gsk_render_node_type_register_static().
@@ -76,8 +90,18 @@ typedef struct
   void            (* diff)          (GskRenderNode        *node1,
                                      GskRenderNode        *node2,
                                      cairo_region_t       *region);
+  guint64         (* hash)          (GskRenderNode        *node,
+                                     guint64               hash);
+  gboolean        (* equal)         (GskRenderNode        *node1,
+                                     GskRenderNode        *node2);
 } GskRenderNodeTypeInfo;
 
+typedef struct
+{
+  guint n_compared;     /* pairs of nodes that were compared */
+  guint n_pruned;       /* identical subtrees that were skipped */
+} GskDiffStats;
+
 void            gsk_render_node_init_types              (void);
 
 GType           gsk_render_node_type_register_static    (const char                  *node_name,
@@ -93,6 +117,124 @@ void            gsk_render_node_diff                    (GskRenderNode
 void            gsk_render_node_diff_impossible         (GskRenderNode               *node1,
                                                          GskRenderNode               *node2,
                                                          cairo_region_t              *region);
+void            gsk_render_node_diff_with_stats         (GskRenderNode               *node1,
+                                                         GskRenderNode               *node2,
+                                                         cairo_region_t              *region,
+                                                         GskDiffStats                *stats);
+
+guint64         gsk_render_node_get_hash                (GskRenderNode               *node);
+gboolean        gsk_render_node_equal                   (GskRenderNode               *node1,
+                                                         GskRenderNode               *node2);
+
+/* Helpers for the hash vfunc. The order of the values matters. */
+static inline guint64
+gsk_hash_uint64 (guint64 hash,
+                 guint64 value)
+{
+  value += G_GUINT64_CONSTANT (0x9e3779b97f4a7c15);
+  value = (value ^ (value >> 30)) * G_GUINT64_CONSTANT (0xbf58476d1ce4e5b9);
+  value = (value ^ (value >> 27)) * G_GUINT64_CONSTANT (0x94d049bb133111eb);
+  value ^= value >> 31;
+
+  return (hash ^ value) * G_GUINT64_CONSTANT (0x100000001b3);
+}
+
+static inline guint64
+gsk_hash_pointer (guint64       hash,
+                  gconstpointer pointer)
+{
+  return gsk_hash_uint64 (hash, GPOINTER_TO_SIZE (pointer));
+}
+
+static inline guint64
+gsk_hash_float (guint64 hash,
+                float   value)
+{
+  union {
+    float f;
+    guint32 u;
+  } u = { value };
+
+  return gsk_hash_uint64 (hash, u.u);
+}
+
+static inline guint64
+gsk_hash_floats (guint64      hash,
+                 const float *values,
+                 gsize        n_values)
+{
+  gsize i;
+
+  for (i = 0; i < n_values; i++)
+    hash = gsk_hash_float (hash, values[i]);
+
+  return hash;
+}
+
+static inline guint64
+gsk_hash_data (guint64       hash,
+               gconstpointer data,
+               gsize         size)
+{
+  const guchar *bytes = data;
+  gsize i;
+
+  for (i = 0; i + 8 <= size; i += 8)
+    {
+      guint64 value;
+
+      memcpy (&value, bytes + i, 8);
+      hash = gsk_hash_uint64 (hash, value);
+    }
+
+  for (; i < size; i++)
+    hash = gsk_hash_uint64 (hash, bytes[i]);
+
+  return gsk_hash_uint64 (hash, size);
+}
+
+static inline guint64
+gsk_hash_point (guint64                 hash,
+                const graphene_point_t *point)
+{
+  hash = gsk_hash_float (hash, point->x);
+  return gsk_hash_float (hash, point->y);
+}
+
+static inline guint64
+gsk_hash_rect (guint64                hash,
+               const graphene_rect_t *rect)
+{
+  hash = gsk_hash_point (hash, &rect->origin);
+  hash = gsk_hash_float (hash, rect->size.width);
+  return gsk_hash_float (hash, rect->size.height);
+}
+
+static inline guint64
+gsk_hash_rounded_rect (guint64               hash,
+                       const GskRoundedRect *rect)
+{
+  guint i;
+
+  hash = gsk_hash_rect (hash, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      hash = gsk_hash_float (hash, rect->corner[i].width);
+      hash = gsk_hash_float (hash, rect->corner[i].height);
+    }
+
+  return hash;
+}
+
+static inline guint64
+gsk_hash_rgba (guint64        hash,
+               const GdkRGBA *rgba)
+{
+  hash = gsk_hash_float (hash, rgba->red);
+  hash = gsk_hash_float (hash, rgba->green);
+  hash = gsk_hash_float (hash, rgba->blue);
+  return gsk_hash_float (hash, rgba->alpha);
+}
 
 bool            gsk_border_node_get_uniform             (GskRenderNode               *self);
 
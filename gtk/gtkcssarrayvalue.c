@@ -97,6 +97,19 @@ gtk_css_value_array_equal (const GtkCssValue *value1,
   return TRUE;
 }
 
+static guint
+gtk_css_value_array_hash (const GtkCssValue *value)
+{
+  guint i, hash;
+
+  hash = value->n_values;
+
+  for (i = 0; i < value->n_values; i++)
+    hash = hash * 31 + gtk_css_value_hash (value->values[i]);
+
+  return hash;
+}
+
 static guint
 gcd (guint a, guint b)
 {
@@ -369,6 +382,7 @@ static const GtkCssValueClass GTK_CSS_VALUE_ARRAY = {
   gtk_css_value_array_free,
   gtk_css_value_array_compute,
   gtk_css_value_array_equal,
+  gtk_css_value_array_hash,
   gtk_css_value_array_transition,
   gtk_css_value_array_is_dynamic,
   gtk_css_value_array_get_dynamic_value,
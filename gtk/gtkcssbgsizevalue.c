@@ -88,6 +88,20 @@ gtk_css_value_bg_size_equal (const GtkCssValue *value1,
            _gtk_css_value_equal (value1->y, value2->y)));
 }
 
+static guint
+gtk_css_value_bg_size_hash (const GtkCssValue *value)
+{
+  guint hash;
+
+  hash = value->cover << 1 | value->contain;
+  if (value->x)
+    hash = hash * 31 + gtk_css_value_hash (value->x);
+  if (value->y)
+    hash = hash * 31 + gtk_css_value_hash (value->y);
+
+  return hash;
+}
+
 static GtkCssValue *
 gtk_css_value_bg_size_transition (GtkCssValue *start,
                                   GtkCssValue *end,
@@ -157,15 +171,16 @@ static const GtkCssValueClass GTK_CSS_VALUE_BG_SIZE = {
   gtk_css_value_bg_size_free,
   gtk_css_value_bg_size_compute,
   gtk_css_value_bg_size_equal,
+  gtk_css_value_bg_size_hash,
   gtk_css_value_bg_size_transition,
   NULL,
   NULL,
   gtk_css_value_bg_size_print
 };
 
-static GtkCssValue auto_singleton = { &GTK_CSS_VALUE_BG_SIZE, 1, TRUE, FALSE, FALSE, NULL, NULL };
-static GtkCssValue cover_singleton = { &GTK_CSS_VALUE_BG_SIZE, 1, TRUE, TRUE, FALSE, NULL, NULL };
-static GtkCssValue contain_singleton = { &GTK_CSS_VALUE_BG_SIZE, 1, TRUE, FALSE, TRUE, NULL, NULL };
+static GtkCssValue auto_singleton = { &GTK_CSS_VALUE_BG_SIZE, 1, TRUE, FALSE, FALSE, FALSE, NULL, NULL };
+static GtkCssValue cover_singleton = { &GTK_CSS_VALUE_BG_SIZE, 1, TRUE, FALSE, TRUE, FALSE, NULL, NULL };
+static GtkCssValue contain_singleton = { &GTK_CSS_VALUE_BG_SIZE, 1, TRUE, FALSE, FALSE, TRUE, NULL, NULL };
 
 GtkCssValue *
 _gtk_css_bg_size_value_new (GtkCssValue *x,
@@ -65,6 +65,12 @@ gtk_css_value_corner_equal (const GtkCssValue *corner1,
       && _gtk_css_value_equal (corner1->y, corner2->y);
 }
 
+static guint
+gtk_css_value_corner_hash (const GtkCssValue *corner)
+{
+  return gtk_css_value_hash (corner->x) * 31 + gtk_css_value_hash (corner->y);
+}
+
 static GtkCssValue *
 gtk_css_value_corner_transition (GtkCssValue *start,
                                  GtkCssValue *end,
@@ -103,6 +109,7 @@ static const GtkCssValueClass GTK_CSS_VALUE_CORNER = {
   gtk_css_value_corner_free,
   gtk_css_value_corner_compute,
   gtk_css_value_corner_equal,
+  gtk_css_value_corner_hash,
   gtk_css_value_corner_transition,
   NULL,
   NULL,
@@ -139,6 +139,7 @@ static const GtkCssValueClass GTK_CSS_VALUE_EASE = {
   gtk_css_value_ease_free,
   gtk_css_value_ease_compute,
   gtk_css_value_ease_equal,
+  NULL,
   gtk_css_value_ease_transition,
   NULL,
   NULL,
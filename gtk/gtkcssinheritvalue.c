@@ -82,6 +82,7 @@ static const GtkCssValueClass GTK_CSS_VALUE_INHERIT = {
   gtk_css_value_inherit_free,
   gtk_css_value_inherit_compute,
   gtk_css_value_inherit_equal,
+  NULL,
   gtk_css_value_inherit_transition,
   NULL,
   NULL,
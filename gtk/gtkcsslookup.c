@@ -23,6 +23,7 @@
 #include "gtkcsstypesprivate.h"
 #include "gtkprivatetypebuiltins.h"
 #include "gtkprivate.h"
+#include "gtkstyleproviderprivate.h"
 
 void
 _gtk_css_lookup_init (GtkCssLookup     *lookup)
@@ -74,3 +75,87 @@ _gtk_css_lookup_set (GtkCssLookup  *lookup,
   lookup->values[id].section = section;
   lookup->set_values = _gtk_bitmask_set (lookup->set_values, id, TRUE);
 }
+
+/* A GtkCssMatch is the result of a lookup, without the empty slots,
+ * so it can be computed ahead of time, possibly in a different
+ * thread, and be kept around until the style is resolved. Like the
+ * lookup, it does not own the sections and values.
+ */
+typedef struct {
+  guint          id;
+  GtkCssSection *section;
+  GtkCssValue   *value;
+} GtkCssMatchValue;
+
+struct _GtkCssMatch {
+  GtkCssChange     change;
+  guint            n_values;
+  GtkCssMatchValue values[];
+};
+
+GtkCssMatch *
+gtk_css_match_new (GtkStyleProvider             *provider,
+                   const GtkCountingBloomFilter *filter,
+                   GtkCssNode                   *node)
+{
+  GtkCssLookup lookup;
+  GtkCssChange change = 0;
+  GtkCssMatch *match;
+  guint i, n;
+
+  _gtk_css_lookup_init (&lookup);
+
+  gtk_style_provider_lookup (provider, filter, node, &lookup, &change);
+
+  n = 0;
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if (lookup.values[i].value)
+        n++;
+    }
+
+  match = g_malloc (sizeof (GtkCssMatch) + n * sizeof (GtkCssMatchValue));
+  match->change = change;
+  match->n_values = n;
+
+  n = 0;
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if (lookup.values[i].value == NULL)
+        continue;
+
+      match->values[n].id = i;
+      match->values[n].section = lookup.values[i].section;
+      match->values[n].value = lookup.values[i].value;
+      n++;
+    }
+
+  _gtk_css_lookup_destroy (&lookup);
+
+  return match;
+}
+
+void
+gtk_css_match_free (GtkCssMatch *match)
+{
+  g_free (match);
+}
+
+GtkCssChange
+gtk_css_match_get_change (const GtkCssMatch *match)
+{
+  return match->change;
+}
+
+void
+gtk_css_match_fill_lookup (const GtkCssMatch *match,
+                           GtkCssLookup      *lookup)
+{
+  guint i;
+
+  for (i = 0; i < match->n_values; i++)
+    _gtk_css_lookup_set (lookup,
+                         match->values[i].id,
+                         match->values[i].section,
+                         match->values[i].value);
+}
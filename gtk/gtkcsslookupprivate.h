@@ -49,6 +49,14 @@ void                    _gtk_css_lookup_set                     (GtkCssLookup
                                                                  GtkCssSection              *section,
                                                                  GtkCssValue                *value);
 
+GtkCssMatch *           gtk_css_match_new                       (GtkStyleProvider             *provider,
+                                                                 const GtkCountingBloomFilter *filter,
+                                                                 GtkCssNode                   *node);
+void                    gtk_css_match_free                      (GtkCssMatch                  *match);
+GtkCssChange            gtk_css_match_get_change                (const GtkCssMatch            *match);
+void                    gtk_css_match_fill_lookup               (const GtkCssMatch            *match,
+                                                                 GtkCssLookup                 *lookup);
+
 static inline const GtkBitmask *
 _gtk_css_lookup_get_set_values (const GtkCssLookup *lookup)
 {
@@ -21,13 +21,17 @@
 
 #include "gtkcssstaticstyleprivate.h"
 #include "gtkcssanimatedstyleprivate.h"
+#include "gtkcsslookupprivate.h"
+#include "gtkcssselectorprivate.h"
 #include "gtkcssstylepropertyprivate.h"
+#include "gtkdebug.h"
 #include "gtkintl.h"
 #include "gtkmarshalers.h"
 #include "gtksettingsprivate.h"
 #include "gtktypebuiltins.h"
 #include "gtkprivate.h"
 #include "gdkprofilerprivate.h"
+#include "gdkparalleltaskprivate.h"
 
 /*
  * CSS nodes are the backbone of the GtkStyleContext implementation and
@@ -126,8 +130,18 @@ gtk_css_node_get_style_provider_or_null (GtkCssNode *cssnode)
 
 static int invalidated_nodes;
 static int created_styles;
+static int matched_nodes;
+static guint64 restyled_nodes;
+static guint64 skipped_nodes;
 static guint invalidated_nodes_counter;
 static guint created_styles_counter;
+static guint matched_nodes_counter;
+
+/* Selector matches computed ahead of time on the thread pool,
+ * see gtk_css_node_match_in_parallel()
+ */
+static GHashTable *prefetched_matches;
+static gboolean propagating_changes;
 
 static void
 gtk_css_node_set_invalid (GtkCssNode *node,
@@ -254,6 +268,9 @@ gtk_css_node_finalize (GObject *object)
     g_object_unref (cssnode->style);
   gtk_css_node_declaration_unref (cssnode->decl);
 
+  if (prefetched_matches)
+    g_hash_table_remove (prefetched_matches, cssnode);
+
   G_OBJECT_CLASS (gtk_css_node_parent_class)->finalize (object);
 }
 
@@ -355,20 +372,69 @@ store_in_global_parent_cache (GtkCssNode                  *node,
                                                  style);
 }
 
+static GtkCssStyle *
+lookup_in_shared_styles (GtkCssNode                  *node,
+                         const GtkCssNodeDeclaration *decl)
+{
+  if (node->parent == NULL)
+    return NULL;
+
+  return gtk_css_node_style_cache_lookup_shared (gtk_css_node_get_style_provider (node),
+                                                 node->parent,
+                                                 decl,
+                                                 gtk_css_node_is_first_child (node),
+                                                 gtk_css_node_is_last_child (node));
+}
+
+static void
+store_in_shared_styles (GtkCssNode                  *node,
+                        const GtkCssNodeDeclaration *decl,
+                        GtkCssStyle                 *style)
+{
+  if (node->parent == NULL)
+    return;
+
+  gtk_css_node_style_cache_insert_shared (gtk_css_node_get_style_provider (node),
+                                          node,
+                                          (GtkCssNodeDeclaration *) decl,
+                                          gtk_css_node_is_first_child (node),
+                                          gtk_css_node_is_last_child (node),
+                                          style);
+}
+
 static GtkCssStyle *
 gtk_css_node_create_style (GtkCssNode                   *cssnode,
                            const GtkCountingBloomFilter *filter,
                            GtkCssChange                  change)
 {
   const GtkCssNodeDeclaration *decl;
+  GtkCssMatch *match;
   GtkCssStyle *style;
   GtkCssChange style_change;
 
   decl = gtk_css_node_get_declaration (cssnode);
 
+  if (prefetched_matches)
+    match = g_hash_table_lookup (prefetched_matches, cssnode);
+  else
+    match = NULL;
+
   style = lookup_in_global_parent_cache (cssnode, decl);
   if (style)
-    return g_object_ref (style);
+    {
+      if (match)
+        g_hash_table_remove (prefetched_matches, cssnode);
+      return g_object_ref (style);
+    }
+
+  style = lookup_in_shared_styles (cssnode, decl);
+  if (style)
+    {
+      if (match)
+        g_hash_table_remove (prefetched_matches, cssnode);
+      store_in_global_parent_cache (cssnode, decl, style);
+      return g_object_ref (style);
+    }
 
   created_styles++;
 
@@ -382,12 +448,24 @@ gtk_css_node_create_style (GtkCssNode                   *cssnode,
       style_change = gtk_css_static_style_get_change (gtk_css_style_get_static_style (cssnode->style));
     }
 
-  style = gtk_css_static_style_new_compute (gtk_css_node_get_style_provider (cssnode),
-                                            filter,
-                                            cssnode,
-                                            style_change);
+  if (match)
+    {
+      style = gtk_css_static_style_new_for_match (gtk_css_node_get_style_provider (cssnode),
+                                                  match,
+                                                  cssnode,
+                                                  style_change);
+      g_hash_table_remove (prefetched_matches, cssnode);
+    }
+  else
+    {
+      style = gtk_css_static_style_new_compute (gtk_css_node_get_style_provider (cssnode),
+                                                filter,
+                                                cssnode,
+                                                style_change);
+    }
 
   store_in_global_parent_cache (cssnode, decl, style);
+  store_in_shared_styles (cssnode, decl, style);
 
   return style;
 }
@@ -631,6 +709,7 @@ gtk_css_node_class_init (GtkCssNodeClass *klass)
     {
       invalidated_nodes_counter = gdk_profiler_define_int_counter ("invalidated-nodes", "CSS Node Invalidations");
       created_styles_counter = gdk_profiler_define_int_counter ("created-styles", "CSS Style Creations");
+      matched_nodes_counter = gdk_profiler_define_int_counter ("matched-nodes", "CSS Nodes Matched in Parallel");
     }
 }
 
@@ -708,6 +787,15 @@ gtk_css_node_invalidate_style (GtkCssNode *cssnode)
     gtk_css_node_invalidate_style (cssnode->next_sibling);
 }
 
+static GtkCssNode *
+gtk_css_node_get_root (GtkCssNode *cssnode)
+{
+  while (cssnode->parent)
+    cssnode = cssnode->parent;
+
+  return cssnode;
+}
+
 static void
 gtk_css_node_reposition (GtkCssNode *node,
                          GtkCssNode *new_parent,
@@ -758,6 +846,13 @@ gtk_css_node_reposition (GtkCssNode *node,
         {
           g_object_ref (node);
 
+          /* The new root validates this subtree from now on */
+          if (old_parent == NULL)
+            {
+              gtk_css_node_get_root (new_parent)->radical_invalidations += node->radical_invalidations;
+              node->radical_invalidations = 0;
+            }
+
           if (node->pending_changes)
             new_parent->needs_propagation = TRUE;
           if (node->invalid && node->visible)
@@ -919,26 +1014,42 @@ static void
 gtk_css_node_propagate_pending_changes (GtkCssNode *cssnode,
                                         gboolean    style_changed)
 {
-  GtkCssChange change, child_change;
+  GtkCssChange change, local_change, child_change, child_local_change;
   GtkCssNode *child;
 
-  change = _gtk_css_change_for_child (cssnode->pending_changes);
+  change = _gtk_css_change_for_child (cssnode->pending_changes & ~cssnode->local_changes);
+  local_change = cssnode->local_changes;
   if (style_changed)
     change |= GTK_CSS_CHANGE_PARENT_STYLE;
 
-  if (!cssnode->needs_propagation && change == 0)
+  if (!cssnode->needs_propagation && change == 0 && local_change == 0)
     return;
 
+  propagating_changes = TRUE;
+
   for (child = gtk_css_node_get_first_child (cssnode);
        child;
        child = gtk_css_node_get_next_sibling (child))
     {
       child_change = child->pending_changes;
+      child_local_change = child->local_changes;
+
+      /* Without the dependency index, the local changes would
+       * have invalidated this child and everything below it.
+       */
+      if (change == 0 && local_change != 0 && child_change == 0)
+        skipped_nodes++;
+
       gtk_css_node_invalidate (child, change);
       if (child->visible)
-        change |= _gtk_css_change_for_sibling (child_change);
+        {
+          change |= _gtk_css_change_for_sibling (child_change & ~child_local_change);
+          local_change |= child_local_change;
+        }
     }
 
+  propagating_changes = FALSE;
+
   cssnode->needs_propagation = FALSE;
 }
 
@@ -969,6 +1080,8 @@ gtk_css_node_do_ensure_style (GtkCssNode                   *cssnode,
 
       style_changed = gtk_css_node_set_style (cssnode, new_style);
       g_object_unref (new_style);
+
+      restyled_nodes++;
     }
   else
     {
@@ -978,6 +1091,7 @@ gtk_css_node_do_ensure_style (GtkCssNode                   *cssnode,
   gtk_css_node_propagate_pending_changes (cssnode, style_changed);
 
   cssnode->pending_changes = 0;
+  cssnode->local_changes = 0;
   cssnode->style_is_invalid = FALSE;
 }
 
@@ -1091,13 +1205,38 @@ gtk_css_node_get_visible (GtkCssNode *cssnode)
   return cssnode->visible;
 }
 
+/* Invalidates @cssnode for @change, but only propagates the parts of it
+ * in @dependent_change to its children and siblings. See
+ * gtk_css_selector_get_dependent_change().
+ */
+static void
+gtk_css_node_invalidate_targeted (GtkCssNode   *cssnode,
+                                  GtkCssChange  change,
+                                  GtkCssChange  dependent_change)
+{
+  GtkCssChange propagating;
+
+  propagating = cssnode->pending_changes & ~cssnode->local_changes;
+
+  gtk_css_node_invalidate (cssnode, change);
+
+  cssnode->local_changes |= change & ~dependent_change & ~propagating;
+}
+
 void
 gtk_css_node_set_name (GtkCssNode *cssnode,
                        GQuark      name)
 {
+  GQuark old_name;
+
+  old_name = gtk_css_node_declaration_get_name (cssnode->decl);
+
   if (gtk_css_node_declaration_set_name (&cssnode->decl, name))
     {
-      gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_NAME);
+      gtk_css_node_invalidate_targeted (cssnode,
+                                        GTK_CSS_CHANGE_NAME,
+                                        gtk_css_selector_get_dependent_change (GTK_CSS_CHANGE_NAME, old_name, 0) |
+                                        gtk_css_selector_get_dependent_change (GTK_CSS_CHANGE_NAME, name, 0));
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_NAME]);
     }
 }
@@ -1152,7 +1291,9 @@ gtk_css_node_set_state (GtkCssNode    *cssnode,
                      GTK_STATE_FLAG_SELECTED))
         change |= GTK_CSS_CHANGE_STATE;
 
-      gtk_css_node_invalidate (cssnode, change);
+      gtk_css_node_invalidate_targeted (cssnode,
+                                        change,
+                                        gtk_css_selector_get_dependent_change (change, 0, gtk_css_node_get_name (cssnode)));
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_STATE]);
     }
 }
@@ -1166,9 +1307,20 @@ gtk_css_node_get_state (GtkCssNode *cssnode)
 static void
 gtk_css_node_clear_classes (GtkCssNode *cssnode)
 {
+  const GQuark *classes;
+  GtkCssChange dependent_change;
+  guint i, n_classes;
+
+  classes = gtk_css_node_declaration_get_classes (cssnode->decl, &n_classes);
+  dependent_change = 0;
+  for (i = 0; i < n_classes && dependent_change == 0; i++)
+    dependent_change = gtk_css_selector_get_dependent_change (GTK_CSS_CHANGE_CLASS,
+                                                              classes[i],
+                                                              gtk_css_node_get_name (cssnode));
+
   if (gtk_css_node_declaration_clear_classes (&cssnode->decl))
     {
-      gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_CLASS);
+      gtk_css_node_invalidate_targeted (cssnode, GTK_CSS_CHANGE_CLASS, dependent_change);
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_CLASSES]);
     }
 }
@@ -1219,7 +1371,11 @@ gtk_css_node_add_class (GtkCssNode *cssnode,
 {
   if (gtk_css_node_declaration_add_class (&cssnode->decl, style_class))
     {
-      gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_CLASS);
+      gtk_css_node_invalidate_targeted (cssnode,
+                                        GTK_CSS_CHANGE_CLASS,
+                                        gtk_css_selector_get_dependent_change (GTK_CSS_CHANGE_CLASS,
+                                                                               style_class,
+                                                                               gtk_css_node_get_name (cssnode)));
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_CLASSES]);
     }
 }
@@ -1230,7 +1386,11 @@ gtk_css_node_remove_class (GtkCssNode *cssnode,
 {
   if (gtk_css_node_declaration_remove_class (&cssnode->decl, style_class))
     {
-      gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_CLASS);
+      gtk_css_node_invalidate_targeted (cssnode,
+                                        GTK_CSS_CHANGE_CLASS,
+                                        gtk_css_selector_get_dependent_change (GTK_CSS_CHANGE_CLASS,
+                                                                               style_class,
+                                                                               gtk_css_node_get_name (cssnode)));
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_CLASSES]);
     }
 }
@@ -1312,13 +1472,246 @@ gtk_css_node_invalidate (GtkCssNode   *cssnode,
   if (change == 0)
     return;
 
+  if (!propagating_changes)
+    {
+      if (change & GTK_CSS_CHANGE_NEEDS_RECOMPUTE)
+        gtk_css_node_get_root (cssnode)->radical_invalidations++;
+
+      /* The node tree changed under the prefetched matches */
+      if (prefetched_matches &&
+          (change & ~(GTK_CSS_CHANGE_TIMESTAMP | GTK_CSS_CHANGE_ANIMATIONS)))
+        g_hash_table_remove_all (prefetched_matches);
+    }
+
   cssnode->pending_changes |= change;
+  cssnode->local_changes &= ~change;
 
   if (cssnode->parent)
     cssnode->parent->needs_propagation = TRUE;
   gtk_css_node_invalidate_style (cssnode);
 }
 
+void
+gtk_css_node_get_invalidation_stats (guint64 *n_restyled,
+                                     guint64 *n_skipped)
+{
+  *n_restyled = restyled_nodes;
+  *n_skipped = skipped_nodes;
+}
+
+/* When a theme, dark mode or font change invalidates the styles of a
+ * whole window, most of the time goes into matching selectors. That
+ * only reads the node tree and the style providers, so it is done on a
+ * thread pool before validating. The styles themselves are still
+ * created in tree order in gtk_css_node_validate_internal(), which
+ * picks up the matches from prefetched_matches.
+ *
+ * The tree is split into tasks, runs of consecutive sibling subtrees
+ * that share a parent. Each task carries its own copy of the bloom
+ * filter for the ancestors of that parent.
+ */
+#define MIN_NODES_FOR_THREADS 256
+#define NODES_PER_TASK 64
+
+typedef struct {
+  GtkCssNode *node;
+  GtkStyleProvider *provider;           /* NULL if the node needs no match */
+  GtkCssMatch *match;
+} MatchItem;
+
+typedef struct {
+  GtkCssNode *parent;
+  guint first_item;
+  guint n_items;
+  GtkCountingBloomFilter filter;
+} MatchTask;
+
+typedef struct {
+  GArray *items;
+  GArray *tasks;
+  guint n_matches;
+  int current_task;
+
+  guint next_task;
+} MatchJob;
+
+static gboolean
+gtk_css_node_needs_match (GtkCssNode *cssnode)
+{
+  GtkCssNode *previous;
+
+  /* These are the nodes that will do a full lookup in
+   * gtk_css_node_create_style()
+   */
+  if (!cssnode->style_is_invalid ||
+      (cssnode->pending_changes & GTK_CSS_CHANGE_NEEDS_RECOMPUTE) == 0)
+    return FALSE;
+
+  /* Unless they are in the middle of a list of identical siblings,
+   * which will most likely find their style in the parent cache.
+   */
+  previous = cssnode->previous_sibling;
+  if (previous && previous->previous_sibling && cssnode->next_sibling &&
+      gtk_css_node_declaration_equal (previous->decl, cssnode->decl))
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+collect_match_items (MatchJob               *job,
+                     GtkCssNode             *cssnode,
+                     GtkStyleProvider       *parent_provider,
+                     GtkCountingBloomFilter *filter)
+{
+  GtkStyleProvider *provider;
+  GtkCssNode *child;
+  gboolean bloomed = FALSE;
+
+  if (!cssnode->invalid)
+    return;
+
+  provider = gtk_css_node_get_style_provider_or_null (cssnode);
+  if (provider == NULL)
+    provider = parent_provider;
+
+  if (job->current_task >= 0)
+    {
+      MatchTask *task = &g_array_index (job->tasks, MatchTask, job->current_task);
+      MatchItem item = { cssnode, NULL, NULL };
+
+      if (gtk_css_node_needs_match (cssnode))
+        {
+          item.provider = provider;
+          job->n_matches++;
+        }
+
+      g_array_append_val (job->items, item);
+      task->n_items++;
+    }
+
+  for (child = gtk_css_node_get_first_child (cssnode);
+       child;
+       child = gtk_css_node_get_next_sibling (child))
+    {
+      if (!child->visible)
+        continue;
+
+      if (!bloomed)
+        {
+          gtk_css_node_declaration_add_bloom_hashes (cssnode->decl, filter);
+          bloomed = TRUE;
+        }
+
+      if (job->current_task < 0 ||
+          g_array_index (job->tasks, MatchTask, job->current_task).n_items >= NODES_PER_TASK)
+        {
+          MatchTask *task;
+
+          g_array_set_size (job->tasks, job->tasks->len + 1);
+          job->current_task = job->tasks->len - 1;
+          task = &g_array_index (job->tasks, MatchTask, job->current_task);
+          task->parent = cssnode;
+          task->first_item = job->items->len;
+          task->n_items = 0;
+          task->filter = *filter;
+        }
+
+      collect_match_items (job, child, provider, filter);
+    }
+
+  if (bloomed)
+    gtk_css_node_declaration_remove_bloom_hashes (cssnode->decl, filter);
+
+  /* Tasks don't leave the subtree of their parent */
+  if (job->current_task >= 0 &&
+      g_array_index (job->tasks, MatchTask, job->current_task).parent == cssnode)
+    job->current_task = -1;
+}
+
+static void
+match_task (MatchJob  *job,
+            MatchTask *task)
+{
+  GPtrArray *ancestors;
+  guint i;
+
+  ancestors = g_ptr_array_new ();
+
+  for (i = 0; i < task->n_items; i++)
+    {
+      MatchItem *item = &g_array_index (job->items, MatchItem, task->first_item + i);
+
+      /* Items are in tree order, so the parent of this node is either
+       * the parent of the task or on the stack of ancestors.
+       */
+      while (ancestors->len > 0 &&
+             g_ptr_array_index (ancestors, ancestors->len - 1) != item->node->parent)
+        {
+          GtkCssNode *ancestor = g_ptr_array_steal_index (ancestors, ancestors->len - 1);
+
+          gtk_css_node_declaration_remove_bloom_hashes (ancestor->decl, &task->filter);
+        }
+
+      if (item->provider)
+        item->match = gtk_css_match_new (item->provider, &task->filter, item->node);
+
+      gtk_css_node_declaration_add_bloom_hashes (item->node->decl, &task->filter);
+      g_ptr_array_add (ancestors, item->node);
+    }
+
+  g_ptr_array_unref (ancestors);
+}
+
+static void
+match_tasks (MatchJob *job)
+{
+  while (TRUE)
+    {
+      guint i = g_atomic_int_add (&job->next_task, 1);
+
+      if (i >= job->tasks->len)
+        break;
+
+      match_task (job, &g_array_index (job->tasks, MatchTask, i));
+    }
+}
+
+static void
+gtk_css_node_match_in_parallel (GtkCssNode *cssnode)
+{
+  GtkCountingBloomFilter filter = GTK_COUNTING_BLOOM_FILTER_INIT;
+  MatchJob job = { 0, };
+  guint i;
+
+  job.items = g_array_new (FALSE, FALSE, sizeof (MatchItem));
+  job.tasks = g_array_new (FALSE, FALSE, sizeof (MatchTask));
+  job.current_task = -1;
+
+  collect_match_items (&job, cssnode, gtk_css_node_get_style_provider (cssnode), &filter);
+
+  if (job.n_matches >= MIN_NODES_FOR_THREADS)
+    {
+      gdk_parallel_task_run ((GdkTaskFunc) match_tasks, &job, job.tasks->len);
+
+      prefetched_matches = g_hash_table_new_full (NULL, NULL,
+                                                  NULL, (GDestroyNotify) gtk_css_match_free);
+
+      for (i = 0; i < job.items->len; i++)
+        {
+          MatchItem *item = &g_array_index (job.items, MatchItem, i);
+
+          if (item->match)
+            g_hash_table_insert (prefetched_matches, item->node, item->match);
+        }
+
+      matched_nodes += job.n_matches;
+    }
+
+  g_array_unref (job.items);
+  g_array_unref (job.tasks);
+}
+
 static void
 gtk_css_node_validate_internal (GtkCssNode             *cssnode,
                                 GtkCountingBloomFilter *filter,
@@ -1372,15 +1765,27 @@ gtk_css_node_validate (GtkCssNode *cssnode)
 
   timestamp = gtk_css_node_get_timestamp (cssnode);
 
+  if (cssnode->radical_invalidations >= MIN_NODES_FOR_THREADS &&
+      g_get_num_processors () > 1 &&
+      !GTK_DEBUG_CHECK (CSS_NO_THREADS))
+    gtk_css_node_match_in_parallel (cssnode);
+
+  /* All of them are handled below */
+  cssnode->radical_invalidations = 0;
+
   gtk_css_node_validate_internal (cssnode, &filter, timestamp);
 
+  g_clear_pointer (&prefetched_matches, g_hash_table_unref);
+
   if (GDK_PROFILER_IS_RUNNING)
     {
       gdk_profiler_end_mark (before,  "css validation", "");
       gdk_profiler_set_int_counter (invalidated_nodes_counter, invalidated_nodes);
       gdk_profiler_set_int_counter (created_styles_counter, created_styles);
+      gdk_profiler_set_int_counter (matched_nodes_counter, matched_nodes);
       invalidated_nodes = 0;
       created_styles = 0;
+      matched_nodes = 0;
     }
 }
 
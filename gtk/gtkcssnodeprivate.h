@@ -52,6 +52,8 @@ struct _GtkCssNode
   GtkCssNodeStyleCache  *cache;                 /* cache for children to look up styles */
 
   GtkCssChange           pending_changes;       /* changes that accumulated since the style was last computed */
+  GtkCssChange           local_changes;         /* pending changes that no other node depends on */
+  int                    radical_invalidations; /* only on roots: invalidations in the tree that need a new match */
 
   guint                  visible :1;            /* node will be skipped when validating or computing styles */
   guint                  invalid :1;            /* node or a child needs to be validated (even if just for animation) */
@@ -149,6 +151,9 @@ void                    gtk_css_node_invalidate_frame_clock
 void                    gtk_css_node_invalidate         (GtkCssNode            *cssnode,
                                                          GtkCssChange           change);
 void                    gtk_css_node_validate           (GtkCssNode            *cssnode);
+void                    gtk_css_node_get_invalidation_stats
+                                                        (guint64               *n_restyled,
+                                                         guint64               *n_skipped);
 
 GtkStyleProvider *      gtk_css_node_get_style_provider (GtkCssNode            *cssnode) G_GNUC_PURE;
 
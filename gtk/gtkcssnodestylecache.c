@@ -20,7 +20,9 @@
 #include "gtkcssnodestylecacheprivate.h"
 
 #include "gtkdebug.h"
+#include "gtkcssnodeprivate.h"
 #include "gtkcssstaticstyleprivate.h"
+#include "gtkstyleproviderprivate.h"
 
 struct _GtkCssNodeStyleCache {
   guint        ref_count;
@@ -180,3 +182,386 @@ gtk_css_node_style_cache_lookup (GtkCssNodeStyleCache        *parent,
   return gtk_css_node_style_cache_ref (result);
 }
 
+
+/* Shared styles
+ *
+ * The caches above only share styles between children of the same
+ * parent. Identical rows in different lists or identical buttons in
+ * different toolbars end up with styles of their own.
+ *
+ * So we also keep an application-wide table of styles, keyed by
+ * the declaration, the position flags, the style provider and the
+ * (static) style of the parent, which is all that goes into
+ * computing a style, apart from the matched selectors.
+ * Selectors can look at ancestors too. Styles that depend on them
+ * remember the declarations of all ancestors, and are only shared
+ * with nodes that have the same ones. Styles that depend on the
+ * siblings or position of the node or of an ancestor are never
+ * shared.
+ *
+ * Whether a style may be shared depends on the selectors that could
+ * match any ancestors, not just the ones this node has. Finding those
+ * means matching the selectors without the bloom filter, so the result
+ * is remembered per provider and declaration.
+ *
+ * The tables are cleared whenever a style provider changes. Entries
+ * that nobody else uses are pruned whenever the table has doubled
+ * in size.
+ */
+
+#define SHARED_STYLES_MIN_PRUNE 1024
+#define SHARED_STYLES_MAX_CHAIN 8
+
+typedef struct {
+  GtkStyleProvider      *provider;
+  GtkCssStyle           *parent_style;
+  GtkCssNodeDeclaration *decl;
+  guint                  is_first : 1;
+  guint                  is_last  : 1;
+} SharedKey;
+
+typedef struct {
+  GtkStyleProvider      *provider;
+  GtkCssNodeDeclaration *decl;
+  GtkCssChange           change;
+} SharedChange;
+
+typedef struct {
+  GtkCssStyle            *style;
+  /* NULL if the style does not depend on ancestors */
+  GtkCssNodeDeclaration **ancestors;
+  guint                   n_ancestors;
+} SharedStyle;
+
+static GHashTable *shared_styles;
+static GHashTable *shared_changes;
+static guint shared_styles_generation;
+static guint shared_styles_prune_size = SHARED_STYLES_MIN_PRUNE;
+static guint n_shared_styles;
+static guint64 n_shared_lookups;
+static guint64 n_shared_hits;
+
+static guint
+shared_key_hash (gconstpointer item)
+{
+  const SharedKey *key = item;
+
+  return (gtk_css_node_declaration_hash (key->decl) << 2 | key->is_first << 1 | key->is_last)
+         ^ GPOINTER_TO_UINT (key->parent_style)
+         ^ GPOINTER_TO_UINT (key->provider);
+}
+
+static gboolean
+shared_key_equal (gconstpointer item1,
+                  gconstpointer item2)
+{
+  const SharedKey *key1 = item1;
+  const SharedKey *key2 = item2;
+
+  return key1->provider == key2->provider &&
+         key1->parent_style == key2->parent_style &&
+         key1->is_first == key2->is_first &&
+         key1->is_last == key2->is_last &&
+         gtk_css_node_declaration_equal (key1->decl, key2->decl);
+}
+
+static void
+shared_key_free (gpointer data)
+{
+  SharedKey *key = data;
+
+  g_object_unref (key->provider);
+  g_object_unref (key->parent_style);
+  gtk_css_node_declaration_unref (key->decl);
+
+  g_slice_free (SharedKey, key);
+}
+
+static guint
+shared_change_hash (gconstpointer item)
+{
+  const SharedChange *change = item;
+
+  return gtk_css_node_declaration_hash (change->decl)
+         ^ GPOINTER_TO_UINT (change->provider);
+}
+
+static gboolean
+shared_change_equal (gconstpointer item1,
+                     gconstpointer item2)
+{
+  const SharedChange *change1 = item1;
+  const SharedChange *change2 = item2;
+
+  return change1->provider == change2->provider &&
+         gtk_css_node_declaration_equal (change1->decl, change2->decl);
+}
+
+static void
+shared_change_free (gpointer data)
+{
+  SharedChange *change = data;
+
+  g_object_unref (change->provider);
+  gtk_css_node_declaration_unref (change->decl);
+
+  g_slice_free (SharedChange, change);
+}
+
+static void
+shared_style_free (gpointer data)
+{
+  SharedStyle *shared = data;
+  guint i;
+
+  g_object_unref (shared->style);
+  for (i = 0; i < shared->n_ancestors; i++)
+    gtk_css_node_declaration_unref (shared->ancestors[i]);
+  g_free (shared->ancestors);
+
+  g_slice_free (SharedStyle, shared);
+
+  n_shared_styles--;
+}
+
+static void
+shared_styles_prune (void)
+{
+  GHashTableIter iter;
+  GPtrArray *chain;
+
+  g_hash_table_iter_init (&iter, shared_styles);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &chain))
+    {
+      guint i;
+
+      for (i = chain->len; i-- > 0; )
+        {
+          SharedStyle *shared = g_ptr_array_index (chain, i);
+
+          /* Only the table holds on to the style */
+          if (G_OBJECT (shared->style)->ref_count == 1)
+            g_ptr_array_remove_index_fast (chain, i);
+        }
+
+      if (chain->len == 0)
+        g_hash_table_iter_remove (&iter);
+    }
+
+  /* Cheap to recompute, and otherwise keeps declarations alive */
+  g_hash_table_remove_all (shared_changes);
+
+  shared_styles_prune_size = MAX (SHARED_STYLES_MIN_PRUNE, 2 * n_shared_styles);
+}
+
+static GHashTable *
+get_shared_styles (void)
+{
+  guint generation = gtk_style_provider_get_generation ();
+
+  if (shared_styles == NULL)
+    {
+      shared_styles = g_hash_table_new_full (shared_key_hash,
+                                             shared_key_equal,
+                                             shared_key_free,
+                                             (GDestroyNotify) g_ptr_array_unref);
+      shared_changes = g_hash_table_new_full (shared_change_hash,
+                                              shared_change_equal,
+                                              shared_change_free,
+                                              NULL);
+    }
+  else if (shared_styles_generation != generation)
+    {
+      g_hash_table_remove_all (shared_styles);
+      g_hash_table_remove_all (shared_changes);
+    }
+
+  shared_styles_generation = generation;
+
+  return shared_styles;
+}
+
+static gboolean
+ancestors_match (const SharedStyle *shared,
+                 GtkCssNode        *parent)
+{
+  guint i;
+
+  if (shared->ancestors == NULL)
+    return TRUE;
+
+  for (i = 0; i < shared->n_ancestors; i++)
+    {
+      if (parent == NULL ||
+          !gtk_css_node_declaration_equal (shared->ancestors[i],
+                                           gtk_css_node_get_declaration (parent)))
+        return FALSE;
+
+      parent = gtk_css_node_get_parent (parent);
+    }
+
+  return parent == NULL;
+}
+
+/* The change flags of a style are computed with the bloom filter of
+ * the node's ancestors, so they miss selectors that look for ancestors
+ * this node doesn't have, but other nodes might. This gets the change
+ * without the filter, which only depends on the node's declaration.
+ * Call get_shared_styles() first, so the table is current.
+ */
+static GtkCssChange
+get_unfiltered_change (GtkStyleProvider      *provider,
+                       GtkCssNode            *node,
+                       GtkCssNodeDeclaration *decl)
+{
+  SharedChange key, *change;
+
+  key.provider = provider;
+  key.decl = decl;
+
+  change = g_hash_table_lookup (shared_changes, &key);
+  if (change == NULL)
+    {
+      change = g_slice_new (SharedChange);
+      change->provider = g_object_ref (provider);
+      change->decl = gtk_css_node_declaration_ref (decl);
+      change->change = gtk_style_provider_get_change (provider, node);
+      g_hash_table_add (shared_changes, change);
+    }
+
+  return change->change;
+}
+
+/* Returns a style computed for another node with the same declaration,
+ * position flags, provider and parent style, or %NULL.
+ */
+GtkCssStyle *
+gtk_css_node_style_cache_lookup_shared (GtkStyleProvider            *provider,
+                                        GtkCssNode                  *parent,
+                                        const GtkCssNodeDeclaration *decl,
+                                        gboolean                     is_first,
+                                        gboolean                     is_last)
+{
+  GtkCssStyle *parent_style;
+  GPtrArray *chain;
+  SharedKey key;
+  guint i;
+
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (NO_CSS_CACHE))
+    return NULL;
+#endif
+
+  parent_style = gtk_css_node_get_style (parent);
+  if (!gtk_css_style_is_static (parent_style))
+    return NULL;
+
+  n_shared_lookups++;
+
+  key.provider = provider;
+  key.parent_style = parent_style;
+  key.decl = (GtkCssNodeDeclaration *) decl;
+  key.is_first = is_first;
+  key.is_last = is_last;
+
+  chain = g_hash_table_lookup (get_shared_styles (), &key);
+  if (chain == NULL)
+    return NULL;
+
+  for (i = 0; i < chain->len; i++)
+    {
+      SharedStyle *shared = g_ptr_array_index (chain, i);
+
+      if (ancestors_match (shared, parent))
+        {
+          n_shared_hits++;
+          return shared->style;
+        }
+    }
+
+  return NULL;
+}
+
+void
+gtk_css_node_style_cache_insert_shared (GtkStyleProvider      *provider,
+                                        GtkCssNode            *node,
+                                        GtkCssNodeDeclaration *decl,
+                                        gboolean               is_first,
+                                        gboolean               is_last,
+                                        GtkCssStyle           *style)
+{
+  GtkCssNode *parent = gtk_css_node_get_parent (node);
+  GtkCssStyle *parent_style;
+  GHashTable *table;
+  GPtrArray *chain;
+  SharedStyle *shared;
+  SharedKey key;
+  GtkCssChange change;
+
+  if (!may_be_stored_in_cache (style))
+    return;
+
+  parent_style = gtk_css_node_get_style (parent);
+  if (!gtk_css_style_is_static (parent_style))
+    return;
+
+  table = get_shared_styles ();
+
+  change = get_unfiltered_change (provider, node, decl);
+  if (change & (GTK_CSS_CHANGE_ANY_PARENT_SIBLING |
+                GTK_CSS_CHANGE_POSITION << GTK_CSS_CHANGE_PARENT_SHIFT))
+    return;
+
+  key.provider = provider;
+  key.parent_style = parent_style;
+  key.decl = decl;
+  key.is_first = is_first;
+  key.is_last = is_last;
+
+  chain = g_hash_table_lookup (table, &key);
+  if (chain == NULL)
+    {
+      SharedKey *new_key = g_slice_dup (SharedKey, &key);
+
+      g_object_ref (new_key->provider);
+      g_object_ref (new_key->parent_style);
+      gtk_css_node_declaration_ref (new_key->decl);
+
+      chain = g_ptr_array_new_with_free_func (shared_style_free);
+      g_hash_table_insert (table, new_key, chain);
+    }
+  else if (chain->len >= SHARED_STYLES_MAX_CHAIN)
+    return;
+
+  shared = g_slice_new0 (SharedStyle);
+  shared->style = g_object_ref (style);
+
+  if (change & GTK_CSS_CHANGE_ANY_PARENT)
+    {
+      GtkCssNode *ancestor;
+      guint i;
+
+      for (ancestor = parent; ancestor; ancestor = gtk_css_node_get_parent (ancestor))
+        shared->n_ancestors++;
+
+      shared->ancestors = g_new (GtkCssNodeDeclaration *, shared->n_ancestors);
+      for (ancestor = parent, i = 0; ancestor; ancestor = gtk_css_node_get_parent (ancestor), i++)
+        shared->ancestors[i] = gtk_css_node_declaration_ref ((GtkCssNodeDeclaration *) gtk_css_node_get_declaration (ancestor));
+    }
+
+  g_ptr_array_add (chain, shared);
+  n_shared_styles++;
+
+  if (n_shared_styles > shared_styles_prune_size)
+    shared_styles_prune ();
+}
+
+void
+gtk_css_node_style_cache_get_shared_stats (guint   *n_styles,
+                                           guint64 *n_lookups,
+                                           guint64 *n_hits)
+{
+  *n_styles = n_shared_styles;
+  *n_lookups = n_shared_lookups;
+  *n_hits = n_shared_hits;
+}
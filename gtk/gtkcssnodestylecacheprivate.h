@@ -41,6 +41,22 @@ GtkCssNodeStyleCache *  gtk_css_node_style_cache_lookup         (GtkCssNodeStyle
                                                                  gboolean                     is_first,
                                                                  gboolean                     is_last);
 
+GtkCssStyle *           gtk_css_node_style_cache_lookup_shared  (GtkStyleProvider            *provider,
+                                                                 GtkCssNode                  *parent,
+                                                                 const GtkCssNodeDeclaration *decl,
+                                                                 gboolean                     is_first,
+                                                                 gboolean                     is_last);
+void                    gtk_css_node_style_cache_insert_shared  (GtkStyleProvider            *provider,
+                                                                 GtkCssNode                  *node,
+                                                                 GtkCssNodeDeclaration       *decl,
+                                                                 gboolean                     is_first,
+                                                                 gboolean                     is_last,
+                                                                 GtkCssStyle                 *style);
+
+void                    gtk_css_node_style_cache_get_shared_stats (guint                  *n_styles,
+                                                                   guint64                *n_lookups,
+                                                                   guint64                *n_hits);
+
 G_END_DECLS
 
 #endif /* __GTK_CSS_NODE_STYLE_CACHE_PRIVATE_H__ */
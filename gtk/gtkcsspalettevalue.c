@@ -247,6 +247,7 @@ static const GtkCssValueClass GTK_CSS_VALUE_PALETTE = {
   gtk_css_value_palette_free,
   gtk_css_value_palette_compute,
   gtk_css_value_palette_equal,
+  NULL,
   gtk_css_value_palette_transition,
   NULL,
   NULL,
@@ -39,6 +39,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <glib/gstdio.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include "gdk/gdkprofilerprivate.h"
@@ -112,6 +113,18 @@ struct GtkCssRuleset
   guint owns_styles : 1;
 };
 
+/* Used while collecting a stylesheet for the cache */
+typedef struct {
+  GFile *file;
+  GBytes *bytes;
+} CacheFile;
+
+typedef struct {
+  GFile *file;
+  gsize start;
+  gsize end;
+} CacheRange;
+
 struct _GtkCssScanner
 {
   GtkCssProvider *provider;
@@ -130,6 +143,15 @@ struct _GtkCssProviderPrivate
   GtkCssSelectorTree *tree;
   GResource *resource;
   char *path;
+
+  /* While loading a stylesheet that will be saved to the cache,
+   * the files it was loaded from and its @define-color and
+   * @keyframes rules, otherwise NULL
+   */
+  GArray *cache_files;
+  GArray *cache_at_rules;
+  guint cache_failed : 1;
+  guint reading_cache : 1;
 };
 
 enum {
@@ -300,7 +322,7 @@ gtk_css_ruleset_add (GtkCssRuleset       *ruleset,
     }
 
   ruleset->styles[i].value = value;
-  if (gtk_keep_css_sections)
+  if (section)
     ruleset->styles[i].section = gtk_css_section_ref (section);
   else
     ruleset->styles[i].section = NULL;
@@ -331,8 +353,17 @@ gtk_css_scanner_parser_error (GtkCssParser         *parser,
                               gpointer              user_data)
 {
   GtkCssScanner *scanner = user_data;
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (scanner->provider);
   GtkCssSection *section;
 
+  /* The cache only holds stylesheets without errors, so that the
+   * errors are reported every time. Errors in the cache itself mean
+   * that it is broken, and we parse the stylesheet instead.
+   */
+  priv->cache_failed = TRUE;
+  if (priv->reading_cache)
+    return;
+
   section = gtk_css_section_new (gtk_css_parser_get_file (parser),
                                  start,
                                  end);
@@ -506,12 +537,26 @@ gtk_css_style_provider_lookup (GtkStyleProvider             *provider,
     *change = gtk_css_selector_tree_get_change_all (priv->tree, filter, node);
 }
 
+static GtkCssChange
+gtk_css_style_provider_get_change (GtkStyleProvider *provider,
+                                   GtkCssNode       *node)
+{
+  GtkCssProvider *css_provider = GTK_CSS_PROVIDER (provider);
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+
+  if (_gtk_css_selector_tree_is_empty (priv->tree))
+    return 0;
+
+  return gtk_css_selector_tree_get_change_all (priv->tree, NULL, node);
+}
+
 static void
 gtk_css_style_provider_iface_init (GtkStyleProviderInterface *iface)
 {
   iface->get_color = gtk_css_style_provider_get_color;
   iface->get_keyframes = gtk_css_style_provider_get_keyframes;
   iface->lookup = gtk_css_style_provider_lookup;
+  iface->get_change = gtk_css_style_provider_get_change;
   iface->emit_error = gtk_css_style_provider_emit_error;
 }
 
@@ -752,16 +797,37 @@ parse_keyframes (GtkCssScanner *scanner)
 static void
 parse_at_keyword (GtkCssScanner *scanner)
 {
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (scanner->provider);
+  gboolean cache_rule = priv->cache_files != NULL;
+  gsize start;
+
+  start = gtk_css_parser_get_start_location (scanner->parser)->bytes;
+
   gtk_css_parser_start_semicolon_block (scanner->parser, GTK_CSS_TOKEN_OPEN_CURLY);
 
-  if (!parse_import (scanner) &&
-      !parse_color_definition (scanner) &&
-      !parse_keyframes (scanner))
+  if (parse_import (scanner))
+    {
+      /* The imported file is saved to the cache instead */
+      cache_rule = FALSE;
+    }
+  else if (!parse_color_definition (scanner) &&
+           !parse_keyframes (scanner))
     {
       gtk_css_parser_error_syntax (scanner->parser, "Unknown @ rule");
     }
 
   gtk_css_parser_end_block (scanner->parser);
+
+  if (cache_rule)
+    {
+      CacheRange range;
+
+      gtk_css_parser_get_token (scanner->parser);
+      range.file = gtk_css_parser_get_file (scanner->parser);
+      range.start = start;
+      range.end = gtk_css_parser_get_start_location (scanner->parser)->bytes;
+      g_array_append_val (priv->cache_at_rules, range);
+    }
 }
 
 static void
@@ -788,6 +854,7 @@ static void
 parse_declaration (GtkCssScanner *scanner,
                    GtkCssRuleset *ruleset)
 {
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (scanner->provider);
   GtkStyleProperty *property;
   char *name;
 
@@ -836,6 +903,15 @@ parse_declaration (GtkCssScanner *scanner,
                                          gtk_css_parser_get_block_location (scanner->parser),
                                          gtk_css_parser_get_end_location (scanner->parser));
         }
+      else if (priv->cache_files)
+        {
+          /* The cache takes the text of the declaration from the section,
+           * so don't include the ';' or '}' after it.
+           */
+          section = gtk_css_section_new (gtk_css_parser_get_file (scanner->parser),
+                                         gtk_css_parser_get_block_location (scanner->parser),
+                                         gtk_css_parser_get_start_location (scanner->parser));
+        }
       else
         section = NULL;
 
@@ -1011,6 +1087,750 @@ gtk_css_provider_postprocess (GtkCssProvider *css_provider)
   gdk_profiler_end_mark (before, "create selector tree", NULL);
 }
 
+/* Stylesheet cache
+ *
+ * Large stylesheets, like the built-in themes, are saved after they
+ * have been loaded, in $XDG_CACHE_HOME/gtk-4.0/css, keyed by a hash of
+ * the main file and of this build of GTK. The cache is a GVariant that
+ * is mapped into memory when loading. It holds
+ * - the imported files, with a hash of their contents
+ * - the text of the @define-color and @keyframes rules
+ * - the text of each distinct declaration, parsed only once when loading
+ * - the style lists of the rulesets, as pairs of property ids and
+ *   declarations
+ * - the style list of each ruleset, in the sorted order
+ * - the selector tree, see gtk_css_selector_tree_save()
+ * so loading it skips parsing selectors, sorting rulesets and building
+ * the selector tree, and most of the value parsing.
+ *
+ * Only stylesheets that loaded without errors or warnings are saved,
+ * so that messages are still reported each time.
+ *
+ * The hash also covers the struct layouts that end up in the file, so
+ * different builds of the same version don't read each other's files.
+ * Loading a file updates its modification time, and after saving, the
+ * least recently used files are removed until the directory is below
+ * CACHE_MAX_FILES and CACHE_MAX_SIZE again.
+ */
+
+#define CACHE_MAGIC "GTKCSS02"
+#define CACHE_FORMAT "(a(ss)a(us)a(usu)aa(uu)auay)"
+#define CACHE_MIN_SIZE 8192
+#define CACHE_MAX_FILES 16
+#define CACHE_MAX_SIZE (8 * 1024 * 1024)
+
+static void
+cache_file_clear (gpointer data)
+{
+  CacheFile *cache_file = data;
+
+  g_clear_object (&cache_file->file);
+  g_bytes_unref (cache_file->bytes);
+}
+
+static char *
+gtk_css_provider_get_cache_path (GFile  *file,
+                                 GBytes *bytes)
+{
+  GChecksum *checksum;
+  guint32 build[7];
+  char *uri;
+  char *basename;
+  char *path;
+  guint i;
+
+  if (gtk_keep_css_sections ||
+      g_getenv ("GTK_NO_STYLESHEET_CACHE") != NULL)
+    return NULL;
+
+  /* Files can import others, so they might be large in the end */
+  if (file == NULL && g_bytes_get_size (bytes) < CACHE_MIN_SIZE)
+    return NULL;
+
+#ifdef VERIFY_TREE
+  /* Loading from the cache does not keep the selectors */
+  return NULL;
+#endif
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+  g_checksum_update (checksum, (const guchar *) CACHE_MAGIC, strlen (CACHE_MAGIC));
+  build[0] = GTK_MAJOR_VERSION;
+  build[1] = GTK_MINOR_VERSION;
+  build[2] = GTK_MICRO_VERSION;
+  build[3] = sizeof (gpointer);
+  build[4] = _gtk_css_style_property_get_n_properties ();
+  build[5] = sizeof (GtkCssRuleset);
+  build[6] = sizeof (PropertyValue);
+  g_checksum_update (checksum, (const guchar *) build, sizeof (build));
+
+  gtk_css_selector_tree_update_checksum (checksum);
+
+  /* Property ids are saved, so they must mean the same when loading */
+  for (i = 0; i < _gtk_css_style_property_get_n_properties (); i++)
+    {
+      const char *name = _gtk_style_property_get_name (GTK_STYLE_PROPERTY (_gtk_css_style_property_lookup_by_id (i)));
+
+      g_checksum_update (checksum, (const guchar *) name, strlen (name) + 1);
+    }
+
+  /* Relative urls are resolved against the file */
+  uri = file ? g_file_get_uri (file) : g_strdup ("");
+  g_checksum_update (checksum, (const guchar *) uri, strlen (uri) + 1);
+  g_free (uri);
+
+  g_checksum_update (checksum, g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes));
+
+  basename = g_strdup_printf ("%s.cache", g_checksum_get_string (checksum));
+  path = g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "css", basename, NULL);
+
+  g_checksum_free (checksum);
+  g_free (basename);
+
+  return path;
+}
+
+static char *
+compute_file_checksum (GBytes *bytes)
+{
+  return g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, bytes);
+}
+
+static gboolean
+cache_file_is_current (GFile      *file,
+                       const char *checksum)
+{
+  GBytes *bytes;
+  char *current;
+  gboolean result;
+
+  bytes = g_file_load_bytes (file, NULL, NULL, NULL);
+  if (bytes == NULL)
+    return FALSE;
+
+  current = compute_file_checksum (bytes);
+  result = g_str_equal (current, checksum);
+
+  g_free (current);
+  g_bytes_unref (bytes);
+
+  return result;
+}
+
+static void
+gtk_css_provider_parse_cached (GtkCssProvider *self,
+                               GFile          *file,
+                               const char     *text,
+                               GtkCssRuleset  *declarations,
+                               guint           n_declarations)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (self);
+  GtkCssScanner *scanner;
+  GBytes *bytes;
+  guint i;
+
+  bytes = g_bytes_new_static (text, strlen (text));
+  scanner = gtk_css_scanner_new (self, NULL, file, bytes);
+
+  if (declarations == NULL)
+    {
+      parse_stylesheet (scanner);
+    }
+  else
+    {
+      /* Each declaration is parsed like in a ruleset of its own */
+      for (i = 0; i < n_declarations; i++)
+        {
+          if (gtk_css_parser_has_token (scanner->parser, GTK_CSS_TOKEN_EOF))
+            break;
+
+          parse_declaration (scanner, &declarations[i]);
+        }
+
+      if (i < n_declarations ||
+          !gtk_css_parser_has_token (scanner->parser, GTK_CSS_TOKEN_EOF))
+        priv->cache_failed = TRUE;
+    }
+
+  gtk_css_scanner_destroy (scanner);
+  g_bytes_unref (bytes);
+}
+
+static gboolean
+gtk_css_provider_read_cache (GtkCssProvider *self,
+                             GFile          *file,
+                             GVariant       *cache)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (self);
+  GVariant *files, *at_rules, *declarations, *style_lists, *rulesets, *tree;
+  GPtrArray *gfiles;
+  GtkCssRuleset *parsed = NULL;
+  PropertyValue **styles;
+  guint *n_styles;
+  gboolean *owned;
+  GBytes *bytes;
+  const guint32 *ruleset_styles;
+  gsize n_rulesets;
+  guint n_declarations, n_style_lists, n_properties;
+  guint i, j;
+  gboolean result = FALSE;
+
+  files = g_variant_get_child_value (cache, 0);
+  at_rules = g_variant_get_child_value (cache, 1);
+  declarations = g_variant_get_child_value (cache, 2);
+  style_lists = g_variant_get_child_value (cache, 3);
+  rulesets = g_variant_get_child_value (cache, 4);
+  tree = g_variant_get_child_value (cache, 5);
+
+  n_style_lists = g_variant_n_children (style_lists);
+  n_properties = _gtk_css_style_property_get_n_properties ();
+  styles = g_new0 (PropertyValue *, n_style_lists);
+  n_styles = g_new0 (guint, n_style_lists);
+  owned = g_new0 (gboolean, n_style_lists);
+  gfiles = g_ptr_array_new ();
+
+  priv->reading_cache = TRUE;
+  priv->cache_failed = FALSE;
+
+  /* The first file is the main file, which is covered by the
+   * cache key. Imported files must not have changed.
+   */
+  for (i = 0; i < g_variant_n_children (files); i++)
+    {
+      const char *uri, *checksum;
+      GFile *gfile;
+
+      g_variant_get_child (files, i, "(&s&s)", &uri, &checksum);
+
+      if (i == 0)
+        {
+          g_ptr_array_add (gfiles, file);
+          continue;
+        }
+
+      gfile = g_file_new_for_uri (uri);
+      g_ptr_array_add (gfiles, gfile);
+
+      if (!cache_file_is_current (gfile, checksum))
+        goto out;
+    }
+
+  for (i = 0; i < g_variant_n_children (at_rules); i++)
+    {
+      const char *text;
+      guint file_index;
+
+      g_variant_get_child (at_rules, i, "(u&s)", &file_index, &text);
+      if (file_index >= gfiles->len)
+        goto out;
+
+      gtk_css_provider_parse_cached (self, g_ptr_array_index (gfiles, file_index), text, NULL, 0);
+    }
+
+  n_declarations = 0;
+  for (i = 0; i < g_variant_n_children (declarations); i++)
+    {
+      const char *text;
+      guint file_index, n;
+
+      g_variant_get_child (declarations, i, "(u&su)", &file_index, &text, &n);
+
+      /* Every declaration takes at least 2 bytes */
+      if (file_index >= gfiles->len || n > strlen (text) / 2)
+        goto out;
+
+      parsed = g_renew (GtkCssRuleset, parsed, n_declarations + n);
+      memset (parsed + n_declarations, 0, n * sizeof (GtkCssRuleset));
+      gtk_css_provider_parse_cached (self, g_ptr_array_index (gfiles, file_index), text, parsed + n_declarations, n);
+      n_declarations += n;
+    }
+
+  if (priv->cache_failed)
+    goto out;
+
+  for (i = 0; i < n_style_lists; i++)
+    {
+      GVariant *list = g_variant_get_child_value (style_lists, i);
+      const guint32 *entries;
+      gsize n_entries;
+
+      entries = g_variant_get_fixed_array (list, &n_entries, 2 * sizeof (guint32));
+      styles[i] = g_new (PropertyValue, n_entries);
+      n_styles[i] = 0;
+
+      for (j = 0; j < n_entries; j++)
+        {
+          guint property_id = entries[2 * j];
+          guint declaration = entries[2 * j + 1];
+          GtkCssStyleProperty *property;
+          guint k;
+
+          if (property_id >= n_properties || declaration >= n_declarations)
+            break;
+
+          property = _gtk_css_style_property_lookup_by_id (property_id);
+          for (k = 0; k < parsed[declaration].n_styles; k++)
+            {
+              if (parsed[declaration].styles[k].property == property)
+                break;
+            }
+          if (k == parsed[declaration].n_styles)
+            break;
+
+          styles[i][j].property = property;
+          styles[i][j].value = _gtk_css_value_ref (parsed[declaration].styles[k].value);
+          styles[i][j].section = NULL;
+          n_styles[i]++;
+        }
+
+      g_variant_unref (list);
+
+      if (n_entries == 0 || j < n_entries)
+        goto out;
+    }
+
+  ruleset_styles = g_variant_get_fixed_array (rulesets, &n_rulesets, sizeof (guint32));
+  g_array_set_size (priv->rulesets, n_rulesets);
+  memset (priv->rulesets->data, 0, n_rulesets * sizeof (GtkCssRuleset));
+  for (i = 0; i < n_rulesets; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      guint list = ruleset_styles[i];
+
+      if (list >= n_style_lists)
+        goto out;
+
+      ruleset->styles = styles[list];
+      ruleset->n_styles = n_styles[list];
+      ruleset->owns_styles = !owned[list];
+      owned[list] = TRUE;
+    }
+
+  bytes = g_variant_get_data_as_bytes (tree);
+  result = gtk_css_selector_tree_load (bytes,
+                                       priv->rulesets->data,
+                                       sizeof (GtkCssRuleset),
+                                       priv->rulesets->len,
+                                       G_STRUCT_OFFSET (GtkCssRuleset, selector_match),
+                                       &priv->tree);
+  g_bytes_unref (bytes);
+
+out:
+  for (i = 0; i < n_style_lists; i++)
+    {
+      if (!owned[i] && styles[i] != NULL)
+        {
+          for (j = 0; j < n_styles[i]; j++)
+            _gtk_css_value_unref (styles[i][j].value);
+          g_free (styles[i]);
+        }
+    }
+  for (i = 0; i < n_declarations; i++)
+    gtk_css_ruleset_clear (&parsed[i]);
+
+  g_free (parsed);
+  g_free (styles);
+  g_free (n_styles);
+  g_free (owned);
+  for (i = 1; i < gfiles->len; i++)
+    g_object_unref (g_ptr_array_index (gfiles, i));
+  g_ptr_array_unref (gfiles);
+
+  g_variant_unref (files);
+  g_variant_unref (at_rules);
+  g_variant_unref (declarations);
+  g_variant_unref (style_lists);
+  g_variant_unref (rulesets);
+  g_variant_unref (tree);
+
+  priv->reading_cache = FALSE;
+
+  return result;
+}
+
+static gboolean
+gtk_css_provider_load_cache (GtkCssProvider *self,
+                             GFile          *file,
+                             const char     *path)
+{
+  GMappedFile *mapped;
+  GVariant *cache;
+  GBytes *bytes;
+  gboolean result;
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped == NULL)
+    return FALSE;
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  cache = g_variant_new_from_bytes (G_VARIANT_TYPE (CACHE_FORMAT), bytes, FALSE);
+  g_variant_ref_sink (cache);
+  g_bytes_unref (bytes);
+
+  result = gtk_css_provider_read_cache (self, file, cache);
+
+  g_variant_unref (cache);
+
+  if (!result)
+    {
+      g_unlink (path);
+      gtk_css_provider_reset (self);
+    }
+  else
+    {
+      /* Keep it from being trimmed */
+      g_utime (path, NULL);
+    }
+
+  return result;
+}
+
+typedef struct {
+  char *path;
+  gint64 mtime;
+  goffset size;
+} CacheEntry;
+
+static int
+compare_cache_entries (gconstpointer a,
+                       gconstpointer b)
+{
+  const CacheEntry *entry_a = a;
+  const CacheEntry *entry_b = b;
+
+  /* Most recently used first */
+  if (entry_a->mtime > entry_b->mtime)
+    return -1;
+  else if (entry_a->mtime < entry_b->mtime)
+    return 1;
+  else
+    return 0;
+}
+
+static void
+gtk_css_provider_trim_cache (const char *dir,
+                             const char *saved_path)
+{
+  GArray *entries;
+  GDir *gdir;
+  const char *name;
+  goffset total_size;
+  guint i;
+
+  gdir = g_dir_open (dir, 0, NULL);
+  if (gdir == NULL)
+    return;
+
+  entries = g_array_new (FALSE, FALSE, sizeof (CacheEntry));
+
+  while ((name = g_dir_read_name (gdir)) != NULL)
+    {
+      CacheEntry entry;
+      GStatBuf buf;
+
+      if (!g_str_has_suffix (name, ".cache"))
+        continue;
+
+      entry.path = g_build_filename (dir, name, NULL);
+      if (g_stat (entry.path, &buf) != 0)
+        {
+          g_free (entry.path);
+          continue;
+        }
+
+      /* Timestamps are coarse, never remove the file that was just saved */
+      entry.mtime = g_str_equal (entry.path, saved_path) ? G_MAXINT64 : buf.st_mtime;
+      entry.size = buf.st_size;
+      g_array_append_val (entries, entry);
+    }
+
+  g_dir_close (gdir);
+
+  g_array_sort (entries, compare_cache_entries);
+
+  total_size = 0;
+  for (i = 0; i < entries->len; i++)
+    {
+      CacheEntry *entry = &g_array_index (entries, CacheEntry, i);
+
+      total_size += entry->size;
+      if (i >= CACHE_MAX_FILES || total_size > CACHE_MAX_SIZE)
+        g_unlink (entry->path);
+
+      g_free (entry->path);
+    }
+
+  g_array_unref (entries);
+}
+
+static guint
+find_cache_file (GArray *files,
+                 GFile  *file)
+{
+  guint i;
+
+  for (i = 0; i < files->len; i++)
+    {
+      if (g_array_index (files, CacheFile, i).file == file)
+        return i;
+    }
+
+  return G_MAXUINT;
+}
+
+static void
+gtk_css_provider_save_cache (GtkCssProvider *self,
+                             const char     *path)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (self);
+  GVariantBuilder files, at_rules, declarations, style_lists, rulesets;
+  GHashTable **declaration_ids;
+  GString **declaration_texts;
+  guint *n_declarations;
+  guint *first_declaration;
+  GHashTable *style_list_ids;
+  GArray *entries;
+  GString *text;
+  GVariant *cache;
+  GBytes *tree;
+  gsize total_size;
+  guint last_file;
+  gboolean in_list;
+  gboolean valid = TRUE;
+  guint n_files;
+  guint i, j;
+  char *dir;
+
+  n_files = priv->cache_files->len;
+
+  total_size = 0;
+  for (i = 0; i < n_files; i++)
+    total_size += g_bytes_get_size (g_array_index (priv->cache_files, CacheFile, i).bytes);
+  if (total_size < CACHE_MIN_SIZE)
+    return;
+
+  g_variant_builder_init (&files, G_VARIANT_TYPE ("a(ss)"));
+  for (i = 0; i < n_files; i++)
+    {
+      CacheFile *cache_file = &g_array_index (priv->cache_files, CacheFile, i);
+      char *uri, *checksum;
+
+      if (i == 0)
+        {
+          g_variant_builder_add (&files, "(ss)", "", "");
+          continue;
+        }
+
+      uri = g_file_get_uri (cache_file->file);
+      checksum = compute_file_checksum (cache_file->bytes);
+      g_variant_builder_add (&files, "(ss)", uri, checksum);
+      g_free (uri);
+      g_free (checksum);
+    }
+
+  /* Consecutive rules from the same file are parsed together */
+  g_variant_builder_init (&at_rules, G_VARIANT_TYPE ("a(us)"));
+  text = g_string_new (NULL);
+  last_file = G_MAXUINT;
+  for (i = 0; i < priv->cache_at_rules->len; i++)
+    {
+      CacheRange *range = &g_array_index (priv->cache_at_rules, CacheRange, i);
+      guint file_index = find_cache_file (priv->cache_files, range->file);
+      const char *data;
+      gsize size;
+
+      if (file_index == G_MAXUINT)
+        {
+          valid = FALSE;
+          break;
+        }
+
+      data = g_bytes_get_data (g_array_index (priv->cache_files, CacheFile, file_index).bytes, &size);
+      if (range->start > range->end || range->end > size)
+        {
+          valid = FALSE;
+          break;
+        }
+
+      if (file_index != last_file && last_file != G_MAXUINT)
+        {
+          g_variant_builder_add (&at_rules, "(us)", last_file, text->str);
+          g_string_truncate (text, 0);
+        }
+
+      g_string_append_len (text, data + range->start, range->end - range->start);
+      g_string_append_c (text, '\n');
+      last_file = file_index;
+    }
+  if (last_file != G_MAXUINT)
+    g_variant_builder_add (&at_rules, "(us)", last_file, text->str);
+  g_string_free (text, TRUE);
+
+  /* Collect the distinct declarations of each file first, so that they
+   * can be numbered in file order
+   */
+  declaration_ids = g_new (GHashTable *, n_files);
+  declaration_texts = g_new (GString *, n_files);
+  n_declarations = g_new0 (guint, n_files);
+  first_declaration = g_new0 (guint, n_files);
+  for (i = 0; i < n_files; i++)
+    {
+      declaration_ids[i] = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      declaration_texts[i] = g_string_new (NULL);
+    }
+
+  /* property id, file, declaration in the file */
+  entries = g_array_new (FALSE, FALSE, 3 * sizeof (guint));
+  style_list_ids = g_hash_table_new (NULL, NULL);
+  g_variant_builder_init (&rulesets, G_VARIANT_TYPE ("au"));
+
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      gpointer list;
+
+      /* Rulesets with several selectors share their styles */
+      if (!g_hash_table_lookup_extended (style_list_ids, ruleset->styles, NULL, &list))
+        {
+          list = GUINT_TO_POINTER (g_hash_table_size (style_list_ids));
+          g_hash_table_insert (style_list_ids, ruleset->styles, list);
+
+          for (j = 0; j < ruleset->n_styles; j++)
+            {
+              PropertyValue *value = &ruleset->styles[j];
+              guint entry[3];
+              guint file_index;
+              const char *data;
+              gsize start, end, size;
+              gpointer id;
+              char *declaration;
+
+              file_index = find_cache_file (priv->cache_files, gtk_css_section_get_file (value->section));
+              if (file_index == G_MAXUINT)
+                {
+                  valid = FALSE;
+                  continue;
+                }
+
+              data = g_bytes_get_data (g_array_index (priv->cache_files, CacheFile, file_index).bytes, &size);
+              start = gtk_css_section_get_start_location (value->section)->bytes;
+              end = gtk_css_section_get_end_location (value->section)->bytes;
+              if (start >= end || end > size)
+                {
+                  valid = FALSE;
+                  continue;
+                }
+
+              declaration = g_strndup (data + start, end - start);
+              if (!g_hash_table_lookup_extended (declaration_ids[file_index], declaration, NULL, &id))
+                {
+                  id = GUINT_TO_POINTER (n_declarations[file_index]++);
+                  g_string_append (declaration_texts[file_index], declaration);
+                  g_string_append (declaration_texts[file_index], ";\n");
+                  g_hash_table_insert (declaration_ids[file_index], declaration, id);
+                }
+              else
+                g_free (declaration);
+
+              entry[0] = _gtk_css_style_property_get_id (value->property);
+              entry[1] = file_index;
+              entry[2] = GPOINTER_TO_UINT (id);
+              g_array_append_vals (entries, entry, 1);
+            }
+
+          /* Terminate the list */
+          g_array_set_size (entries, entries->len + 1);
+          memset (&g_array_index (entries, guint, 3 * (entries->len - 1)), 0xff, 3 * sizeof (guint));
+        }
+
+      g_variant_builder_add (&rulesets, "u", GPOINTER_TO_UINT (list));
+    }
+
+  g_variant_builder_init (&declarations, G_VARIANT_TYPE ("a(usu)"));
+  for (i = 0; i < n_files; i++)
+    {
+      if (i > 0)
+        first_declaration[i] = first_declaration[i - 1] + n_declarations[i - 1];
+
+      if (n_declarations[i] > 0)
+        g_variant_builder_add (&declarations, "(usu)", i, declaration_texts[i]->str, n_declarations[i]);
+    }
+
+  g_variant_builder_init (&style_lists, G_VARIANT_TYPE ("aa(uu)"));
+  in_list = FALSE;
+  for (i = 0; i < entries->len; i++)
+    {
+      guint *entry = &g_array_index (entries, guint, 3 * i);
+
+      if (!in_list)
+        {
+          g_variant_builder_open (&style_lists, G_VARIANT_TYPE ("a(uu)"));
+          in_list = TRUE;
+        }
+
+      if (entry[0] == G_MAXUINT)
+        {
+          g_variant_builder_close (&style_lists);
+          in_list = FALSE;
+        }
+      else
+        {
+          g_variant_builder_add (&style_lists, "(uu)", entry[0], first_declaration[entry[1]] + entry[2]);
+        }
+    }
+
+  tree = gtk_css_selector_tree_save (priv->tree, priv->rulesets->data, sizeof (GtkCssRuleset));
+
+  cache = g_variant_new ("(a(ss)a(us)a(usu)aa(uu)au@ay)",
+                         &files,
+                         &at_rules,
+                         &declarations,
+                         &style_lists,
+                         &rulesets,
+                         g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING, tree, TRUE));
+  g_variant_ref_sink (cache);
+
+  dir = g_path_get_dirname (path);
+  if (valid && g_mkdir_with_parents (dir, 0755) == 0 &&
+      g_file_set_contents (path, g_variant_get_data (cache), g_variant_get_size (cache), NULL))
+    gtk_css_provider_trim_cache (dir, path);
+
+  g_free (dir);
+  g_variant_unref (cache);
+  g_bytes_unref (tree);
+  g_array_unref (entries);
+  g_hash_table_unref (style_list_ids);
+  for (i = 0; i < n_files; i++)
+    {
+      g_hash_table_unref (declaration_ids[i]);
+      g_string_free (declaration_texts[i], TRUE);
+    }
+  g_free (declaration_ids);
+  g_free (declaration_texts);
+  g_free (n_declarations);
+  g_free (first_declaration);
+}
+
+static void
+gtk_css_provider_clear_sections (GtkCssProvider *self)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (self);
+  guint i, j;
+
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+
+      if (!ruleset->owns_styles)
+        continue;
+
+      for (j = 0; j < ruleset->n_styles; j++)
+        g_clear_pointer (&ruleset->styles[j].section, gtk_css_section_unref);
+    }
+}
+
 static void
 gtk_css_provider_load_internal (GtkCssProvider *self,
                                 GtkCssScanner  *parent,
@@ -1051,7 +1871,35 @@ gtk_css_provider_load_internal (GtkCssProvider *self,
 
   if (bytes)
     {
+      GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (self);
       GtkCssScanner *scanner;
+      char *cache_path = NULL;
+
+      if (parent == NULL)
+        {
+          cache_path = gtk_css_provider_get_cache_path (file, bytes);
+          if (cache_path && gtk_css_provider_load_cache (self, file, cache_path))
+            {
+              g_free (cache_path);
+              g_bytes_unref (bytes);
+              goto out;
+            }
+        }
+
+      if (cache_path)
+        {
+          priv->cache_files = g_array_new (FALSE, FALSE, sizeof (CacheFile));
+          g_array_set_clear_func (priv->cache_files, cache_file_clear);
+          priv->cache_at_rules = g_array_new (FALSE, FALSE, sizeof (CacheRange));
+          priv->cache_failed = FALSE;
+        }
+
+      if (priv->cache_files)
+        {
+          CacheFile cache_file = { file ? g_object_ref (file) : NULL, g_bytes_ref (bytes) };
+
+          g_array_append_val (priv->cache_files, cache_file);
+        }
 
       scanner = gtk_css_scanner_new (self,
                                      parent,
@@ -1065,9 +1913,21 @@ gtk_css_provider_load_internal (GtkCssProvider *self,
       if (parent == NULL)
         gtk_css_provider_postprocess (self);
 
+      if (cache_path)
+        {
+          if (!priv->cache_failed)
+            gtk_css_provider_save_cache (self, cache_path);
+
+          gtk_css_provider_clear_sections (self);
+          g_clear_pointer (&priv->cache_files, g_array_unref);
+          g_clear_pointer (&priv->cache_at_rules, g_array_unref);
+          g_free (cache_path);
+        }
+
       g_bytes_unref (bytes);
     }
 
+out:
   if (GDK_PROFILER_IS_RUNNING)
     {
       char *uri = g_file_get_uri (file);
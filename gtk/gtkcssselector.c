@@ -2064,12 +2064,280 @@ _gtk_css_selector_tree_match_print (const GtkCssSelectorTree *tree,
     }
 }
 
+/* Dependencies
+ *
+ * Changing a class, the name or the state of a node always restyles the
+ * node itself. Its descendants and later siblings only need a restyle if
+ * a selector looks at that class, name or state outside of its rightmost
+ * compound selector, like .active in ".active label" or :hover in
+ * "button:hover ~ label". Every selector tree adds the classes, names and
+ * states it looks at there to a global index while it exists, and
+ * gtk_css_selector_get_dependent_change() looks them up, so that
+ * GtkCssNode only propagates the changes something depends on. The
+ * index covers the trees of all style providers, so it errs on the
+ * side of propagating for nodes that don't use all of them.
+ *
+ * Classes and states are indexed together with the name required by the
+ * compound selector they appear in, or 0 if there is none. So
+ * "button:hover label" makes hovering buttons propagate, but not hovering
+ * other nodes.
+ */
+
+typedef struct {
+  GtkCssChange change;
+  GQuark quark;
+  GQuark name;
+  guint n_trees;
+} GtkCssDependency;
+
+static const GtkCssChange state_changes[] = {
+  GTK_CSS_CHANGE_HOVER,
+  GTK_CSS_CHANGE_DISABLED,
+  GTK_CSS_CHANGE_BACKDROP,
+  GTK_CSS_CHANGE_SELECTED,
+  GTK_CSS_CHANGE_STATE,
+};
+
+static GHashTable *dependencies;
+
+static guint
+gtk_css_dependency_hash (gconstpointer data)
+{
+  const GtkCssDependency *dep = data;
+
+  return (guint) (dep->change ^ (dep->change >> 32)) ^ (dep->quark * 31) ^ (dep->name * 131);
+}
+
+static gboolean
+gtk_css_dependency_equal (gconstpointer a_,
+                          gconstpointer b_)
+{
+  const GtkCssDependency *a = a_;
+  const GtkCssDependency *b = b_;
+
+  return a->change == b->change &&
+         a->quark == b->quark &&
+         a->name == b->name;
+}
+
+static void
+add_dependency (GHashTable   *set,
+                GtkCssChange  change,
+                GQuark        quark,
+                GQuark        name)
+{
+  GtkCssDependency *dep;
+
+  dep = g_new (GtkCssDependency, 1);
+  dep->change = change;
+  dep->quark = quark;
+  dep->name = name;
+  dep->n_trees = 0;
+
+  g_hash_table_add (set, dep);
+}
+
+static void
+add_compound_dependencies (GHashTable            *set,
+                           const GtkCssSelector **compound,
+                           guint                  n_selectors)
+{
+  GQuark name = 0;
+  guint i, j;
+
+  for (i = 0; i < n_selectors; i++)
+    {
+      if (compound[i]->class == &GTK_CSS_SELECTOR_NAME)
+        name = compound[i]->name.name;
+    }
+
+  for (i = 0; i < n_selectors; i++)
+    {
+      const GtkCssSelector *selector = compound[i];
+
+      if (selector->class == &GTK_CSS_SELECTOR_NAME ||
+          selector->class == &GTK_CSS_SELECTOR_NOT_NAME)
+        {
+          add_dependency (set, GTK_CSS_CHANGE_NAME, selector->name.name, 0);
+        }
+      else if (selector->class == &GTK_CSS_SELECTOR_CLASS ||
+               selector->class == &GTK_CSS_SELECTOR_NOT_CLASS)
+        {
+          add_dependency (set, GTK_CSS_CHANGE_CLASS, selector->style_class.style_class, name);
+        }
+      else if (selector->class == &GTK_CSS_SELECTOR_PSEUDOCLASS_STATE ||
+               selector->class == &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_STATE)
+        {
+          GtkCssChange change = change_pseudoclass_state (selector);
+
+          for (j = 0; j < G_N_ELEMENTS (state_changes); j++)
+            {
+              if (change & state_changes[j])
+                add_dependency (set, state_changes[j], 0, name);
+            }
+        }
+    }
+}
+
+/* Walks the tree, collecting the simple selectors of the current compound
+ * selector in @compound, from @start on. Selectors in the rightmost
+ * compound selector are skipped.
+ */
+static void
+collect_dependencies (const GtkCssSelectorTree *tree,
+                      GPtrArray                *compound,
+                      guint                     start,
+                      gboolean                  rightmost,
+                      GHashTable               *set)
+{
+  for (; tree != NULL; tree = gtk_css_selector_tree_get_sibling (tree))
+    {
+      const GtkCssSelectorTree *prev = gtk_css_selector_tree_get_previous (tree);
+
+      if (!gtk_css_selector_is_simple (&tree->selector))
+        {
+          if (!rightmost)
+            add_compound_dependencies (set,
+                                       (const GtkCssSelector **) compound->pdata + start,
+                                       compound->len - start);
+
+          collect_dependencies (prev, compound, compound->len, FALSE, set);
+        }
+      else if (rightmost)
+        {
+          collect_dependencies (prev, compound, start, TRUE, set);
+        }
+      else
+        {
+          g_ptr_array_add (compound, (gpointer) &tree->selector);
+
+          /* A selector ends here */
+          if (gtk_css_selector_tree_get_matches (tree))
+            add_compound_dependencies (set,
+                                       (const GtkCssSelector **) compound->pdata + start,
+                                       compound->len - start);
+
+          collect_dependencies (prev, compound, start, FALSE, set);
+
+          g_ptr_array_set_size (compound, compound->len - 1);
+        }
+    }
+}
+
+static void
+gtk_css_selector_tree_update_dependencies (const GtkCssSelectorTree *tree,
+                                           gboolean                  add)
+{
+  GHashTable *set;
+  GPtrArray *compound;
+  GHashTableIter iter;
+  gpointer key;
+
+  if (tree == NULL)
+    return;
+
+  if (dependencies == NULL)
+    dependencies = g_hash_table_new_full (gtk_css_dependency_hash, gtk_css_dependency_equal, g_free, NULL);
+
+  set = g_hash_table_new_full (gtk_css_dependency_hash, gtk_css_dependency_equal, g_free, NULL);
+  compound = g_ptr_array_new ();
+
+  collect_dependencies (tree, compound, 0, TRUE, set);
+
+  g_hash_table_iter_init (&iter, set);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      GtkCssDependency *dep = g_hash_table_lookup (dependencies, key);
+
+      if (add)
+        {
+          if (dep == NULL)
+            {
+              g_hash_table_iter_steal (&iter);
+              dep = key;
+              g_hash_table_add (dependencies, dep);
+            }
+
+          dep->n_trees++;
+        }
+      else if (dep != NULL)
+        {
+          dep->n_trees--;
+          if (dep->n_trees == 0)
+            g_hash_table_remove (dependencies, dep);
+        }
+    }
+
+  g_ptr_array_unref (compound);
+  g_hash_table_unref (set);
+}
+
+static gboolean
+has_dependency (GtkCssChange change,
+                GQuark       quark,
+                GQuark       name)
+{
+  GtkCssDependency key = { change, quark, name, 0 };
+
+  if (dependencies == NULL)
+    return FALSE;
+
+  if (g_hash_table_contains (dependencies, &key))
+    return TRUE;
+
+  key.name = 0;
+  return name != 0 && g_hash_table_contains (dependencies, &key);
+}
+
+/**
+ * gtk_css_selector_get_dependent_change:
+ * @change: the change of a node, made of #GTK_CSS_CHANGE_CLASS,
+ *   #GTK_CSS_CHANGE_NAME or the state changes
+ * @quark: the class or name that changed
+ * @name: the name of the node
+ *
+ * Finds the parts of @change that a selector looks at on ancestors or
+ * previous siblings, so they need to be propagated to the children and
+ * siblings of the node. Other changes are returned unmodified.
+ *
+ * Returns: the changes that other nodes depend on
+ */
+GtkCssChange
+gtk_css_selector_get_dependent_change (GtkCssChange change,
+                                       GQuark       quark,
+                                       GQuark       name)
+{
+  GtkCssChange result;
+  guint i;
+
+  result = change & ~(GTK_CSS_CHANGE_CLASS | GTK_CSS_CHANGE_NAME);
+
+  if ((change & GTK_CSS_CHANGE_NAME) &&
+      has_dependency (GTK_CSS_CHANGE_NAME, quark, 0))
+    result |= GTK_CSS_CHANGE_NAME;
+
+  if ((change & GTK_CSS_CHANGE_CLASS) &&
+      has_dependency (GTK_CSS_CHANGE_CLASS, quark, name))
+    result |= GTK_CSS_CHANGE_CLASS;
+
+  for (i = 0; i < G_N_ELEMENTS (state_changes); i++)
+    {
+      if ((change & state_changes[i]) &&
+          !has_dependency (state_changes[i], 0, name))
+        result &= ~state_changes[i];
+    }
+
+  return result;
+}
+
 void
 _gtk_css_selector_tree_free (GtkCssSelectorTree *tree)
 {
   if (tree == NULL)
     return;
 
+  gtk_css_selector_tree_update_dependencies (tree, FALSE);
+
   g_free (tree);
 }
 
@@ -2313,5 +2581,409 @@ _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
   }
 #endif
 
+  gtk_css_selector_tree_update_dependencies (tree, TRUE);
+
   return tree;
 }
+
+/* Saving and loading trees
+ *
+ * A tree is a single block of memory with relative offsets, so saving it
+ * only needs to replace the pointers in it: selector classes become
+ * indexes into selector_classes, names become indexes into a string table
+ * that is appended to the tree, and matches become indexes into the array
+ * of matches, starting at 1 so that the terminating NULL stays 0.
+ *
+ * The saved data is only valid for the build of GTK that wrote it.
+ */
+
+static const GtkCssSelectorClass *selector_classes[] = {
+  &GTK_CSS_SELECTOR_DESCENDANT,
+  &GTK_CSS_SELECTOR_CHILD,
+  &GTK_CSS_SELECTOR_SIBLING,
+  &GTK_CSS_SELECTOR_ADJACENT,
+  &GTK_CSS_SELECTOR_ANY,
+  &GTK_CSS_SELECTOR_NOT_ANY,
+  &GTK_CSS_SELECTOR_NAME,
+  &GTK_CSS_SELECTOR_NOT_NAME,
+  &GTK_CSS_SELECTOR_CLASS,
+  &GTK_CSS_SELECTOR_NOT_CLASS,
+  &GTK_CSS_SELECTOR_ID,
+  &GTK_CSS_SELECTOR_NOT_ID,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_POSITION,
+  &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_POSITION,
+};
+
+typedef struct {
+  guint32 tree_size;
+  guint32 names_size;
+} GtkCssSelectorTreeHeader;
+
+static gboolean
+gtk_css_selector_class_has_name (const GtkCssSelectorClass *class)
+{
+  return class == &GTK_CSS_SELECTOR_NAME ||
+         class == &GTK_CSS_SELECTOR_NOT_NAME ||
+         class == &GTK_CSS_SELECTOR_CLASS ||
+         class == &GTK_CSS_SELECTOR_NOT_CLASS ||
+         class == &GTK_CSS_SELECTOR_ID ||
+         class == &GTK_CSS_SELECTOR_NOT_ID;
+}
+
+static guint
+gtk_css_selector_class_get_index (const GtkCssSelectorClass *class)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (selector_classes); i++)
+    {
+      if (selector_classes[i] == class)
+        return i;
+    }
+
+  g_assert_not_reached ();
+  return 0;
+}
+
+/* The size of the block of memory that holds the tree. Children and
+ * siblings are always allocated after their node, see subdivide_infos().
+ */
+static gsize
+gtk_css_selector_tree_get_size (const GtkCssSelectorTree *tree,
+                                const guint8             *data)
+{
+  gsize size = 0;
+
+  for (; tree != NULL; tree = gtk_css_selector_tree_get_sibling (tree))
+    {
+      gpointer *matches = gtk_css_selector_tree_get_matches (tree);
+      gsize end;
+
+      end = (const guint8 *) tree - data + sizeof (GtkCssSelectorTree);
+      size = MAX (size, end);
+
+      if (matches)
+        {
+          guint n;
+
+          for (n = 0; matches[n] != NULL; n++) ;
+          end = (const guint8 *) (matches + n + 1) - data;
+          size = MAX (size, end);
+        }
+
+      if (gtk_css_selector_tree_get_previous (tree))
+        size = MAX (size, gtk_css_selector_tree_get_size (gtk_css_selector_tree_get_previous (tree), data));
+    }
+
+  return size;
+}
+
+static void
+gtk_css_selector_tree_save_node (GtkCssSelectorTree *tree,
+                                 gconstpointer       matches,
+                                 gsize               match_size,
+                                 GHashTable         *name_indexes,
+                                 GString            *names)
+{
+  for (; tree != NULL; tree = (GtkCssSelectorTree *) gtk_css_selector_tree_get_sibling (tree))
+    {
+      const GtkCssSelectorClass *class = tree->selector.class;
+      gpointer *tree_matches;
+
+      if (gtk_css_selector_class_has_name (class))
+        {
+          gpointer index;
+
+          if (!g_hash_table_lookup_extended (name_indexes, GUINT_TO_POINTER (tree->selector.name.name), NULL, &index))
+            {
+              index = GUINT_TO_POINTER (g_hash_table_size (name_indexes));
+              g_hash_table_insert (name_indexes, GUINT_TO_POINTER (tree->selector.name.name), index);
+              g_string_append (names, g_quark_to_string (tree->selector.name.name));
+              g_string_append_c (names, '\0');
+            }
+
+          tree->selector.name.name = GPOINTER_TO_UINT (index);
+        }
+
+      tree->selector.class = GUINT_TO_POINTER (gtk_css_selector_class_get_index (class));
+
+      tree_matches = gtk_css_selector_tree_get_matches (tree);
+      if (tree_matches)
+        {
+          guint n;
+
+          for (n = 0; tree_matches[n] != NULL; n++)
+            tree_matches[n] = GSIZE_TO_POINTER (((const guint8 *) tree_matches[n] - (const guint8 *) matches) / match_size + 1);
+        }
+
+      gtk_css_selector_tree_save_node ((GtkCssSelectorTree *) gtk_css_selector_tree_get_previous (tree),
+                                       matches, match_size,
+                                       name_indexes, names);
+    }
+}
+
+/**
+ * gtk_css_selector_tree_update_checksum:
+ * @checksum: the checksum to update
+ *
+ * Adds the layout of saved trees to @checksum: the sizes of the
+ * structs that gtk_css_selector_tree_save() copies and the order of
+ * the selector classes, which are saved as indexes. Saved trees
+ * must only be loaded by a build with the same checksum.
+ */
+void
+gtk_css_selector_tree_update_checksum (GChecksum *checksum)
+{
+  guint32 sizes[4];
+  guint i;
+
+  sizes[0] = sizeof (GtkCssSelector);
+  sizes[1] = sizeof (GtkCssSelectorTree);
+  sizes[2] = sizeof (GtkCssSelectorTreeHeader);
+  sizes[3] = G_N_ELEMENTS (selector_classes);
+  g_checksum_update (checksum, (const guchar *) sizes, sizeof (sizes));
+
+  for (i = 0; i < G_N_ELEMENTS (selector_classes); i++)
+    g_checksum_update (checksum, (const guchar *) selector_classes[i]->name, strlen (selector_classes[i]->name) + 1);
+}
+
+/**
+ * gtk_css_selector_tree_save:
+ * @tree: (nullable): the tree to save
+ * @matches: the array that all matches of @tree point into
+ * @match_size: the size of the elements of @matches
+ *
+ * Saves @tree in a form that gtk_css_selector_tree_load() can
+ * turn back into the same tree.
+ *
+ * Returns: the saved tree
+ */
+GBytes *
+gtk_css_selector_tree_save (const GtkCssSelectorTree *tree,
+                            gconstpointer             matches,
+                            gsize                     match_size)
+{
+  GtkCssSelectorTreeHeader header = { 0, 0 };
+  GHashTable *name_indexes;
+  GByteArray *array;
+  GString *names;
+  gsize size;
+
+  array = g_byte_array_new ();
+
+  if (tree == NULL)
+    {
+      g_byte_array_append (array, (guint8 *) &header, sizeof (header));
+      return g_byte_array_free_to_bytes (array);
+    }
+
+  size = gtk_css_selector_tree_get_size (tree, (const guint8 *) tree);
+  header.tree_size = size;
+
+  g_byte_array_append (array, (guint8 *) &header, sizeof (header));
+  g_byte_array_append (array, (const guint8 *) tree, size);
+
+  name_indexes = g_hash_table_new (NULL, NULL);
+  names = g_string_new (NULL);
+
+  gtk_css_selector_tree_save_node ((GtkCssSelectorTree *) (array->data + sizeof (header)),
+                                   matches, match_size,
+                                   name_indexes, names);
+
+  header.names_size = names->len;
+  memcpy (array->data, &header, sizeof (header));
+  g_byte_array_append (array, (guint8 *) names->str, names->len);
+
+  g_string_free (names, TRUE);
+  g_hash_table_unref (name_indexes);
+
+  return g_byte_array_free_to_bytes (array);
+}
+
+static gboolean
+gtk_css_selector_tree_offset_is_valid (gsize  tree_offset,
+                                       gint32 offset,
+                                       gsize  size,
+                                       gsize  min_offset)
+{
+  gsize target;
+
+  if (offset == GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+    return TRUE;
+
+  target = tree_offset + offset;
+
+  return target >= min_offset &&
+         target % sizeof (gpointer) == 0 &&
+         target + sizeof (GtkCssSelectorTree) <= size;
+}
+
+static gboolean
+gtk_css_selector_tree_load_node (guint8        *data,
+                                 gsize          offset,
+                                 gsize          size,
+                                 guint8        *matches,
+                                 gsize          match_size,
+                                 guint          n_matches,
+                                 goffset        selector_match_offset,
+                                 const GQuark  *names,
+                                 guint          n_names)
+{
+  while (TRUE)
+    {
+      GtkCssSelectorTree *tree = (GtkCssSelectorTree *) (data + offset);
+      guint class_index;
+
+      /* Only allow offsets that point forward, so broken data can't
+       * make us loop.
+       */
+      if (!gtk_css_selector_tree_offset_is_valid (offset, tree->previous_offset, size, offset + 1) ||
+          !gtk_css_selector_tree_offset_is_valid (offset, tree->sibling_offset, size, offset + 1) ||
+          !gtk_css_selector_tree_offset_is_valid (offset, tree->parent_offset, offset, 0))
+        return FALSE;
+
+      class_index = GPOINTER_TO_UINT (tree->selector.class);
+      if (class_index >= G_N_ELEMENTS (selector_classes))
+        return FALSE;
+
+      tree->selector.class = selector_classes[class_index];
+
+      if (gtk_css_selector_class_has_name (tree->selector.class))
+        {
+          if (tree->selector.name.name >= n_names)
+            return FALSE;
+
+          tree->selector.name.name = names[tree->selector.name.name];
+        }
+
+      if (tree->matches_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        {
+          gsize match_offset = offset + tree->matches_offset;
+          gpointer *tree_matches;
+          guint n;
+
+          if (match_offset <= offset || match_offset % sizeof (gpointer) != 0)
+            return FALSE;
+
+          tree_matches = (gpointer *) (data + match_offset);
+          for (n = 0; ; n++)
+            {
+              gsize index;
+
+              if (match_offset + (n + 1) * sizeof (gpointer) > size)
+                return FALSE;
+
+              index = GPOINTER_TO_SIZE (tree_matches[n]);
+              if (index == 0)
+                break;
+              if (index > n_matches)
+                return FALSE;
+
+              tree_matches[n] = matches + (index - 1) * match_size;
+              G_STRUCT_MEMBER (GtkCssSelectorTree *, tree_matches[n], selector_match_offset) = tree;
+            }
+        }
+
+      if (tree->previous_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET &&
+          !gtk_css_selector_tree_load_node (data, offset + tree->previous_offset, size,
+                                            matches, match_size, n_matches, selector_match_offset,
+                                            names, n_names))
+        return FALSE;
+
+      if (tree->sibling_offset == GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        return TRUE;
+
+      offset += tree->sibling_offset;
+    }
+}
+
+/**
+ * gtk_css_selector_tree_load:
+ * @bytes: data returned by gtk_css_selector_tree_save()
+ * @matches: the array to point the matches into
+ * @match_size: the size of the elements of @matches
+ * @n_matches: the number of elements in @matches
+ * @selector_match_offset: offset of a #GtkCssSelectorTree pointer in
+ *     the elements of @matches that is set to the node matching them,
+ *     like _gtk_css_selector_tree_builder_add() does
+ * @out_tree: (out) (nullable): return location for the tree
+ *
+ * Loads a tree saved with gtk_css_selector_tree_save(). The matches
+ * in the loaded tree point into @matches.
+ *
+ * Returns: %FALSE if @bytes is not a valid tree
+ */
+gboolean
+gtk_css_selector_tree_load (GBytes              *bytes,
+                            gpointer             matches,
+                            gsize                match_size,
+                            guint                n_matches,
+                            goffset              selector_match_offset,
+                            GtkCssSelectorTree **out_tree)
+{
+  GtkCssSelectorTreeHeader header;
+  const guint8 *data;
+  const char *names, *end;
+  GArray *quarks;
+  guint8 *tree;
+  gsize size;
+
+  data = g_bytes_get_data (bytes, &size);
+  if (size < sizeof (header))
+    return FALSE;
+
+  memcpy (&header, data, sizeof (header));
+  if (header.tree_size % sizeof (gpointer) != 0 ||
+      (header.tree_size > 0 && header.tree_size < sizeof (GtkCssSelectorTree)) ||
+      size != sizeof (header) + header.tree_size + header.names_size)
+    return FALSE;
+
+  if (header.tree_size == 0)
+    {
+      *out_tree = NULL;
+      return TRUE;
+    }
+
+  quarks = g_array_new (FALSE, FALSE, sizeof (GQuark));
+  names = (const char *) data + sizeof (header) + header.tree_size;
+  end = names + header.names_size;
+  while (names < end)
+    {
+      const char *next = memchr (names, '\0', end - names);
+      GQuark quark;
+
+      if (next == NULL)
+        {
+          g_array_unref (quarks);
+          return FALSE;
+        }
+
+      quark = g_quark_from_string (names);
+      g_array_append_val (quarks, quark);
+      names = next + 1;
+    }
+
+  /* Copy, so the tree is aligned and can be freed with
+   * _gtk_css_selector_tree_free()
+   */
+  tree = g_malloc (header.tree_size);
+  memcpy (tree, data + sizeof (header), header.tree_size);
+
+  if (!gtk_css_selector_tree_load_node (tree, 0, header.tree_size,
+                                        matches, match_size, n_matches, selector_match_offset,
+                                        (const GQuark *) quarks->data, quarks->len))
+    {
+      g_free (tree);
+      g_array_unref (quarks);
+      return FALSE;
+    }
+
+  g_array_unref (quarks);
+
+  gtk_css_selector_tree_update_dependencies ((GtkCssSelectorTree *) tree, TRUE);
+
+  *out_tree = (GtkCssSelectorTree *) tree;
+  return TRUE;
+}
@@ -61,6 +61,10 @@ void         _gtk_css_selector_tree_match_print      (const GtkCssSelectorTree *
 						      GString                  *str);
 gboolean     _gtk_css_selector_tree_is_empty         (const GtkCssSelectorTree *tree) G_GNUC_CONST;
 
+GtkCssChange gtk_css_selector_get_dependent_change   (GtkCssChange              change,
+                                                      GQuark                    quark,
+                                                      GQuark                    name);
+
 
 
 GtkCssSelectorTreeBuilder *_gtk_css_selector_tree_builder_new   (void);
@@ -71,6 +75,17 @@ void                       _gtk_css_selector_tree_builder_add   (GtkCssSelectorT
 GtkCssSelectorTree *       _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder);
 void                       _gtk_css_selector_tree_builder_free  (GtkCssSelectorTreeBuilder *builder);
 
+void         gtk_css_selector_tree_update_checksum   (GChecksum                *checksum);
+GBytes *     gtk_css_selector_tree_save              (const GtkCssSelectorTree *tree,
+                                                      gconstpointer             matches,
+                                                      gsize                     match_size);
+gboolean     gtk_css_selector_tree_load              (GBytes                   *bytes,
+                                                      gpointer                  matches,
+                                                      gsize                     match_size,
+                                                      guint                     n_matches,
+                                                      goffset                   selector_match_offset,
+                                                      GtkCssSelectorTree      **out_tree);
+
 G_END_DECLS
 
 #endif /* __GTK_CSS_SELECTOR_PRIVATE_H__ */
@@ -164,6 +164,28 @@ gtk_css_value_shadow_equal (const GtkCssValue *value1,
   return TRUE;
 }
 
+static guint
+gtk_css_value_shadow_hash (const GtkCssValue *value)
+{
+  guint i, hash;
+
+  hash = value->n_shadows;
+
+  for (i = 0; i < value->n_shadows; i++)
+    {
+      const ShadowValue *shadow = &value->shadows[i];
+
+      hash = hash * 31 + shadow->inset;
+      hash = hash * 31 + gtk_css_value_hash (shadow->hoffset);
+      hash = hash * 31 + gtk_css_value_hash (shadow->voffset);
+      hash = hash * 31 + gtk_css_value_hash (shadow->radius);
+      hash = hash * 31 + gtk_css_value_hash (shadow->spread);
+      hash = hash * 31 + gtk_css_value_hash (shadow->color);
+    }
+
+  return hash;
+}
+
 static GtkCssValue *
 gtk_css_value_shadow_transition (GtkCssValue *start,
                                  GtkCssValue *end,
@@ -280,13 +302,14 @@ static const GtkCssValueClass GTK_CSS_VALUE_SHADOW = {
   gtk_css_value_shadow_free,
   gtk_css_value_shadow_compute,
   gtk_css_value_shadow_equal,
+  gtk_css_value_shadow_hash,
   gtk_css_value_shadow_transition,
   NULL,
   NULL,
   gtk_css_value_shadow_print
 };
 
-static GtkCssValue shadow_none_singleton = { &GTK_CSS_VALUE_SHADOW, 1, TRUE, FALSE, 0 };
+static GtkCssValue shadow_none_singleton = { &GTK_CSS_VALUE_SHADOW, 1, TRUE, FALSE, FALSE, 0 };
 
 GtkCssValue *
 gtk_css_shadow_value_new_none (void)
@@ -987,15 +987,40 @@ gtk_css_lookup_resolve (GtkCssLookup      *lookup,
     gtk_css_other_values_new_compute (sstyle, provider, parent_style, lookup);
 }
 
+static GtkCssStyle *
+gtk_css_static_style_new_resolve (GtkStyleProvider *provider,
+                                  GtkCssLookup     *lookup,
+                                  GtkCssNode       *node,
+                                  GtkCssChange      change)
+{
+  GtkCssStaticStyle *result;
+  GtkCssNode *parent;
+
+  result = g_object_new (GTK_TYPE_CSS_STATIC_STYLE, NULL);
+
+  result->change = change;
+
+  if (node)
+    parent = gtk_css_node_get_parent (node);
+  else
+    parent = NULL;
+
+  gtk_css_lookup_resolve (lookup,
+                          provider,
+                          result,
+                          parent ? gtk_css_node_get_style (parent) : NULL);
+
+  return GTK_CSS_STYLE (result);
+}
+
 GtkCssStyle *
 gtk_css_static_style_new_compute (GtkStyleProvider             *provider,
                                   const GtkCountingBloomFilter *filter,
                                   GtkCssNode                   *node,
                                   GtkCssChange                  change)
 {
-  GtkCssStaticStyle *result;
+  GtkCssStyle *result;
   GtkCssLookup lookup;
-  GtkCssNode *parent;
 
   _gtk_css_lookup_init (&lookup);
 
@@ -1006,23 +1031,36 @@ gtk_css_static_style_new_compute (GtkStyleProvider             *provider,
                                &lookup,
                                change == 0 ? &change : NULL);
 
-  result = g_object_new (GTK_TYPE_CSS_STATIC_STYLE, NULL);
+  result = gtk_css_static_style_new_resolve (provider, &lookup, node, change);
 
-  result->change = change;
+  _gtk_css_lookup_destroy (&lookup);
 
-  if (node)
-    parent = gtk_css_node_get_parent (node);
-  else
-    parent = NULL;
+  return result;
+}
 
-  gtk_css_lookup_resolve (&lookup,
-                          provider,
-                          result,
-                          parent ? gtk_css_node_get_style (parent) : NULL);
+/* Like gtk_css_static_style_new_compute(), but with the lookup
+ * already done by gtk_css_match_new().
+ */
+GtkCssStyle *
+gtk_css_static_style_new_for_match (GtkStyleProvider  *provider,
+                                    const GtkCssMatch *match,
+                                    GtkCssNode        *node,
+                                    GtkCssChange       change)
+{
+  GtkCssStyle *result;
+  GtkCssLookup lookup;
+
+  _gtk_css_lookup_init (&lookup);
+  gtk_css_match_fill_lookup (match, &lookup);
+
+  if (change == 0)
+    change = gtk_css_match_get_change (match);
+
+  result = gtk_css_static_style_new_resolve (provider, &lookup, node, change);
 
   _gtk_css_lookup_destroy (&lookup);
 
-  return GTK_CSS_STYLE (result);
+  return result;
 }
 
 G_STATIC_ASSERT (GTK_CSS_PROPERTY_BORDER_TOP_STYLE == GTK_CSS_PROPERTY_BORDER_TOP_WIDTH - 1);
@@ -1089,6 +1127,9 @@ gtk_css_static_style_compute_value (GtkCssStaticStyle *style,
       value = _gtk_css_initial_value_new_compute (id, provider, (GtkCssStyle *)style, parent_style);
     }
 
+  /* Share equal values between styles, see gtk_css_value_intern() */
+  value = gtk_css_value_intern (value);
+
   gtk_css_static_style_set_value (style, id, value, section);
 }
 
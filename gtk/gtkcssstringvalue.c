@@ -51,6 +51,12 @@ gtk_css_value_string_equal (const GtkCssValue *value1,
   return g_strcmp0 (value1->string, value2->string) == 0;
 }
 
+static guint
+gtk_css_value_string_hash (const GtkCssValue *value)
+{
+  return value->string ? g_str_hash (value->string) : 0;
+}
+
 static GtkCssValue *
 gtk_css_value_string_transition (GtkCssValue *start,
                                  GtkCssValue *end,
@@ -122,6 +128,7 @@ static const GtkCssValueClass GTK_CSS_VALUE_STRING = {
   gtk_css_value_string_free,
   gtk_css_value_string_compute,
   gtk_css_value_string_equal,
+  gtk_css_value_string_hash,
   gtk_css_value_string_transition,
   NULL,
   NULL,
@@ -133,6 +140,7 @@ static const GtkCssValueClass GTK_CSS_VALUE_IDENT = {
   gtk_css_value_string_free,
   gtk_css_value_string_compute,
   gtk_css_value_string_equal,
+  gtk_css_value_string_hash,
   gtk_css_value_string_transition,
   NULL,
   NULL,
@@ -86,6 +86,7 @@ static const GtkCssValueClass GTK_CSS_VALUE_UNSET = {
   gtk_css_value_unset_free,
   gtk_css_value_unset_compute,
   gtk_css_value_unset_equal,
+  NULL,
   gtk_css_value_unset_transition,
   NULL,
   NULL,
@@ -19,7 +19,7 @@
 
 #include "gtkprivate.h"
 #include "gtkcssvalueprivate.h"
-
+#include "gtkcssarrayvalueprivate.h"
 #include "gtkcssstyleprivate.h"
 #include "gtkstyleproviderprivate.h"
 
@@ -136,6 +136,14 @@ get_accounting_data (const char *class)
 }
 #endif
 
+/* Computed values of static styles are interned, so that equal values
+ * are shared between styles and comparing them usually finds the same
+ * pointer. The table does not hold references, values are removed from
+ * it when they are freed. Interned values have is_interned set, so that
+ * freeing other values does not need a lookup.
+ */
+static GHashTable *interned_values;
+
 GtkCssValue *
 _gtk_css_value_alloc (const GtkCssValueClass *klass,
                       gsize                   size)
@@ -189,6 +197,9 @@ gtk_css_value_unref (GtkCssValue *value)
   }
 #endif
 
+  if (value->is_interned)
+    g_hash_table_remove (interned_values, value);
+
   value->class->free (value);
 }
 
@@ -254,6 +265,94 @@ _gtk_css_value_equal0 (const GtkCssValue *value1,
   return _gtk_css_value_equal (value1, value2);
 }
 
+/* Values of classes without a hash function only hash by class */
+guint
+gtk_css_value_hash (const GtkCssValue *value)
+{
+  gtk_internal_return_val_if_fail (value != NULL, 0);
+
+  if (value->class->hash == NULL)
+    return GPOINTER_TO_UINT (value->class);
+
+  return value->class->hash (value);
+}
+
+/* Equal values are only the same if the classes of all the values
+ * they are made of hash everything they compare. Images for example
+ * compare equal while they render with different colors.
+ */
+static gboolean
+gtk_css_value_can_intern (GtkCssValue *value)
+{
+  guint i, n;
+
+  if (value->class->hash == NULL)
+    return FALSE;
+
+  n = _gtk_css_array_value_get_n_values (value);
+  for (i = 0; i < n; i++)
+    {
+      GtkCssValue *nth = _gtk_css_array_value_get_nth (value, i);
+
+      if (nth != value && !gtk_css_value_can_intern (nth))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gtk_css_value_intern_equal (gconstpointer value1,
+                            gconstpointer value2)
+{
+  return _gtk_css_value_equal (value1, value2);
+}
+
+/**
+ * gtk_css_value_intern:
+ * @value: (transfer full): a computed value
+ *
+ * Looks for a value that is equal to @value and has been interned
+ * before. If there is one, @value is released in favor of it.
+ * Otherwise @value is interned.
+ *
+ * Dynamic values and values that are or contain values of classes
+ * that cannot be hashed are returned as they are.
+ *
+ * Returns: (transfer full): @value or an equal value
+ **/
+GtkCssValue *
+gtk_css_value_intern (GtkCssValue *value)
+{
+  GtkCssValue *interned;
+
+  gtk_internal_return_val_if_fail (value != NULL, NULL);
+
+  if (!gtk_css_value_can_intern (value) ||
+      gtk_css_value_is_dynamic (value))
+    return value;
+
+  if (interned_values == NULL)
+    interned_values = g_hash_table_new ((GHashFunc) gtk_css_value_hash,
+                                        gtk_css_value_intern_equal);
+
+  interned = g_hash_table_lookup (interned_values, value);
+  if (interned == NULL)
+    {
+      g_hash_table_add (interned_values, value);
+      value->is_interned = TRUE;
+      return value;
+    }
+
+  if (interned != value)
+    {
+      _gtk_css_value_ref (interned);
+      _gtk_css_value_unref (value);
+    }
+
+  return interned;
+}
+
 GtkCssValue *
 _gtk_css_value_transition (GtkCssValue *start,
                            GtkCssValue *end,
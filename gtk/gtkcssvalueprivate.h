@@ -38,7 +38,8 @@ typedef struct _GtkCssValueClass      GtkCssValueClass;
 #define GTK_CSS_VALUE_BASE \
   const GtkCssValueClass *class; \
   int ref_count; \
-  guint is_computed: 1;
+  guint is_computed: 1; \
+  guint is_interned: 1;
 
 struct _GtkCssValueClass {
   const char *type_name;
@@ -51,6 +52,8 @@ struct _GtkCssValueClass {
                                                        GtkCssStyle                *parent_style);
   gboolean      (* equal)                             (const GtkCssValue          *value1,
                                                        const GtkCssValue          *value2);
+  /* Optional. Values without a hash function are not interned */
+  guint         (* hash)                              (const GtkCssValue          *value);
   GtkCssValue * (* transition)                        (GtkCssValue                *start,
                                                        GtkCssValue                *end,
                                                        guint                       property_id,
@@ -82,6 +85,8 @@ gboolean     _gtk_css_value_equal                     (const GtkCssValue
                                                        const GtkCssValue          *value2) G_GNUC_PURE;
 gboolean     _gtk_css_value_equal0                    (const GtkCssValue          *value1,
                                                        const GtkCssValue          *value2) G_GNUC_PURE;
+guint           gtk_css_value_hash                    (const GtkCssValue          *value) G_GNUC_PURE;
+GtkCssValue *   gtk_css_value_intern                  (GtkCssValue                *value);
 GtkCssValue *_gtk_css_value_transition                (GtkCssValue                *start,
                                                        GtkCssValue                *end,
                                                        guint                       property_id,
@@ -95,6 +100,16 @@ void         _gtk_css_value_print                     (const GtkCssValue
                                                        GString                    *string);
 gboolean     gtk_css_value_is_computed                (const GtkCssValue          *value) G_GNUC_PURE;
 
+static inline guint
+gtk_css_hash_double (double d)
+{
+  /* 0.0 and -0.0 compare equal */
+  if (d == 0.0)
+    return 0;
+
+  return g_double_hash (&d);
+}
+
 G_END_DECLS
 
 #endif /* __GTK_CSS_VALUE_PRIVATE_H__ */
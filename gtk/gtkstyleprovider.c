@@ -115,14 +115,51 @@ gtk_style_provider_lookup (GtkStyleProvider             *provider,
   iface->lookup (provider, filter, node, lookup, out_change);
 }
 
+/* Like the change returned by gtk_style_provider_lookup(), but
+ * computed without a bloom filter, so it includes selectors that
+ * look at ancestors the node doesn't currently have.
+ */
+GtkCssChange
+gtk_style_provider_get_change (GtkStyleProvider *provider,
+                               GtkCssNode       *node)
+{
+  GtkStyleProviderInterface *iface;
+
+  gtk_internal_return_val_if_fail (GTK_IS_STYLE_PROVIDER (provider), GTK_CSS_CHANGE_ANY);
+  gtk_internal_return_val_if_fail (GTK_IS_CSS_NODE (node), GTK_CSS_CHANGE_ANY);
+
+  iface = GTK_STYLE_PROVIDER_GET_INTERFACE (provider);
+
+  if (!iface->lookup)
+    return 0;
+
+  if (!iface->get_change)
+    return GTK_CSS_CHANGE_ANY;
+
+  return iface->get_change (provider, node);
+}
+
+static guint generation;
+
 void
 gtk_style_provider_changed (GtkStyleProvider *provider)
 {
   gtk_internal_return_if_fail (GTK_IS_STYLE_PROVIDER (provider));
 
+  generation++;
+
   g_signal_emit (provider, signals[CHANGED], 0);
 }
 
+/* Changes whenever any style provider changes, so that caches
+ * of computed styles know when to drop their contents.
+ */
+guint
+gtk_style_provider_get_generation (void)
+{
+  return generation;
+}
+
 GtkSettings *
 gtk_style_provider_get_settings (GtkStyleProvider *provider)
 {
@@ -47,6 +47,8 @@ struct _GtkStyleProviderInterface
                                                  GtkCssNode              *node,
                                                  GtkCssLookup            *lookup,
                                                  GtkCssChange            *out_change);
+  GtkCssChange          (* get_change)          (GtkStyleProvider        *provider,
+                                                 GtkCssNode              *node);
   void                  (* emit_error)          (GtkStyleProvider        *provider,
                                                  GtkCssSection           *section,
                                                  const GError            *error);
@@ -65,8 +67,11 @@ void                    gtk_style_provider_lookup                (GtkStyleProvid
                                                                   GtkCssNode              *node,
                                                                   GtkCssLookup            *lookup,
                                                                   GtkCssChange            *out_change);
+GtkCssChange            gtk_style_provider_get_change            (GtkStyleProvider        *provider,
+                                                                  GtkCssNode              *node);
 
 void                    gtk_style_provider_changed               (GtkStyleProvider        *provider);
+guint                   gtk_style_provider_get_generation        (void);
 
 void                    gtk_style_provider_emit_error            (GtkStyleProvider        *provider,
                                                                   GtkCssSection           *section,
@@ -32,6 +32,8 @@
 #include "gtkeventcontrollerkey.h"
 #include "gtkmain.h"
 #include "gtkliststore.h"
+#include "gtkcssnodestylecacheprivate.h"
+#include "gtkcssnodeprivate.h"
 
 #include <glib/gi18n-lib.h>
 
@@ -61,6 +63,9 @@ struct _GtkInspectorStatisticsPrivate
   guint update_source_id;
   GtkWidget *search_entry;
   GtkWidget *search_bar;
+  GtkWidget *shared_styles;
+  GtkWidget *restyled_nodes;
+  guint css_stats_source_id;
 };
 
 typedef struct {
@@ -149,6 +154,33 @@ update_type_counts (gpointer data)
   return TRUE;
 }
 
+static gboolean
+update_css_stats (gpointer data)
+{
+  GtkInspectorStatistics *sl = data;
+  guint n_styles;
+  guint64 n_lookups, n_hits;
+  guint64 n_restyled, n_skipped;
+  char *text;
+
+  gtk_css_node_style_cache_get_shared_stats (&n_styles, &n_lookups, &n_hits);
+
+  text = g_strdup_printf (_("Shared styles: %u, %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " lookups hit (%.1f%%)"),
+                          n_styles, n_hits, n_lookups,
+                          n_lookups > 0 ? 100.0 * n_hits / n_lookups : 0.0);
+  gtk_label_set_label (GTK_LABEL (sl->priv->shared_styles), text);
+  g_free (text);
+
+  gtk_css_node_get_invalidation_stats (&n_restyled, &n_skipped);
+
+  text = g_strdup_printf (_("Restyled nodes: %" G_GUINT64_FORMAT ", skipped: %" G_GUINT64_FORMAT),
+                          n_restyled, n_skipped);
+  gtk_label_set_label (GTK_LABEL (sl->priv->restyled_nodes), text);
+  g_free (text);
+
+  return G_SOURCE_CONTINUE;
+}
+
 static void
 toggle_record (GtkToggleButton        *button,
                GtkInspectorStatistics *sl)
@@ -346,6 +378,28 @@ root (GtkWidget *widget)
   gtk_search_bar_set_key_capture_widget (GTK_SEARCH_BAR (sl->priv->search_bar), toplevel);
 }
 
+static void
+map (GtkWidget *widget)
+{
+  GtkInspectorStatistics *sl = GTK_INSPECTOR_STATISTICS (widget);
+
+  GTK_WIDGET_CLASS (gtk_inspector_statistics_parent_class)->map (widget);
+
+  sl->priv->css_stats_source_id = g_timeout_add_seconds (1, update_css_stats, sl);
+  update_css_stats (sl);
+}
+
+static void
+unmap (GtkWidget *widget)
+{
+  GtkInspectorStatistics *sl = GTK_INSPECTOR_STATISTICS (widget);
+
+  g_source_remove (sl->priv->css_stats_source_id);
+  sl->priv->css_stats_source_id = 0;
+
+  GTK_WIDGET_CLASS (gtk_inspector_statistics_parent_class)->unmap (widget);
+}
+
 static void
 unroot (GtkWidget *widget)
 {
@@ -469,6 +523,8 @@ gtk_inspector_statistics_class_init (GtkInspectorStatisticsClass *klass)
 
   widget_class->root = root;
   widget_class->unroot = unroot;
+  widget_class->map = map;
+  widget_class->unmap = unmap;
 
   g_object_class_install_property (object_class, PROP_BUTTON,
       g_param_spec_object ("button", NULL, NULL,
@@ -489,6 +545,8 @@ gtk_inspector_statistics_class_init (GtkInspectorStatisticsClass *klass)
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorStatistics, search_entry);
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorStatistics, search_bar);
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorStatistics, excuse);
+  gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorStatistics, shared_styles);
+  gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorStatistics, restyled_nodes);
 
 }
 
@@ -2,6 +2,10 @@
 
 #include <gsk/gskcairoblurprivate.h>
 
+#include <string.h>
+
+static const char *kernels[] = { "avx2", "sse2", "neon", "c" };
+
 static void
 init_surface (cairo_t *cr)
 {
@@ -9,13 +13,43 @@ init_surface (cairo_t *cr)
   int h = cairo_image_surface_get_height (cairo_get_target (cr));
 
   cairo_set_source_rgb (cr, 0, 0, 0);
-  cairo_fill (cr);
+  cairo_paint (cr);
 
   cairo_set_source_rgb (cr, 1, 1, 1);
   cairo_arc (cr, w/2, h/2, w/2, 0, 2*G_PI);
   cairo_fill (cr);
 }
 
+static cairo_surface_t *
+blur_reference (int size,
+                int radius)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_A8, size, size);
+  cr = cairo_create (surface);
+  init_surface (cr);
+  cairo_destroy (cr);
+
+  gsk_cairo_blur_set_kernel ("c");
+  gsk_cairo_blur_surface (surface, radius, GSK_BLUR_X | GSK_BLUR_Y);
+
+  return surface;
+}
+
+static gboolean
+surfaces_equal (cairo_surface_t *a,
+                cairo_surface_t *b)
+{
+  cairo_surface_flush (a);
+  cairo_surface_flush (b);
+
+  return memcmp (cairo_image_surface_get_data (a),
+                 cairo_image_surface_get_data (b),
+                 cairo_image_surface_get_stride (a) * cairo_image_surface_get_height (a)) == 0;
+}
+
 int
 main (int argc, char **argv)
 {
@@ -23,8 +57,9 @@ main (int argc, char **argv)
   cairo_t *cr;
   GTimer *timer;
   double msec;
-  int i, j;
+  int i, j, k;
   int size;
+  int result = 0;
 
   timer = g_timer_new ();
 
@@ -34,21 +69,49 @@ main (int argc, char **argv)
 
   cr = cairo_create (surface);
 
-  /* We do everything three times, first two as warmup */
-  for (j = 0; j < 2; j++)
+  for (k = 0; k < G_N_ELEMENTS (kernels); k++)
     {
-      for (i = 1; i < 16; i++)
-	{
-	  init_surface (cr);
-	  g_timer_start (timer);
-	  gsk_cairo_blur_surface (surface, i, GSK_BLUR_X | GSK_BLUR_Y);
-	  msec = g_timer_elapsed (timer, NULL) * 1000;
-	  if (j == 1)
-	    g_print ("Radius %2d: %.2f msec, %.2f kpixels/msec:\n", i, msec, size*size/(msec*1000));
-	}
+      if (!gsk_cairo_blur_set_kernel (kernels[k]))
+        continue;
+
+      g_print ("Kernel %s\n", kernels[k]);
+
+      /* We do everything three times, first two as warmup */
+      for (j = 0; j < 2; j++)
+        {
+          for (i = 1; i < 16; i++)
+            {
+              init_surface (cr);
+              g_timer_start (timer);
+              gsk_cairo_blur_surface (surface, i, GSK_BLUR_X | GSK_BLUR_Y);
+              msec = g_timer_elapsed (timer, NULL) * 1000;
+              if (j == 1)
+                g_print ("Radius %2d: %.2f msec, %.2f kpixels/msec:\n", i, msec, size*size/(msec*1000));
+            }
+        }
+
+      /* Check that all kernels produce the same output */
+      for (i = 2; i < 16; i++)
+        {
+          cairo_surface_t *reference = blur_reference (size, i);
+
+          gsk_cairo_blur_set_kernel (kernels[k]);
+          init_surface (cr);
+          gsk_cairo_blur_surface (surface, i, GSK_BLUR_X | GSK_BLUR_Y);
+
+          if (!surfaces_equal (surface, reference))
+            {
+              g_print ("Radius %2d: output differs from the C kernel\n", i);
+              result = 1;
+            }
+
+          cairo_surface_destroy (reference);
+        }
     }
 
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
   g_timer_destroy (timer);
 
-  return 0;
+  return result;
 }
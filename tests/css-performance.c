@@ -0,0 +1,205 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Restyles a synthetic tree of about 50000 CSS nodes, the way a theme
+ * change does, with and without matching selectors in parallel and
+ * with and without sharing styles.
+ */
+
+#include <gtk/gtk.h>
+#include <string.h>
+#include "gtk/gtkcssnodeprivate.h"
+#include "gtk/gtkcssstyleprivate.h"
+
+#define N_BOXES 100
+#define N_ROWS 25
+#define N_LABELS 20
+#define N_RUNS 5
+
+static GtkCssProvider *
+create_provider (void)
+{
+  GtkCssProvider *provider;
+  GString *css;
+  int i;
+
+  css = g_string_new ("");
+
+  for (i = 0; i < 13; i++)
+    {
+      g_string_append_printf (css,
+                              "box.b%d > row label.c%d { color: rgb(%d,0,0); margin: %dpx; }\n"
+                              "row.r%d label:nth-child(%d) { font-size: %dpx; }\n"
+                              "box.b%d row.r%d > label.c%d:hover { background-color: rgb(0,%d,0); }\n"
+                              "label.c%d ~ label.c%d { padding: %dpx; }\n",
+                              i % 7, i, i * 19, i,
+                              i % 5, i + 1, 10 + i,
+                              i % 3, i % 5, i, i * 17,
+                              i, (i + 3) % 13, i);
+    }
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, css->str, css->len);
+  g_string_free (css, TRUE);
+
+  return provider;
+}
+
+static GtkCssNode *
+create_node (GtkCssNode *parent,
+             const char *name,
+             const char *klass)
+{
+  GtkCssNode *node;
+
+  node = gtk_css_node_new ();
+  gtk_css_node_set_name (node, g_quark_from_static_string (name));
+  gtk_css_node_add_class (node, g_quark_from_string (klass));
+  if (parent)
+    {
+      gtk_css_node_set_parent (node, parent);
+      g_object_unref (node);
+    }
+
+  return node;
+}
+
+static GtkCssNode *
+create_tree (guint *n_nodes)
+{
+  GtkCssNode *root, *box, *row;
+  char klass[16];
+  int i, j, k;
+
+  root = create_node (NULL, "window", "background");
+  *n_nodes = 1;
+
+  for (i = 0; i < N_BOXES; i++)
+    {
+      g_snprintf (klass, sizeof (klass), "b%d", i % 7);
+      box = create_node (root, "box", klass);
+      (*n_nodes)++;
+
+      for (j = 0; j < N_ROWS; j++)
+        {
+          g_snprintf (klass, sizeof (klass), "r%d", (i + j) % 5);
+          row = create_node (box, "row", klass);
+          (*n_nodes)++;
+
+          for (k = 0; k < N_LABELS; k++)
+            {
+              g_snprintf (klass, sizeof (klass), "c%d", (i * 7 + j * 3 + k) % 13);
+              create_node (row, "label", klass);
+              (*n_nodes)++;
+            }
+        }
+    }
+
+  return root;
+}
+
+static double
+restyle (GtkCssNode *root)
+{
+  gint64 start;
+
+  gtk_css_node_invalidate_style_provider (root);
+
+  start = g_get_monotonic_time ();
+  gtk_css_node_validate (root);
+
+  return (g_get_monotonic_time () - start) / 1000.0;
+}
+
+static void
+collect_styles (GtkCssNode *node,
+                GPtrArray  *styles)
+{
+  GtkCssNode *child;
+
+  g_ptr_array_add (styles, gtk_css_style_to_string (gtk_css_node_get_style (node)));
+
+  for (child = gtk_css_node_get_first_child (node);
+       child;
+       child = gtk_css_node_get_next_sibling (child))
+    collect_styles (child, styles);
+}
+
+static const struct {
+  const char *name;
+  guint flags;
+} configs[] = {
+  { "threads", 0 },
+  { "no threads", GTK_DEBUG_CSS_NO_THREADS },
+  { "no cache", GTK_DEBUG_CSS_NO_THREADS | GTK_DEBUG_NO_CSS_CACHE },
+};
+
+int
+main (int argc, char **argv)
+{
+  GtkCssProvider *provider;
+  GtkCssNode *root;
+  GPtrArray *styles[G_N_ELEMENTS (configs)];
+  guint n_nodes, n_styles, c, j;
+  guint64 n_lookups, n_hits;
+  guint debug_flags;
+  int i;
+
+  gtk_init ();
+
+  provider = create_provider ();
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  root = create_tree (&n_nodes);
+  gtk_css_node_validate (root);
+
+  g_print ("%u nodes, %u processors\n", n_nodes, g_get_num_processors ());
+
+  gtk_css_node_style_cache_get_shared_stats (&n_styles, &n_lookups, &n_hits);
+  g_print ("%u shared styles, %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " lookups hit\n",
+           n_styles, n_hits, n_lookups);
+
+  debug_flags = gtk_get_debug_flags () & ~(GTK_DEBUG_CSS_NO_THREADS | GTK_DEBUG_NO_CSS_CACHE);
+
+  for (c = 0; c < G_N_ELEMENTS (configs); c++)
+    {
+      double total = 0, best = G_MAXDOUBLE;
+
+      gtk_set_debug_flags (debug_flags | configs[c].flags);
+
+      for (i = 0; i < N_RUNS; i++)
+        {
+          double msec = restyle (root);
+
+          total += msec;
+          best = MIN (best, msec);
+        }
+
+      g_print ("%-10s  %8.2f ms (best %8.2f ms)\n",
+               configs[c].name, total / N_RUNS, best);
+
+      styles[c] = g_ptr_array_new_with_free_func (g_free);
+      collect_styles (root, styles[c]);
+    }
+
+  for (c = 1; c < G_N_ELEMENTS (configs); c++)
+    {
+      g_assert_cmpuint (styles[0]->len, ==, styles[c]->len);
+      for (j = 0; j < styles[0]->len; j++)
+        {
+          if (strcmp (g_ptr_array_index (styles[0], j), g_ptr_array_index (styles[c], j)) != 0)
+            {
+              g_printerr ("Style of node %u differs with %s\n", j, configs[c].name);
+              return 1;
+            }
+        }
+    }
+
+  for (c = 0; c < G_N_ELEMENTS (configs); c++)
+    g_ptr_array_unref (styles[c]);
+  g_object_unref (root);
+  g_object_unref (provider);
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include <gdk/gdkmemoryformatprivate.h>
+
+#include <string.h>
+
+static const char *kernels[] = { "avx2", "ssse3", "neon", "c" };
+
+static gsize
+bytes_per_pixel (GdkMemoryFormat format)
+{
+  switch (format)
+    {
+    case GDK_MEMORY_R8G8B8:
+    case GDK_MEMORY_B8G8R8:
+      return 3;
+    default:
+      return 4;
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  GEnumClass *enum_class;
+  guchar *src, *dest, *reference;
+  GTimer *timer;
+  double msec;
+  GdkMemoryFormat src_format, dest_format;
+  int i, k;
+  int size;
+  int result = 0;
+
+  timer = g_timer_new ();
+  enum_class = g_type_class_ref (GDK_TYPE_MEMORY_FORMAT);
+
+  /* Odd so that the kernels have leftover pixels at the end of rows */
+  size = 2001;
+
+  src = g_malloc (size * size * 4);
+  for (i = 0; i < size * size * 4; i++)
+    src[i] = g_random_int_range (0, 256);
+
+  dest = g_malloc (size * size * 4);
+  reference = g_malloc (size * size * 4);
+
+  for (k = 0; k < G_N_ELEMENTS (kernels); k++)
+    {
+      if (!gdk_memory_convert_set_kernel (kernels[k]))
+        continue;
+
+      g_print ("Kernel %s\n", kernels[k]);
+
+      /* Only premultiplied formats are possible destinations */
+      for (dest_format = 0; dest_format < 3; dest_format++)
+        for (src_format = 0; src_format < GDK_MEMORY_N_FORMATS; src_format++)
+          {
+            gsize src_stride = size * bytes_per_pixel (src_format);
+
+            /* We do everything three times, first two as warmup */
+            for (i = 0; i < 3; i++)
+              {
+                g_timer_start (timer);
+                gdk_memory_convert (dest, size * 4, dest_format,
+                                    src, src_stride, src_format,
+                                    size, size);
+                msec = g_timer_elapsed (timer, NULL) * 1000;
+              }
+
+            g_print ("%s => %s: %.2f msec, %.2f kpixels/msec\n",
+                     g_enum_get_value (enum_class, src_format)->value_nick,
+                     g_enum_get_value (enum_class, dest_format)->value_nick,
+                     msec, size * size / (msec * 1000));
+
+            /* Check that all kernels produce the same output */
+            gdk_memory_convert_set_kernel ("c");
+            gdk_memory_convert (reference, size * 4, dest_format,
+                                src, src_stride, src_format,
+                                size, size);
+            gdk_memory_convert_set_kernel (kernels[k]);
+
+            if (memcmp (dest, reference, size * size * 4) != 0)
+              {
+                g_print ("%s => %s: output differs from the C kernel\n",
+                         g_enum_get_value (enum_class, src_format)->value_nick,
+                         g_enum_get_value (enum_class, dest_format)->value_nick);
+                result = 1;
+              }
+          }
+    }
+
+  g_free (src);
+  g_free (dest);
+  g_free (reference);
+  g_type_class_unref (enum_class);
+  g_timer_destroy (timer);
+
+  return result;
+}
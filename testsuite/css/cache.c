@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2021 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+/* Must match CACHE_MAX_FILES in gtkcssprovider.c */
+#define CACHE_MAX_FILES 16
+
+static char *cache_dir;
+
+/* Large enough to be cached, and using selectors, @define-color,
+ * @keyframes and shorthands, so that all parts of the cache are used
+ */
+static GFile *
+create_stylesheet (const char *name,
+                   guint       seed)
+{
+  GString *string;
+  GFile *file;
+  char *path;
+  guint i;
+
+  string = g_string_new (NULL);
+  g_string_append_printf (string, "@define-color accent_%u rgb(%u,0,0);\n", seed, seed % 256);
+  g_string_append (string, "@keyframes spin { from { opacity: 0; } to { opacity: 1; } }\n");
+
+  for (i = 0; i < 200; i++)
+    {
+      g_string_append_printf (string,
+                              "window.c%u > box label:hover,\n"
+                              "button#b%u:not(:backdrop) ~ entry:nth-child(%u) {\n"
+                              "  color: @accent_%u;\n"
+                              "  margin: %upx %upx;\n"
+                              "  border: 1px solid alpha(black, 0.%u);\n"
+                              "  animation: spin %ums infinite;\n"
+                              "}\n",
+                              i, i, i % 7 + 1, seed, i % 5, i % 3, i % 10, i * 10 + 100);
+      if (i % 4 == 0)
+        g_string_append_printf (string, "label.l%u { font-size: %upt; }\n", i, i % 20 + 6);
+    }
+
+  path = g_build_filename (cache_dir, name, NULL);
+  g_file_set_contents (path, string->str, string->len, NULL);
+  file = g_file_new_for_path (path);
+
+  g_free (path);
+  g_string_free (string, TRUE);
+
+  return file;
+}
+
+static char *
+load_to_string (GFile *file)
+{
+  GtkCssProvider *provider;
+  char *result;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_file (provider, file);
+  result = gtk_css_provider_to_string (provider);
+  g_object_unref (provider);
+
+  return result;
+}
+
+static char *
+get_css_cache_dir (void)
+{
+  return g_build_filename (cache_dir, "gtk-4.0", "css", NULL);
+}
+
+static GPtrArray *
+list_cache_files (void)
+{
+  GPtrArray *files;
+  const char *name;
+  char *dir;
+  GDir *gdir;
+
+  files = g_ptr_array_new_with_free_func (g_free);
+  dir = get_css_cache_dir ();
+  gdir = g_dir_open (dir, 0, NULL);
+  if (gdir)
+    {
+      while ((name = g_dir_read_name (gdir)) != NULL)
+        {
+          if (g_str_has_suffix (name, ".cache"))
+            g_ptr_array_add (files, g_build_filename (dir, name, NULL));
+        }
+      g_dir_close (gdir);
+    }
+  g_free (dir);
+
+  return files;
+}
+
+static void
+clear_cache (void)
+{
+  GPtrArray *files;
+  guint i;
+
+  files = list_cache_files ();
+  for (i = 0; i < files->len; i++)
+    g_unlink (g_ptr_array_index (files, i));
+  g_ptr_array_unref (files);
+}
+
+static void
+test_reload (void)
+{
+  GFile *file;
+  GPtrArray *files;
+  char *parsed, *cached;
+
+  clear_cache ();
+  file = create_stylesheet ("reload.css", 1);
+
+  parsed = load_to_string (file);
+
+  files = list_cache_files ();
+  g_assert_cmpuint (files->len, ==, 1);
+  g_ptr_array_unref (files);
+
+  cached = load_to_string (file);
+  g_assert_cmpstr (parsed, ==, cached);
+
+  g_free (parsed);
+  g_free (cached);
+  g_object_unref (file);
+}
+
+static void
+test_damaged (gconstpointer data)
+{
+  gboolean truncate = GPOINTER_TO_INT (data);
+  GFile *file;
+  GPtrArray *files;
+  char *path;
+  char *contents, *rewritten;
+  gsize length, rewritten_length;
+  char *parsed, *cached;
+
+  clear_cache ();
+  file = create_stylesheet ("damaged.css", 2);
+
+  parsed = load_to_string (file);
+
+  files = list_cache_files ();
+  g_assert_cmpuint (files->len, ==, 1);
+  path = g_strdup (g_ptr_array_index (files, 0));
+  g_ptr_array_unref (files);
+
+  g_assert_true (g_file_get_contents (path, &contents, &length, NULL));
+  if (truncate)
+    {
+      g_assert_true (g_file_set_contents (path, contents, length / 2, NULL));
+    }
+  else
+    {
+      char *garbage = g_memdup (contents, length);
+
+      /* Clears the framing of the GVariant and the selector tree */
+      memset (garbage + length / 2, 0, length - length / 2);
+      g_assert_true (g_file_set_contents (path, garbage, length, NULL));
+      g_free (garbage);
+    }
+
+  /* Falls back to parsing, and writes a good cache again */
+  cached = load_to_string (file);
+  g_assert_cmpstr (parsed, ==, cached);
+
+  g_assert_true (g_file_get_contents (path, &rewritten, &rewritten_length, NULL));
+  g_assert_cmpmem (contents, length, rewritten, rewritten_length);
+
+  g_free (cached);
+  cached = load_to_string (file);
+  g_assert_cmpstr (parsed, ==, cached);
+
+  g_free (rewritten);
+  g_free (contents);
+  g_free (path);
+  g_free (parsed);
+  g_free (cached);
+  g_object_unref (file);
+}
+
+static void
+test_trim (void)
+{
+  GPtrArray *files;
+  guint i;
+
+  clear_cache ();
+
+  for (i = 0; i < CACHE_MAX_FILES + 4; i++)
+    {
+      char *name = g_strdup_printf ("trim%u.css", i);
+      GFile *file = create_stylesheet (name, 100 + i);
+
+      g_free (load_to_string (file));
+
+      g_object_unref (file);
+      g_free (name);
+    }
+
+  files = list_cache_files ();
+  g_assert_cmpuint (files->len, <=, CACHE_MAX_FILES);
+  g_ptr_array_unref (files);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int result;
+
+  cache_dir = g_dir_make_tmp ("gtk-css-cache-XXXXXX", NULL);
+  g_assert_nonnull (cache_dir);
+
+  /* Must happen before anything looks at the cache dir */
+  g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+  g_unsetenv ("GTK_NO_STYLESHEET_CACHE");
+  g_unsetenv ("GTK_CSS_DEBUG");
+
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/css/cache/reload", test_reload);
+  g_test_add_data_func ("/css/cache/truncated", GINT_TO_POINTER (TRUE), test_damaged);
+  g_test_add_data_func ("/css/cache/corrupted", GINT_TO_POINTER (FALSE), test_damaged);
+  g_test_add_func ("/css/cache/trim", test_trim);
+
+  result = g_test_run ();
+
+  clear_cache ();
+  g_free (cache_dir);
+
+  return result;
+}
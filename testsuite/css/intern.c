@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2021 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gtk/gtk.h>
+#include "gtk/gtkcssvalueprivate.h"
+#include "gtk/gtkcssnodeprivate.h"
+#include "gtk/gtkcssstyleprivate.h"
+#include "gtk/gtkcssstylepropertyprivate.h"
+#include "gtk/gtkcssstaticstyleprivate.h"
+
+static GtkCssValue *
+value_from_string (GtkStyleProperty *prop,
+                   const char       *str)
+{
+  GBytes *bytes;
+  GtkCssParser *parser;
+  GtkCssValue *value;
+
+  bytes = g_bytes_new_static (str, strlen (str));
+  parser = gtk_css_parser_new_for_bytes (bytes, NULL, NULL, NULL, NULL, NULL);
+  value = _gtk_style_property_parse_value (prop, parser);
+  gtk_css_parser_unref (parser);
+  g_bytes_unref (bytes);
+
+  return value;
+}
+
+static GtkCssValue *
+computed_from_string (guint       id,
+                      const char *str)
+{
+  GtkStyleProperty *prop;
+  GtkCssValue *value, *computed;
+
+  prop = (GtkStyleProperty *)_gtk_css_style_property_lookup_by_id (id);
+  value = value_from_string (prop, str);
+  g_assert_nonnull (value);
+  computed = _gtk_css_value_compute (value, id,
+                                     GTK_STYLE_PROVIDER (gtk_settings_get_default ()),
+                                     gtk_css_static_style_get_default (),
+                                     NULL);
+  gtk_css_value_unref (value);
+
+  return computed;
+}
+
+static void
+test_intern (void)
+{
+  GtkCssValue *value1, *value2, *value3;
+
+  value1 = gtk_css_value_intern (computed_from_string (GTK_CSS_PROPERTY_BOX_SHADOW, "2px 3px 4px red, inset 0 1px rgba(0,0,0,0.5)"));
+  value2 = gtk_css_value_intern (computed_from_string (GTK_CSS_PROPERTY_BOX_SHADOW, "2px 3px 4px red, inset 0 1px rgba(0,0,0,0.5)"));
+  g_assert_true (value1 == value2);
+  gtk_css_value_unref (value2);
+
+  value3 = gtk_css_value_intern (computed_from_string (GTK_CSS_PROPERTY_BOX_SHADOW, "2px 3px 5px red, inset 0 1px rgba(0,0,0,0.5)"));
+  g_assert_true (value1 != value3);
+
+  /* Freeing an equal value that was not interned keeps the interned one */
+  value2 = computed_from_string (GTK_CSS_PROPERTY_BOX_SHADOW, "2px 3px 4px red, inset 0 1px rgba(0,0,0,0.5)");
+  g_assert_true (value1 != value2);
+  gtk_css_value_unref (value2);
+  value2 = gtk_css_value_intern (computed_from_string (GTK_CSS_PROPERTY_BOX_SHADOW, "2px 3px 4px red, inset 0 1px rgba(0,0,0,0.5)"));
+  g_assert_true (value1 == value2);
+
+  gtk_css_value_unref (value1);
+  gtk_css_value_unref (value2);
+  gtk_css_value_unref (value3);
+
+  /* Freed values must be gone from the table */
+  value1 = computed_from_string (GTK_CSS_PROPERTY_BOX_SHADOW, "2px 3px 4px red, inset 0 1px rgba(0,0,0,0.5)");
+  g_assert_true (gtk_css_value_intern (value1) == value1);
+  gtk_css_value_unref (value1);
+}
+
+/* Icon theme images compare equal regardless of the colors they
+ * are recolored with, so arrays of them must not be interned.
+ */
+static void
+test_intern_images (void)
+{
+  GtkCssProvider *provider;
+  GtkCssNode *node1, *node2;
+  GtkCssValue *value1, *value2;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider,
+                                   "image { background-image: -gtk-icontheme('edit-find'); }\n"
+                                   "image.red { color: red; }\n"
+                                   "image.blue { color: blue; }\n",
+                                   -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  node1 = gtk_css_node_new ();
+  gtk_css_node_set_name (node1, g_quark_from_static_string ("image"));
+  gtk_css_node_add_class (node1, g_quark_from_static_string ("red"));
+  gtk_css_node_validate (node1);
+
+  node2 = gtk_css_node_new ();
+  gtk_css_node_set_name (node2, g_quark_from_static_string ("image"));
+  gtk_css_node_add_class (node2, g_quark_from_static_string ("blue"));
+  gtk_css_node_validate (node2);
+
+  value1 = gtk_css_style_get_value (gtk_css_node_get_style (node1), GTK_CSS_PROPERTY_BACKGROUND_IMAGE);
+  value2 = gtk_css_style_get_value (gtk_css_node_get_style (node2), GTK_CSS_PROPERTY_BACKGROUND_IMAGE);
+  g_assert_true (value1 != value2);
+
+  value1 = gtk_css_value_ref (value1);
+  g_assert_true (gtk_css_value_intern (value1) == value1);
+  gtk_css_value_unref (value1);
+
+  g_object_unref (node1);
+  g_object_unref (node2);
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/css/value/intern", test_intern);
+  g_test_add_func ("/css/value/intern/images", test_intern_images);
+
+  return g_test_run ();
+}
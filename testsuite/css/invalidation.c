@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gtk/gtkcssnodeprivate.h"
+#include "gtk/gtkcssstyleprivate.h"
+#include "gtk/gtkcsscolorvalueprivate.h"
+#include "gtk/gtkcssstylepropertyprivate.h"
+
+static GtkCssNode *
+create_node (GtkCssNode *parent,
+             const char *name)
+{
+  GtkCssNode *node;
+
+  node = gtk_css_node_new ();
+  gtk_css_node_set_name (node, g_quark_from_static_string (name));
+  if (parent)
+    {
+      gtk_css_node_set_parent (node, parent);
+      g_object_unref (node);
+    }
+
+  return node;
+}
+
+static gboolean
+node_is_red (GtkCssNode *node)
+{
+  const GdkRGBA *color;
+
+  color = gtk_css_color_value_get_rgba (gtk_css_style_get_value (gtk_css_node_get_style (node),
+                                                                 GTK_CSS_PROPERTY_COLOR));
+
+  return color->red == 1.0 && color->green == 0.0 && color->blue == 0.0;
+}
+
+static void
+test_targeted (void)
+{
+  GtkCssProvider *provider;
+  GtkCssNode *root, *box, *label;
+  guint64 n_restyled, n_skipped, n_skipped_before;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider,
+                                   "box.dependent > label { color: red; }\n"
+                                   "button:hover label { color: red; }\n",
+                                   -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  root = create_node (NULL, "window");
+  box = create_node (root, "box");
+  label = create_node (box, "label");
+  gtk_css_node_validate (root);
+  g_assert_false (node_is_red (label));
+
+  /* Nothing looks at .independent */
+  gtk_css_node_get_invalidation_stats (&n_restyled, &n_skipped_before);
+  gtk_css_node_add_class (box, g_quark_from_static_string ("independent"));
+  gtk_css_node_validate (root);
+  gtk_css_node_get_invalidation_stats (&n_restyled, &n_skipped);
+  g_assert_cmpuint (n_skipped, >, n_skipped_before);
+  g_assert_false (node_is_red (label));
+
+  gtk_css_node_set_state (box, GTK_STATE_FLAG_PRELIGHT);
+  gtk_css_node_validate (root);
+  g_assert_false (node_is_red (label));
+
+  /* but .dependent on a box needs to reach the label */
+  gtk_css_node_add_class (box, g_quark_from_static_string ("dependent"));
+  gtk_css_node_validate (root);
+  g_assert_true (node_is_red (label));
+
+  gtk_css_node_remove_class (box, g_quark_from_static_string ("dependent"));
+  gtk_css_node_validate (root);
+  g_assert_false (node_is_red (label));
+
+  /* and so does turning the box into a hovered button */
+  gtk_css_node_set_name (box, g_quark_from_static_string ("button"));
+  gtk_css_node_validate (root);
+  g_assert_true (node_is_red (label));
+
+  gtk_css_node_set_state (box, 0);
+  gtk_css_node_validate (root);
+  g_assert_false (node_is_red (label));
+
+  g_object_unref (root);
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/css/invalidation/targeted", test_targeted);
+
+  return g_test_run ();
+}
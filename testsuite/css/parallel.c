@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2021 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gtk/gtkcssnodeprivate.h"
+#include "gtk/gtkcssstyleprivate.h"
+
+/* Enough nodes to be matched on the thread pool */
+#define N_BOXES 10
+#define N_ROWS 20
+
+static const char css[] =
+  "box.odd row { color: red; }\n"
+  "box row:nth-child(3n+1) > label { margin-left: 3px; }\n"
+  "row:first-child image, row:last-child image { opacity: 0.5; }\n"
+  "row.selected ~ row label { font-weight: bold; }\n"
+  "window box:not(.odd) > row.selected { background-color: blue; }\n"
+  "label + image { padding: 1px 2px; }\n";
+
+static GtkCssNode *
+create_node (GtkCssNode *parent,
+             const char *name)
+{
+  GtkCssNode *node;
+
+  node = gtk_css_node_new ();
+  gtk_css_node_set_name (node, g_quark_from_static_string (name));
+  if (parent)
+    {
+      gtk_css_node_set_parent (node, parent);
+      g_object_unref (node);
+    }
+
+  return node;
+}
+
+static GtkCssNode *
+create_tree (void)
+{
+  GtkCssNode *root, *box, *row;
+  int i, j;
+
+  root = create_node (NULL, "window");
+  for (i = 0; i < N_BOXES; i++)
+    {
+      box = create_node (root, "box");
+      if (i % 2)
+        gtk_css_node_add_class (box, g_quark_from_static_string ("odd"));
+
+      for (j = 0; j < N_ROWS; j++)
+        {
+          row = create_node (box, "row");
+          create_node (row, "label");
+          create_node (row, "image");
+        }
+    }
+
+  return root;
+}
+
+/* Selects every seventh row, which invalidates the rows after it,
+ * like a theme change does for the whole tree
+ */
+static void
+change_tree (GtkCssNode *root)
+{
+  GtkCssNode *box, *row;
+  int n = 0;
+
+  for (box = gtk_css_node_get_first_child (root);
+       box;
+       box = gtk_css_node_get_next_sibling (box))
+    {
+      for (row = gtk_css_node_get_first_child (box);
+           row;
+           row = gtk_css_node_get_next_sibling (row))
+        {
+          if (n++ % 7 == 0)
+            gtk_css_node_add_class (row, g_quark_from_static_string ("selected"));
+          else
+            gtk_css_node_remove_class (row, g_quark_from_static_string ("selected"));
+        }
+    }
+}
+
+static void
+validate (GtkCssNode *root,
+          gboolean    threads)
+{
+  GtkDebugFlags flags = gtk_get_debug_flags ();
+
+  if (threads)
+    gtk_set_debug_flags (flags & ~GTK_DEBUG_CSS_NO_THREADS);
+  else
+    gtk_set_debug_flags (flags | GTK_DEBUG_CSS_NO_THREADS);
+
+  gtk_css_node_validate (root);
+
+  gtk_set_debug_flags (flags);
+}
+
+static void
+assert_same_styles (GtkCssNode *node1,
+                    GtkCssNode *node2)
+{
+  GtkCssNode *child1, *child2;
+  char *style1, *style2;
+
+  style1 = gtk_css_style_to_string (gtk_css_node_get_style (node1));
+  style2 = gtk_css_style_to_string (gtk_css_node_get_style (node2));
+  g_assert_cmpstr (style1, ==, style2);
+  g_free (style1);
+  g_free (style2);
+
+  for (child1 = gtk_css_node_get_first_child (node1), child2 = gtk_css_node_get_first_child (node2);
+       child1 && child2;
+       child1 = gtk_css_node_get_next_sibling (child1), child2 = gtk_css_node_get_next_sibling (child2))
+    assert_same_styles (child1, child2);
+
+  g_assert_true (child1 == NULL && child2 == NULL);
+}
+
+static GtkCssProvider *
+add_provider (void)
+{
+  GtkCssProvider *provider;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, css, -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  return provider;
+}
+
+static void
+remove_provider (GtkCssProvider *provider)
+{
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+/* Styles matched on the thread pool must be the same as the
+ * ones matched while validating
+ */
+static void
+test_restyle (void)
+{
+  GtkCssProvider *provider;
+  GtkCssNode *serial, *parallel;
+
+  provider = add_provider ();
+
+  serial = create_tree ();
+  parallel = create_tree ();
+  validate (serial, FALSE);
+  validate (parallel, TRUE);
+  assert_same_styles (serial, parallel);
+
+  change_tree (serial);
+  change_tree (parallel);
+  validate (serial, FALSE);
+  validate (parallel, TRUE);
+  assert_same_styles (serial, parallel);
+
+  g_object_unref (serial);
+  g_object_unref (parallel);
+  remove_provider (provider);
+}
+
+/* Validating one window does not use up the invalidations
+ * of another one
+ */
+static void
+test_per_root (void)
+{
+  GtkCssProvider *provider;
+  GtkCssNode *first, *second;
+  int n;
+
+  provider = add_provider ();
+
+  first = create_tree ();
+  second = create_tree ();
+  g_assert_cmpint (first->radical_invalidations, >, 0);
+  g_assert_cmpint (second->radical_invalidations, >, 0);
+
+  validate (first, TRUE);
+  g_assert_cmpint (first->radical_invalidations, ==, 0);
+  g_assert_cmpint (second->radical_invalidations, >, 0);
+
+  validate (second, TRUE);
+  g_assert_cmpint (second->radical_invalidations, ==, 0);
+
+  /* Subtrees bring theirs along */
+  g_object_unref (second);
+  second = create_node (NULL, "box");
+  create_node (create_node (second, "row"), "label");
+  n = second->radical_invalidations;
+  g_assert_cmpint (n, >, 0);
+  gtk_css_node_set_parent (second, first);
+  g_assert_cmpint (first->radical_invalidations, >=, n);
+  g_assert_cmpint (second->radical_invalidations, ==, 0);
+  g_object_unref (second);
+
+  g_object_unref (first);
+  remove_provider (provider);
+}
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/css/parallel/restyle", test_restyle);
+  g_test_add_func ("/css/parallel/per-root", test_per_root);
+
+  return g_test_run ();
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2021 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gtk/gtkcssnodeprivate.h"
+#include "gtk/gtkcssnodestylecacheprivate.h"
+#include "gtk/gtkcssstyleprivate.h"
+#include "gtk/gtkcsscolorvalueprivate.h"
+#include "gtk/gtkcssstylepropertyprivate.h"
+
+static GtkCssNode *
+create_node (GtkCssNode *parent,
+             const char *name)
+{
+  GtkCssNode *node;
+
+  node = gtk_css_node_new ();
+  gtk_css_node_set_name (node, g_quark_from_static_string (name));
+  if (parent)
+    {
+      gtk_css_node_set_parent (node, parent);
+      g_object_unref (node);
+    }
+
+  return node;
+}
+
+static gboolean
+node_is_red (GtkCssNode *node)
+{
+  const GdkRGBA *color;
+
+  color = gtk_css_color_value_get_rgba (gtk_css_style_get_value (gtk_css_node_get_style (node),
+                                                                 GTK_CSS_PROPERTY_COLOR));
+
+  return color->red == 1.0 && color->green == 0.0 && color->blue == 0.0;
+}
+
+/* Two identical subtrees, one of them under a class that a
+ * descendant selector looks for. The styles of the other one
+ * must not be shared with it.
+ */
+static void
+test_ancestors (void)
+{
+  GtkCssProvider *provider;
+  GtkCssNode *root, *box1, *box2, *label1, *label2, *label3;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider,
+                                   ".sharing-sidebar label { color: red; }\n",
+                                   -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  root = create_node (NULL, "window");
+  box1 = create_node (root, "box");
+  label1 = create_node (create_node (box1, "row"), "label");
+  box2 = create_node (root, "box");
+  label2 = create_node (create_node (box2, "row"), "label");
+  gtk_css_node_validate (root);
+  g_assert_false (node_is_red (label1));
+  g_assert_false (node_is_red (label2));
+
+  /* The box keeps its style, so the row and label below it look
+   * up the same keys as the ones in the first box.
+   */
+  gtk_css_node_add_class (box2, g_quark_from_static_string ("sharing-sidebar"));
+  gtk_css_node_validate (root);
+  g_assert_false (node_is_red (label1));
+  g_assert_true (node_is_red (label2));
+
+  /* A new subtree in the sidebar */
+  label3 = create_node (create_node (box2, "row"), "label");
+  gtk_css_node_validate (root);
+  g_assert_true (node_is_red (label3));
+
+  g_object_unref (root);
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+#define N_BOXES 6
+
+/* Rows and labels in boxes that share their style share theirs,
+ * also when some selector looks at ancestors they don't have.
+ */
+static void
+test_hits (gconstpointer data)
+{
+  const char *css = data;
+  GtkCssProvider *provider;
+  GtkCssNode *root;
+  guint n_styles;
+  guint64 n_lookups, n_hits, n_hits_before;
+  int i;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, css, -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  root = create_node (NULL, "window");
+  for (i = 0; i < N_BOXES; i++)
+    create_node (create_node (create_node (root, "box"), "row"), "label");
+
+  gtk_css_node_style_cache_get_shared_stats (&n_styles, &n_lookups, &n_hits_before);
+  gtk_css_node_validate (root);
+  gtk_css_node_style_cache_get_shared_stats (&n_styles, &n_lookups, &n_hits);
+
+  /* The boxes in the middle get the style of the second one from
+   * their parent, the rows and labels in them from the shared styles
+   */
+  g_assert_cmpuint (n_hits - n_hits_before, >=, 2 * (N_BOXES - 3));
+
+  g_object_unref (root);
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/css/sharing/ancestors", test_ancestors);
+  g_test_add_data_func ("/css/sharing/hits", "label { color: red; }", test_hits);
+  g_test_add_data_func ("/css/sharing/hits-ancestors", ".sharing-sidebar label { color: red; }", test_hits);
+
+  return g_test_run ();
+}
@@ -22,6 +22,8 @@
 
 #include <gtk/gtk.h>
 #include "gtk/gtkcssvalueprivate.h"
+#include "gtk/gtkcssnodeprivate.h"
+#include "gtk/gtkcssstyleprivate.h"
 #include "gtk/gtkcsscolorvalueprivate.h"
 #include "gtk/gtkcssnumbervalueprivate.h"
 #include "gtk/gtkcssstylepropertyprivate.h"
@@ -0,0 +1,158 @@
+#include <string.h>
+#include <gtk/gtk.h>
+#include "gdk/broadway/gdkdisplay-broadway.h"
+#include "gdk/broadway/gdkprivate-broadway.h"
+#include "gdk/broadway/broadway-output.h"
+
+static GdkTexture *
+create_texture (guint8 value)
+{
+  GdkTexture *texture;
+  GBytes *bytes;
+  guchar *data;
+
+  data = g_malloc (16 * 16 * 4);
+  memset (data, value, 16 * 16 * 4);
+  bytes = g_bytes_new_take (data, 16 * 16 * 4);
+  texture = gdk_memory_texture_new (16, 16, GDK_MEMORY_DEFAULT, bytes, 16 * 4);
+  g_bytes_unref (bytes);
+
+  return texture;
+}
+
+/* Textures with the same pixels are only uploaded once */
+static void
+test_shared (void)
+{
+  GdkDisplay *display = gdk_display_get_default ();
+  GdkBroadwayDisplay *broadway_display;
+  GdkTexture *texture1, *texture2, *texture3;
+  guint32 id1, id2, id3;
+  guint n_uploads;
+
+  if (!GDK_IS_BROADWAY_DISPLAY (display))
+    {
+      g_test_skip ("Not using the broadway backend");
+      return;
+    }
+
+  broadway_display = GDK_BROADWAY_DISPLAY (display);
+  n_uploads = broadway_display->n_texture_uploads;
+
+  texture1 = create_texture (0x80);
+  texture2 = create_texture (0x80);
+  texture3 = create_texture (0x40);
+
+  id1 = gdk_broadway_display_ensure_texture (display, texture1);
+  id2 = gdk_broadway_display_ensure_texture (display, texture2);
+  g_assert_cmpuint (id1, ==, id2);
+  g_assert_cmpuint (broadway_display->n_texture_uploads, ==, n_uploads + 1);
+
+  id3 = gdk_broadway_display_ensure_texture (display, texture3);
+  g_assert_cmpuint (id3, !=, id1);
+  g_assert_cmpuint (broadway_display->n_texture_uploads, ==, n_uploads + 2);
+
+  /* Unused uploads are kept around for a while */
+  g_object_unref (texture1);
+  g_object_unref (texture2);
+  texture1 = create_texture (0x80);
+  id1 = gdk_broadway_display_ensure_texture (display, texture1);
+  g_assert_cmpuint (id1, ==, id2);
+  g_assert_cmpuint (broadway_display->n_texture_uploads, ==, n_uploads + 2);
+
+  g_object_unref (texture1);
+  g_object_unref (texture3);
+}
+
+static BroadwayEncodedTexture *
+create_encoded_texture (void)
+{
+  BroadwayEncodedTexture *encoded;
+  BroadwayTextureHeader *header;
+  GBytes *bytes;
+  guchar *data;
+  gsize i, size;
+
+  /* Four tiles of noise, so that they are neither solid nor compressed */
+  size = sizeof (BroadwayTextureHeader) + 128 * 128 * 4;
+  data = g_malloc (size);
+  header = (BroadwayTextureHeader *) data;
+  header->width = 128;
+  header->height = 128;
+  for (i = sizeof (BroadwayTextureHeader); i < size; i++)
+    data[i] = g_test_rand_int_range (0, 256);
+
+  bytes = g_bytes_new_take (data, size);
+  encoded = broadway_encoded_texture_new (bytes);
+  g_bytes_unref (bytes);
+
+  return encoded;
+}
+
+static gsize
+flush (BroadwayOutput      *output,
+       GMemoryOutputStream *stream)
+{
+  static gsize last_size = 0;
+  gsize size, sent;
+
+  g_assert_true (broadway_output_flush (output));
+  size = g_memory_output_stream_get_data_size (stream);
+  sent = size - last_size;
+  last_size = size;
+
+  return sent;
+}
+
+/* Tiles the client already has are only sent as a reference, and
+ * sent again once all textures using them are released */
+static void
+test_tiles (void)
+{
+  GOutputStream *stream;
+  BroadwayOutput *output;
+  BroadwayEncodedTexture *encoded;
+  gsize full, cached;
+
+  stream = g_memory_output_stream_new_resizable ();
+  output = broadway_output_new (stream, 0);
+  encoded = create_encoded_texture ();
+  g_assert_cmpuint (encoded->n_tiles, ==, 4);
+
+  broadway_output_upload_texture (output, 1, encoded);
+  full = flush (output, G_MEMORY_OUTPUT_STREAM (stream));
+  g_assert_cmpuint (full, >, 128 * 128 * 4);
+
+  broadway_output_upload_texture (output, 2, encoded);
+  cached = flush (output, G_MEMORY_OUTPUT_STREAM (stream));
+  g_assert_cmpuint (cached, <, 128);
+
+  /* Texture 2 still holds the tiles */
+  broadway_output_release_texture (output, 1);
+  broadway_output_upload_texture (output, 3, encoded);
+  g_assert_cmpuint (flush (output, G_MEMORY_OUTPUT_STREAM (stream)), <, 128);
+  g_assert_false (broadway_output_has_texture (output, 1));
+  g_assert_true (broadway_output_has_texture (output, 3));
+
+  broadway_output_release_texture (output, 2);
+  broadway_output_release_texture (output, 3);
+  flush (output, G_MEMORY_OUTPUT_STREAM (stream));
+
+  broadway_output_upload_texture (output, 4, encoded);
+  g_assert_cmpuint (flush (output, G_MEMORY_OUTPUT_STREAM (stream)), ==, full);
+
+  broadway_encoded_texture_free (encoded);
+  broadway_output_free (output);
+  g_object_unref (stream);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/broadway/texture/shared", test_shared);
+  g_test_add_func ("/broadway/texture/tiles", test_tiles);
+
+  return g_test_run ();
+}
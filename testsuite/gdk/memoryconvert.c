@@ -0,0 +1,86 @@
+#include <string.h>
+#include <gdk/gdk.h>
+#include "gdk/gdkmemoryformatprivate.h"
+
+/* Odd widths, so that the SIMD kernels have leftover pixels */
+static const struct {
+  gsize width;
+  gsize height;
+} sizes[] = {
+  { 1, 1 },
+  { 3, 5 },
+  { 17, 3 },
+  { 67, 45 },
+};
+
+/* The SIMD kernels must give exactly the same output as the C one,
+ * for all conversions
+ */
+static void
+test_kernel (gconstpointer data)
+{
+  const char *kernel = data;
+  GdkMemoryFormat src_format, dest_format;
+  guint i;
+
+  if (!gdk_memory_convert_set_kernel (kernel))
+    {
+      g_test_skip ("Kernel not supported on this machine");
+      return;
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      gsize width = sizes[i].width;
+      gsize height = sizes[i].height;
+      /* Large enough for all formats, and padded, so that rows
+       * don't start aligned */
+      gsize src_stride = width * 4 + 3;
+      gsize dest_stride = width * 4;
+      guchar *src, *dest, *reference;
+      gsize j;
+
+      src = g_malloc (src_stride * height);
+      for (j = 0; j < src_stride * height; j++)
+        src[j] = g_test_rand_int_range (0, 256);
+
+      dest = g_malloc (dest_stride * height);
+      reference = g_malloc (dest_stride * height);
+
+      /* Only premultiplied formats are possible destinations */
+      for (dest_format = 0; dest_format < 3; dest_format++)
+        for (src_format = 0; src_format < GDK_MEMORY_N_FORMATS; src_format++)
+          {
+            gdk_memory_convert_set_kernel ("c");
+            gdk_memory_convert (reference, dest_stride, dest_format,
+                                src, src_stride, src_format,
+                                width, height);
+
+            gdk_memory_convert_set_kernel (kernel);
+            gdk_memory_convert (dest, dest_stride, dest_format,
+                                src, src_stride, src_format,
+                                width, height);
+
+            if (memcmp (dest, reference, dest_stride * height) != 0)
+              g_test_message ("%s: %d => %d differs for %" G_GSIZE_FORMAT "x%" G_GSIZE_FORMAT,
+                              kernel, src_format, dest_format, width, height);
+            g_assert_cmpmem (dest, dest_stride * height, reference, dest_stride * height);
+          }
+
+      g_free (src);
+      g_free (dest);
+      g_free (reference);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_data_func ("/memoryconvert/kernel/avx2", "avx2", test_kernel);
+  g_test_add_data_func ("/memoryconvert/kernel/ssse3", "ssse3", test_kernel);
+  g_test_add_data_func ("/memoryconvert/kernel/neon", "neon", test_kernel);
+
+  return g_test_run ();
+}
@@ -72,9 +72,9 @@ compare_textures (GdkTexture *expected,
       for (x = 0; x < width; x++)
         {
           if (ignore_alpha)
-            g_assert_cmphex (*(guint32 *) &expected_data[y * width + x * 4] & 0xFFFFFF, ==, *(guint32 *) &test_data[y * width + x * 4] & 0xFFFFFF);
+            g_assert_cmphex (*(guint32 *) &expected_data[(y * width + x) * 4] & 0xFFFFFF, ==, *(guint32 *) &test_data[(y * width + x) * 4] & 0xFFFFFF);
           else
-            g_assert_cmphex (*(guint32 *) &expected_data[y * width + x * 4], ==, *(guint32 *) &test_data[y * width + x * 4]);
+            g_assert_cmphex (*(guint32 *) &expected_data[(y * width + x) * 4], ==, *(guint32 *) &test_data[(y * width + x) * 4]);
         }
     }
 
@@ -173,6 +173,22 @@ test_download_4x4_with_stride (gconstpointer data)
   g_object_unref (test);
 }
 
+/* Wide enough for the SIMD conversions, with pixels left over */
+static void
+test_download_33x3 (gconstpointer data)
+{
+  const TestData *test_data = data;
+  GdkTexture *expected, *test;
+
+  expected = create_texture (GDK_MEMORY_DEFAULT, test_data->color, 33, 3, 33 * 4);
+  test = create_texture (test_data->format, test_data->color, 33, 3, 33 * tests[test_data->format].bytes_per_pixel);
+
+  compare_textures (expected, test, tests[test_data->format].opaque);
+
+  g_object_unref (expected);
+  g_object_unref (test);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -223,6 +239,15 @@ main (int argc, char *argv[])
           test_data->color = color;
           g_test_add_data_func_full (test_name, test_data, test_download_4x4_with_stride, g_free);
           g_free (test_name);
+
+          test_data = g_new (TestData, 1);
+          test_name = g_strdup_printf ("/memorytexture/download_33x3/%s/%s",
+                                       g_enum_get_value (enum_class, format)->value_nick,
+                                       color_names[color]);
+          test_data->format = format;
+          test_data->color = color;
+          g_test_add_data_func_full (test_name, test_data, test_download_33x3, g_free);
+          g_free (test_name);
         }
     }
 
@@ -86,6 +86,95 @@ test_texture_from_resource (void)
   g_object_unref (texture);
 }
 
+static void
+test_texture_from_resource_pixels (void)
+{
+  GdkPixbuf *pixbuf;
+  GdkTexture *texture, *texture2;
+  GError *error = NULL;
+  guchar *data, *data2;
+  int width, height;
+  gsize stride;
+
+  pixbuf = gdk_pixbuf_new_from_resource ("/org/gtk/libgtk/icons/16x16/places/user-trash.png", &error);
+  g_assert_no_error (error);
+  texture = gdk_texture_new_for_pixbuf (pixbuf);
+  texture2 = gdk_texture_new_from_resource ("/org/gtk/libgtk/icons/16x16/places/user-trash.png");
+
+  width = gdk_texture_get_width (texture);
+  height = gdk_texture_get_height (texture);
+  g_assert_cmpint (gdk_texture_get_width (texture2), ==, width);
+  g_assert_cmpint (gdk_texture_get_height (texture2), ==, height);
+
+  stride = 4 * width;
+  data = g_new0 (guchar, stride * height);
+  gdk_texture_download (texture, data, stride);
+  data2 = g_new0 (guchar, stride * height);
+  gdk_texture_download (texture2, data2, stride);
+
+  g_assert_true (compare_pixels (width, height, data, stride, data2, stride));
+
+  g_free (data);
+  g_free (data2);
+  g_object_unref (pixbuf);
+  g_object_unref (texture);
+  g_object_unref (texture2);
+}
+
+static void
+texture_loaded (GObject      *source,
+                GAsyncResult *result,
+                gpointer      data)
+{
+  GdkTexture **texture = data;
+  GError *error = NULL;
+
+  *texture = gdk_texture_new_from_file_finish (result, &error);
+  g_assert_no_error (error);
+
+  g_main_context_wakeup (NULL);
+}
+
+static void
+test_texture_from_file_async (void)
+{
+  GdkTexture *texture;
+  GdkTexture *texture2 = NULL;
+  GFile *file;
+  guchar *data, *data2;
+  gsize stride;
+
+  texture = gdk_texture_new_from_resource ("/org/gtk/libgtk/icons/16x16/places/user-trash.png");
+  gdk_texture_save_to_png (texture, "test-async.png");
+  g_object_unref (texture);
+
+  file = g_file_new_for_path ("test-async.png");
+  texture = gdk_texture_new_from_file (file, NULL);
+  g_assert_nonnull (texture);
+
+  gdk_texture_new_from_file_async (file, NULL, texture_loaded, &texture2);
+  while (texture2 == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpint (gdk_texture_get_width (texture2), ==, 16);
+  g_assert_cmpint (gdk_texture_get_height (texture2), ==, 16);
+
+  stride = 4 * 16;
+  data = g_new0 (guchar, stride * 16);
+  gdk_texture_download (texture, data, stride);
+  data2 = g_new0 (guchar, stride * 16);
+  gdk_texture_download (texture2, data2, stride);
+
+  g_assert_true (compare_pixels (16, 16, data, stride, data2, stride));
+
+  g_free (data);
+  g_free (data2);
+  g_object_unref (texture);
+  g_object_unref (texture2);
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+}
+
 static void
 test_texture_save_to_png (void)
 {
@@ -106,6 +195,43 @@ test_texture_save_to_png (void)
   g_object_unref (texture2);
 }
 
+static void
+test_texture_from_jpeg (gconstpointer data)
+{
+  const char *name = data;
+  GdkTexture *texture;
+  GError *error = NULL;
+  GFile *file;
+  char *path;
+  guint32 pixels[8 * 8];
+  guint32 expected;
+  int i;
+
+  path = g_test_build_filename (G_TEST_DIST, "image-data", name, NULL);
+  file = g_file_new_for_path (path);
+  texture = gdk_texture_new_from_file (file, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpint (gdk_texture_get_width (texture), ==, 8);
+  g_assert_cmpint (gdk_texture_get_height (texture), ==, 8);
+
+  /* The gray image is 0x40, the CMYK ones are red, stored
+   * inverted with an Adobe marker and plain without one.
+   */
+  if (g_str_has_prefix (name, "gray"))
+    expected = 0xff404040;
+  else
+    expected = 0xffff0000;
+
+  gdk_texture_download (texture, (guchar *) pixels, 8 * 4);
+  for (i = 0; i < 8 * 8; i++)
+    g_assert_cmphex (pixels[i], ==, expected);
+
+  g_object_unref (texture);
+  g_object_unref (file);
+  g_free (path);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -114,7 +240,12 @@ main (int argc, char *argv[])
 
   g_test_add_func ("/texture/from-pixbuf", test_texture_from_pixbuf);
   g_test_add_func ("/texture/from-resource", test_texture_from_resource);
+  g_test_add_func ("/texture/from-resource-pixels", test_texture_from_resource_pixels);
+  g_test_add_func ("/texture/from-file-async", test_texture_from_file_async);
   g_test_add_func ("/texture/save-to-png", test_texture_save_to_png);
+  g_test_add_data_func ("/texture/from-jpeg/gray", "gray.jpg", test_texture_from_jpeg);
+  g_test_add_data_func ("/texture/from-jpeg/cmyk", "cmyk.jpg", test_texture_from_jpeg);
+  g_test_add_data_func ("/texture/from-jpeg/cmyk-adobe", "cmyk-adobe.jpg", test_texture_from_jpeg);
 
   return g_test_run ();
 }
@@ -0,0 +1,183 @@
+#include <gtk/gtk.h>
+
+#ifdef GDK_WINDOWING_WAYLAND
+#include <gdk/wayland/gdkwayland.h>
+#endif
+
+#define WIDTH 100
+#define HEIGHT 100
+
+/* Each frame adds one square, and only damages that */
+static const struct {
+  cairo_rectangle_int_t rect;
+  guint32 color;
+} squares[] = {
+  { { 10, 10, 20, 20 }, 0x0000ff },
+  { { 40, 40, 20, 20 }, 0x00ff00 },
+  { { 70, 10, 20, 20 }, 0xffff00 },
+  { { 10, 70, 20, 20 }, 0x00ffff },
+  { { 15, 15, 10, 10 }, 0xff00ff },
+};
+
+#ifdef GDK_WINDOWING_WAYLAND
+static void
+compute_size (GdkToplevel     *toplevel,
+              GdkToplevelSize *size,
+              gpointer         data)
+{
+  gdk_toplevel_size_set_size (size, WIDTH, HEIGHT);
+}
+
+static void
+set_source_color (cairo_t *cr,
+                  guint32  color)
+{
+  cairo_set_source_rgb (cr,
+                        ((color >> 16) & 0xff) / 255.,
+                        ((color >> 8) & 0xff) / 255.,
+                        (color & 0xff) / 255.);
+}
+
+/* The scene up to square @n */
+static guint32
+expected_color (guint n,
+                int   x,
+                int   y)
+{
+  guint32 color = 0xff0000;
+  guint i;
+
+  for (i = 0; i < n; i++)
+    {
+      if (x >= squares[i].rect.x && x < squares[i].rect.x + squares[i].rect.width &&
+          y >= squares[i].rect.y && y < squares[i].rect.y + squares[i].rect.height)
+        color = squares[i].color;
+    }
+
+  return color;
+}
+
+/* Checks that the whole buffer that is drawn to holds the scene up
+ * to square @n, including the parts outside the frame region */
+static void
+assert_buffer (cairo_surface_t *buffer,
+               guint            n)
+{
+  double x_scale, y_scale;
+  guchar *data;
+  int stride;
+  int x, y;
+
+  cairo_surface_flush (buffer);
+  cairo_surface_get_device_scale (buffer, &x_scale, &y_scale);
+  data = cairo_image_surface_get_data (buffer);
+  stride = cairo_image_surface_get_stride (buffer);
+
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      {
+        guint32 pixel = *(guint32 *) (data + (int) (y * y_scale) * stride + (int) (x * x_scale) * 4);
+
+        g_assert_cmphex (pixel & 0xffffff, ==, expected_color (n, x, y));
+      }
+}
+
+/* Draws the whole scene up to square @n, clipped to the frame region */
+static void
+draw_frame (GdkCairoContext *context,
+            guint            n)
+{
+  GdkDrawContext *draw_context = GDK_DRAW_CONTEXT (context);
+  cairo_region_t *region;
+  cairo_t *cr;
+  guint i;
+
+  if (n == 0)
+    region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) { 0, 0, WIDTH, HEIGHT });
+  else
+    region = cairo_region_create_rectangle (&squares[n - 1].rect);
+
+  gdk_draw_context_begin_frame (draw_context, region);
+
+  /* Once there is a previous frame, only the damage is redrawn */
+  if (n > 0)
+    g_assert_true (cairo_region_equal (gdk_draw_context_get_frame_region (draw_context), region));
+
+  cr = gdk_cairo_context_cairo_create (context);
+
+  set_source_color (cr, 0xff0000);
+  cairo_paint (cr);
+  for (i = 0; i < n; i++)
+    {
+      set_source_color (cr, squares[i].color);
+      gdk_cairo_rectangle (cr, &squares[i].rect);
+      cairo_fill (cr);
+    }
+
+  assert_buffer (cairo_get_target (cr), n);
+
+  cairo_destroy (cr);
+  gdk_draw_context_end_frame (draw_context);
+  cairo_region_destroy (region);
+}
+#endif
+
+/* Frames that only redraw their damage must still leave the whole
+ * scene in the buffer they draw to, also when that buffer is reused
+ * and the rest is copied from the previous frame.
+ */
+static void
+test_partial (void)
+{
+#ifdef GDK_WINDOWING_WAYLAND
+  GdkDisplay *display = gdk_display_get_default ();
+  GdkToplevelLayout *layout;
+  GdkCairoContext *context;
+  GdkSurface *surface;
+  guint i;
+
+  if (!GDK_IS_WAYLAND_DISPLAY (display))
+    {
+      g_test_skip ("Not using the Wayland backend");
+      return;
+    }
+
+  surface = gdk_surface_new_toplevel (display);
+  g_signal_connect (surface, "compute-size", G_CALLBACK (compute_size), NULL);
+  layout = gdk_toplevel_layout_new ();
+  gdk_toplevel_present (GDK_TOPLEVEL (surface), layout);
+  gdk_toplevel_layout_unref (layout);
+
+  while (!gdk_surface_get_mapped (surface) ||
+         gdk_surface_get_width (surface) != WIDTH ||
+         gdk_surface_get_height (surface) != HEIGHT)
+    g_main_context_iteration (NULL, TRUE);
+
+  context = gdk_surface_create_cairo_context (surface);
+
+  /* Twice as many frames as buffers are kept, and a roundtrip after
+   * each, so that released buffers get reused */
+  for (i = 0; i <= G_N_ELEMENTS (squares); i++)
+    {
+      draw_frame (context, i);
+      wl_display_roundtrip (gdk_wayland_display_get_wl_display (display));
+      while (g_main_context_iteration (NULL, FALSE));
+    }
+
+  g_object_unref (context);
+  gdk_surface_destroy (surface);
+  g_object_unref (surface);
+#else
+  g_test_skip ("Built without Wayland support");
+#endif
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/wayland/cairo/partial", test_partial);
+
+  return g_test_run ();
+}
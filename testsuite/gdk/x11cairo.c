@@ -0,0 +1,155 @@
+#include <gtk/gtk.h>
+
+#ifdef GDK_WINDOWING_X11
+#include <gdk/x11/gdkx.h>
+#endif
+
+#define WIDTH 100
+#define HEIGHT 100
+
+/* Each frame adds one square, and only damages that */
+static const struct {
+  cairo_rectangle_int_t rect;
+  guint32 color;
+} squares[] = {
+  { { 10, 10, 20, 20 }, 0x0000ff },
+  { { 40, 40, 20, 20 }, 0x00ff00 },
+  { { 70, 10, 20, 20 }, 0xffff00 },
+  { { 10, 70, 20, 20 }, 0x00ffff },
+  { { 15, 15, 10, 10 }, 0xff00ff },
+};
+
+#ifdef GDK_WINDOWING_X11
+static void
+compute_size (GdkToplevel     *toplevel,
+              GdkToplevelSize *size,
+              gpointer         data)
+{
+  gdk_toplevel_size_set_size (size, WIDTH, HEIGHT);
+}
+
+static void
+set_source_color (cairo_t *cr,
+                  guint32  color)
+{
+  cairo_set_source_rgb (cr,
+                        ((color >> 16) & 0xff) / 255.,
+                        ((color >> 8) & 0xff) / 255.,
+                        (color & 0xff) / 255.);
+}
+
+/* Draws the whole scene up to square @n, clipped to the frame region */
+static void
+draw_frame (GdkCairoContext *context,
+            guint            n)
+{
+  cairo_region_t *region;
+  cairo_t *cr;
+  guint i;
+
+  if (n == 0)
+    region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) { 0, 0, WIDTH, HEIGHT });
+  else
+    region = cairo_region_create_rectangle (&squares[n - 1].rect);
+
+  gdk_draw_context_begin_frame (GDK_DRAW_CONTEXT (context), region);
+  cr = gdk_cairo_context_cairo_create (context);
+
+  set_source_color (cr, 0xff0000);
+  cairo_paint (cr);
+  for (i = 0; i < n; i++)
+    {
+      set_source_color (cr, squares[i].color);
+      gdk_cairo_rectangle (cr, &squares[i].rect);
+      cairo_fill (cr);
+    }
+
+  cairo_destroy (cr);
+  gdk_draw_context_end_frame (GDK_DRAW_CONTEXT (context));
+  cairo_region_destroy (region);
+}
+
+static guint32
+expected_color (int x,
+                int y)
+{
+  guint32 color = 0xff0000;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (squares); i++)
+    {
+      if (x >= squares[i].rect.x && x < squares[i].rect.x + squares[i].rect.width &&
+          y >= squares[i].rect.y && y < squares[i].rect.y + squares[i].rect.height)
+        color = squares[i].color;
+    }
+
+  return color;
+}
+#endif
+
+/* Frames that only redraw their damage must leave the whole scene
+ * on the window, also when the buffers are reused. Run with and
+ * without GDK_DEBUG=shm-disable to test both paths.
+ */
+static void
+test_partial (void)
+{
+#ifdef GDK_WINDOWING_X11
+  GdkDisplay *display = gdk_display_get_default ();
+  GdkToplevelLayout *layout;
+  GdkCairoContext *context;
+  GdkSurface *surface;
+  XImage *image;
+  guint i;
+  int x, y;
+
+  if (!GDK_IS_X11_DISPLAY (display))
+    {
+      g_test_skip ("Not using the X11 backend");
+      return;
+    }
+
+  surface = gdk_surface_new_toplevel (display);
+  g_signal_connect (surface, "compute-size", G_CALLBACK (compute_size), NULL);
+  layout = gdk_toplevel_layout_new ();
+  gdk_toplevel_present (GDK_TOPLEVEL (surface), layout);
+  gdk_toplevel_layout_unref (layout);
+
+  while (!gdk_surface_get_mapped (surface) ||
+         gdk_surface_get_width (surface) != WIDTH ||
+         gdk_surface_get_height (surface) != HEIGHT)
+    g_main_context_iteration (NULL, TRUE);
+
+  context = gdk_surface_create_cairo_context (surface);
+
+  for (i = 0; i <= G_N_ELEMENTS (squares); i++)
+    draw_frame (context, i);
+
+  image = XGetImage (gdk_x11_display_get_xdisplay (display),
+                     gdk_x11_surface_get_xid (surface),
+                     0, 0, WIDTH, HEIGHT,
+                     AllPlanes, ZPixmap);
+  g_assert_nonnull (image);
+
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      g_assert_cmphex (XGetPixel (image, x, y) & 0xffffff, ==, expected_color (x, y));
+
+  XDestroyImage (image);
+  g_object_unref (context);
+  gdk_surface_destroy (surface);
+  g_object_unref (surface);
+#else
+  g_test_skip ("Built without X11 support");
+#endif
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/x11/cairo/partial", test_partial);
+
+  return g_test_run ();
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <gtk/gtk.h>
+#include "gsk/gskprofilerprivate.h"
+#include "gsk/gskrendererprivate.h"
+
+#define WIDTH 1500
+
+/* More frames than it takes for unused glyphs to be marked as old,
+ * and for the atlases to be compacted one per frame */
+#define N_AGING_FRAMES 240
+
+static GskRenderNode *
+create_text (const char *text,
+             int         min_size,
+             int         max_size)
+{
+  GtkSnapshot *snapshot;
+  PangoContext *context;
+  PangoLayout *layout;
+  int size, height;
+
+  snapshot = gtk_snapshot_new ();
+  context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+  layout = pango_layout_new (context);
+  pango_layout_set_width (layout, WIDTH * PANGO_SCALE);
+  pango_layout_set_text (layout, text, -1);
+
+  for (size = min_size; size <= max_size; size += 8)
+    {
+      PangoFontDescription *desc;
+
+      desc = pango_font_description_from_string ("Sans");
+      pango_font_description_set_absolute_size (desc, size * PANGO_SCALE);
+      pango_layout_set_font_description (layout, desc);
+      pango_font_description_free (desc);
+
+      gtk_snapshot_append_layout (snapshot, layout, &(GdkRGBA) { 0, 0, 0, 1 });
+      pango_layout_get_pixel_size (layout, NULL, &height);
+      gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (0, height));
+    }
+
+  g_object_unref (layout);
+  g_object_unref (context);
+
+  return gtk_snapshot_free_to_node (snapshot);
+}
+
+/* Many glyphs at many sizes, to fill several atlases */
+static GskRenderNode *
+create_filler (void)
+{
+  char text[128];
+  int i;
+
+  for (i = 0; i < 94; i++)
+    text[i] = '!' + i;
+  text[i] = '\0';
+
+  return create_text (text, 20, 76);
+}
+
+static guchar *
+render (GskRenderer   *renderer,
+        GskRenderNode *node,
+        guint         *n_evicted,
+        guint         *n_dropped)
+{
+  GskProfiler *profiler;
+  GdkTexture *texture;
+  graphene_rect_t bounds;
+  guchar *data;
+  int width, height;
+
+  gsk_render_node_get_bounds (node, &bounds);
+  width = ceil (bounds.origin.x + bounds.size.width);
+  height = ceil (bounds.origin.y + bounds.size.height);
+
+  texture = gsk_renderer_render_texture (renderer, node, &GRAPHENE_RECT_INIT (0, 0, width, height));
+  data = g_malloc (width * height * 4);
+  gdk_texture_download (texture, data, width * 4);
+  g_object_unref (texture);
+
+  profiler = gsk_renderer_get_profiler (renderer);
+  *n_evicted += gsk_profiler_counter_get (profiler, g_quark_from_static_string ("atlas-item-evictions"));
+  *n_dropped += gsk_profiler_counter_get (profiler, g_quark_from_static_string ("atlases-dropped"));
+
+  return data;
+}
+
+/* Glyphs that stay in use must still render the same after the
+ * glyphs around them in the atlas are evicted and their atlas is
+ * compacted or dropped
+ */
+static void
+test_evict (void)
+{
+  GdkSurface *surface;
+  GskRenderer *renderer;
+  GskRenderNode *survivors, *filler;
+  GError *error = NULL;
+  guchar *reference, *data;
+  guint n_evicted = 0, n_dropped = 0;
+  graphene_rect_t bounds;
+  gsize size;
+  int i;
+
+  surface = gdk_surface_new_toplevel (gdk_display_get_default ());
+  renderer = gsk_gl_renderer_new ();
+  if (!gsk_renderer_realize (renderer, surface, &error))
+    {
+      g_test_skip ("No GL renderer");
+      g_clear_error (&error);
+      g_object_unref (renderer);
+      gdk_surface_destroy (surface);
+      g_object_unref (surface);
+      return;
+    }
+
+  survivors = create_text ("Glyphs that survive", 20, 76);
+  gsk_render_node_get_bounds (survivors, &bounds);
+  size = ceil (bounds.origin.x + bounds.size.width) * ceil (bounds.origin.y + bounds.size.height) * 4;
+  filler = create_filler ();
+
+  reference = render (renderer, survivors, &n_evicted, &n_dropped);
+
+  data = render (renderer, filler, &n_evicted, &n_dropped);
+  g_free (data);
+
+  for (i = 0; i < N_AGING_FRAMES; i++)
+    {
+      data = render (renderer, survivors, &n_evicted, &n_dropped);
+      g_assert_cmpmem (data, size, reference, size);
+      g_free (data);
+    }
+
+  if (gsk_profiler_counter_get (gsk_renderer_get_profiler (renderer),
+                                g_quark_from_static_string ("atlases")) == 0)
+    g_test_message ("Built without profiler counters");
+  else
+    g_assert_cmpuint (n_evicted + n_dropped, >, 0);
+
+  g_free (reference);
+  gsk_render_node_unref (survivors);
+  gsk_render_node_unref (filler);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  gdk_surface_destroy (surface);
+  g_object_unref (surface);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/atlas/evict", test_evict);
+
+  return g_test_run ();
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+#include <gtk/gtk.h>
+#include "gsk/gskcairoblurprivate.h"
+
+/* Odd sizes, so that the SIMD kernels have leftover columns */
+static const struct {
+  int width;
+  int height;
+} sizes[] = {
+  { 1, 1 },
+  { 3, 50 },
+  { 67, 45 },
+  { 200, 7 },
+  { 129, 131 },
+};
+
+static cairo_surface_t *
+create_surface (int width,
+                int height)
+{
+  cairo_surface_t *surface;
+  guchar *data;
+  int stride;
+  int x, y;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_A8, width, height);
+  cairo_surface_flush (surface);
+  data = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+
+  /* Hard edges and gradients */
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      data[y * stride + x] = ((x / 5 + y / 3) % 2) ? 255 : (x * 7 + y * 13) % 256;
+
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+/* The row based blur that the kernels replaced, as a reference for
+ * all of them, including the C one
+ */
+static void
+reference_blur_row (guchar *row,
+                    guchar *tmp,
+                    int     width,
+                    int     d,
+                    int     shift)
+{
+  int offset = (d % 2 == 1) ? d / 2 : (d - shift) / 2;
+  int sum = 0;
+  int i;
+
+  for (i = -d + offset; i < width + offset; i++)
+    {
+      if (i >= 0 && i < width)
+        sum += row[i];
+
+      if (i >= offset)
+        {
+          if (i >= d)
+            sum -= row[i - d];
+
+          tmp[i - offset] = (sum + d / 2) / d;
+        }
+    }
+
+  memcpy (row, tmp, width);
+}
+
+static void
+reference_blur_rows (guchar *buffer,
+                     int     width,
+                     int     height,
+                     int     d)
+{
+  guchar *tmp = g_malloc (width);
+  int i;
+
+  for (i = 0; i < height; i++)
+    {
+      guchar *row = buffer + i * width;
+
+      if (d % 2 == 1)
+        {
+          reference_blur_row (row, tmp, width, d, 0);
+          reference_blur_row (row, tmp, width, d, 0);
+          reference_blur_row (row, tmp, width, d, 0);
+        }
+      else
+        {
+          reference_blur_row (row, tmp, width, d, 1);
+          reference_blur_row (row, tmp, width, d, -1);
+          reference_blur_row (row, tmp, width, d + 1, 0);
+        }
+    }
+
+  g_free (tmp);
+}
+
+static void
+reference_flip (guchar       *dst,
+                const guchar *src,
+                int           width,
+                int           height)
+{
+  int x, y;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      dst[x * height + y] = src[y * width + x];
+}
+
+static cairo_surface_t *
+reference_blur (int          width,
+                int          height,
+                int          radius,
+                GskBlurFlags flags)
+{
+  cairo_surface_t *surface;
+  guchar *data, *flipped;
+  int stride, d;
+
+  surface = create_surface (width, height);
+  data = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+  /* Same as get_box_filter_size() */
+  d = (int) ((3.0 * sqrt (2 * G_PI) / 4) * radius);
+
+  if (radius > 1)
+    {
+      flipped = g_malloc (stride * height);
+
+      if (flags & GSK_BLUR_Y)
+        {
+          reference_flip (flipped, data, stride, height);
+          reference_blur_rows (flipped, height, stride, d);
+          reference_flip (data, flipped, height, stride);
+        }
+
+      if (flags & GSK_BLUR_X)
+        reference_blur_rows (data, stride, height, d);
+
+      g_free (flipped);
+    }
+
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+static cairo_surface_t *
+blur (const char   *kernel,
+      int           width,
+      int           height,
+      int           radius,
+      GskBlurFlags  flags)
+{
+  cairo_surface_t *surface;
+
+  g_assert_true (gsk_cairo_blur_set_kernel (kernel));
+
+  surface = create_surface (width, height);
+  gsk_cairo_blur_surface (surface, radius, flags);
+  cairo_surface_flush (surface);
+
+  return surface;
+}
+
+static const GskBlurFlags flags[] = {
+  GSK_BLUR_X,
+  GSK_BLUR_Y,
+  GSK_BLUR_X | GSK_BLUR_Y,
+};
+
+/* All kernels must give exactly the same output as the row based
+ * blur they replaced
+ */
+static void
+test_kernel (gconstpointer data)
+{
+  const char *kernel = data;
+  guint i, f;
+  int radius;
+
+  if (!gsk_cairo_blur_set_kernel (kernel))
+    {
+      g_test_skip ("Kernel not supported on this machine");
+      return;
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      for (f = 0; f < G_N_ELEMENTS (flags); f++)
+        {
+          for (radius = 1; radius <= 16; radius++)
+            {
+              cairo_surface_t *reference, *surface;
+              int stride;
+
+              reference = reference_blur (sizes[i].width, sizes[i].height, radius, flags[f]);
+              surface = blur (kernel, sizes[i].width, sizes[i].height, radius, flags[f]);
+              stride = cairo_image_surface_get_stride (surface);
+
+              g_assert_cmpmem (cairo_image_surface_get_data (surface), stride * sizes[i].height,
+                               cairo_image_surface_get_data (reference), stride * sizes[i].height);
+
+              cairo_surface_destroy (reference);
+              cairo_surface_destroy (surface);
+            }
+        }
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_data_func ("/blur/kernel/avx2", "avx2", test_kernel);
+  g_test_add_data_func ("/blur/kernel/sse2", "sse2", test_kernel);
+  g_test_add_data_func ("/blur/kernel/neon", "neon", test_kernel);
+  g_test_add_data_func ("/blur/kernel/c", "c", test_kernel);
+
+  return g_test_run ();
+}
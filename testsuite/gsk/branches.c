@@ -0,0 +1,166 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gsk/gskdebugprivate.h"
+#include "gsk/gskrendererprivate.h"
+
+#define WIDTH 800
+#define HEIGHT 600
+
+/* A wide container, like a long list, with rows that can be
+ * recorded in branches and some that make their branch fail
+ */
+static GskRenderNode *
+create_tree (void)
+{
+  GtkSnapshot *snapshot;
+  PangoContext *context;
+  PangoLayout *layout;
+  GskRoundedRect outline;
+  char text[64];
+  int i;
+
+  snapshot = gtk_snapshot_new ();
+  context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+  layout = pango_layout_new (context);
+
+  gtk_snapshot_append_color (snapshot, &(GdkRGBA) { 1, 1, 1, 1 },
+                             &GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT));
+
+  for (i = 0; i < 60; i++)
+    {
+      graphene_rect_t row = GRAPHENE_RECT_INIT (0, 10 * i, WIDTH, 10);
+
+      gtk_snapshot_append_color (snapshot, &(GdkRGBA) { i % 2, 0.5, 1 - (i % 3) / 2.0, 1 }, &row);
+
+      gsk_rounded_rect_init_from_rect (&outline, &GRAPHENE_RECT_INIT (5 * i, 10 * i, 200, 10), 3);
+      gtk_snapshot_append_border (snapshot, &outline,
+                                  (float[4]) { 1, 1, 1, 1 },
+                                  (GdkRGBA[4]) {
+                                    { 0, 0, 0, 1 },
+                                    { 0, 0, 0, 1 },
+                                    { 0, 0, 0, 1 },
+                                    { 0, 0, 0, 1 },
+                                  });
+
+      g_snprintf (text, sizeof (text), "Row %d", i);
+      pango_layout_set_text (layout, text, -1);
+      gtk_snapshot_save (snapshot);
+      gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (300, 10 * i));
+      gtk_snapshot_append_layout (snapshot, layout, &(GdkRGBA) { 0, 0, 0, 1 });
+      gtk_snapshot_restore (snapshot);
+
+      /* Needs an offscreen, so its branch is redone serially */
+      if (i % 10 == 5)
+        {
+          gsk_rounded_rect_init_from_rect (&outline, &GRAPHENE_RECT_INIT (500, 10 * i, 100, 10), 5);
+          gtk_snapshot_save (snapshot);
+          gtk_snapshot_rotate (snapshot, 10);
+          gtk_snapshot_push_rounded_clip (snapshot, &outline);
+          gtk_snapshot_append_color (snapshot, &(GdkRGBA) { 0, 1, 0, 1 }, &row);
+          gtk_snapshot_pop (snapshot);
+          gtk_snapshot_restore (snapshot);
+        }
+    }
+
+  g_object_unref (layout);
+  g_object_unref (context);
+
+  return gtk_snapshot_free_to_node (snapshot);
+}
+
+static guchar *
+render (GskRenderNode *node,
+        gboolean       branches)
+{
+  GdkSurface *surface;
+  GskRenderer *renderer;
+  GdkTexture *texture;
+  GError *error = NULL;
+  guchar *data;
+
+  surface = gdk_surface_new_toplevel (gdk_display_get_default ());
+  renderer = gsk_gl_renderer_new ();
+  if (!gsk_renderer_realize (renderer, surface, &error))
+    {
+      g_clear_error (&error);
+      g_object_unref (renderer);
+      gdk_surface_destroy (surface);
+      g_object_unref (surface);
+      return NULL;
+    }
+
+  if (!branches)
+    gsk_renderer_set_debug_flags (renderer,
+                                  gsk_renderer_get_debug_flags (renderer) | GSK_DEBUG_GL_NO_THREADS);
+
+  texture = gsk_renderer_render_texture (renderer, node, &GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT));
+  data = g_malloc (WIDTH * HEIGHT * 4);
+  gdk_texture_download (texture, data, WIDTH * 4);
+
+  g_object_unref (texture);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  gdk_surface_destroy (surface);
+  g_object_unref (surface);
+
+  return data;
+}
+
+/* Recording the children of a container in branches on multiple
+ * threads must give the same pixels as recording them serially
+ */
+static void
+test_compare (void)
+{
+  GskRenderNode *node;
+  guchar *parallel, *serial;
+
+  if (g_get_num_processors () < 2)
+    g_test_message ("Only one processor, branches are not used");
+
+  node = create_tree ();
+
+  serial = render (node, FALSE);
+  if (serial == NULL)
+    {
+      g_test_skip ("No GL renderer");
+      gsk_render_node_unref (node);
+      return;
+    }
+
+  parallel = render (node, TRUE);
+
+  g_assert_cmpmem (parallel, WIDTH * HEIGHT * 4, serial, WIDTH * HEIGHT * 4);
+
+  g_free (parallel);
+  g_free (serial);
+  gsk_render_node_unref (node);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/branches/compare", test_compare);
+
+  return g_test_run ();
+}
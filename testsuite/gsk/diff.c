@@ -0,0 +1,178 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gsk/gskrendernodeprivate.h"
+
+static GskRenderNode *
+create_tree (const GdkRGBA *color)
+{
+  GskRenderNode *children[2];
+  GskRenderNode *container, *node;
+
+  children[0] = gsk_color_node_new (&(GdkRGBA) { 0, 0, 1, 1 },
+                                    &GRAPHENE_RECT_INIT (0, 0, 10, 10));
+  children[1] = gsk_color_node_new (color,
+                                    &GRAPHENE_RECT_INIT (20, 20, 10, 10));
+  container = gsk_container_node_new (children, 2);
+  node = gsk_opacity_node_new (container, 0.5);
+
+  gsk_render_node_unref (children[0]);
+  gsk_render_node_unref (children[1]);
+  gsk_render_node_unref (container);
+
+  return node;
+}
+
+static void
+test_identical (void)
+{
+  GskRenderNode *node1, *node2;
+  cairo_region_t *region;
+  GskDiffStats stats;
+
+  node1 = create_tree (&(GdkRGBA) { 1, 0, 0, 1 });
+  node2 = create_tree (&(GdkRGBA) { 1, 0, 0, 1 });
+
+  g_assert_true (gsk_render_node_get_hash (node1) == gsk_render_node_get_hash (node2));
+  g_assert_true (gsk_render_node_equal (node1, node2));
+
+  region = cairo_region_create ();
+  gsk_render_node_diff_with_stats (node1, node2, region, &stats);
+  g_assert_true (cairo_region_is_empty (region));
+  g_assert_cmpuint (stats.n_pruned, ==, 1);
+
+  cairo_region_destroy (region);
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+}
+
+static void
+test_different (void)
+{
+  GskRenderNode *node1, *node2;
+  cairo_region_t *region;
+
+  node1 = create_tree (&(GdkRGBA) { 1, 0, 0, 1 });
+  node2 = create_tree (&(GdkRGBA) { 0, 1, 0, 1 });
+
+  g_assert_false (gsk_render_node_equal (node1, node2));
+
+  region = cairo_region_create ();
+  gsk_render_node_diff (node1, node2, region);
+  g_assert_true (cairo_region_contains_rectangle (region, &(cairo_rectangle_int_t) { 20, 20, 10, 10 }) == CAIRO_REGION_OVERLAP_IN);
+  g_assert_true (cairo_region_contains_rectangle (region, &(cairo_rectangle_int_t) { 0, 0, 10, 10 }) == CAIRO_REGION_OVERLAP_OUT);
+
+  cairo_region_destroy (region);
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+}
+
+/* gsk_render_node_equal() is not fooled by equal hashes, while
+ * diffs trust them to avoid walking identical subtrees twice
+ */
+static void
+test_collision (void)
+{
+  GskRenderNode *node1, *node2;
+  cairo_region_t *region;
+  GskDiffStats stats;
+
+  node1 = gsk_color_node_new (&(GdkRGBA) { 1, 0, 0, 1 },
+                              &GRAPHENE_RECT_INIT (0, 0, 10, 10));
+  node2 = gsk_color_node_new (&(GdkRGBA) { 0, 1, 0, 1 },
+                              &GRAPHENE_RECT_INIT (0, 0, 10, 10));
+  node2->hash = gsk_render_node_get_hash (node1);
+
+  g_assert_false (gsk_render_node_equal (node1, node2));
+
+  region = cairo_region_create ();
+  gsk_render_node_diff_with_stats (node1, node2, region, &stats);
+  g_assert_cmpuint (stats.n_compared, ==, 1);
+  g_assert_cmpuint (stats.n_pruned, ==, 1);
+
+  cairo_region_destroy (region);
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+}
+
+static void
+diff_trees (GskDiffStats *stats)
+{
+  GskRenderNode *node1, *node2;
+  cairo_region_t *region;
+
+  node1 = create_tree (&(GdkRGBA) { 1, 0, 0, 1 });
+  node2 = create_tree (&(GdkRGBA) { 0, 1, 0, 1 });
+  region = cairo_region_create ();
+
+  gsk_render_node_diff_with_stats (node1, node2, region, stats);
+
+  cairo_region_destroy (region);
+  gsk_render_node_unref (node1);
+  gsk_render_node_unref (node2);
+}
+
+/* Diffs in different threads keep their own stats */
+static gpointer
+diff_thread (gpointer data)
+{
+  const GskDiffStats *expected = data;
+  GskDiffStats stats;
+  int i;
+
+  for (i = 0; i < 1000; i++)
+    {
+      diff_trees (&stats);
+      g_assert_cmpuint (stats.n_compared, ==, expected->n_compared);
+      g_assert_cmpuint (stats.n_pruned, ==, expected->n_pruned);
+    }
+
+  return NULL;
+}
+
+static void
+test_threads (void)
+{
+  GThread *threads[4];
+  GskDiffStats expected;
+  guint i;
+
+  diff_trees (&expected);
+  g_assert_cmpuint (expected.n_pruned, ==, 1);
+
+  for (i = 0; i < G_N_ELEMENTS (threads); i++)
+    threads[i] = g_thread_new ("diff", diff_thread, &expected);
+
+  for (i = 0; i < G_N_ELEMENTS (threads); i++)
+    g_thread_join (threads[i]);
+}
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/diff/identical", test_identical);
+  g_test_add_func ("/diff/different", test_different);
+  g_test_add_func ("/diff/collision", test_collision);
+  g_test_add_func ("/diff/threads", test_threads);
+
+  return g_test_run ();
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gsk/gskdebugprivate.h"
+#include "gsk/gskprofilerprivate.h"
+#include "gsk/gskrendererprivate.h"
+
+#define WIDTH 200
+#define HEIGHT 200
+
+static const GdkRGBA colors[] = {
+  { 1, 0, 0, 1 },
+  { 0, 0, 1, 0.5 },
+};
+
+/* Alternating colors, so that each draw changes the color. With
+ * @overlap, every rectangle covers the one before it, so no draw
+ * may be moved.
+ */
+static GskRenderNode *
+create_tree (gboolean overlap)
+{
+  GskRenderNode *children[32];
+  GskRenderNode *node;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (children); i++)
+    {
+      graphene_rect_t bounds;
+
+      if (overlap)
+        graphene_rect_init (&bounds, 5 * i, 5 * i, 40, 40);
+      else
+        graphene_rect_init (&bounds, 25 * (i % 8), 25 * (i / 8), 20, 20);
+
+      children[i] = gsk_color_node_new (&colors[i % 2], &bounds);
+    }
+
+  node = gsk_container_node_new (children, G_N_ELEMENTS (children));
+
+  for (i = 0; i < G_N_ELEMENTS (children); i++)
+    gsk_render_node_unref (children[i]);
+
+  return node;
+}
+
+static guchar *
+render (GskRenderNode *node,
+        gboolean       merge,
+        guint         *n_draws_recorded,
+        guint         *n_draws)
+{
+  GdkSurface *surface;
+  GskRenderer *renderer;
+  GskProfiler *profiler;
+  GdkTexture *texture;
+  GError *error = NULL;
+  guchar *data;
+
+  surface = gdk_surface_new_toplevel (gdk_display_get_default ());
+  renderer = gsk_gl_renderer_new ();
+  if (!gsk_renderer_realize (renderer, surface, &error))
+    {
+      g_clear_error (&error);
+      g_object_unref (renderer);
+      gdk_surface_destroy (surface);
+      g_object_unref (surface);
+      return NULL;
+    }
+
+  if (!merge)
+    gsk_renderer_set_debug_flags (renderer,
+                                  gsk_renderer_get_debug_flags (renderer) | GSK_DEBUG_GL_NO_MERGE);
+
+  profiler = gsk_renderer_get_profiler (renderer);
+  gsk_profiler_reset (profiler);
+
+  texture = gsk_renderer_render_texture (renderer, node, &GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT));
+  data = g_malloc (WIDTH * HEIGHT * 4);
+  gdk_texture_download (texture, data, WIDTH * 4);
+
+  *n_draws_recorded = gsk_profiler_counter_get (profiler, g_quark_from_static_string ("draws-recorded"));
+  *n_draws = gsk_profiler_counter_get (profiler, g_quark_from_static_string ("draws"));
+
+  g_object_unref (texture);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  gdk_surface_destroy (surface);
+  g_object_unref (surface);
+
+  return data;
+}
+
+/* Merging draws must not change the output, and must only save
+ * draws where they don't overlap
+ */
+static void
+test_merge (gconstpointer data)
+{
+  gboolean overlap = GPOINTER_TO_INT (data);
+  GskRenderNode *node;
+  guchar *merged, *unmerged;
+  guint n_recorded, n_draws, n_unmerged_recorded, n_unmerged_draws;
+
+  node = create_tree (overlap);
+
+  merged = render (node, TRUE, &n_recorded, &n_draws);
+  if (merged == NULL)
+    {
+      g_test_skip ("No GL renderer");
+      gsk_render_node_unref (node);
+      return;
+    }
+  unmerged = render (node, FALSE, &n_unmerged_recorded, &n_unmerged_draws);
+
+  g_assert_cmpmem (merged, WIDTH * HEIGHT * 4, unmerged, WIDTH * HEIGHT * 4);
+
+  if (n_recorded == 0)
+    {
+      g_test_message ("Built without profiler counters");
+    }
+  else
+    {
+      g_assert_cmpuint (n_unmerged_draws, ==, n_unmerged_recorded);
+      g_assert_cmpuint (n_recorded, ==, n_unmerged_recorded);
+      if (overlap)
+        g_assert_cmpuint (n_draws, ==, n_recorded);
+      else
+        g_assert_cmpuint (n_draws, <, n_recorded);
+    }
+
+  g_free (merged);
+  g_free (unmerged);
+  gsk_render_node_unref (node);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_data_func ("/drawmerge/separate", GINT_TO_POINTER (FALSE), test_merge);
+  g_test_add_data_func ("/drawmerge/overlapping", GINT_TO_POINTER (TRUE), test_merge);
+
+  return g_test_run ();
+}
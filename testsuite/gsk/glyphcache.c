@@ -0,0 +1,154 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gsk/gskdebugprivate.h"
+#include "gsk/gskrendererprivate.h"
+
+#define WIDTH 1500
+#define HEIGHT 400
+
+/* Many distinct glyphs at a few sizes, so that there are enough
+ * of them to be rasterized on multiple threads
+ */
+static GskRenderNode *
+create_text (void)
+{
+  GtkSnapshot *snapshot;
+  PangoContext *context;
+  PangoLayout *layout;
+  char text[128];
+  int i, size, height;
+
+  for (i = 0; i < 94; i++)
+    text[i] = '!' + i;
+  text[i] = '\0';
+
+  snapshot = gtk_snapshot_new ();
+  context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+  layout = pango_layout_new (context);
+  pango_layout_set_width (layout, WIDTH * PANGO_SCALE);
+  pango_layout_set_text (layout, text, -1);
+
+  gtk_snapshot_append_color (snapshot, &(GdkRGBA) { 1, 1, 1, 1 },
+                             &GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT));
+
+  for (size = 10; size <= 30; size += 10)
+    {
+      PangoFontDescription *desc;
+
+      desc = pango_font_description_from_string ("Sans");
+      pango_font_description_set_absolute_size (desc, size * PANGO_SCALE);
+      pango_layout_set_font_description (layout, desc);
+      pango_font_description_free (desc);
+
+      gtk_snapshot_append_layout (snapshot, layout, &(GdkRGBA) { 0, 0, 0, 1 });
+      pango_layout_get_pixel_size (layout, NULL, &height);
+      gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (0.25, height));
+    }
+
+  g_object_unref (layout);
+  g_object_unref (context);
+
+  return gtk_snapshot_free_to_node (snapshot);
+}
+
+/* Each renderer gets its own glyph cache, see main(), so all
+ * glyphs are rasterized again for every call
+ */
+static guchar *
+render (GskRenderNode *node,
+        gboolean       threaded)
+{
+  GdkSurface *surface;
+  GskRenderer *renderer;
+  GdkTexture *texture;
+  GError *error = NULL;
+  guchar *data;
+
+  surface = gdk_surface_new_toplevel (gdk_display_get_default ());
+  renderer = gsk_gl_renderer_new ();
+  if (!gsk_renderer_realize (renderer, surface, &error))
+    {
+      g_clear_error (&error);
+      g_object_unref (renderer);
+      gdk_surface_destroy (surface);
+      g_object_unref (surface);
+      return NULL;
+    }
+
+  if (!threaded)
+    gsk_renderer_set_debug_flags (renderer,
+                                  gsk_renderer_get_debug_flags (renderer) | GSK_DEBUG_GL_NO_THREADS);
+
+  texture = gsk_renderer_render_texture (renderer, node, &GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT));
+  data = g_malloc (WIDTH * HEIGHT * 4);
+  gdk_texture_download (texture, data, WIDTH * 4);
+
+  g_object_unref (texture);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  gdk_surface_destroy (surface);
+  g_object_unref (surface);
+
+  return data;
+}
+
+/* Glyphs rasterized on multiple threads must look the same as
+ * glyphs rasterized on the main thread
+ */
+static void
+test_threads (void)
+{
+  GskRenderNode *node;
+  guchar *threaded, *serial;
+
+  if (g_get_num_processors () < 2)
+    g_test_message ("Only one processor, glyphs are not rasterized in threads");
+
+  node = create_text ();
+
+  serial = render (node, FALSE);
+  if (serial == NULL)
+    {
+      g_test_skip ("No GL renderer");
+      gsk_render_node_unref (node);
+      return;
+    }
+
+  threaded = render (node, TRUE);
+
+  g_assert_cmpmem (threaded, WIDTH * HEIGHT * 4, serial, WIDTH * HEIGHT * 4);
+
+  g_free (threaded);
+  g_free (serial);
+  gsk_render_node_unref (node);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_setenv ("GSK_NO_SHARED_CACHES", "1", TRUE);
+
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/glyphcache/threads", test_threads);
+
+  return g_test_run ();
+}
@@ -156,6 +156,29 @@ deserialize_error_func (const GskParseLocation *start,
   g_string_append_c (errors, '\n');
 }
 
+static gboolean
+binary_roundtrip_matches (GskRenderNode *node,
+                          GBytes        *text)
+{
+  GskRenderNode *loaded;
+  GBytes *binary, *reserialized;
+  gboolean result;
+
+  binary = gsk_render_node_serialize_binary (node);
+  loaded = gsk_render_node_deserialize (binary, NULL, NULL);
+  g_bytes_unref (binary);
+  if (loaded == NULL)
+    return FALSE;
+
+  reserialized = gsk_render_node_serialize (loaded);
+  gsk_render_node_unref (loaded);
+
+  result = g_bytes_equal (text, reserialized);
+  g_bytes_unref (reserialized);
+
+  return result;
+}
+
 static gboolean
 parse_node_file (GFile *file, gboolean generate)
 {
@@ -180,6 +203,13 @@ parse_node_file (GFile *file, gboolean generate)
   node = gsk_render_node_deserialize (bytes, deserialize_error_func, errors);
   g_bytes_unref (bytes);
   bytes = gsk_render_node_serialize (node);
+
+  if (!generate && !binary_roundtrip_matches (node, bytes))
+    {
+      g_print ("Binary serialization doesn't match the text serialization\n");
+      result = FALSE;
+    }
+
   gsk_render_node_unref (node);
 
   if (generate)
@@ -240,6 +270,60 @@ parse_node_file (GFile *file, gboolean generate)
   return result;
 }
 
+static GskRenderNode *
+create_deep_node (guint depth)
+{
+  GskRenderNode *node, *child;
+
+  node = gsk_color_node_new (&(GdkRGBA) { 1, 0, 0, 1 }, &GRAPHENE_RECT_INIT (0, 0, 10, 10));
+  while (--depth > 0)
+    {
+      child = node;
+      node = gsk_opacity_node_new (child, 0.5);
+      gsk_render_node_unref (child);
+    }
+
+  return node;
+}
+
+/* The binary format is read recursively, so it limits the depth */
+static gboolean
+test_binary_depth (void)
+{
+  GskRenderNode *node, *loaded;
+  GString *errors;
+  GBytes *binary;
+  gboolean result = TRUE;
+
+  node = create_deep_node (1024);
+  binary = gsk_render_node_serialize_binary (node);
+  gsk_render_node_unref (node);
+  loaded = gsk_render_node_deserialize (binary, NULL, NULL);
+  g_bytes_unref (binary);
+  if (loaded == NULL)
+    {
+      g_print ("Failed to load 1024 levels of nodes\n");
+      result = FALSE;
+    }
+  g_clear_pointer (&loaded, gsk_render_node_unref);
+
+  errors = g_string_new ("");
+  node = create_deep_node (1025);
+  binary = gsk_render_node_serialize_binary (node);
+  gsk_render_node_unref (node);
+  loaded = gsk_render_node_deserialize (binary, deserialize_error_func, errors);
+  g_bytes_unref (binary);
+  if (loaded != NULL || errors->len == 0)
+    {
+      g_print ("Loaded 1025 levels of nodes without an error\n");
+      result = FALSE;
+    }
+  g_clear_pointer (&loaded, gsk_render_node_unref);
+  g_string_free (errors, TRUE);
+
+  return result;
+}
+
 static gboolean
 test_file (GFile *file)
 {
@@ -328,6 +412,10 @@ main (int argc, char **argv)
 
       g_object_unref (dir);
     }
+  else if (strcmp (argv[1], "--binary-depth") == 0)
+    {
+      success = test_binary_depth ();
+    }
   else if (strcmp (argv[1], "--generate") == 0)
     {
       if (argc >= 3)
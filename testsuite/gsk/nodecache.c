@@ -0,0 +1,170 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gsk/gskcaironodecacheprivate.h"
+
+#define WIDTH 1000
+#define HEIGHT 1000
+
+/* An opaque gradient on white, so that drawing it from the cache
+ * gives exactly the same pixels */
+static GskRenderNode *
+create_tree (void)
+{
+  GtkSnapshot *snapshot;
+
+  snapshot = gtk_snapshot_new ();
+
+  gtk_snapshot_append_color (snapshot, &(GdkRGBA) { 1, 1, 1, 1 },
+                             &GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT));
+  gtk_snapshot_append_linear_gradient (snapshot,
+                                       &GRAPHENE_RECT_INIT (10, 10, WIDTH - 20, HEIGHT - 20),
+                                       &GRAPHENE_POINT_INIT (10, 10),
+                                       &GRAPHENE_POINT_INIT (WIDTH - 10, HEIGHT - 10),
+                                       (GskColorStop[]) {
+                                         { 0, { 1, 0, 0, 1 } },
+                                         { 0.5, { 0, 1, 0, 1 } },
+                                         { 1, { 0, 0, 1, 1 } },
+                                       }, 3);
+
+  return gtk_snapshot_free_to_node (snapshot);
+}
+
+/* Draws a frame, only inside @clip if it is given */
+static cairo_surface_t *
+draw (GskCairoNodeCache           *cache,
+      GskRenderNode               *node,
+      const cairo_rectangle_int_t *clip)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
+  cr = cairo_create (surface);
+
+  if (clip)
+    {
+      cairo_rectangle (cr, clip->x, clip->y, clip->width, clip->height);
+      cairo_clip (cr);
+    }
+
+  if (cache)
+    {
+      gsk_cairo_node_cache_prepare (cache, cr, node);
+      gsk_cairo_node_cache_attach (cache, cr);
+    }
+
+  gsk_render_node_draw (node, cr);
+
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  return surface;
+}
+
+static void
+assert_same_pixels (cairo_surface_t             *surface,
+                    cairo_surface_t             *reference,
+                    const cairo_rectangle_int_t *clip)
+{
+  int stride = cairo_image_surface_get_stride (surface);
+  guchar *data = cairo_image_surface_get_data (surface);
+  guchar *ref = cairo_image_surface_get_data (reference);
+  int y;
+
+  for (y = clip->y; y < clip->y + clip->height; y++)
+    g_assert_cmpmem (data + y * stride + clip->x * 4, clip->width * 4,
+                     ref + y * stride + clip->x * 4, clip->width * 4);
+}
+
+/* Unchanged nodes are drawn from the cache from their second
+ * frame on, and look the same */
+static void
+test_hits (void)
+{
+  cairo_rectangle_int_t all = { 0, 0, WIDTH, HEIGHT };
+  GskCairoNodeCache *cache;
+  GskRenderNode *node;
+  cairo_surface_t *reference, *surface;
+  int i;
+
+  node = create_tree ();
+  reference = draw (NULL, node, NULL);
+  cache = gsk_cairo_node_cache_new (32 * 1024 * 1024);
+
+  for (i = 0; i < 3; i++)
+    {
+      surface = draw (cache, node, NULL);
+      assert_same_pixels (surface, reference, &all);
+      cairo_surface_destroy (surface);
+
+      if (i == 0)
+        g_assert_cmpuint (gsk_cairo_node_cache_get_hits (cache), ==, 0);
+      else
+        g_assert_cmpuint (gsk_cairo_node_cache_get_hits (cache), ==, 1);
+    }
+
+  gsk_cairo_node_cache_free (cache);
+  cairo_surface_destroy (reference);
+  gsk_render_node_unref (node);
+}
+
+/* Only the visible part of a node is cached, and it is not used
+ * for drawing more of the node */
+static void
+test_clip (void)
+{
+  cairo_rectangle_int_t all = { 0, 0, WIDTH, HEIGHT };
+  cairo_rectangle_int_t corner = { 0, 0, 100, 100 };
+  GskCairoNodeCache *cache;
+  GskRenderNode *node;
+  cairo_surface_t *reference, *surface;
+
+  node = create_tree ();
+  reference = draw (NULL, node, NULL);
+  cache = gsk_cairo_node_cache_new (32 * 1024 * 1024);
+
+  surface = draw (cache, node, &corner);
+  cairo_surface_destroy (surface);
+  surface = draw (cache, node, &corner);
+  assert_same_pixels (surface, reference, &corner);
+  cairo_surface_destroy (surface);
+  g_assert_cmpuint (gsk_cairo_node_cache_get_hits (cache), ==, 1);
+  g_assert_cmpuint (gsk_cairo_node_cache_get_size (cache), <, WIDTH * HEIGHT);
+
+  surface = draw (cache, node, NULL);
+  assert_same_pixels (surface, reference, &all);
+  cairo_surface_destroy (surface);
+
+  gsk_cairo_node_cache_free (cache);
+  cairo_surface_destroy (reference);
+  gsk_render_node_unref (node);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/nodecache/hits", test_hits);
+  g_test_add_func ("/nodecache/clip", test_clip);
+
+  return g_test_run ();
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include "gsk/gskocclusionprivate.h"
+
+static const GdkRGBA red = { 1, 0, 0, 1 };
+static const GdkRGBA blue = { 0, 0, 1, 1 };
+static const GdkRGBA translucent_blue = { 0, 0, 1, 0.5 };
+
+/* Puts @back behind @front, taking the references */
+static GskRenderNode *
+stack (GskRenderNode *back,
+       GskRenderNode *front)
+{
+  GskRenderNode *children[2] = { back, front };
+  GskRenderNode *container;
+
+  container = gsk_container_node_new (children, 2);
+  gsk_render_node_unref (back);
+  gsk_render_node_unref (front);
+
+  return container;
+}
+
+static GskRenderNode *
+color (const GdkRGBA *rgba,
+       float          x,
+       float          y,
+       float          width,
+       float          height)
+{
+  return gsk_color_node_new (rgba, &GRAPHENE_RECT_INIT (x, y, width, height));
+}
+
+/* Like stack(), these take the references */
+static GskRenderNode *
+opacity (GskRenderNode *child,
+         float          value)
+{
+  GskRenderNode *node = gsk_opacity_node_new (child, value);
+
+  gsk_render_node_unref (child);
+
+  return node;
+}
+
+static GskRenderNode *
+transform (GskRenderNode *child,
+           GskTransform  *matrix)
+{
+  GskRenderNode *node = gsk_transform_node_new (child, matrix);
+
+  gsk_render_node_unref (child);
+  gsk_transform_unref (matrix);
+
+  return node;
+}
+
+/* Culls @root, and checks how many nodes were left out */
+static GskRenderNode *
+cull (GskRenderNode *root,
+      guint          expected)
+{
+  GHashTable *copies = NULL;
+  GskRenderNode *result;
+  guint n_culled;
+
+  result = gsk_occlusion_cull (root, &copies, &n_culled);
+  g_assert_cmpuint (n_culled, ==, expected);
+  g_hash_table_unref (copies);
+
+  return result;
+}
+
+static void
+test_covered (void)
+{
+  GskRenderNode *root, *result;
+
+  root = stack (color (&red, 10, 10, 20, 20), color (&blue, 0, 0, 100, 100));
+  result = cull (root, 1);
+
+  g_assert_true (result != root);
+  g_assert_cmpint (gsk_render_node_get_node_type (result), ==, GSK_CONTAINER_NODE);
+  g_assert_cmpuint (gsk_container_node_get_n_children (result), ==, 1);
+  g_assert_true (gsk_container_node_get_child (result, 0) == gsk_container_node_get_child (root, 1));
+
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+}
+
+static void
+test_partly_covered (void)
+{
+  GskRenderNode *root, *result;
+
+  root = stack (color (&red, 90, 90, 20, 20), color (&blue, 0, 0, 100, 100));
+  result = cull (root, 0);
+  g_assert_true (result == root);
+
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+}
+
+static void
+test_translucent (void)
+{
+  GskRenderNode *root, *result;
+
+  root = stack (color (&red, 10, 10, 20, 20), color (&translucent_blue, 0, 0, 100, 100));
+  result = cull (root, 0);
+  g_assert_true (result == root);
+
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+}
+
+static void
+test_opacity (void)
+{
+  GskRenderNode *root, *result;
+
+  /* Opaque nodes inside translucent ones don't cover anything */
+  root = stack (color (&red, 10, 10, 20, 20),
+                opacity (color (&blue, 0, 0, 100, 100), 0.5));
+  result = cull (root, 0);
+  g_assert_true (result == root);
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+
+  root = stack (color (&red, 10, 10, 20, 20),
+                opacity (color (&blue, 0, 0, 100, 100), 1.0));
+  result = cull (root, 1);
+  g_assert_true (result != root);
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+}
+
+static void
+test_transform (void)
+{
+  GskRenderNode *root, *result;
+
+  /* Scaled up, the front node covers the back one */
+  root = stack (color (&red, 60, 60, 20, 20),
+                transform (color (&blue, 0, 0, 50, 50),
+                           gsk_transform_scale (NULL, 2, 2)));
+  result = cull (root, 1);
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+
+  /* A covered node inside a translation */
+  root = stack (transform (color (&red, 0, 0, 10, 10),
+                           gsk_transform_translate (NULL, &GRAPHENE_POINT_INIT (50, 50))),
+                color (&blue, 40, 40, 30, 30));
+  result = cull (root, 1);
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+
+  /* Rotated, it is not looked at */
+  root = stack (color (&red, 0, 0, 10, 10),
+                transform (color (&blue, -100, -100, 200, 200),
+                           gsk_transform_rotate (NULL, 45)));
+  result = cull (root, 0);
+  g_assert_true (result == root);
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+}
+
+static void
+test_rounded_clip (void)
+{
+  GskRenderNode *front, *back, *root, *result;
+  GskRoundedRect clip;
+
+  gsk_rounded_rect_init_from_rect (&clip, &GRAPHENE_RECT_INIT (0, 0, 100, 100), 20);
+  back = color (&blue, 0, 0, 100, 100);
+  front = gsk_rounded_clip_node_new (back, &clip);
+  gsk_render_node_unref (back);
+
+  /* The corners are not covered, the middle is */
+  back = stack (color (&red, 0, 0, 10, 10), color (&red, 40, 40, 20, 20));
+  root = stack (back, gsk_render_node_ref (front));
+  result = cull (root, 1);
+
+  g_assert_true (result != root);
+  back = gsk_container_node_get_child (result, 0);
+  g_assert_cmpint (gsk_render_node_get_node_type (back), ==, GSK_CONTAINER_NODE);
+  g_assert_cmpuint (gsk_container_node_get_n_children (back), ==, 1);
+
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+  gsk_render_node_unref (front);
+}
+
+static void
+test_clip (void)
+{
+  GskRenderNode *child, *front, *root, *result;
+
+  /* Only the clipped part of the front node covers */
+  child = color (&blue, 0, 0, 100, 100);
+  front = gsk_clip_node_new (child, &GRAPHENE_RECT_INIT (0, 0, 50, 100));
+  gsk_render_node_unref (child);
+  root = stack (color (&red, 60, 10, 20, 20), front);
+  result = cull (root, 0);
+  g_assert_true (result == root);
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+}
+
+static void
+test_reuse (void)
+{
+  GskRenderNode *back, *root, *result, *next;
+  GHashTable *copies = NULL;
+  guint n_culled;
+
+  back = stack (color (&red, 10, 10, 20, 20), color (&red, 200, 200, 20, 20));
+  root = stack (back, color (&blue, 0, 0, 100, 100));
+
+  result = gsk_occlusion_cull (root, &copies, &n_culled);
+  g_assert_cmpuint (n_culled, ==, 1);
+  g_assert_true (result != root);
+
+  /* The same tree gives the same copies */
+  next = gsk_occlusion_cull (root, &copies, &n_culled);
+  g_assert_cmpuint (n_culled, ==, 1);
+  g_assert_true (next == result);
+  g_assert_true (gsk_container_node_get_child (next, 0) == gsk_container_node_get_child (result, 0));
+  gsk_render_node_unref (next);
+
+  /* Without culling, nothing is copied */
+  gsk_render_node_unref (root);
+  root = stack (color (&red, 200, 200, 20, 20), color (&blue, 0, 0, 100, 100));
+  next = gsk_occlusion_cull (root, &copies, &n_culled);
+  g_assert_cmpuint (n_culled, ==, 0);
+  g_assert_true (next == root);
+  g_assert_cmpuint (g_hash_table_size (copies), ==, 0);
+
+  gsk_render_node_unref (next);
+  gsk_render_node_unref (result);
+  gsk_render_node_unref (root);
+  g_hash_table_unref (copies);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/occlusion/covered", test_covered);
+  g_test_add_func ("/occlusion/partly-covered", test_partly_covered);
+  g_test_add_func ("/occlusion/translucent", test_translucent);
+  g_test_add_func ("/occlusion/opacity", test_opacity);
+  g_test_add_func ("/occlusion/transform", test_transform);
+  g_test_add_func ("/occlusion/clip", test_clip);
+  g_test_add_func ("/occlusion/rounded-clip", test_rounded_clip);
+  g_test_add_func ("/occlusion/reuse", test_reuse);
+
+  return g_test_run ();
+}
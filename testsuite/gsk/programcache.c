@@ -0,0 +1,178 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gtk/gtk.h>
+
+#define WIDTH 64
+#define HEIGHT 64
+
+static guchar *
+render (void)
+{
+  GdkSurface *surface;
+  GskRenderer *renderer;
+  GskRenderNode *node;
+  GdkTexture *texture;
+  GError *error = NULL;
+  guchar *data;
+
+  surface = gdk_surface_new_toplevel (gdk_display_get_default ());
+  renderer = gsk_gl_renderer_new ();
+  if (!gsk_renderer_realize (renderer, surface, &error))
+    {
+      g_clear_error (&error);
+      g_object_unref (renderer);
+      gdk_surface_destroy (surface);
+      g_object_unref (surface);
+      return NULL;
+    }
+
+  node = gsk_linear_gradient_node_new (&GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT),
+                                       &GRAPHENE_POINT_INIT (0, 0),
+                                       &GRAPHENE_POINT_INIT (WIDTH, HEIGHT),
+                                       (GskColorStop[]) {
+                                         { 0, { 1, 0, 0, 1 } },
+                                         { 1, { 0, 0, 1, 1 } },
+                                       }, 2);
+  texture = gsk_renderer_render_texture (renderer, node, &GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT));
+  data = g_malloc (WIDTH * HEIGHT * 4);
+  gdk_texture_download (texture, data, WIDTH * 4);
+
+  g_object_unref (texture);
+  gsk_render_node_unref (node);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  gdk_surface_destroy (surface);
+  g_object_unref (surface);
+
+  return data;
+}
+
+/* Overwrites everything after the header of each cached program,
+ * and returns the paths */
+static GPtrArray *
+corrupt_cached_programs (const char *dir_path)
+{
+  GPtrArray *paths;
+  const char *name;
+  GDir *dir;
+
+  paths = g_ptr_array_new_with_free_func (g_free);
+  dir = g_dir_open (dir_path, 0, NULL);
+  if (dir == NULL)
+    return paths;
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      char *path = g_build_filename (dir_path, name, NULL);
+      char *contents;
+      gsize length, i;
+
+      g_assert_true (g_file_get_contents (path, &contents, &length, NULL));
+      /* Magic and format */
+      for (i = 12; i < length; i++)
+        contents[i] = (char) (i * 31 + 7);
+      g_assert_true (g_file_set_contents (path, contents, length, NULL));
+      g_free (contents);
+
+      g_ptr_array_add (paths, path);
+    }
+
+  g_dir_close (dir);
+
+  return paths;
+}
+
+/* A cached program that the driver rejects is compiled again,
+ * and replaced in the cache
+ */
+static void
+test_corrupt (void)
+{
+  char *dir_path;
+  GPtrArray *paths;
+  guchar *reference, *data;
+  guint i;
+
+  if (g_getenv ("GSK_NO_PROGRAM_CACHE"))
+    {
+      g_test_skip ("Program cache is turned off");
+      return;
+    }
+
+  reference = render ();
+  if (reference == NULL)
+    {
+      g_test_skip ("No GL renderer");
+      return;
+    }
+
+  dir_path = g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "gl-programs", NULL);
+  paths = corrupt_cached_programs (dir_path);
+  if (paths->len == 0)
+    {
+      g_test_skip ("Program binaries are not supported");
+      goto out;
+    }
+
+  data = render ();
+  g_assert_cmpmem (data, WIDTH * HEIGHT * 4, reference, WIDTH * HEIGHT * 4);
+  g_free (data);
+
+  /* Rejected programs were removed, the new binaries saved */
+  for (i = 0; i < paths->len; i++)
+    {
+      const char *path = g_ptr_array_index (paths, i);
+      char *contents;
+      gsize length, j;
+      gboolean corrupt = TRUE;
+
+      if (!g_file_get_contents (path, &contents, &length, NULL))
+        continue;
+
+      for (j = 12; j < length; j++)
+        {
+          if (contents[j] != (char) (j * 31 + 7))
+            {
+              corrupt = FALSE;
+              break;
+            }
+        }
+      g_assert_false (corrupt);
+      g_free (contents);
+    }
+
+out:
+  g_ptr_array_unref (paths);
+  g_free (dir_path);
+  g_free (reference);
+}
+
+int
+main (int argc, char *argv[])
+{
+  /* Keeps the program cache in a temporary directory */
+  g_test_init (&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+  gtk_init ();
+
+  g_test_add_func ("/programcache/corrupt", test_corrupt);
+
+  return g_test_run ();
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gtk/gtk.h>
+#include "gsk/gskcairoblurprivate.h"
+
+#define SIZE 64
+
+/* Draws a blurred outset shadow around @x, @y, @width, @height
+ * and returns the alpha of each pixel
+ */
+static guchar *
+draw_outset_shadow (float x,
+                    float y,
+                    float width,
+                    float height)
+{
+  GskRoundedRect outline;
+  GskRenderNode *node;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  guchar *alpha;
+  guchar *data;
+  int stride;
+  int i, j;
+
+  gsk_rounded_rect_init_from_rect (&outline, &GRAPHENE_RECT_INIT (x, y, width, height), 4);
+  node = gsk_outset_shadow_node_new (&outline, &(GdkRGBA) { 0, 0, 0, 1 }, 0, 0, 0, 6);
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, SIZE, SIZE);
+  cr = cairo_create (surface);
+  gsk_render_node_draw (node, cr);
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  data = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+  alpha = g_new (guchar, SIZE * SIZE);
+  for (j = 0; j < SIZE; j++)
+    for (i = 0; i < SIZE; i++)
+      alpha[j * SIZE + i] = ((guint32 *) (data + j * stride))[i] >> 24;
+
+  cairo_surface_destroy (surface);
+  gsk_render_node_unref (node);
+
+  return alpha;
+}
+
+/* Boxes at fractional positions must not be snapped to whole
+ * pixels, which is what happens when they are drawn from a
+ * mask that was made for a pixel-aligned box.
+ */
+static void
+test_fractional (void)
+{
+  guchar *fractional, *snapped, *left, *right;
+  gboolean different = FALSE;
+  int x, y, i;
+
+  fractional = draw_outset_shadow (20.5, 20.5, 20, 20);
+  snapped = draw_outset_shadow (20, 20, 21, 21);
+  left = draw_outset_shadow (20, 20, 20, 20);
+  right = draw_outset_shadow (21, 21, 20, 20);
+
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      {
+        i = y * SIZE + x;
+
+        /* The boxes themselves are cut out differently */
+        if ((x < 20 || x >= 41 || y < 20 || y >= 41) &&
+            fractional[i] != snapped[i])
+          different = TRUE;
+
+        /* Half a pixel off is about halfway between the neighbours */
+        g_assert_cmpint (ABS (fractional[i] - (left[i] + right[i]) / 2), <=, 8);
+      }
+
+  g_assert_true (different);
+
+  g_free (fractional);
+  g_free (snapped);
+  g_free (left);
+  g_free (right);
+}
+
+/* Pixel-aligned boxes are drawn from cached masks, which must give
+ * the same result for the same box, wherever it is
+ */
+static void
+test_aligned (void)
+{
+  guchar *first, *second;
+  int x, y;
+
+  first = draw_outset_shadow (16, 16, 20, 20);
+  second = draw_outset_shadow (17, 18, 20, 20);
+
+  for (y = 0; y < SIZE - 2; y++)
+    for (x = 0; x < SIZE - 1; x++)
+      g_assert_cmpint (first[y * SIZE + x], ==, second[(y + 2) * SIZE + x + 1]);
+
+  g_free (first);
+  g_free (second);
+}
+
+/* Blurs the box as a whole, like the shadow code does when it
+ * doesn't use any of its caches
+ */
+static guchar *
+blur_box (float x,
+          float y,
+          float width,
+          float height)
+{
+  GskRoundedRect outline;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  guchar *alpha;
+  guchar *data;
+  int stride;
+  int j;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_A8, SIZE, SIZE);
+  cr = cairo_create (surface);
+  gsk_rounded_rect_init_from_rect (&outline, &GRAPHENE_RECT_INIT (x, y, width, height), 4);
+  gsk_rounded_rect_path (&outline, cr);
+  cairo_fill (cr);
+  cairo_destroy (cr);
+
+  gsk_cairo_blur_surface (surface, 6, GSK_BLUR_X | GSK_BLUR_Y);
+  cairo_surface_flush (surface);
+
+  data = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+  alpha = g_new (guchar, SIZE * SIZE);
+  for (j = 0; j < SIZE; j++)
+    memcpy (alpha + j * SIZE, data + j * stride, SIZE);
+
+  cairo_surface_destroy (surface);
+
+  return alpha;
+}
+
+/* Both the nine-slice cache for aligned boxes and the corner masks
+ * for the others must look like the box blurred as a whole
+ */
+static void
+test_slices (gconstpointer data)
+{
+  const graphene_rect_t *rect = data;
+  guchar *sliced, *blurred;
+  int x, y, i;
+
+  sliced = draw_outset_shadow (rect->origin.x, rect->origin.y, rect->size.width, rect->size.height);
+  blurred = blur_box (rect->origin.x, rect->origin.y, rect->size.width, rect->size.height);
+
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      {
+        /* The box itself is cut out of the shadow */
+        if (x >= floor (rect->origin.x) && x < ceil (rect->origin.x + rect->size.width) &&
+            y >= floor (rect->origin.y) && y < ceil (rect->origin.y + rect->size.height))
+          continue;
+
+        i = y * SIZE + x;
+        g_assert_cmpint (ABS (sliced[i] - blurred[i]), <=, 2);
+      }
+
+  g_free (sliced);
+  g_free (blurred);
+}
+
+static const graphene_rect_t aligned_box = { { 20, 20 }, { 24, 20 } };
+static const graphene_rect_t fractional_box = { { 20.25, 19.5 }, { 23.5, 20.75 } };
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/shadow/outset/fractional", test_fractional);
+  g_test_add_func ("/shadow/outset/aligned", test_aligned);
+  g_test_add_data_func ("/shadow/outset/slices/aligned", &aligned_box, test_slices);
+  g_test_add_data_func ("/shadow/outset/slices/fractional", &fractional_box, test_slices);
+
+  return g_test_run ();
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright © 2021 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gtk/gtk.h>
+#include "gsk/gskdebugprivate.h"
+#include "gsk/gskrendererprivate.h"
+
+#define WIDTH 1000
+#define HEIGHT 700
+
+/* Lots of text, and nodes that cross the tile edges */
+static GskRenderNode *
+create_tree (void)
+{
+  GtkSnapshot *snapshot;
+  PangoContext *context;
+  PangoLayout *layout;
+  GskRoundedRect outline;
+  GString *text;
+  int i;
+
+  snapshot = gtk_snapshot_new ();
+
+  gtk_snapshot_append_color (snapshot, &(GdkRGBA) { 1, 1, 1, 1 },
+                             &GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT));
+
+  gtk_snapshot_append_linear_gradient (snapshot,
+                                       &GRAPHENE_RECT_INIT (100, 100, 700, 300),
+                                       &GRAPHENE_POINT_INIT (100, 100),
+                                       &GRAPHENE_POINT_INIT (800, 400),
+                                       (GskColorStop[]) {
+                                         { 0, { 1, 0, 0, 1 } },
+                                         { 1, { 0, 0, 1, 0.5 } },
+                                       }, 2);
+
+  for (i = 0; i < 20; i++)
+    {
+      gsk_rounded_rect_init_from_rect (&outline, &GRAPHENE_RECT_INIT (33 * i + 0.5, 29 * i + 0.25, 230, 110), 12);
+      gtk_snapshot_append_border (snapshot, &outline,
+                                  (float[4]) { 1, 2, 3, 4 },
+                                  (GdkRGBA[4]) {
+                                    { 0, 0, 0, 1 },
+                                    { 0, 0.5, 0, 1 },
+                                    { 0, 0, 0.5, 1 },
+                                    { 0.5, 0, 0, 1 },
+                                  });
+    }
+
+  context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+  layout = pango_layout_new (context);
+  text = g_string_new (NULL);
+  for (i = 0; i < 40; i++)
+    g_string_append_printf (text, "Line %d: The quick brown fox jumps over the lazy dog, %d times\n", i, i * 17);
+  pango_layout_set_text (layout, text->str, text->len);
+
+  gsk_rounded_rect_init_from_rect (&outline, &GRAPHENE_RECT_INIT (10, 10, WIDTH - 20, HEIGHT - 20), 40);
+  gtk_snapshot_push_rounded_clip (snapshot, &outline);
+  gtk_snapshot_push_opacity (snapshot, 0.8);
+  gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (20.5, 15));
+  gtk_snapshot_append_layout (snapshot, layout, &(GdkRGBA) { 0, 0, 0, 1 });
+  gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (480, 0));
+  gtk_snapshot_scale (snapshot, 1.5, 1.5);
+  gtk_snapshot_append_layout (snapshot, layout, &(GdkRGBA) { 0.2, 0.4, 0.6, 1 });
+  gtk_snapshot_pop (snapshot);
+  gtk_snapshot_pop (snapshot);
+
+  g_string_free (text, TRUE);
+  g_object_unref (layout);
+  g_object_unref (context);
+
+  return gtk_snapshot_free_to_node (snapshot);
+}
+
+static guchar *
+render (GskRenderNode *node,
+        gboolean       tiled)
+{
+  GdkSurface *surface;
+  GskRenderer *renderer;
+  GdkTexture *texture;
+  GError *error = NULL;
+  guchar *data;
+
+  surface = gdk_surface_new_toplevel (gdk_display_get_default ());
+  renderer = gsk_cairo_renderer_new ();
+  gsk_renderer_realize (renderer, surface, &error);
+  g_assert_no_error (error);
+
+  if (!tiled)
+    gsk_renderer_set_debug_flags (renderer,
+                                  gsk_renderer_get_debug_flags (renderer) | GSK_DEBUG_CAIRO_NO_THREADS);
+
+  texture = gsk_renderer_render_texture (renderer, node, &GRAPHENE_RECT_INIT (0, 0, WIDTH, HEIGHT));
+  data = g_malloc (WIDTH * HEIGHT * 4);
+  gdk_texture_download (texture, data, WIDTH * 4);
+
+  g_object_unref (texture);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  gdk_surface_destroy (surface);
+  g_object_unref (surface);
+
+  return data;
+}
+
+/* Drawing in tiles on multiple threads must give the same
+ * pixels as drawing everything at once
+ */
+static void
+test_compare (void)
+{
+  GskRenderNode *node;
+  guchar *tiled, *serial;
+
+  if (g_get_num_processors () < 2)
+    g_test_message ("Only one processor, tiling is not used");
+
+  node = create_tree ();
+
+  serial = render (node, FALSE);
+  tiled = render (node, TRUE);
+
+  g_assert_cmpmem (tiled, WIDTH * HEIGHT * 4, serial, WIDTH * HEIGHT * 4);
+
+  g_free (tiled);
+  g_free (serial);
+  gsk_render_node_unref (node);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/tiling/compare", test_compare);
+
+  return g_test_run ();
+}